@@ -8,5 +8,7 @@ namespace DebugSettings
     bool EnemiesFrozen = false;
     bool PlayersInvuln = false;
     bool DisableMusic = false;
+    Serial::StreamFormat NetworkStreamFormat = Serial::StreamFormat::Binary;
+    Serial::StreamFormat SaveStreamFormat = Serial::StreamFormat::Binary;
     ItemGenerationType itemGenerationType = ItemGenerationType::Normal;
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <serial/streamformat.h>
 
 namespace DebugSettings
 {
@@ -9,6 +10,10 @@ namespace DebugSettings
     extern bool PlayersInvuln;
     extern bool DisableMusic;
 
+    // Text streams can be selected here to make network traffic and saves human readable when debugging
+    extern Serial::StreamFormat NetworkStreamFormat;
+    extern Serial::StreamFormat SaveStreamFormat;
+
     enum class ItemGenerationType
     {
         Normal,
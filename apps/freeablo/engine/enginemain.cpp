@@ -2,6 +2,7 @@
 #include "../faaudio/audiomanager.h"
 #include "../fagui/guimanager.h"
 #include "../falevelgen/levelgen.h"
+#include "../farender/spriteloader.h"
 #include "../fasavegame/gameloader.h"
 #include "../faworld/enums.h"
 #include "../faworld/itemfactory.h"
@@ -19,9 +20,10 @@
 #include <functional>
 #include <input/inputmanager.h>
 #include <iostream>
+#include <misc/mappedfile.h>
 #include <misc/misc.h>
 #include <random/random.h>
-#include <serial/textstream.h>
+#include <serial/streamformat.h>
 #include <thread>
 
 namespace Engine
@@ -43,9 +45,16 @@ namespace Engine
 
         Cel::CelDecoder::loadConfigFiles();
 
-        auto resolutionWidth = mSettings.get<size_t>("Display", "resolutionWidth");
-        auto resolutionHeight = mSettings.get<size_t>("Display", "resolutionHeight");
-        const bool fullscreen = mSettings.get<bool>("Display", "fullscreen");
+        Render::RenderSettings renderSettings = {};
+        renderSettings.windowWidth = mSettings.get<int32_t>("Display", "resolutionWidth");
+        renderSettings.windowHeight = mSettings.get<int32_t>("Display", "resolutionHeight");
+        renderSettings.fullscreen = mSettings.get<bool>("Display", "fullscreen");
+
+        std::string rendererName = mSettings.get<std::string>("Display", "renderer", "opengl");
+        if (rendererName == "software")
+            renderSettings.renderer = Render::RenderInstance::Type::Software;
+        else if (rendererName != "opengl")
+            message_and_abort_fmt("Unknown renderer \"%s\", expected \"opengl\" or \"software\"\n", rendererName.c_str());
 
         auto pathEXE = mSettings.get<std::string>("Game", "PathEXE");
         if (pathEXE.empty())
@@ -55,8 +64,8 @@ namespace Engine
             return;
 
         Engine::ThreadManager threadManager;
-        FARender::Renderer renderer(*mExe, resolutionWidth, resolutionHeight, fullscreen);
-        renderer.mSpriteLoader.load();
+        FARender::Renderer renderer(*mExe, renderSettings);
+        renderer.mSpriteLoader.load(mSettings.get<bool>("Display", "indexedSprites", false));
 
         mInputManager = std::make_shared<EngineInputManager>(renderer.getNuklearContext());
         mInputManager->registerKeyboardObserver(this);
@@ -66,6 +75,89 @@ namespace Engine
         mainThread.join();
     }
 
+    void EngineMain::runDedicatedServer(const DedicatedServerOptions& options)
+    {
+        if (!mSettings.loadUserSettings())
+            return;
+
+        Cel::CelDecoder::loadConfigFiles();
+
+        auto pathEXE = mSettings.get<std::string>("Game", "PathEXE");
+        if (pathEXE.empty())
+            pathEXE = "Diablo.exe";
+        mExe = std::make_unique<DiabloExe::DiabloExe>(pathEXE);
+        if (!mExe->isLoaded())
+            return;
+
+        ThreadManager threadManager(true);
+        FARender::SpriteLoader spriteLoader(*mExe);
+        spriteLoader.loadHeadless();
+
+        uint32_t seed = options.seed != 0 ? options.seed : uint32_t(time(nullptr));
+
+        mWorld = std::make_unique<FAWorld::World>(*mExe, seed);
+        mPlayerFactory = std::make_unique<FAWorld::PlayerFactory>(*mExe, mWorld->getItemFactory());
+        mLocalInputHandler = std::make_unique<LocalInputHandler>(*mWorld);
+
+        mWorld->generateLevels();
+
+        auto server = std::make_unique<Server>(*mWorld, *mLocalInputHandler, options.port, options.maxPeers);
+        Server& serverRef = *server;
+        mMultiplayer = std::move(server);
+        mInGame = true;
+
+        std::cout << "Dedicated server listening on port " << options.port << " for up to " << options.maxPeers << " players, seed " << seed << std::endl;
+
+        using clock = std::chrono::steady_clock;
+
+        // Scheduled from a fixed start point rather than from the end of the last tick, so we don't drift
+        const clock::duration tickDuration = std::chrono::duration_cast<clock::duration>(std::chrono::seconds(1)) / FAWorld::World::ticksPerSecond;
+        const FAWorld::Tick statsIntervalTicks = FAWorld::World::getTicksInPeriod(options.statsIntervalSeconds);
+
+        clock::time_point nextTickTime = clock::now();
+        clock::duration busyTime = clock::duration::zero();
+        int64_t frames = 0;
+
+        while (!mDone)
+        {
+            clock::time_point frameStartTime = clock::now();
+
+            mMultiplayer->update();
+
+            std::optional<std::vector<FAWorld::PlayerInput>> inputs;
+            while ((inputs = mMultiplayer->getAndClearInputs(mWorld->getCurrentTick())))
+            {
+                mMultiplayer->verify(mWorld->getCurrentTick());
+                mWorld->update(false, *inputs);
+
+                if (options.statsIntervalSeconds > 0 && mWorld->getCurrentTick() % statsIntervalTicks == 0)
+                {
+                    double busyPercent = frames ? 100.0 * std::chrono::duration<double>(busyTime).count() /
+                                                      (std::chrono::duration<double>(tickDuration).count() * double(frames))
+                                                : 0.0;
+
+                    std::cout << "[server] " << serverRef.getStatsString() << " | load " << int32_t(busyPercent) << "%" << std::endl;
+
+                    busyTime = clock::duration::zero();
+                    frames = 0;
+                }
+            }
+
+            busyTime += clock::now() - frameStartTime;
+            frames++;
+
+            nextTickTime += tickDuration;
+            if (nextTickTime < clock::now())
+                nextTickTime = clock::now(); // Don't try to catch up after a stall, just carry on from here
+            else
+                std::this_thread::sleep_until(nextTickTime);
+        }
+
+        // These hold pointers into the sprite loader, so they need to go first
+        mMultiplayer.reset();
+        mWorld.reset();
+    }
+
     void EngineMain::runGameLoop(const cxxopts::ParseResult& variables)
     {
         FARender::Renderer& renderer = *FARender::Renderer::get();
@@ -149,6 +241,7 @@ namespace Engine
                         if (mWorld->getCurrentLevelIndex() != lastLevelIndex)
                         {
                             mWorld->playLevelMusic(mWorld->getCurrentLevelIndex());
+                            mWorld->preloadLevelSounds(mWorld->getCurrentLevelIndex());
                             lastLevelIndex = mWorld->getCurrentLevelIndex();
                         }
                     }
@@ -163,35 +256,33 @@ namespace Engine
                 mMultiplayer->doMultiplayerGui(ctx);
 
             FARender::RenderState* state = renderer.getFreeState();
-            if (state)
+            if (mWorld->getCurrentPlayer())
             {
-                if (mWorld->getCurrentPlayer())
-                {
-                    FAWorld::GameLevel* level = mWorld->getCurrentLevel();
-                    if (level != nullptr)
-                        state->tileset = renderer.getTileset(*level);
-                    state->mPos = mWorld->getCurrentPlayer()->getPos();
-                    state->level = level;
-                    mWorld->fillRenderState(state, mLocalInputHandler->getHoverStatus());
-                }
-                else
-                    state->level = nullptr;
-
-                state->currentCursor = renderer.mDefaultCursor.get();
-                if (!mPaused && mWorld->getCurrentPlayer())
-                {
-                    if (const FAWorld::Item* item = mWorld->getCurrentPlayer()->mInventory.getCursorHeld())
-                        state->currentCursor = item->getInventoryIconCursor();
-                }
+                FAWorld::GameLevel* level = mWorld->getCurrentLevel();
+                if (level != nullptr)
+                    state->tileset = renderer.getTileset(*level);
+                state->mPos = mWorld->getCurrentPlayer()->getPos();
+                state->level = level;
+                mWorld->fillRenderState(state, mLocalInputHandler->getHoverStatus());
+            }
+            else
+                state->level = nullptr;
 
-                state->nuklearData.fill(ctx);
-                state->debugData = std::move(renderer.mTmpDebugRenderData);
+            state->currentCursor = renderer.mDefaultCursor.get();
+            if (!mPaused && mWorld->getCurrentPlayer())
+            {
+                if (const FAWorld::Item* item = mWorld->getCurrentPlayer()->mInventory.getCursorHeld())
+                    state->currentCursor = item->getInventoryIconCursor();
             }
 
-            nk_clear(ctx);
+            state->nuklearData.fill(ctx);
+
+            // Swap rather than move, so both vectors keep their capacity
+            std::swap(state->debugData, renderer.mTmpDebugRenderData);
+            renderer.mTmpDebugRenderData.clear();
 
-            if (state)
-                renderer.setCurrentState(state);
+            nk_clear(ctx);
+            renderer.setCurrentState(state);
 
             clock::time_point frameEndTargetTime = frameStartTime + std::chrono::milliseconds(1000 / FAWorld::World::ticksPerSecond);
             clock::duration remainingTickTime = frameEndTargetTime - clock::now();
@@ -256,21 +347,11 @@ namespace Engine
 
     void EngineMain::startGameFromSave(const std::string& savePath)
     {
-        FILE* saveFile = fopen(savePath.c_str(), "rb");
-        release_assert(saveFile);
-
-        fseek(saveFile, 0, SEEK_END);
-        size_t size = ftell(saveFile);
-        fseek(saveFile, 0, SEEK_SET);
+        Misc::MappedFile saveFile(savePath);
+        release_assert(saveFile.isOpen());
 
-        std::string tmp;
-        tmp.resize(size);
-
-        fread((void*)tmp.data(), 1, size, saveFile);
-        fclose(saveFile);
-
-        Serial::TextReadStream stream(tmp);
-        FASaveGame::GameLoader loader(stream);
+        std::unique_ptr<Serial::ReadStreamInterface> stream = Serial::createReadStream(saveFile.data(), saveFile.size());
+        FASaveGame::GameLoader loader(*stream);
 
         mWorld->load(loader);
         mWorld->setFirstPlayerAsCurrent();
@@ -285,7 +366,11 @@ namespace Engine
 
     bool EngineMain::isPaused() const { return mPaused; }
 
-    void EngineMain::stop() { mDone = true; }
+    void EngineMain::stop()
+    {
+        static_assert(std::atomic<bool>::is_always_lock_free, "stop() is called from a signal handler");
+        mDone = true;
+    }
 
     void EngineMain::togglePause() { mPaused = !mPaused; }
 
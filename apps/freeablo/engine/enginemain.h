@@ -1,6 +1,7 @@
 #pragma once
 #include "../faworld/playerfactory.h"
 #include "engineinputmanager.h"
+#include <atomic>
 #include <memory>
 #include <settings/settings.h>
 
@@ -29,12 +30,22 @@ namespace Engine
     class LocalInputHandler;
     class MultiplayerInterface;
 
+    struct DedicatedServerOptions
+    {
+        uint16_t port = 6666;
+        size_t maxPeers = 32;
+        uint32_t seed = 0; ///< 0 means pick one from the current time
+        int32_t statsIntervalSeconds = 10;
+    };
+
     class EngineMain : public KeyboardInputObserverInterface
     {
     public:
         EngineMain();
         ~EngineMain() override;
         void run(const cxxopts::ParseResult& variables);
+        // Hosts a game with no window, audio or local player, until stop() is called
+        void runDedicatedServer(const DedicatedServerOptions& options);
         void stop();
         void togglePause();
         void toggleNoclip();
@@ -65,7 +76,7 @@ namespace Engine
         std::unique_ptr<DiabloExe::DiabloExe> mExe;
         std::unique_ptr<FAWorld::PlayerFactory> mPlayerFactory;
         std::unique_ptr<FAGui::GuiManager> mGuiManager;
-        bool mDone = false;
+        std::atomic<bool> mDone = false; // atomic as stop() is also called from the dedicated server's signal handler
         bool mPaused = false;
         bool mNoclip = false;
         bool mInGame = false;
@@ -0,0 +1,178 @@
+#include "headlessbenchmark.h"
+#include "../farender/spriteloader.h"
+#include "../faworld/gamelevel.h"
+#include "../faworld/monster.h"
+#include "../faworld/player.h"
+#include "../faworld/playerfactory.h"
+#include "../faworld/simprofile.h"
+#include "../faworld/world.h"
+#include "debugsettings.h"
+#include "enginemain.h"
+#include "threadmanager.h"
+#include <algorithm>
+#include <cel/celdecoder.h>
+#include <chrono>
+#include <diabloexe/diabloexe.h>
+#include <diabloexe/monster.h>
+#include <random>
+#include <settings/settings.h>
+
+namespace Engine
+{
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+
+        double toMilliseconds(Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); }
+
+        Misc::Point randomPassablePoint(FAWorld::GameLevel& level, std::mt19937& random)
+        {
+            Misc::Point point(int32_t(random() % uint32_t(level.width())), int32_t(random() % uint32_t(level.height())));
+            return level.getFreeSpotNear(point);
+        }
+    }
+
+    bool HeadlessBenchmark::run(Settings::Settings& settings, const Options& options)
+    {
+        Cel::CelDecoder::loadConfigFiles();
+
+        auto pathEXE = settings.get<std::string>("Game", "PathEXE");
+        if (pathEXE.empty())
+            pathEXE = "Diablo.exe";
+
+        // The simulation still reaches for a few engine singletons (the world, the exe, the item factory), so we need an EngineMain for them to live in
+        EngineMain engine;
+        engine.mExe = std::make_unique<DiabloExe::DiabloExe>(pathEXE);
+        if (!engine.mExe->isLoaded())
+            return false;
+
+        const DiabloExe::DiabloExe& exe = *engine.mExe;
+
+        DebugSettings::PlayersInvuln = options.invulnerablePlayers;
+
+        ThreadManager threadManager(true);
+
+        Clock::time_point loadStart = Clock::now();
+        FARender::SpriteLoader spriteLoader(exe);
+        spriteLoader.loadHeadless();
+        printf("Loaded sprite metadata in %.0fms\n", toMilliseconds(Clock::now() - loadStart));
+
+        engine.mWorld = std::make_unique<FAWorld::World>(exe, options.seed);
+        engine.mPlayerFactory = std::make_unique<FAWorld::PlayerFactory>(exe, engine.mWorld->getItemFactory());
+        FAWorld::World& world = *engine.mWorld;
+
+        std::mt19937 random(options.seed);
+
+        // Levels
+        std::vector<FAWorld::GameLevel*> levels;
+        {
+            Clock::time_point start = Clock::now();
+
+            world.generateLevels();
+            for (int32_t i = 1; i <= options.levels; i++)
+                levels.push_back(world.getLevel(size_t(i)));
+
+            printf("Generated %d levels in %.0fms\n", int32_t(levels.size()), toMilliseconds(Clock::now() - start));
+        }
+
+        if (levels.empty())
+            levels.push_back(world.getLevel(0));
+
+        // Monsters
+        for (FAWorld::GameLevel* level : levels)
+        {
+            std::vector<const DiabloExe::Monster*> possibleMonsters = exe.getMonstersInLevel(size_t(level->getLevelIndex()));
+            if (possibleMonsters.empty())
+                continue;
+
+            for (int32_t i = 0; i < options.extraMonstersPerLevel; i++)
+            {
+                const DiabloExe::Monster& monsterStats = exe.getMonster(possibleMonsters[random() % possibleMonsters.size()]->monsterName);
+
+                FAWorld::Monster* monster = new FAWorld::Monster(world, monsterStats);
+                monster->teleport(level, FAWorld::Position(randomPassablePoint(*level, random)));
+            }
+        }
+
+        // Players
+        std::vector<FAWorld::Player*> players;
+        for (int32_t i = 0; i < options.players; i++)
+        {
+            FAWorld::Player* player = engine.mPlayerFactory->create(world, FAWorld::PlayerClass(i % 3));
+            player->moveToLevel(levels[size_t(i) % levels.size()], true);
+            players.push_back(player);
+        }
+
+        if (!players.empty())
+            world.addCurrentPlayer(players.front());
+
+        size_t actorCount = 0;
+        for (FAWorld::GameLevel* level : levels)
+            actorCount += level->getActors().size();
+
+        printf("Simulating %lld ticks with %d players and %d actors on %d levels...\n",
+               (long long)options.ticks,
+               int32_t(players.size()),
+               int32_t(actorCount),
+               int32_t(levels.size()));
+
+        // Each scripted player wanders to a new random spot every few seconds, dragging the monsters that notice them along
+        const FAWorld::Tick retargetInterval = FAWorld::World::getTicksInPeriod(3);
+
+        FAWorld::SimProfile profile;
+        FAWorld::SimProfile::active = &profile;
+
+        uint64_t allocationsAtStart = options.allocationCounter ? options.allocationCounter() : 0;
+        Clock::duration slowestTick = Clock::duration::zero();
+        std::vector<FAWorld::PlayerInput> inputs;
+
+        Clock::time_point simStart = Clock::now();
+        for (int64_t tick = 0; tick < options.ticks; tick++)
+        {
+            inputs.clear();
+            for (size_t i = 0; i < players.size(); i++)
+            {
+                if ((tick + int64_t(i)) % retargetInterval == 0)
+                {
+                    Misc::Point target = randomPassablePoint(*players[i]->getLevel(), random);
+                    inputs.emplace_back(FAWorld::PlayerInput::TargetTileData{target.x, target.y}, players[i]->getId());
+                }
+            }
+
+            Clock::time_point tickStart = Clock::now();
+            world.update(false, inputs);
+            slowestTick = std::max(slowestTick, Clock::now() - tickStart);
+        }
+        Clock::duration simTime = Clock::now() - simStart;
+
+        uint64_t allocations = options.allocationCounter ? options.allocationCounter() - allocationsAtStart : 0;
+        FAWorld::SimProfile::active = nullptr;
+
+        double simSeconds = std::chrono::duration<double>(simTime).count();
+        double ticksPerSecond = double(options.ticks) / std::max(simSeconds, 1e-9);
+
+        printf("\n");
+        printf("ticks/sec:        %.1f (%.1fx real time)\n", ticksPerSecond, ticksPerSecond / double(FAWorld::World::ticksPerSecond));
+        printf("mean tick:        %.3fms\n", toMilliseconds(simTime) / double(std::max<int64_t>(options.ticks, 1)));
+        printf("slowest tick:     %.3fms\n", toMilliseconds(slowestTick));
+        // Runs with the same options must always end up in the same state, so this is a quick determinism check
+        printf("final state hash: %016llx\n", (unsigned long long)engine.mWorld->getStateHash());
+        if (options.allocationCounter)
+            printf("allocations:      %llu (%.1f per tick)\n", (unsigned long long)allocations, double(allocations) / double(std::max<int64_t>(options.ticks, 1)));
+
+        printf("\nsection             total ms     %% of sim        calls\n");
+        for (size_t i = 0; i < size_t(FAWorld::SimSection::ENUM_END); i++)
+        {
+            printf("%-16s %11.1f %11.1f%% %12llu\n",
+                   FAWorld::simSectionToString(FAWorld::SimSection(i)),
+                   toMilliseconds(profile.time[i]),
+                   100.0 * toMilliseconds(profile.time[i]) / std::max(toMilliseconds(simTime), 1e-9),
+                   (unsigned long long)profile.count[i]);
+        }
+
+        // Tear the world down while the sprite loader and thread manager it points into still exist
+        engine.mWorld.reset();
+
+        return true;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace Settings
+{
+    class Settings;
+}
+
+namespace Engine
+{
+    // Runs the simulation with no window, renderer or audio, as fast as it will go, and prints throughput stats.
+    // Game data still needs to be available (FAIO must be initialised), the level generator and monster stats come from it.
+    class HeadlessBenchmark
+    {
+    public:
+        struct Options
+        {
+            int32_t levels = 4;                 ///< Dungeon levels to generate, not counting the town
+            int32_t extraMonstersPerLevel = 0;  ///< Monsters to add to each dungeon level on top of the ones levelgen places
+            int32_t players = 4;                ///< Scripted players, spread evenly over the dungeon levels
+            int64_t ticks = 60 * 60;            ///< Ticks to simulate
+            uint32_t seed = 1;                  ///< Seeds both the world and the scripted players, so runs are repeatable
+            bool invulnerablePlayers = true;    ///< Keeps the players alive (and the monsters busy) for the whole run
+            std::function<uint64_t()> allocationCounter; ///< Optional, returns the number of heap allocations made so far
+        };
+
+        // Returns false if the game data couldn't be loaded
+        static bool run(Settings::Settings& settings, const Options& options);
+    };
+}
@@ -4,10 +4,14 @@
 #include "../../faworld/gamelevel.h"
 #include "../../faworld/player.h"
 #include "../../faworld/world.h"
+#include "../debugsettings.h"
 #include "../enginemain.h"
 #include "../localinputhandler.h"
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <misc/assert.h>
+#include <serial/streamformat.h>
 #include <serial/textstream.h>
 
 namespace Engine
@@ -18,8 +22,31 @@ namespace Engine
         {
             std::cerr << "Unable to initialize networking library." << std::endl;
         }
-        mAddress.port = 6666;
-        enet_address_set_host(&mAddress, serverAddress.c_str());
+        // Accept "host:port", for servers that aren't on the default port. An address with more than one ':' is an IPv6 address
+        // without a port, so it is passed through whole rather than split on its last ':'.
+        std::string host = serverAddress;
+        mAddress.port = DEFAULT_PORT;
+
+        size_t portSeparator = serverAddress.find(':');
+        if (portSeparator != std::string::npos && portSeparator == serverAddress.rfind(':'))
+        {
+            host = serverAddress.substr(0, portSeparator);
+
+            const char* portStart = serverAddress.data() + portSeparator + 1;
+            const char* portEnd = serverAddress.data() + serverAddress.size();
+
+            uint32_t port = 0;
+            auto [parsedEnd, error] = std::from_chars(portStart, portEnd, port);
+            if (error == std::errc() && parsedEnd == portEnd && port >= 1 && port <= 65535)
+                mAddress.port = uint16_t(port);
+            else
+            {
+                std::cerr << "Invalid port in server address \"" << serverAddress << "\", expected a number from 1 to 65535. Using port "
+                          << DEFAULT_PORT << " instead." << std::endl;
+            }
+        }
+
+        enet_address_set_host(&mAddress, host.c_str());
         mHost = enet_host_create(nullptr, 32, 2, 0, 0);
         mHost->checksum = enet_crc32;
         mServerPeer = enet_host_connect(mHost, &mAddress, CHANNEL_ID_END, 0);
@@ -94,12 +121,27 @@ namespace Engine
 
     void Client::verify(FAWorld::Tick tick)
     {
+        const FAWorld::World& world = *EngineMain::get()->mWorld;
+
+        if (tick == mDesyncDumpTick)
+        {
+            dumpWorldToFile(world, "CLIENT.txt");
+            message_and_abort_fmt("desync detected, world state at tick %d dumped to CLIENT.txt (compare with SERVER.txt on the server)\n", int32_t(tick));
+        }
+
+        if (tick % STATE_HASH_INTERVAL == 0)
+        {
+            mStateHashes.emplace_back(tick, world.getStateHash());
+            if (mStateHashes.size() > STATE_HASHES_PER_UPDATE)
+                mStateHashes.erase(mStateHashes.begin());
+        }
+
         if (!mDoFullVerify)
             return;
 
         Serial::TextWriteStream worldStream;
         FASaveGame::GameSaver saver(worldStream);
-        EngineMain::get()->mWorld->save(saver);
+        world.save(saver);
 
         auto worldData = worldStream.getData();
         std::string strData(reinterpret_cast<const char*>(worldData.first), worldData.second);
@@ -126,8 +168,8 @@ namespace Engine
 
     void Client::processServerPacket(const ENetEvent& event)
     {
-        Serial::TextReadStream stream(std::string(reinterpret_cast<const char*>(event.packet->data), event.packet->dataLength));
-        FASaveGame::GameLoader loader(stream);
+        std::unique_ptr<Serial::ReadStreamInterface> stream = Serial::createReadStream(event.packet->data, event.packet->dataLength);
+        FASaveGame::GameLoader loader(*stream);
 
         MessageType type = MessageType(loader.load<uint8_t>());
 
@@ -135,7 +177,13 @@ namespace Engine
         {
             case MessageType::MapToClient:
             {
-                this->receiveMap(loader);
+                this->receiveMapHeader(loader);
+                return;
+            }
+
+            case MessageType::MapFragmentToClient:
+            {
+                this->receiveMapFragment(loader);
                 return;
             }
 
@@ -152,6 +200,12 @@ namespace Engine
                 return;
             }
 
+            case MessageType::DesyncToClient:
+            {
+                mDesyncDumpTick = loader.load<FAWorld::Tick>();
+                return;
+            }
+
             case MessageType::ClientUpdateToServer:
             case MessageType::AcknowledgeMapToServer:
                 invalid_enum(MessageType, type);
@@ -160,22 +214,46 @@ namespace Engine
         invalid_enum(MessageType, type);
     }
 
-    void Client::receiveMap(FASaveGame::GameLoader& loader)
+    void Client::receiveMapHeader(FASaveGame::GameLoader& loader)
     {
-        puts("RECEIVED MAP\n");
-
         mDoFullVerify = loader.load<bool>();
-        int32_t myPlayerId = loader.load<int32_t>();
-        EngineMain::get()->mWorld->load(loader);
-        EngineMain::get()->mWorld->addCurrentPlayer(static_cast<FAWorld::Player*>(EngineMain::get()->mWorld->getActorById(myPlayerId)));
+        mMyPlayerId = loader.load<int32_t>();
+        uint32_t uncompressedSize = loader.load<uint32_t>();
+        mMapCompressedSize = loader.load<uint32_t>();
+
+        mMapCompressedReceived = 0;
+        mMapDecompressor = std::make_unique<MapStream::Decompressor>(uncompressedSize);
+    }
+
+    void Client::receiveMapFragment(FASaveGame::GameLoader& loader)
+    {
+        release_assert(mMapDecompressor);
+
+        std::string fragment = loader.load<std::string>();
+        mMapCompressedReceived += fragment.size();
+        mMapDecompressor->addFragment(fragment);
+
+        if (!mMapDecompressor->isDone())
+            return;
+
+        release_assert(mMapCompressedReceived == mMapCompressedSize);
+
+        {
+            std::unique_ptr<Serial::ReadStreamInterface> stream = Serial::createReadStream(mMapDecompressor->getData());
+            FASaveGame::GameLoader mapLoader(*stream);
+            EngineMain::get()->mWorld->load(mapLoader);
+        }
+        mMapDecompressor.reset();
+
+        EngineMain::get()->mWorld->addCurrentPlayer(static_cast<FAWorld::Player*>(EngineMain::get()->mWorld->getActorById(mMyPlayerId)));
 
         auto myPlayer = EngineMain::get()->mWorld->getCurrentPlayer();
         release_assert(myPlayer->getLevel()->isPassable(myPlayer->mMoveHandler.getCurrentPosition().current(), myPlayer));
 
-        Serial::TextWriteStream stream;
-        FASaveGame::GameSaver saver(stream);
+        std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+        FASaveGame::GameSaver saver(*stream);
         saver.save(uint8_t(MessageType::AcknowledgeMapToServer));
-        auto data = stream.getData();
+        auto data = stream->getData();
 
         EngineMain::get()->mInGame = true;
 
@@ -184,18 +262,29 @@ namespace Engine
         enet_peer_send(mServerPeer, RELIABLE_CHANNEL_ID, packet);
     }
 
+    std::optional<float> Client::getMapDownloadProgress() const
+    {
+        if (!mMapDecompressor || mMapCompressedSize == 0)
+            return std::nullopt;
+
+        return float(mMapCompressedReceived) / float(mMapCompressedSize);
+    }
+
     void Client::receiveInputs(FASaveGame::GameLoader& loader)
     {
-        while (loader.load<bool>())
-        {
-            FAWorld::Tick tick = loader.load<FAWorld::Tick>();
+        uint32_t packetId = loader.load<uint32_t>();
+        mHighestInputPacketReceived = std::max(mHighestInputPacketReceived, packetId);
+        mInputPacketsReceived++;
 
-            auto& inputs = mInputs[tick];
-            uint32_t size = loader.load<uint32_t>();
-            inputs.resize(size);
-            for (uint32_t i = 0; i < size; i++)
-                inputs[i].load(loader);
-        }
+        FAWorld::Tick currentTick = EngineMain::get()->mWorld->getCurrentTick();
+
+        InputsPacket::read(loader, [&](FAWorld::Tick tick, const std::string& encoded) {
+            // The server sends most ticks more than once, so skip the ones we've already got or have already run
+            if (tick < currentTick || mInputs.count(tick))
+                return;
+
+            InputsPacket::decodeTick(encoded, mInputs[tick]);
+        });
     }
 
     void Client::receiveVerifyPacket(FASaveGame::GameLoader& loader)
@@ -210,11 +299,20 @@ namespace Engine
         mLocalInputsBuffer[mLastLocalInputId] = mLocalInputHandler.getAndClearInputs();
         FAWorld::PlayerInput::removeUnnecessaryInputs(mLocalInputsBuffer[mLastLocalInputId]);
 
-        Serial::TextWriteStream stream;
-        FASaveGame::GameSaver saver(stream);
+        std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+        FASaveGame::GameSaver saver(*stream);
 
         saver.save(uint8_t(MessageType::ClientUpdateToServer));
         saver.save(EngineMain::get()->mWorld->getCurrentTick());
+        saver.save(mHighestInputPacketReceived);
+        saver.save(mInputPacketsReceived);
+
+        saver.save(uint32_t(mStateHashes.size()));
+        for (const auto& pair : mStateHashes)
+        {
+            saver.save(pair.first);
+            saver.save(pair.second);
+        }
 
         auto addInputs = [&](uint32_t id) {
             saver.save(true); // There is another set of inputs here
@@ -226,7 +324,7 @@ namespace Engine
             for (size_t i = 0; i < inputs.size(); i++)
                 inputs[i].save(saver);
 
-            return stream.getCurrentSize() <= MAX_CLIENT_UPDATE_PACKET_SIZE;
+            return stream->getCurrentSize() <= MAX_CLIENT_UPDATE_PACKET_SIZE;
         };
 
         // Send as many input sets as we can fit
@@ -241,17 +339,17 @@ namespace Engine
             if (!addInputs(inputSetNumber))
                 break;
 
-            lastTickEndPosition = stream.getCurrentSize();
+            lastTickEndPosition = stream->getCurrentSize();
         }
 
         // get rid of all the old inputs that didn't fit
         for (; mLocalInputsBuffer.count(inputSetNumber); inputSetNumber--)
             mLocalInputsBuffer.erase(inputSetNumber);
 
-        stream.resize(lastTickEndPosition);
+        stream->resize(lastTickEndPosition);
         saver.save(false); // there are no more inputs in this packet
 
-        auto data = stream.getData();
+        auto data = stream->getData();
 
         // does not take ownership of data
         ENetPacket* packet = enet_packet_create(data.first, data.second, ENET_PACKET_FLAG_UNSEQUENCED);
@@ -1,5 +1,6 @@
 #pragma once
 #include "multiplayerinterface.h"
+#include "netcommon.h"
 #include <enet/enet.h>
 #include <set>
 
@@ -28,10 +29,13 @@ namespace Engine
 
         bool isConnected() { return mConnected; }
         bool didConnectionFail() { return mConnectionFailed; }
+        // Fraction of the map received so far, while it's being downloaded
+        std::optional<float> getMapDownloadProgress() const;
 
     private:
         void processServerPacket(const ENetEvent& event);
-        void receiveMap(FASaveGame::GameLoader& loader);
+        void receiveMapHeader(FASaveGame::GameLoader& loader);
+        void receiveMapFragment(FASaveGame::GameLoader& loader);
         void receiveInputs(FASaveGame::GameLoader& loader);
         void receiveVerifyPacket(FASaveGame::GameLoader& loader);
         void sendClientUpdate();
@@ -44,6 +48,17 @@ namespace Engine
         std::map<uint32_t, std::vector<FAWorld::PlayerInput>> mLocalInputsBuffer;
 
         std::unordered_map<FAWorld::Tick, std::vector<FAWorld::PlayerInput>> mInputs;
+        // Reported back to the server so it can work out how many input packets we're losing
+        uint32_t mHighestInputPacketReceived = 0;
+        uint32_t mInputPacketsReceived = 0;
+
+        int32_t mMyPlayerId = -1;
+        std::unique_ptr<MapStream::Decompressor> mMapDecompressor;
+        size_t mMapCompressedSize = 0;
+        size_t mMapCompressedReceived = 0;
+
+        std::vector<std::pair<FAWorld::Tick, uint64_t>> mStateHashes; ///< The most recent ones, which we send with every update
+        FAWorld::Tick mDesyncDumpTick = -1;
 
         bool mDoFullVerify = false;
         std::unordered_map<FAWorld::Tick, std::string> mServerStatesForFullVerify;
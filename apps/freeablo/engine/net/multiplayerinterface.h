@@ -27,6 +27,13 @@ namespace Engine
         virtual void registerNewPlayer(FAWorld::Player* player, uint32_t peerId) = 0;
         virtual void doMultiplayerGui(nk_context*){};
 
+        static constexpr uint16_t DEFAULT_PORT = 6666;
+
+        // Clients send the server a hash of their world state every STATE_HASH_INTERVAL ticks, see World::getStateHash().
+        // Each update carries the last few, so losing some packets doesn't matter.
+        static constexpr FAWorld::Tick STATE_HASH_INTERVAL = 15;
+        static constexpr size_t STATE_HASHES_PER_UPDATE = 4;
+
         enum
         {
             RELIABLE_CHANNEL_ID = 10,
@@ -40,8 +47,10 @@ namespace Engine
         {
             // server-to-client
             MapToClient,
+            MapFragmentToClient,
             InputsToClient,
             VerifyToClient,
+            DesyncToClient,
 
             // client-to-server
             AcknowledgeMapToServer,
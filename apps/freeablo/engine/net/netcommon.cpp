@@ -0,0 +1,211 @@
+#include "netcommon.h"
+#include "../../fasavegame/gameloader.h"
+#include "../debugsettings.h"
+#include <algorithm>
+#include <cmath>
+#include <misc/assert.h>
+#include <serial/loader.h>
+#include <serial/streamformat.h>
+#include <serial/textstream.h>
+#include <zlib.h>
+
+namespace Engine
+{
+    namespace InputsPacket
+    {
+        std::string encodeTick(const std::vector<FAWorld::PlayerInput>& inputs)
+        {
+            if (inputs.empty())
+                return {};
+
+            std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+            Serial::Saver saver(*stream);
+
+            saver.save(uint32_t(inputs.size()));
+            for (const auto& input : inputs)
+                input.save(saver);
+
+            auto data = stream->getData();
+            return std::string(reinterpret_cast<const char*>(data.first), data.second);
+        }
+
+        void decodeTick(const std::string& encoded, std::vector<FAWorld::PlayerInput>& inputs)
+        {
+            inputs.clear();
+
+            if (encoded.empty())
+                return;
+
+            std::unique_ptr<Serial::ReadStreamInterface> stream = Serial::createReadStream(encoded);
+            Serial::Loader loader(*stream);
+
+            inputs.resize(loader.load<uint32_t>());
+            for (auto& input : inputs)
+                input.load(loader);
+        }
+
+        void write(Serial::Saver& saver, const std::vector<FAWorld::Tick>& ticks, const std::map<FAWorld::Tick, std::string>& encodedTicks)
+        {
+            for (size_t i = 0; i < ticks.size();)
+            {
+                const std::string& encoded = encodedTicks.at(ticks[i]);
+
+                if (!encoded.empty())
+                {
+                    saver.save(uint8_t(EntryType::Tick));
+                    saver.save(ticks[i]);
+                    saver.save(encoded);
+                    i++;
+                    continue;
+                }
+
+                size_t end = i + 1;
+                while (end < ticks.size() && ticks[end] == ticks[end - 1] + 1 && encodedTicks.at(ticks[end]).empty())
+                    end++;
+
+                saver.save(uint8_t(EntryType::EmptyTicks));
+                saver.save(ticks[i]);
+                saver.save(uint32_t(end - i));
+                i = end;
+            }
+
+            saver.save(uint8_t(EntryType::End));
+        }
+
+        void read(Serial::Loader& loader, const std::function<void(FAWorld::Tick, const std::string&)>& onTick)
+        {
+            static const std::string noInputs;
+
+            while (true)
+            {
+                EntryType type = EntryType(loader.load<uint8_t>());
+
+                switch (type)
+                {
+                    case EntryType::End:
+                        return;
+
+                    case EntryType::Tick:
+                    {
+                        FAWorld::Tick tick = loader.load<FAWorld::Tick>();
+                        onTick(tick, loader.load<std::string>());
+                        break;
+                    }
+
+                    case EntryType::EmptyTicks:
+                    {
+                        FAWorld::Tick first = loader.load<FAWorld::Tick>();
+                        uint32_t count = loader.load<uint32_t>();
+
+                        for (uint32_t i = 0; i < count; i++)
+                            onTick(first + i, noInputs);
+                        break;
+                    }
+
+                    default:
+                        invalid_enum(EntryType, type);
+                }
+            }
+        }
+
+        size_t maxEntrySize(const std::string& encoded, Serial::StreamFormat format)
+        {
+            // This runs for every tick we send to every peer, so it works from the largest each value can be written as, rather than writing
+            // the entry out to measure it. Entries are written at the top level of the packet, so there is no indentation in the text format.
+            switch (format)
+            {
+                case Serial::StreamFormat::Binary:
+                {
+                    // Each value may be preceded by a type tag, integers are varints of at most 10 bytes, and strings are prefixed by their length
+                    constexpr size_t typeAndTick = (1 + 1) + (1 + 10);
+                    constexpr size_t count = 1 + 5;
+                    return typeAndTick + std::max(1 + 10 + encoded.size(), count);
+                }
+                case Serial::StreamFormat::Text:
+                {
+                    // Each value is a "TYPE digits" line, and a string's bytes go on the line after its length
+                    constexpr size_t typeAndTick = sizeof("U8 255\n") - 1 + sizeof("I64 -9223372036854775808\n") - 1;
+                    constexpr size_t count = sizeof("U32 4294967295\n") - 1;
+                    return typeAndTick + std::max(sizeof("STRING 4294967295\n") - 1 + encoded.size() + 1, count);
+                }
+            }
+
+            invalid_enum(Serial::StreamFormat, format);
+        }
+
+        int32_t copiesForPacketLoss(double packetLoss)
+        {
+            static constexpr double TARGET_LOSS = 0.01;
+
+            if (packetLoss <= TARGET_LOSS)
+                return 1;
+            if (packetLoss >= 1.0)
+                return MAX_COPIES;
+
+            int32_t copies = int32_t(std::ceil(std::log(TARGET_LOSS) / std::log(packetLoss)));
+            return std::clamp(copies, 1, MAX_COPIES);
+        }
+    }
+
+    void dumpWorldToFile(const FAWorld::World& world, const std::string& path)
+    {
+        Serial::TextWriteStream stream;
+        FASaveGame::GameSaver saver(stream);
+        world.save(saver);
+
+        auto data = stream.getData();
+
+        FILE* f = fopen(path.c_str(), "wb");
+        release_assert(f);
+        fwrite(data.first, 1, data.second, f);
+        fclose(f);
+    }
+
+    namespace MapStream
+    {
+        std::string compress(const uint8_t* data, size_t size)
+        {
+            std::string compressed(compressBound(uLong(size)), '\0');
+            uLongf compressedSize = uLongf(compressed.size());
+
+            // This runs on the server's main thread while everyone waits, so favour speed over size. World saves compress well anyway.
+            int result = compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressedSize, data, uLong(size), Z_BEST_SPEED);
+            release_assert(result == Z_OK);
+
+            compressed.resize(compressedSize);
+            return compressed;
+        }
+
+        Decompressor::Decompressor(size_t uncompressedSize) : mStream(std::make_unique<z_stream_s>()), mData(uncompressedSize, '\0')
+        {
+            *mStream = {};
+            int result = inflateInit(mStream.get());
+            release_assert(result == Z_OK);
+
+            mStream->next_out = reinterpret_cast<Bytef*>(mData.data());
+            mStream->avail_out = uInt(mData.size());
+        }
+
+        Decompressor::~Decompressor() { inflateEnd(mStream.get()); }
+
+        void Decompressor::addFragment(const std::string& fragment)
+        {
+            release_assert(!mDone);
+
+            // zlib doesn't write to its input, it's just not declared const unless built with ZLIB_CONST
+            mStream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(fragment.data()));
+            mStream->avail_in = uInt(fragment.size());
+
+            int result = inflate(mStream.get(), Z_NO_FLUSH);
+            if (result == Z_STREAM_END)
+            {
+                release_assert(mStream->avail_out == 0 && mStream->avail_in == 0);
+                mDone = true;
+            }
+            else
+            {
+                release_assert(result == Z_OK && mStream->avail_in == 0);
+            }
+        }
+    }
+}
@@ -1,6 +1,83 @@
 #pragma once
+#include "../../faworld/playerinput.h"
+#include "../../faworld/world.h"
 #include <enet/enet.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <serial/streamformat.h>
+#include <string>
+#include <vector>
+
+namespace Serial
+{
+    class Loader;
+    class Saver;
+}
+
+struct z_stream_s;
 
 namespace Engine
 {
+    // Layout of the inputs part of a server to client InputsToClient packet.
+    // Each tick's inputs are encoded once into a self contained stream, and the same bytes are then copied into every peer's packets
+    // until they're no longer needed. Most ticks have no inputs at all, so runs of consecutive empty ticks are sent as one range entry.
+    namespace InputsPacket
+    {
+        enum class EntryType : uint8_t
+        {
+            End,
+            Tick,       // tick, encoded inputs
+            EmptyTicks, // first tick, count
+        };
+
+        // Ticks with no inputs encode to an empty string
+        std::string encodeTick(const std::vector<FAWorld::PlayerInput>& inputs);
+        void decodeTick(const std::string& encoded, std::vector<FAWorld::PlayerInput>& inputs);
+
+        // ticks must be sorted, and all of them must be present in encodedTicks
+        void write(Serial::Saver& saver, const std::vector<FAWorld::Tick>& ticks, const std::map<FAWorld::Tick, std::string>& encodedTicks);
+        // Calls onTick once for every tick in the packet, in order, with an empty string for ticks that have no inputs
+        void read(Serial::Loader& loader, const std::function<void(FAWorld::Tick, const std::string&)>& onTick);
+
+        // Upper bound on the space one tick can take up in a packet written in the given stream format. Empty ticks might instead start a
+        // range entry, so they're given enough space for either.
+        size_t maxEntrySize(const std::string& encoded, Serial::StreamFormat format);
+
+        static constexpr size_t MAX_PACKET_SIZE = 1000;
+        static constexpr size_t PACKET_START_PADDING = 50; // room for the message type, packet number, end entry and stream header
+
+        // How many times to send each tick to a peer that loses the given fraction of packets,
+        // so that all copies are lost less than 1% of the time.
+        int32_t copiesForPacketLoss(double packetLoss);
+        static constexpr int32_t MAX_COPIES = 4;
+    }
+
+    // Saves the world as text, so the dumps from both ends of a desync can be diffed
+    void dumpWorldToFile(const FAWorld::World& world, const std::string& path);
+
+    // The world snapshot sent to joining clients is zlib compressed once, then streamed to each of them in fragments
+    namespace MapStream
+    {
+        static constexpr size_t FRAGMENT_SIZE = 16 * 1024;
+
+        std::string compress(const uint8_t* data, size_t size);
+
+        // Inflates fragments as they arrive, so there's nothing left to decompress once the last one is in
+        class Decompressor
+        {
+        public:
+            explicit Decompressor(size_t uncompressedSize);
+            ~Decompressor();
+
+            void addFragment(const std::string& fragment);
+            bool isDone() const { return mDone; }
+            const std::string& getData() const { return mData; }
+
+        private:
+            std::unique_ptr<z_stream_s> mStream;
+            std::string mData;
+            bool mDone = false;
+        };
+    }
 }
@@ -2,27 +2,34 @@
 #include "../../fasavegame/gameloader.h"
 #include "../../faworld/player.h"
 #include "../../faworld/world.h"
+#include "../debugsettings.h"
 #include "../enginemain.h"
 #include "../localinputhandler.h"
+#include <algorithm>
 #include <cstring>
+#include <fmt/format.h>
 #include <iostream>
 #include <misc/assert.h>
 #include <misc/misc.h>
+#include <serial/streamformat.h>
 #include <serial/textstream.h>
 
 namespace Engine
 {
     const char* Server::SERVER_ADDRESS = "0.0.0.0";
 
-    Server::Server(FAWorld::World& world, LocalInputHandler& localInputHandler) : mWorld(world), mLocalInputHandler(localInputHandler)
+    Server::Server(FAWorld::World& world, LocalInputHandler& localInputHandler, uint16_t port, size_t maxPeers)
+        : mWorld(world), mLocalInputHandler(localInputHandler)
     {
         if (0 != enet_initialize())
         {
             std::cerr << "Unable to initialize networking library." << std::endl;
         }
-        mAddress.port = 6666;
+        mAddress.port = port;
         enet_address_set_host(&mAddress, SERVER_ADDRESS);
-        mHost = enet_host_create(&mAddress, 32, CHANNEL_ID_END, 0, 0);
+        mHost = enet_host_create(&mAddress, maxPeers, CHANNEL_ID_END, 0, 0);
+        if (!mHost)
+            message_and_abort_fmt("Unable to listen on port %d\n", int(port));
         mHost->checksum = enet_crc32;
     }
 
@@ -32,6 +39,18 @@ namespace Engine
         enet_deinitialize();
     }
 
+    void Server::verify(FAWorld::Tick tick)
+    {
+        if (tick == mDesyncDumpTick)
+        {
+            dumpWorldToFile(mWorld, "SERVER.txt");
+            mDesyncDumpTick = -1;
+        }
+
+        if (tick % STATE_HASH_INTERVAL == 0)
+            mStateHashes[tick] = mWorld.getStateHash();
+    }
+
     std::optional<std::vector<FAWorld::PlayerInput>> Server::getAndClearInputs(FAWorld::Tick tick)
     {
         if (!mInputs.count(tick))
@@ -55,6 +74,7 @@ namespace Engine
         this->handleEvents();
         this->handleMapSending();
         this->processInputs();
+        this->updateStats();
     }
 
     void Server::handleEvents()
@@ -148,14 +168,23 @@ namespace Engine
 
     void Server::handleMapSending()
     {
+        // Snapshots are only shared between peers that join on the same tick
+        if (mMapSnapshot && mMapSnapshot->tick != mWorld.getCurrentTick())
+            mMapSnapshot.reset();
+
         // see onPeerConnect for an explanation of this
-        for (auto& peer : mPeers)
+        for (auto& pair : mPeers)
         {
-            if (!peer.second.mapSent && peer.second.actorId != -1)
+            Peer& peer = pair.second;
+
+            if (!peer.mapSent && peer.actorId != -1)
             {
-                sendMapToPeer(peer.second);
-                peer.second.mapSent = true;
+                startMapTransfer(peer);
+                peer.mapSent = true;
             }
+
+            if (peer.mapTransfer)
+                sendMapFragments(peer);
         }
     }
 
@@ -166,29 +195,73 @@ namespace Engine
         mPeers.erase(peerId);
     }
 
-    void Server::sendMapToPeer(Peer& peer)
+    void Server::startMapTransfer(Peer& peer)
     {
-        Serial::TextWriteStream stream;
-        FASaveGame::GameSaver saver(stream);
+        if (!mMapSnapshot)
+        {
+            auto snapshot = std::make_shared<MapSnapshot>();
+            snapshot->tick = mWorld.getCurrentTick();
+
+            std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+            FASaveGame::GameSaver saver(*stream);
+            mWorld.save(saver);
+
+            auto data = stream->getData();
+            snapshot->uncompressedSize = uint32_t(data.second);
+            snapshot->compressed = MapStream::compress(data.first, data.second);
+
+            mMapSnapshot = std::move(snapshot);
+        }
+
+        std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+        FASaveGame::GameSaver saver(*stream);
 
         saver.save(uint8_t(MessageType::MapToClient));
         saver.save(mDoFullVerify);
         saver.save(peer.actorId);
-        mWorld.save(saver);
+        saver.save(mMapSnapshot->uncompressedSize);
+        saver.save(uint32_t(mMapSnapshot->compressed.size()));
 
-        auto data = stream.getData();
+        auto data = stream->getData();
 
         // does not take ownership of data
         ENetPacket* packet = enet_packet_create(data.first, data.second, ENET_PACKET_FLAG_RELIABLE);
         enet_peer_send(peer.peer, RELIABLE_CHANNEL_ID, packet);
 
+        peer.mapTransfer = mMapSnapshot;
+        peer.mapTransferOffset = 0;
         peer.lastTick = mWorld.getCurrentTick() - 1;
     }
 
+    void Server::sendMapFragments(Peer& peer)
+    {
+        // Only queue a little at a time, so a big map doesn't sit in ENet's queues in front of everything else we send,
+        // and ENet's reliable window paces the transfer to what the connection can take.
+        while (peer.mapTransfer && enet_list_size(&peer.peer->outgoingReliableCommands) < MAX_QUEUED_MAP_COMMANDS)
+        {
+            const std::string& compressed = peer.mapTransfer->compressed;
+            size_t fragmentSize = std::min(MapStream::FRAGMENT_SIZE, compressed.size() - peer.mapTransferOffset);
+
+            std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+            FASaveGame::GameSaver saver(*stream);
+
+            saver.save(uint8_t(MessageType::MapFragmentToClient));
+            saver.save(compressed.substr(peer.mapTransferOffset, fragmentSize));
+
+            auto data = stream->getData();
+            ENetPacket* packet = enet_packet_create(data.first, data.second, ENET_PACKET_FLAG_RELIABLE);
+            enet_peer_send(peer.peer, RELIABLE_CHANNEL_ID, packet);
+
+            peer.mapTransferOffset += fragmentSize;
+            if (peer.mapTransferOffset == compressed.size())
+                peer.mapTransfer.reset();
+        }
+    }
+
     void Server::readPeerPacket(const ENetEvent& event)
     {
-        Serial::TextReadStream stream(std::string((const char*)event.packet->data, event.packet->dataLength));
-        FASaveGame::GameLoader loader(stream);
+        std::unique_ptr<Serial::ReadStreamInterface> stream = Serial::createReadStream(event.packet->data, event.packet->dataLength);
+        FASaveGame::GameLoader loader(*stream);
 
         MessageType type = MessageType(loader.load<uint8_t>());
 
@@ -208,7 +281,9 @@ namespace Engine
 
             case MessageType::InputsToClient:
             case MessageType::MapToClient:
+            case MessageType::MapFragmentToClient:
             case MessageType::VerifyToClient:
+            case MessageType::DesyncToClient:
                 invalid_enum(MessageType, type);
         }
 
@@ -217,135 +292,100 @@ namespace Engine
 
     void Server::sendInputsToClients(std::vector<FAWorld::PlayerInput>& inputs)
     {
-        // The basic approach of this function is to send a fized-size packet each tick, and just fill it with as many ticks worth of
-        // inputs as we can fit. We ensure that these are chosen well, and that every tick is guaranteed to be received eventually by every client.
+        // Each tick is sent to each peer until they acknowledge it (by advancing past it), in an unsequenced packet
+        // that we send every tick. The tick's inputs are encoded once here, and the bytes shared by every peer's packets.
+        // How many copies of a tick a peer gets straight away depends on how many packets it's been losing, and a tick that
+        // should have been acknowledged by now gets resent, so every tick is guaranteed to reach every client eventually.
 
-        mOldInputs[mWorld.getCurrentTick()] = inputs;
+        FAWorld::Tick currentTick = mWorld.getCurrentTick();
+        mEncodedInputs[currentTick] = InputsPacket::encodeTick(inputs);
 
-        FAWorld::Tick oldestNeededTick = std::numeric_limits<FAWorld::Tick>::max();
+        FAWorld::Tick oldestNeededTick = currentTick;
 
         for (auto& pair : mPeers)
         {
             Peer& peer = pair.second;
 
+            // Peers that are still receiving the map will need everything since it was taken
+            if (peer.mapSent)
+                oldestNeededTick = std::min(oldestNeededTick, peer.lastTick);
+
             if (!peer.hasMap)
                 continue;
 
-            bool firstInPacket = true;
-
-            auto fillPacket = [this, &firstInPacket](FAWorld::Tick& currentlyProcessingTick) -> ENetPacket* {
-                Serial::TextWriteStream stream;
-                FASaveGame::GameSaver saver(stream);
-
-                saver.save(uint8_t(MessageType::InputsToClient));
-
-                size_t lastTickEndPosition = 0;
-
-                auto addTick = [&](FAWorld::Tick tick) {
-                    saver.save(true); // Is there another tick in this packet?
-                    saver.save(tick);
-                    saver.save(uint32_t(mOldInputs[tick].size()));
-
-                    if (firstInPacket)
-                    {
-                        release_assert(stream.getCurrentSize() < UPDATE_PACKET_START_PADDING);
-                        firstInPacket = false;
-                    }
+            peer.sentTicks.erase(peer.sentTicks.begin(), peer.sentTicks.lower_bound(peer.lastTick));
 
-                    for (const auto& input : mOldInputs[tick])
-                        input.save(saver);
+            int32_t copies = InputsPacket::copiesForPacketLoss(peer.packetLoss);
+            FAWorld::Tick resendAfterTicks = FAWorld::Tick(peer.peer->roundTripTime) * FAWorld::World::ticksPerSecond / 1000 + RESEND_MARGIN_TICKS;
 
-                    if (stream.getCurrentSize() > MAX_UPDATE_PACKET_SIZE)
-                    {
-                        // This assert detects single ticks with too many inputs to fit in one packet.
-                        // This should not happen, as we should never allow more than
-                        // ((MAX_UPDATE_PACKET_SIZE - UPDATE_PACKET_START_PADDING) / PlayerInput::MAX_SERIALISED_INPUT_SIZE) inputs in one tick.
-                        // TODO: there is a few bits added to the packet before we start the inputs, we should account for them somehow.
-                        release_assert(lastTickEndPosition > 0);
-                        return false;
-                    }
+            mTicksToSend.clear();
+            size_t packetSize = UPDATE_PACKET_START_PADDING;
 
-                    lastTickEndPosition = stream.getCurrentSize();
+            auto addTick = [&](FAWorld::Tick tick) {
+                SentTick& sent = peer.sentTicks[tick];
+                if (sent.copies >= copies && currentTick - sent.lastSentTick < resendAfterTicks)
                     return true;
-                };
 
-                // On even ticks, we cycle through old inputs, and on odd ticks we just send as many of the most recent ticks
-                // as we can fit. This provides a decent balance between definitely sending everything again if it's needed
-                // (because of packet loss/corruption), and always sending the most recent stuff.
-                if (mWorld.getCurrentTick() % 2 == 0)
-                {
-                    addTick(mWorld.getCurrentTick());
+                // Ticks we never got around to encoding had no inputs
+                size_t entrySize = InputsPacket::maxEntrySize(mEncodedInputs[tick], DebugSettings::NetworkStreamFormat);
+                if (packetSize + entrySize > MAX_UPDATE_PACKET_SIZE)
+                    return false;
 
-                    while (currentlyProcessingTick < mWorld.getCurrentTick())
-                    {
-                        if (!addTick(currentlyProcessingTick))
-                            break;
+                packetSize += entrySize;
+                mTicksToSend.push_back(tick);
 
-                        currentlyProcessingTick++;
-                    }
-                }
-                else
-                {
-                    FAWorld::Tick tick = mWorld.getCurrentTick();
-                    while (mOldInputs.count(tick) != 0)
-                    {
-                        if (!addTick(tick))
-                            break;
-
-                        tick--;
-                    }
-                }
+                sent.copies++;
+                sent.lastSentTick = currentTick;
+                return true;
+            };
 
-                if (lastTickEndPosition == 0)
-                    return nullptr;
+            // The newest tick always fits, as processInputs() limits how many inputs a tick can have. After that, we go from the oldest tick
+            // the peer is missing, as it can't progress without that one.
+            addTick(currentTick);
+            for (FAWorld::Tick tick = peer.lastTick; tick < currentTick; tick++)
+            {
+                if (!addTick(tick))
+                    break;
+            }
 
-                stream.resize(lastTickEndPosition);
-                saver.save(false); // There are no more ticks in this packet
+            peer.bytesSentLastTick = 0;
 
-                auto data = stream.getData();
-                ENetPacket* packet = enet_packet_create(nullptr, data.second, ENET_PACKET_FLAG_UNSEQUENCED);
-                memcpy(packet->data, data.first, data.second);
+            if (mTicksToSend.empty())
+                continue;
 
-                return packet;
-            };
+            std::sort(mTicksToSend.begin(), mTicksToSend.end());
 
-            FAWorld::Tick currentlyProcessingTick = peer.lastSentTick;
+            std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+            FASaveGame::GameSaver saver(*stream);
 
-            if (currentlyProcessingTick < peer.lastTick || currentlyProcessingTick >= mWorld.getCurrentTick() - 5)
-                currentlyProcessingTick = peer.lastTick;
+            peer.inputPacketsSent++;
 
-            oldestNeededTick = std::min(oldestNeededTick, peer.lastTick);
+            saver.save(uint8_t(MessageType::InputsToClient));
+            saver.save(peer.inputPacketsSent);
+            InputsPacket::write(saver, mTicksToSend, mEncodedInputs);
 
-            peer.bytesSentLastTick = 0;
+            auto data = stream->getData();
+            release_assert(data.second <= MAX_UPDATE_PACKET_SIZE);
 
-            if (ENetPacket* packet = fillPacket(currentlyProcessingTick))
-            {
-                peer.bytesSentLastTick += packet->dataLength;
-                enet_peer_send(peer.peer, SERVER_TO_CLIENT_CHANNEL_ID, packet);
+            ENetPacket* packet = enet_packet_create(nullptr, data.second, ENET_PACKET_FLAG_UNSEQUENCED);
+            memcpy(packet->data, data.first, data.second);
 
-                peer.lastSentTick = currentlyProcessingTick;
-            }
+            peer.bytesSentLastTick += packet->dataLength;
+            enet_peer_send(peer.peer, SERVER_TO_CLIENT_CHANNEL_ID, packet);
         }
 
-        // Remove no-longer needed old input lists
-        // Done as a manual loop, because apparently std::remove_if doesn't work on associative containers (yet)
-        for (auto it = mOldInputs.begin(); it != mOldInputs.end();)
-        {
-            if (it->first < oldestNeededTick)
-                it = mOldInputs.erase(it);
-            else
-                ++it;
-        }
+        mEncodedInputs.erase(mEncodedInputs.begin(), mEncodedInputs.lower_bound(oldestNeededTick));
+        mStateHashes.erase(mStateHashes.begin(), mStateHashes.lower_bound(oldestNeededTick - STATE_HASH_INTERVAL * FAWorld::Tick(STATE_HASHES_PER_UPDATE)));
 
         if (mDoFullVerify && !mPeers.empty() && mLastTickVerified < mWorld.getCurrentTick())
         {
-            Serial::TextWriteStream stream;
-            FASaveGame::GameSaver saver(stream);
+            std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+            FASaveGame::GameSaver saver(*stream);
 
             saver.save(uint8_t(MessageType::VerifyToClient));
             saver.save(mWorld.getCurrentTick());
 
-            // save world as a string
+            // save world as a string, always in text so it can be dumped and diffed if the client detects a desync
             {
                 Serial::TextWriteStream worldStream;
                 FASaveGame::GameSaver worldSaver(worldStream);
@@ -356,7 +396,7 @@ namespace Engine
                 saver.save(strData);
             }
 
-            auto data = stream.getData();
+            auto data = stream->getData();
             ENetPacket* packet = enet_packet_create(data.first, data.second, ENET_PACKET_FLAG_RELIABLE);
             enet_host_broadcast(mHost, RELIABLE_CHANNEL_ID, packet);
 
@@ -368,6 +408,32 @@ namespace Engine
     {
         peer.lastTick = loader.load<FAWorld::Tick>();
 
+        {
+            // Estimate the peer's packet loss from the sequence numbers of the input packets it has seen. Client updates are unsequenced,
+            // so this can go backwards occasionally, in which case we just ignore it.
+            uint32_t highestInputPacketReceived = loader.load<uint32_t>();
+            uint32_t inputPacketsReceived = loader.load<uint32_t>();
+
+            uint32_t expected = highestInputPacketReceived - peer.lossSampleHighestPacket;
+            uint32_t received = inputPacketsReceived - peer.lossSampleReceived;
+
+            if (int32_t(expected) >= int32_t(LOSS_SAMPLE_PACKETS) && int32_t(received) >= 0)
+            {
+                double loss = 1.0 - std::min(1.0, double(received) / double(expected));
+                peer.packetLoss = peer.packetLoss * (1.0 - LOSS_SMOOTHING) + loss * LOSS_SMOOTHING;
+
+                peer.lossSampleHighestPacket = highestInputPacketReceived;
+                peer.lossSampleReceived = inputPacketsReceived;
+            }
+        }
+
+        uint32_t stateHashCount = loader.load<uint32_t>();
+        for (uint32_t i = 0; i < stateHashCount; i++)
+        {
+            FAWorld::Tick tick = loader.load<FAWorld::Tick>();
+            checkStateHash(peer, tick, loader.load<uint64_t>());
+        }
+
         std::map<uint32_t, std::vector<FAWorld::PlayerInput>> inputSetsInPacket;
         while (loader.load<bool>())
         {
@@ -389,32 +455,94 @@ namespace Engine
         }
     }
 
+    void Server::checkStateHash(Peer& peer, FAWorld::Tick tick, uint64_t hash)
+    {
+        auto it = mStateHashes.find(tick);
+        if (tick <= peer.lastStateHashChecked || it == mStateHashes.end())
+            return;
+
+        peer.lastStateHashChecked = tick;
+
+        if (it->second == hash || peer.desynced)
+            return;
+
+        peer.desynced = true;
+        std::cerr << "Desync detected with player " << peer.actorId << " at tick " << tick << std::endl;
+
+        // We're ahead of the client, so we can't go back and dump the tick that mismatched. Instead, we both dump the
+        // next tick we haven't run yet. The state will still be diverged by then, and the two dumps can be diffed.
+        mDesyncDumpTick = mWorld.getCurrentTick() + 1;
+
+        std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(DebugSettings::NetworkStreamFormat);
+        FASaveGame::GameSaver saver(*stream);
+        saver.save(uint8_t(MessageType::DesyncToClient));
+        saver.save(mDesyncDumpTick);
+
+        auto data = stream->getData();
+        ENetPacket* packet = enet_packet_create(data.first, data.second, ENET_PACKET_FLAG_RELIABLE);
+        enet_peer_send(peer.peer, RELIABLE_CHANNEL_ID, packet);
+    }
+
+    void Server::updateStats()
+    {
+        mPeerStats.clear();
+
+        for (const auto& pair : mPeers)
+        {
+            const Peer& peer = pair.second;
+
+            PeerStats stats;
+            stats.actorId = peer.actorId;
+            stats.ticksBehind = mStatsAverager.getAverage(std::to_string(peer.actorId) + "_ticks_behind", mWorld.getCurrentTick() - peer.lastTick);
+            stats.bytesPerTick = mStatsAverager.getAverage(std::to_string(peer.actorId) + "_bytes_sent_per_tick", peer.bytesSentLastTick);
+            stats.bytesPerSecond = mStatsAverager.getAverage(std::to_string(peer.actorId) + "_bytes_sent_per_second",
+                                                             peer.bytesSentLastTick * FAWorld::World::getTicksInPeriod(FixedPoint(1)));
+            stats.packetLoss = peer.packetLoss;
+            stats.copies = InputsPacket::copiesForPacketLoss(peer.packetLoss);
+
+            mPeerStats.push_back(stats);
+        }
+    }
+
+    std::string Server::getStatsString() const
+    {
+        std::string result = "tick " + std::to_string(mWorld.getCurrentTick()) + ", " + std::to_string(mPeers.size()) + " peers";
+
+        for (const PeerStats& stats : mPeerStats)
+        {
+            result += fmt::format(" | player {}: {:.1f} ticks behind, {:.1f} bytes/tick, {}/s, {:.1f}% loss, {} copies",
+                                  stats.actorId,
+                                  stats.ticksBehind,
+                                  stats.bytesPerTick,
+                                  Misc::numberToHumanFileSize(stats.bytesPerSecond),
+                                  stats.packetLoss * 100.0,
+                                  stats.copies);
+        }
+
+        return result;
+    }
+
     void Server::doMultiplayerGui(nk_context* ctx)
     {
         if (nk_begin(ctx, "Players", nk_rect(0, 0, 600, 200), NK_WINDOW_TITLE | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_MINIMIZABLE))
         {
-            nk_layout_row_dynamic(ctx, 30, 4);
+            nk_layout_row_dynamic(ctx, 30, 6);
 
             nk_label(ctx, "Player ID", NK_TEXT_CENTERED);
             nk_label(ctx, "Ticks behind", NK_TEXT_CENTERED);
             nk_label(ctx, "Bytes/Tick", NK_TEXT_CENTERED);
             nk_label(ctx, "Bytes/Second", NK_TEXT_CENTERED);
+            nk_label(ctx, "Loss", NK_TEXT_CENTERED);
+            nk_label(ctx, "Copies", NK_TEXT_CENTERED);
 
-            for (const auto& pair : mPeers)
+            for (const PeerStats& stats : mPeerStats)
             {
-                const Peer& peer = pair.second;
-
-                nk_label(ctx, std::to_string(peer.actorId).c_str(), NK_TEXT_CENTERED);
-
-                double ticksBehind = mStatsAverager.getAverage(std::to_string(peer.actorId) + "_ticks_behind", mWorld.getCurrentTick() - peer.lastTick);
-                nk_label(ctx, std::to_string(ticksBehind).c_str(), NK_TEXT_RIGHT);
-
-                double bytesPerTick = mStatsAverager.getAverage(std::to_string(peer.actorId) + "_bytes_sent_per_tick", peer.bytesSentLastTick);
-                nk_label(ctx, std::to_string(bytesPerTick).c_str(), NK_TEXT_RIGHT);
-
-                double bytesPerSec = mStatsAverager.getAverage(std::to_string(peer.actorId) + "_bytes_sent_per_second",
-                                                               peer.bytesSentLastTick * FAWorld::World::getTicksInPeriod(FixedPoint(1)));
-                nk_label(ctx, Misc::numberToHumanFileSize(bytesPerSec).c_str(), NK_TEXT_RIGHT);
+                nk_label(ctx, std::to_string(stats.actorId).c_str(), NK_TEXT_CENTERED);
+                nk_label(ctx, std::to_string(stats.ticksBehind).c_str(), NK_TEXT_RIGHT);
+                nk_label(ctx, std::to_string(stats.bytesPerTick).c_str(), NK_TEXT_RIGHT);
+                nk_label(ctx, Misc::numberToHumanFileSize(stats.bytesPerSecond).c_str(), NK_TEXT_RIGHT);
+                nk_label(ctx, fmt::format("{:.1f}%", stats.packetLoss * 100.0).c_str(), NK_TEXT_RIGHT);
+                nk_label(ctx, std::to_string(stats.copies).c_str(), NK_TEXT_RIGHT);
             }
         }
         nk_end(ctx);
@@ -1,6 +1,8 @@
 #pragma once
 #include "multiplayerinterface.h"
+#include "netcommon.h"
 #include <enet/enet.h>
+#include <memory>
 #include <misc/averager.h>
 #include <unordered_map>
 
@@ -16,19 +18,48 @@ namespace Engine
     class Server : public MultiplayerInterface
     {
     public:
-        Server(FAWorld::World& world, LocalInputHandler& localInputHandler);
+        static constexpr size_t DEFAULT_MAX_PEERS = 32;
+
+        Server(FAWorld::World& world, LocalInputHandler& localInputHandler, uint16_t port = DEFAULT_PORT, size_t maxPeers = DEFAULT_MAX_PEERS);
         virtual ~Server();
 
         virtual std::optional<std::vector<FAWorld::PlayerInput>> getAndClearInputs(FAWorld::Tick tick) override;
         virtual void update() override;
-        virtual void verify(FAWorld::Tick) override {}
+        virtual void verify(FAWorld::Tick tick) override;
         virtual bool isServer() const override { return true; }
         virtual bool isMultiplayer() const override { return !mPeers.empty(); }
         virtual bool isPlayerRegistered(uint32_t peerId) const override;
         virtual void registerNewPlayer(FAWorld::Player* player, uint32_t peerId) override;
         virtual void doMultiplayerGui(nk_context* ctx) override;
 
+        struct PeerStats
+        {
+            int32_t actorId = -1;
+            double ticksBehind = 0;
+            double bytesPerTick = 0;
+            double bytesPerSecond = 0;
+            double packetLoss = 0;
+            int32_t copies = 1;
+        };
+
+        // Running averages, updated once per update() call
+        const std::vector<PeerStats>& getPeerStats() const { return mPeerStats; }
+        std::string getStatsString() const;
+
     private:
+        struct SentTick
+        {
+            int32_t copies = 0;
+            FAWorld::Tick lastSentTick = 0;
+        };
+
+        struct MapSnapshot
+        {
+            FAWorld::Tick tick = 0;
+            uint32_t uncompressedSize = 0;
+            std::string compressed;
+        };
+
         struct Peer
         {
             Peer() = default;
@@ -37,13 +68,25 @@ namespace Engine
             ENetPeer* peer = nullptr;
             bool hasMap = false;
             bool mapSent = false;
+            std::shared_ptr<const MapSnapshot> mapTransfer; ///< Set while we're still sending this peer its map
+            size_t mapTransferOffset = 0;
 
             FAWorld::Tick lastTick = 0;
             uint32_t lastInputSetIdReceived = 0;
 
             int32_t actorId = -1;
             size_t bytesSentLastTick = 0;
-            FAWorld::Tick lastSentTick = -1;
+
+            // Ticks at or after lastTick that we've sent, so the peer hasn't acknowledged them yet
+            std::map<FAWorld::Tick, SentTick> sentTicks;
+
+            uint32_t inputPacketsSent = 0;
+            uint32_t lossSampleHighestPacket = 0;
+            uint32_t lossSampleReceived = 0;
+            double packetLoss = 0;
+
+            FAWorld::Tick lastStateHashChecked = -1;
+            bool desynced = false;
         };
 
         void handleMapSending();
@@ -51,16 +94,22 @@ namespace Engine
         void processInputs();
         void onPeerConnect(const ENetEvent& event);
         void onPeerDisconnect(const ENetEvent& event);
-        void sendMapToPeer(Peer& peer);
+        void startMapTransfer(Peer& peer);
+        void sendMapFragments(Peer& peer);
         void readPeerPacket(const ENetEvent& event);
         void sendInputsToClients(std::vector<FAWorld::PlayerInput>& inputs);
         void receiveClientUpdate(FASaveGame::GameLoader& loader, Peer& peer);
+        void checkStateHash(Peer& peer, FAWorld::Tick tick, uint64_t hash);
+        void updateStats();
 
         static const char* SERVER_ADDRESS;
 
         bool mDoFullVerify = false;
         FAWorld::Tick mLastTickVerified = -1;
 
+        std::map<FAWorld::Tick, uint64_t> mStateHashes;
+        FAWorld::Tick mDesyncDumpTick = -1;
+
         FAWorld::World& mWorld;
         LocalInputHandler& mLocalInputHandler;
 
@@ -68,7 +117,9 @@ namespace Engine
         std::vector<FAWorld::PlayerInput> mInputsBuffer;
 
         // Inputs from old ticks that clients might not have yet
-        std::unordered_map<FAWorld::Tick, std::vector<FAWorld::PlayerInput>> mOldInputs;
+        std::shared_ptr<const MapSnapshot> mMapSnapshot; ///< Taken this tick, and shared by everyone who joins on it
+        std::map<FAWorld::Tick, std::string> mEncodedInputs; ///< Every tick that a peer might still need, see InputsPacket
+        std::vector<FAWorld::Tick> mTicksToSend;
 
         // This is where we locally store inputs to be executed by the server.
         // They are accumulated in mInputsBuffer, and eventually both sent to clients and moved into here.
@@ -83,8 +134,15 @@ namespace Engine
         std::map<uint32_t, Peer> mPeers;
 
         Misc::Averager mStatsAverager;
+        std::vector<PeerStats> mPeerStats;
+
+        static constexpr size_t UPDATE_PACKET_START_PADDING = InputsPacket::PACKET_START_PADDING;
+        static constexpr size_t MAX_UPDATE_PACKET_SIZE = InputsPacket::MAX_PACKET_SIZE;
+
+        static constexpr size_t MAX_QUEUED_MAP_COMMANDS = 64;
 
-        static constexpr size_t UPDATE_PACKET_START_PADDING = 50;
-        static constexpr size_t MAX_UPDATE_PACKET_SIZE = 1000;
+        static constexpr FAWorld::Tick RESEND_MARGIN_TICKS = 3; ///< How long past the round trip time we wait for a tick to be acknowledged
+        static constexpr uint32_t LOSS_SAMPLE_PACKETS = 30;
+        static constexpr double LOSS_SMOOTHING = 0.2;
     };
 }
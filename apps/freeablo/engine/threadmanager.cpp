@@ -3,6 +3,7 @@
 #include "debugsettings.h"
 #include <chrono>
 #include <input/inputmanager.h>
+#include <iomanip>
 #include <iostream>
 
 namespace Engine
@@ -10,7 +11,13 @@ namespace Engine
     ThreadManager* ThreadManager::mThreadManager = nullptr;
     ThreadManager* ThreadManager::get() { return mThreadManager; }
 
-    ThreadManager::ThreadManager() : mQueue(100), mRenderState(nullptr), mAudioManager(50, 100) { mThreadManager = this; }
+    ThreadManager::ThreadManager(bool headless) : mQueue(100), mHeadless(headless)
+    {
+        if (!mHeadless)
+            mAudioManager = std::make_unique<FAAudio::AudioManager>(50, 100);
+
+        mThreadManager = this;
+    }
 
     void ThreadManager::run()
     {
@@ -20,22 +27,27 @@ namespace Engine
 
         auto last = std::chrono::system_clock::now();
         size_t numFrames = 0;
+        std::chrono::steady_clock::duration maxMessageTime = {};
 
         while (true)
         {
+            // Audio is loaded on the audio manager's own thread, so this should only ever take as long as queueing a request
+            auto messagesStart = std::chrono::steady_clock::now();
             while (mQueue.front())
             {
                 handleMessage(*mQueue.front());
                 mQueue.pop();
             }
+            maxMessageTime = std::max(maxMessageTime, std::chrono::steady_clock::now() - messagesStart);
 
             inputManager->poll();
 
-            if (!renderer->renderFrame(mRenderState))
+            FARender::RenderState* renderState = renderer->getLatestState();
+            if (!renderer->renderFrame(renderState))
                 break;
 
             auto now = std::chrono::system_clock::now();
-            if (mRenderState)
+            if (renderState)
                 numFrames++;
 
             size_t duration =
@@ -43,10 +55,23 @@ namespace Engine
 
             if (duration >= MAXIMUM_DURATION_IN_MS)
             {
+                FARender::RenderLatencyStats latency = renderer->takeLatencyStats();
+
                 std::stringstream ss;
-                ss << "(" << ((float)numFrames) / (((float)duration) / MAXIMUM_DURATION_IN_MS) << " FPS)";
+                ss << "(" << ((float)numFrames) / (((float)duration) / MAXIMUM_DURATION_IN_MS) << " FPS, ";
+                ss << std::fixed << std::setprecision(1) << latency.averageMilliseconds() << "ms latency, " << latency.maxMilliseconds() << "ms max, ";
+                ss << std::chrono::duration<double, std::milli>(maxMessageTime).count() << "ms max audio on render thread";
+
+                if (mAudioManager)
+                {
+                    FAAudio::AudioLoadStats audioLoads = mAudioManager->takeLoadStats();
+                    ss << ", " << audioLoads.loads << " audio loads " << audioLoads.maxMilliseconds() << "ms max";
+                }
+
+                ss << ")";
                 Render::setWindowTitle(Render::getWindowTitle() + " " + ss.str());
                 numFrames = 0;
+                maxMessageTime = {};
                 last = now;
             }
         }
@@ -54,79 +79,84 @@ namespace Engine
 
     void ThreadManager::playMusic(const std::string& path)
     {
-        if (DebugSettings::DisableMusic)
+        if (DebugSettings::DisableMusic || mHeadless)
             return;
 
         Message message = {};
         message.type = ThreadState::PLAY_MUSIC;
-        message.data.musicPath = new std::string(path);
+        message.sound = FAAudio::SoundId::intern(path);
 
         mQueue.push(message);
     }
 
-    void ThreadManager::playSound(const std::string& path)
+    void ThreadManager::playSound(FAAudio::SoundId sound)
     {
-        if (path.empty())
+        if (!sound.isValid())
         {
             std::cerr << "Attempt to play invalid sound!" << std::endl;
             return;
         }
 
+        if (mHeadless)
+            return;
+
         Message message = {};
         message.type = ThreadState::PLAY_SOUND;
-        message.data.soundPath = new std::string(path);
+        message.sound = sound;
 
         mQueue.push(message);
     }
 
     void ThreadManager::stopSound()
     {
+        if (mHeadless)
+            return;
+
         Message message = {};
         message.type = ThreadState::STOP_SOUND;
         mQueue.push(message);
     }
 
-    bool ThreadManager::isPlayingSound() const { return mAudioManager.isPlayingSound(); }
-
-    void ThreadManager::sendRenderState(FARender::RenderState* state)
+    void ThreadManager::preloadSounds(std::vector<FAAudio::SoundId> sounds)
     {
+        if (mHeadless || sounds.empty())
+            return;
+
         Message message = {};
-        message.type = ThreadState::RENDER_STATE;
-        message.data.renderState = state;
+        message.type = ThreadState::PRELOAD_SOUNDS;
+        message.preloadSounds = new std::vector<FAAudio::SoundId>(std::move(sounds));
 
         mQueue.push(message);
     }
 
+    bool ThreadManager::isPlayingSound() const { return mAudioManager && mAudioManager->isPlayingSound(); }
+
     void ThreadManager::handleMessage(const Message& message)
     {
         switch (message.type)
         {
             case ThreadState::PLAY_MUSIC:
             {
-                mAudioManager.playMusic(*message.data.musicPath);
-                delete message.data.musicPath;
+                mAudioManager->playMusic(message.sound);
                 break;
             }
 
             case ThreadState::PLAY_SOUND:
             {
-                mAudioManager.playSound(*message.data.soundPath);
-                delete message.data.soundPath;
+                mAudioManager->playSound(message.sound);
                 break;
             }
 
             case ThreadState::STOP_SOUND:
             {
-                mAudioManager.stopSound();
+                mAudioManager->stopSound();
                 break;
             }
 
-            case ThreadState::RENDER_STATE:
+            case ThreadState::PRELOAD_SOUNDS:
             {
-                if (mRenderState && mRenderState != message.data.renderState)
-                    mRenderState->ready = true;
-
-                mRenderState = message.data.renderState;
+                mAudioManager->preloadSounds(*message.preloadSounds);
+                delete message.preloadSounds;
                 break;
             }
         }
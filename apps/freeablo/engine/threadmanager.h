@@ -1,5 +1,6 @@
 #pragma once
 #include "../faaudio/audiomanager.h"
+#include <memory>
 #include <string>
 
 // clang-format off
@@ -8,11 +9,6 @@
 #include <misc/enablewarn.h>
 // clang-format on
 
-namespace FARender
-{
-    class RenderState;
-}
-
 namespace Engine
 {
     enum class ThreadState
@@ -20,40 +16,41 @@ namespace Engine
         PLAY_MUSIC,
         PLAY_SOUND,
         STOP_SOUND,
-        RENDER_STATE,
+        PRELOAD_SOUNDS,
     };
 
     struct Message
     {
         ThreadState type;
-
-        union
-        {
-            std::string* musicPath;
-            std::string* soundPath;
-            FARender::RenderState* renderState;
-            std::vector<uint32_t>* preloadSpriteIds;
-        } data;
+        FAAudio::SoundId sound;
+        std::vector<FAAudio::SoundId>* preloadSounds; ///< only set for PRELOAD_SOUNDS, which is rare enough that it can allocate
     };
 
     class ThreadManager
     {
     public:
         static ThreadManager* get();
-        ThreadManager();
+
+        // A headless ThreadManager has no audio device and discards all messages, for running the simulation without a window
+        explicit ThreadManager(bool headless = false);
         void run();
         void playMusic(const std::string& path);
-        void playSound(const std::string& path);
+        /// Sounds played often, like hits and deaths in combat, should be interned once and played by id, so playing them doesn't
+        /// have to allocate or look up the path.
+        void playSound(FAAudio::SoundId sound);
+        void playSound(const std::string& path) { playSound(FAAudio::SoundId::intern(path)); }
         void stopSound();
         bool isPlayingSound() const;
-        void sendRenderState(FARender::RenderState* state);
+
+        /// Warms the audio cache with sounds that are likely to be played soon, e.g. the ones used by a level that was just entered
+        void preloadSounds(std::vector<FAAudio::SoundId> sounds);
 
     private:
         void handleMessage(const Message& message);
 
         static ThreadManager* mThreadManager; ///< Singleton instance
         rigtorp::SPSCQueue<Message> mQueue;
-        FARender::RenderState* mRenderState;
-        FAAudio::AudioManager mAudioManager;
+        bool mHeadless = false;
+        std::unique_ptr<FAAudio::AudioManager> mAudioManager;
     };
 }
@@ -1,20 +1,33 @@
 #include "audiomanager.h"
+#include <algorithm>
 #include <iostream>
 #include <misc/assert.h>
-#include <string>
+#include <utility>
 
 namespace FAAudio
 {
-    AudioManager::AudioManager(int32_t channelCount, size_t cacheSize) : mCacheSize(cacheSize), mCount(0), mCurrentMusic(NULL), mIsPlayingSound(false)
+    AudioManager::AudioManager(int32_t channelCount, size_t cacheSize) : mCacheSize(cacheSize), mRequests(256)
     {
         Audio::init(channelCount);
         mPlaying.resize(channelCount);
+
+        mThread = std::thread([this] { run(); });
     }
 
     AudioManager::~AudioManager()
     {
-        for (std::map<std::string, CacheEntry>::iterator it = mCache.begin(); it != mCache.end(); ++it)
-            Audio::freeSound(it->second.sound);
+        {
+            std::lock_guard<std::mutex> lock(mRequestMutex);
+            mStopping = true;
+        }
+        mRequestCondition.notify_one();
+        mThread.join();
+
+        for (const CacheEntry& entry : mCache)
+        {
+            if (entry.sound)
+                Audio::freeSound(entry.sound);
+        }
 
         if (mCurrentMusic)
             Audio::freeMusic(mCurrentMusic);
@@ -22,80 +35,206 @@ namespace FAAudio
         Audio::quit();
     }
 
-    void AudioManager::playSound(const std::string& path)
+    void AudioManager::playSound(SoundId sound)
     {
         mIsPlayingSound = true;
+        queueRequest({Request::Type::PlaySound, sound});
+    }
 
-        if (mCache.find(path) == mCache.end())
+    void AudioManager::stopSound()
+    {
+        mIsPlayingSound = false;
+        queueRequest({Request::Type::StopSound, SoundId()});
+    }
+
+    bool AudioManager::isPlayingSound() const { return mIsPlayingSound; }
+
+    void AudioManager::playMusic(SoundId music) { queueRequest({Request::Type::PlayMusic, music}); }
+
+    void AudioManager::preloadSounds(const std::vector<SoundId>& sounds)
+    {
         {
-            if (mCount >= mCacheSize)
+            std::lock_guard<std::mutex> lock(mRequestMutex);
+            mPreloads.insert(mPreloads.end(), sounds.begin(), sounds.end());
+        }
+        mRequestCondition.notify_one();
+    }
+
+    AudioLoadStats AudioManager::takeLoadStats()
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        return std::exchange(mLoadStats, AudioLoadStats());
+    }
+
+    void AudioManager::queueRequest(const Request& request)
+    {
+        mRequests.push(request);
+
+        // Taking the lock, even though we don't change anything under it, makes sure the audio thread is either waiting or hasn't
+        // checked the queue yet, so it can't miss this notification
+        {
+            std::lock_guard<std::mutex> lock(mRequestMutex);
+        }
+        mRequestCondition.notify_one();
+    }
+
+    void AudioManager::run()
+    {
+        while (true)
+        {
+            SoundId preload;
+
             {
-                // find the least recently used CacheEntry that is not still playing, and evict it
-                std::list<std::string>::reverse_iterator it = mUsedList.rbegin();
-                for (; it != mUsedList.rend(); ++it)
+                std::unique_lock<std::mutex> lock(mRequestMutex);
+                mRequestCondition.wait(lock, [&] { return mStopping || mRequests.front() || !mPreloads.empty(); });
+
+                if (mStopping)
+                    return;
+
+                if (!mRequests.front())
                 {
-                    bool playing = false;
-
-                    for (size_t i = 0; i < mPlaying.size(); i++)
-                    {
-                        if (mPlaying[i] == *it)
-                        {
-                            if (Audio::channelPlaying(i))
-                            {
-                                playing = true;
-                                break;
-                            }
-                        }
-                    }
-
-                    if (!playing)
-                        break;
+                    preload = mPreloads.front();
+                    mPreloads.pop_front();
                 }
+            }
 
-                release_assert(it != mUsedList.rend() && "no evictable sounds found, this should never happen");
+            if (preload.isValid())
+            {
+                getSound(preload);
+            }
+            else
+            {
+                handleRequest(*mRequests.front());
+                mRequests.pop();
+            }
+        }
+    }
 
-                std::cerr << "EVICTING " << *it << std::endl;
+    void AudioManager::handleRequest(const Request& request)
+    {
+        switch (request.type)
+        {
+            case Request::Type::PlaySound:
+            {
+                int channel = Audio::playSound(getSound(request.sound));
+                if (channel >= 0)
+                    mPlaying[channel] = request.sound;
+                break;
+            }
+
+            case Request::Type::StopSound:
+            {
+                Audio::stopSound();
+                break;
+            }
 
-                CacheEntry toEvict = mCache[*it];
+            case Request::Type::PlayMusic:
+            {
+                if (mCurrentMusic != NULL)
+                    Audio::freeMusic(mCurrentMusic);
 
-                Audio::freeMusic(toEvict.sound);
+                auto start = std::chrono::steady_clock::now();
+                mCurrentMusic = Audio::loadMusic(request.sound.path());
+                recordLoad(start);
 
-                mCache.erase(*it);
-                mUsedList.erase(--(it.base()));
-                mCount--;
+                Audio::playMusic(mCurrentMusic);
+                break;
             }
+        }
+    }
+
+    Audio::Sound* AudioManager::getSound(SoundId id)
+    {
+        if (id.index() >= mCache.size())
+            mCache.resize(SoundId::count());
+
+        uint32_t index = id.index();
 
-            mUsedList.push_front(path);
-            mCache[path] = CacheEntry(Audio::loadSound(path), mUsedList.begin());
-            mCount++;
+        if (mCache[index].sound)
+        {
+            unlink(index);
+            linkAtFront(index);
+            return mCache[index].sound;
         }
-        else
+
+        if (mCount >= mCacheSize)
+        {
+            // find the least recently used sound that is not still playing, and evict it
+            uint32_t toEvict = mLeastRecentlyUsed;
+            while (toEvict != NONE && isPlaying(toEvict))
+                toEvict = mCache[toEvict].previous;
+
+            release_assert(toEvict != NONE && "no evictable sounds found, this should never happen");
+
+            std::cerr << "EVICTING " << mCache[toEvict].id.path() << std::endl;
+
+            unlink(toEvict);
+            Audio::freeSound(mCache[toEvict].sound);
+            mCache[toEvict].sound = nullptr;
+            mCount--;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        mCache[index].id = id;
+        mCache[index].sound = Audio::loadSound(id.path());
+        recordLoad(start);
+
+        linkAtFront(index);
+        mCount++;
+
+        return mCache[index].sound;
+    }
+
+    bool AudioManager::isPlaying(uint32_t index) const
+    {
+        for (size_t i = 0; i < mPlaying.size(); i++)
         {
-            // move to top of used list
-            mUsedList.erase(mCache[path].usedListIt);
-            mUsedList.push_front(path);
-            mCache[path].usedListIt = mUsedList.begin();
+            if (mPlaying[i].index() == index && Audio::channelPlaying(int32_t(i)))
+                return true;
         }
 
-        int channel = Audio::playSound(mCache[path].sound);
-        if (channel >= 0)
-            mPlaying[channel] = path;
+        return false;
     }
 
-    void AudioManager::stopSound()
+    void AudioManager::unlink(uint32_t index)
     {
-        mIsPlayingSound = false;
-        Audio::stopSound();
+        CacheEntry& entry = mCache[index];
+
+        if (entry.previous != NONE)
+            mCache[entry.previous].next = entry.next;
+        else
+            mMostRecentlyUsed = entry.next;
+
+        if (entry.next != NONE)
+            mCache[entry.next].previous = entry.previous;
+        else
+            mLeastRecentlyUsed = entry.previous;
+
+        entry.previous = NONE;
+        entry.next = NONE;
     }
 
-    bool AudioManager::isPlayingSound() const { return mIsPlayingSound; }
+    void AudioManager::linkAtFront(uint32_t index)
+    {
+        CacheEntry& entry = mCache[index];
+        entry.previous = NONE;
+        entry.next = mMostRecentlyUsed;
 
-    void AudioManager::playMusic(const std::string& path)
+        if (mMostRecentlyUsed != NONE)
+            mCache[mMostRecentlyUsed].previous = index;
+        else
+            mLeastRecentlyUsed = index;
+
+        mMostRecentlyUsed = index;
+    }
+
+    void AudioManager::recordLoad(std::chrono::steady_clock::time_point start)
     {
-        if (mCurrentMusic != NULL)
-            Audio::freeMusic(mCurrentMusic);
+        std::chrono::steady_clock::duration duration = std::chrono::steady_clock::now() - start;
 
-        mCurrentMusic = Audio::loadMusic(path);
-        Audio::playMusic(mCurrentMusic);
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mLoadStats.loads++;
+        mLoadStats.total += duration;
+        mLoadStats.max = std::max(mLoadStats.max, duration);
     }
 }
@@ -1,46 +1,111 @@
 #pragma once
+#include "soundid.h"
+#include <atomic>
 #include <audio/fa_audio.h>
-#include <list>
-#include <map>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
 #include <stdint.h>
-#include <string>
+#include <thread>
 #include <vector>
 
-namespace Engine
-{
-    class ThreadManager;
-}
+// clang-format off
+#include <misc/disablewarn.h>
+#include <rigtorp/SPSCQueue.h>
+#include <misc/enablewarn.h>
+// clang-format on
 
 namespace FAAudio
 {
-    struct CacheEntry
+    /// Time the audio thread spent reading and decoding sounds and music
+    struct AudioLoadStats
     {
-        Audio::Sound* sound;
-        std::list<std::string>::iterator usedListIt;
+        size_t loads = 0;
+        std::chrono::steady_clock::duration total = {};
+        std::chrono::steady_clock::duration max = {};
 
-        CacheEntry(Audio::Sound* _sound, std::list<std::string>::iterator _usedListIt) : sound(_sound), usedListIt(_usedListIt) {}
-
-        CacheEntry() {}
+        double averageMilliseconds() const { return loads ? std::chrono::duration<double, std::milli>(total).count() / loads : 0.0; }
+        double maxMilliseconds() const { return std::chrono::duration<double, std::milli>(max).count(); }
     };
 
+    /// Loads and plays audio on its own thread. The public functions only queue a request for that thread, so they never wait on
+    /// file IO or decoding, and playing a sound doesn't allocate. Requests are handled in the order they were made, and preloads are
+    /// only done when no other requests are waiting. Requests must all be made from the same thread.
     class AudioManager
     {
     public:
         AudioManager(int32_t channelCount, size_t cacheSize);
         ~AudioManager();
 
-        void playSound(const std::string& path);
+        void playSound(SoundId sound);
         void stopSound();
-        void playMusic(const std::string& path);
+        void playMusic(SoundId music);
         bool isPlayingSound() const;
 
+        /// Loads sounds into the cache ahead of time, so playing them later doesn't have to wait for them to load
+        void preloadSounds(const std::vector<SoundId>& sounds);
+
+        AudioLoadStats takeLoadStats();
+
+    private:
+        struct Request
+        {
+            enum class Type
+            {
+                PlaySound,
+                StopSound,
+                PlayMusic,
+            };
+
+            Type type;
+            SoundId sound;
+        };
+
+        /// The sound cache is indexed by SoundId. Loaded entries are also linked together from most to least recently used,
+        /// so using a sound or evicting the oldest one doesn't have to search.
+        struct CacheEntry
+        {
+            SoundId id;
+            Audio::Sound* sound = nullptr;
+            uint32_t previous = NONE;
+            uint32_t next = NONE;
+        };
+
+        static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+        void queueRequest(const Request& request);
+        void run();
+        void handleRequest(const Request& request);
+
+        Audio::Sound* getSound(SoundId id);
+        bool isPlaying(uint32_t index) const;
+        void unlink(uint32_t index);
+        void linkAtFront(uint32_t index);
+        void recordLoad(std::chrono::steady_clock::time_point start);
+
     private:
-        std::vector<std::string> mPlaying;
-        std::map<std::string, CacheEntry> mCache;
-        std::list<std::string> mUsedList;
+        // Only touched by the audio thread
+        std::vector<SoundId> mPlaying; ///< the sound last played on each channel
+        std::vector<CacheEntry> mCache;
+        uint32_t mMostRecentlyUsed = NONE;
+        uint32_t mLeastRecentlyUsed = NONE;
         size_t mCacheSize;
-        size_t mCount;
-        Audio::Music* mCurrentMusic;
-        bool mIsPlayingSound;
+        size_t mCount = 0;
+        Audio::Music* mCurrentMusic = nullptr;
+
+        std::atomic_bool mIsPlayingSound = false;
+
+        rigtorp::SPSCQueue<Request> mRequests;
+        std::mutex mRequestMutex;
+        std::condition_variable mRequestCondition;
+        std::deque<SoundId> mPreloads;
+        bool mStopping = false;
+
+        std::mutex mStatsMutex;
+        AudioLoadStats mLoadStats;
+
+        std::thread mThread;
     };
 }
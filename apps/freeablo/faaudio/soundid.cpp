@@ -0,0 +1,59 @@
+#include "soundid.h"
+#include <deque>
+#include <misc/assert.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace FAAudio
+{
+    namespace
+    {
+        struct Registry
+        {
+            std::mutex mutex;
+            std::deque<std::string> paths; ///< a deque so references to paths stay valid as more are added
+            std::unordered_map<std::string, uint32_t> indices;
+        };
+
+        Registry& getRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+    }
+
+    SoundId SoundId::intern(const std::string& path)
+    {
+        if (path.empty())
+            return SoundId();
+
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        auto it = registry.indices.find(path);
+        if (it != registry.indices.end())
+            return SoundId(it->second);
+
+        uint32_t index = uint32_t(registry.paths.size());
+        registry.paths.push_back(path);
+        registry.indices[path] = index;
+
+        return SoundId(index);
+    }
+
+    uint32_t SoundId::count()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return uint32_t(registry.paths.size());
+    }
+
+    const std::string& SoundId::path() const
+    {
+        release_assert(isValid());
+
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return registry.paths[mIndex];
+    }
+}
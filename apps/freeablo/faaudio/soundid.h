@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace FAAudio
+{
+    /// An interned sound or music path. Interning a path takes a lock and a lookup, but after that a SoundId can be copied around,
+    /// queued and used as an index without touching the string again, so hot paths should intern once and keep the id.
+    class SoundId
+    {
+    public:
+        SoundId() = default;
+
+        /// Returns the same id every time for the same path. An empty path gives an invalid id.
+        static SoundId intern(const std::string& path);
+
+        /// The number of ids handed out so far, all ids have an index less than this
+        static uint32_t count();
+
+        bool isValid() const { return mIndex != INVALID; }
+        uint32_t index() const { return mIndex; }
+        const std::string& path() const;
+
+        bool operator==(const SoundId& other) const { return mIndex == other.mIndex; }
+        bool operator!=(const SoundId& other) const { return mIndex != other.mIndex; }
+        bool operator<(const SoundId& other) const { return mIndex < other.mIndex; }
+
+    private:
+        static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+
+        explicit SoundId(uint32_t index) : mIndex(index) {}
+
+        uint32_t mIndex = INVALID;
+    };
+}
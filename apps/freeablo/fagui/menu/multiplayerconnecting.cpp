@@ -15,7 +15,24 @@ namespace FAGui
 
         if (mState == State::Connecting)
         {
-            nk_label(ctx, "Connecting...", NK_TEXT_CENTERED);
+            auto multiplayer = static_cast<Engine::Client*>(mMenuHandler.engine().mMultiplayer.get());
+            std::optional<float> mapProgress = multiplayer ? multiplayer->getMapDownloadProgress() : std::nullopt;
+
+            if (mapProgress)
+            {
+                nk_label(ctx, ("Downloading map... " + std::to_string(int32_t(*mapProgress * 100)) + "%").c_str(), NK_TEXT_CENTERED);
+
+                nk_size progress = nk_size(*mapProgress * 100);
+                nk_progress(ctx, &progress, 100, nk_false);
+            }
+            else if (multiplayer && multiplayer->isConnected())
+            {
+                nk_label(ctx, "Waiting for map...", NK_TEXT_CENTERED);
+            }
+            else
+            {
+                nk_label(ctx, "Connecting...", NK_TEXT_CENTERED);
+            }
         }
         else
         {
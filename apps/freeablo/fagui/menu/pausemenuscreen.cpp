@@ -1,4 +1,5 @@
 #include "pausemenuscreen.h"
+#include "../../engine/debugsettings.h"
 #include "../../engine/enginemain.h"
 #include "../../farender/animationplayer.h"
 #include "../../farender/renderer.h"
@@ -6,7 +7,7 @@
 #include "../../faworld/world.h"
 #include "../menuhandler.h"
 #include "../nkhelpers.h"
-#include "serial/textstream.h"
+#include "serial/streamformat.h"
 #include <cstring>
 #include <render/spritegroup.h>
 
@@ -56,10 +57,10 @@ namespace FAGui
         FAWorld::World* world = Engine::EngineMain::get()->mWorld.get();
         mMenuItems.push_back({drawItem("Save Game"), [this, world]() {
                                   {
-                                      Serial::TextWriteStream writeStream;
-                                      FASaveGame::GameSaver saver(writeStream);
+                                      std::unique_ptr<Serial::WriteStreamInterface> writeStream = Serial::createWriteStream(DebugSettings::SaveStreamFormat);
+                                      FASaveGame::GameSaver saver(*writeStream);
                                       world->save(saver);
-                                      std::pair<uint8_t*, size_t> writtenData = writeStream.getData();
+                                      std::pair<uint8_t*, size_t> writtenData = writeStream->getData();
                                       FILE* f = fopen("save.sav", "wb");
                                       fwrite(writtenData.first, 1, writtenData.second, f);
                                       fclose(f);
@@ -1,4 +1,5 @@
 #include "levelrenderer.h"
+#include "spriteloader.h"
 #include <level/level.h>
 #include <render/commandqueue.h>
 #include <render/debugrenderer.h>
@@ -16,9 +17,92 @@ namespace FARender
 {
     static Vec2i getCurrentResolution() { return {Render::getWindowSize().windowWidth, Render::getWindowSize().windowHeight}; }
 
-    void DrawLevelCache::addSprite(const Render::TextureReference* atlasEntry, int32_t x, int32_t y, std::optional<ByteColour> highlightColor)
+    // clang-format off
+    static Render::SpriteVertexMain spriteBaseVertices[] =
     {
-        mSpritesToDraw.push_back(SpriteData{atlasEntry, x, y, highlightColor});
+        {{0, 0},  {0, 0}},
+        {{1, 0},  {1, 0}},
+        {{1, 1},  {1, 1}},
+        {{0, 0},  {0, 0}},
+        {{1, 1},  {1, 1}},
+        {{0, 1},  {0, 1}}
+    };
+    // clang-format on
+
+    static Render::SpriteVertexPerInstance
+    makeSpriteInstance(const Render::TextureReference& atlasEntry, int32_t x, int32_t y, std::optional<ByteColour> highlightColor, float zBufferVal)
+    {
+        Render::SpriteVertexPerInstance vertexData = {};
+
+        vertexData.v_spriteSizeInPixels[0] = atlasEntry.mTrimmedWidth;
+        vertexData.v_spriteSizeInPixels[1] = atlasEntry.mTrimmedHeight;
+
+        vertexData.v_atlasOffsetInPixels[0] = atlasEntry.mX;
+        vertexData.v_atlasOffsetInPixels[1] = atlasEntry.mY;
+
+        vertexData.v_destinationInPixels[0] = x + atlasEntry.mTrimmedOffsetX;
+        vertexData.v_destinationInPixels[1] = y + atlasEntry.mTrimmedOffsetY;
+
+        vertexData.v_zValue = zBufferVal;
+        vertexData.v_paletteRow = float(atlasEntry.mPaletteRow);
+
+        if (auto c = highlightColor)
+        {
+            // This forces a buffer around the texture being drawn so we can fit the outline.
+            int32_t pad = Render::AtlasTexture::PADDING - 1;
+            vertexData.v_spriteSizeInPixels[0] += pad * 2;
+            vertexData.v_spriteSizeInPixels[1] += pad * 2;
+            vertexData.v_atlasOffsetInPixels[0] -= pad;
+            vertexData.v_atlasOffsetInPixels[1] -= pad;
+            vertexData.v_destinationInPixels[0] -= pad;
+            vertexData.v_destinationInPixels[1] -= pad;
+
+            vertexData.v_hoverColor[0] = c->r;
+            vertexData.v_hoverColor[1] = c->g;
+            vertexData.v_hoverColor[2] = c->b;
+            vertexData.v_hoverColor[3] = 255;
+        }
+
+        return vertexData;
+    }
+
+    // Draws instanceCount sprites from the instance buffer of vertexArrayObject. The vertex uniforms' offset is left as the caller set it.
+    static void drawSpriteInstances(Render::Texture& texture,
+                                    size_t instanceCount,
+                                    DrawLevelUniforms::CpuBufferType& drawLevelUniformCpuBuffer,
+                                    Render::Buffer& drawLevelUniformBuffer,
+                                    Render::VertexArrayObject& vertexArrayObject,
+                                    Render::DescriptorSet& drawLevelDescriptorSet,
+                                    Render::Pipeline& drawLevelPipeline,
+                                    Render::Framebuffer* nonDefaultFramebuffer)
+    {
+        auto vertexUniforms = drawLevelUniformCpuBuffer.getMemberPointer<DrawLevelUniforms::Vertex>();
+        vertexUniforms->screenSizeInPixels[0] = getCurrentResolution().w;
+        vertexUniforms->screenSizeInPixels[1] = getCurrentResolution().h;
+
+        auto fragmentUniforms = drawLevelUniformCpuBuffer.getMemberPointer<DrawLevelUniforms::Fragment>();
+        fragmentUniforms->atlasSizeInPixels[0] = texture.width();
+        fragmentUniforms->atlasSizeInPixels[1] = texture.height();
+
+        drawLevelUniformBuffer.setData(drawLevelUniformCpuBuffer.data(), drawLevelUniformCpuBuffer.getSizeInBytes());
+
+        drawLevelDescriptorSet.updateItems({
+            {2, &texture},
+        });
+
+        Render::Bindings bindings;
+        bindings.vao = &vertexArrayObject;
+        bindings.pipeline = &drawLevelPipeline;
+        bindings.descriptorSet = &drawLevelDescriptorSet;
+        bindings.nonDefaultFramebuffer = nonDefaultFramebuffer;
+
+        Render::mainCommandQueue->cmdDrawInstances(0, 6, instanceCount, bindings);
+    }
+
+    void DrawLevelCache::addSprite(
+        const Render::TextureReference* atlasEntry, int32_t x, int32_t y, std::optional<ByteColour> highlightColor, float zBufferValue)
+    {
+        mSpritesToDraw.push_back(SpriteData{atlasEntry, x, y, highlightColor, zBufferValue});
     }
 
     void DrawLevelCache::end(DrawLevelUniforms::CpuBufferType& drawLevelUniformCpuBuffer,
@@ -28,9 +112,6 @@ namespace FARender
                              Render::Pipeline& drawLevelPipeline,
                              Render::Framebuffer* nonDefaultFramebuffer)
     {
-        for (size_t i = 0; i < mSpritesToDraw.size(); i++)
-            mSpritesToDraw[i].zBufferValue = 1.0f - ((i + 1) / float(mSpritesToDraw.size() + 2));
-
         // explicit z buffer values ensure the draws act like they were done in-order, so we're free to batch by texture as aggressively as possible
         auto sortByTexture = [](const SpriteData& a, const SpriteData& b) { return a.atlasEntry->mTexture < b.atlasEntry->mTexture; };
         std::sort(mSpritesToDraw.begin(), mSpritesToDraw.end(), sortByTexture);
@@ -69,38 +150,7 @@ namespace FARender
             draw(drawLevelUniformCpuBuffer, drawLevelUniformBuffer, vertexArrayObject, drawLevelDescriptorSet, drawLevelPipeline, nonDefaultFramebuffer);
 
         mTexture = atlasEntry.mTexture;
-
-        Render::SpriteVertexPerInstance vertexData = {};
-
-        vertexData.v_spriteSizeInPixels[0] = atlasEntry.mTrimmedWidth;
-        vertexData.v_spriteSizeInPixels[1] = atlasEntry.mTrimmedHeight;
-
-        vertexData.v_atlasOffsetInPixels[0] = atlasEntry.mX;
-        vertexData.v_atlasOffsetInPixels[1] = atlasEntry.mY;
-
-        vertexData.v_destinationInPixels[0] = x + atlasEntry.mTrimmedOffsetX;
-        vertexData.v_destinationInPixels[1] = y + atlasEntry.mTrimmedOffsetY;
-
-        vertexData.v_zValue = zBufferVal;
-
-        if (auto c = highlightColor)
-        {
-            // This forces a buffer around the texture being drawn so we can fit the outline.
-            int32_t pad = Render::AtlasTexture::PADDING - 1;
-            vertexData.v_spriteSizeInPixels[0] += pad * 2;
-            vertexData.v_spriteSizeInPixels[1] += pad * 2;
-            vertexData.v_atlasOffsetInPixels[0] -= pad;
-            vertexData.v_atlasOffsetInPixels[1] -= pad;
-            vertexData.v_destinationInPixels[0] -= pad;
-            vertexData.v_destinationInPixels[1] -= pad;
-
-            vertexData.v_hoverColor[0] = c->r;
-            vertexData.v_hoverColor[1] = c->g;
-            vertexData.v_hoverColor[2] = c->b;
-            vertexData.v_hoverColor[3] = 255;
-        }
-
-        mInstanceData.push_back(vertexData);
+        mInstanceData.push_back(makeSpriteInstance(atlasEntry, x, y, highlightColor, zBufferVal));
     }
 
     void DrawLevelCache::draw(DrawLevelUniforms::CpuBufferType& drawLevelUniformCpuBuffer,
@@ -113,39 +163,117 @@ namespace FARender
         if (mInstanceData.empty())
             return;
 
-        auto vertexUniforms = drawLevelUniformCpuBuffer.getMemberPointer<DrawLevelUniforms::Vertex>();
-        vertexUniforms->screenSizeInPixels[0] = getCurrentResolution().w;
-        vertexUniforms->screenSizeInPixels[1] = getCurrentResolution().h;
+        vertexArrayObject.getVertexBuffer(1)->setData(mInstanceData.data(), mInstanceData.size() * sizeof(Render::SpriteVertexPerInstance));
 
-        auto fragmentUniforms = drawLevelUniformCpuBuffer.getMemberPointer<DrawLevelUniforms::Fragment>();
-        fragmentUniforms->atlasSizeInPixels[0] = mTexture->width();
-        fragmentUniforms->atlasSizeInPixels[1] = mTexture->height();
+        drawSpriteInstances(*mTexture,
+                            mInstanceData.size(),
+                            drawLevelUniformCpuBuffer,
+                            drawLevelUniformBuffer,
+                            vertexArrayObject,
+                            drawLevelDescriptorSet,
+                            drawLevelPipeline,
+                            nonDefaultFramebuffer);
 
-        drawLevelUniformBuffer.setData(drawLevelUniformCpuBuffer.data(), drawLevelUniformCpuBuffer.getSizeInBytes());
+        mInstanceData.clear();
+        mTexture = nullptr;
+    }
 
-        vertexArrayObject.getVertexBuffer(1)->setData(mInstanceData.data(), mInstanceData.size() * sizeof(Render::SpriteVertexPerInstance));
+    void LevelObjects::clear()
+    {
+        mAdded.clear();
+        mSorted.clear();
+        mIndexWidth = 0;
+        mIndexHeight = 0;
+    }
 
-        drawLevelDescriptorSet.updateItems({
-            {2, mTexture},
-        });
+    void LevelObjects::add(const Misc::Point& tile, LevelObject&& object) { mAdded.emplace_back(tile, std::move(object)); }
 
-        Render::Bindings bindings;
-        bindings.vao = &vertexArrayObject;
-        bindings.pipeline = &drawLevelPipeline;
-        bindings.descriptorSet = &drawLevelDescriptorSet;
-        bindings.nonDefaultFramebuffer = nonDefaultFramebuffer;
+    void LevelObjects::buildIndex(const Misc::Point& firstTile, const Misc::Point& lastTile)
+    {
+        mIndexOrigin = firstTile;
+        mIndexWidth = std::max(lastTile.x - firstTile.x + 1, 0);
+        mIndexHeight = std::max(lastTile.y - firstTile.y + 1, 0);
 
-        Render::mainCommandQueue->cmdDrawInstances(0, 6, mInstanceData.size(), bindings);
+        // Counting sort, which keeps objects on the same tile in the order they were added
+        mCellStarts.assign(size_t(mIndexWidth) * size_t(mIndexHeight) + 1, 0);
+        for (const auto& added : mAdded)
+        {
+            int32_t cell = getIndexCell(added.first);
+            if (cell >= 0)
+                mCellStarts[cell + 1]++;
+        }
 
-        mInstanceData.clear();
-        mTexture = nullptr;
+        for (size_t i = 1; i < mCellStarts.size(); i++)
+            mCellStarts[i] += mCellStarts[i - 1];
+
+        mCellCursors.assign(mCellStarts.begin(), mCellStarts.end() - 1);
+        mSorted.resize(mCellStarts.back());
+
+        for (auto& added : mAdded)
+        {
+            int32_t cell = getIndexCell(added.first);
+            if (cell >= 0)
+                mSorted[mCellCursors[cell]++] = std::move(added.second);
+        }
+
+        mAdded.clear();
+    }
+
+    LevelObjects::TileObjects LevelObjects::get(const Misc::Point& tile) const
+    {
+        int32_t cell = getIndexCell(tile);
+        if (cell < 0)
+            return TileObjects(nullptr, nullptr);
+
+        return TileObjects(mSorted.data() + mCellStarts[cell], mSorted.data() + mCellStarts[cell + 1]);
+    }
+
+    int32_t LevelObjects::getIndexCell(const Misc::Point& tile) const
+    {
+        Misc::Point position = tile - mIndexOrigin;
+        if (position.x < 0 || position.y < 0 || position.x >= mIndexWidth || position.y >= mIndexHeight)
+            return -1;
+
+        return position.y * mIndexWidth + position.x;
     }
 
     constexpr auto tileHeight = 32;
     constexpr auto tileWidth = tileHeight * 2;
     constexpr auto staticObjectHeight = 256;
 
-    // For a given isometric tile, tileScreenPosition will be the point marked
+    // Every level sprite gets an explicit depth from the tile it belongs to. Tiles are ordered the same way drawObjectsByTiles
+    // visits them (by x + y, then by x), and sprites within a tile by their slot. This lets the cached static geometry and the
+    // sprites built each frame be drawn in any order, and still come out as if they were all drawn back to front.
+    // Ground sprites use the back half of the depth range, so they are always behind anything above ground.
+    constexpr int32_t depthTileMargin = 64;
+    constexpr int32_t depthTileRange = 256; // tile coordinates outside [-depthTileMargin, depthTileRange - depthTileMargin) share a depth
+    // With this many slots, each key is still about four steps of a 24 bit depth buffer apart
+    constexpr int32_t depthSlotsPerTile = 16;
+    constexpr int32_t depthKeyCount = (depthTileRange * 2 - 1) * depthTileRange * depthSlotsPerTile;
+
+    namespace DepthSlot
+    {
+        constexpr int32_t pillar = 0;
+        constexpr int32_t specialSprite = 1;
+        // Items, then actors and missiles, which is far more than a tile holds in practice (an item, a couple of actors and some missiles).
+        // Sprites are sorted by texture before drawing, so any that did run past the last slot would overlap each other in no particular order.
+        constexpr int32_t firstDynamic = 2;
+    }
+
+    static float tileDepth(Vec2i tile, int32_t slot)
+    {
+        int32_t x = std::clamp(tile.x + depthTileMargin, 0, depthTileRange - 1);
+        int32_t y = std::clamp(tile.y + depthTileMargin, 0, depthTileRange - 1);
+        int32_t key = ((x + y) * depthTileRange + x) * depthSlotsPerTile + std::min(slot, depthSlotsPerTile - 1);
+
+        // Worked out in double, as neighbouring keys are only a few float steps apart near 1
+        return float(1.0 - (key + 1) / double(depthKeyCount + 1));
+    }
+
+    static float groundDepth(Vec2i tile) { return 0.5f + 0.5f * tileDepth(tile, 0); }
+    static float aboveGroundDepth(Vec2i tile, int32_t slot) { return 0.5f * tileDepth(tile, slot); }
+
+    // For a given isometric tile, tileTop will be the point marked
     // with an X in the diagram below, at the top left of the bounding box of
     // the tile.
     //
@@ -155,11 +283,16 @@ namespace FARender
     //    .     .
     //       .
     //
-    void
-    LevelRenderer::drawTilesetSprite(const Render::TextureReference* sprite, const Misc::Point& tileScreenPosition, std::optional<ByteColour> highlightColor)
+    static Misc::Point tilesetSpriteDestination(const Render::TextureReference* sprite, const Misc::Point& tileTop)
     {
         // centering sprite at the center of tile by width and at the bottom of tile by height
-        mDrawLevelCache.addSprite(sprite, tileScreenPosition.x - sprite->mWidth / 2, tileScreenPosition.y - sprite->mHeight + tileHeight, highlightColor);
+        return Misc::Point{tileTop.x - sprite->mWidth / 2, tileTop.y - sprite->mHeight + tileHeight};
+    }
+
+    void LevelRenderer::drawTilesetSprite(const Render::TextureReference* sprite, const Misc::Point& tileWorldPosition, float zBufferValue)
+    {
+        Misc::Point destination = tilesetSpriteDestination(sprite, tileWorldPosition);
+        mDrawLevelCache.addSprite(sprite, destination.x, destination.y, std::nullopt, zBufferValue);
     }
 
     // basic transform of isometric grid to normal, (0, 0) tile coordinate maps to (0, 0) pixel coordinates
@@ -182,13 +315,11 @@ namespace FARender
 
     void LevelRenderer::drawAtWorldPosition(const Render::TextureReference* sprite,
                                             const Vec2Fix& fractionalPos,
-                                            const Misc::Point& toScreen,
+                                            float zBufferValue,
                                             std::optional<ByteColour> highlightColor)
     {
         Vec2i point = Vec2i(tileTopPoint(fractionalPos));
-        Vec2i res = point + toScreen;
-
-        mDrawLevelCache.addSprite(sprite, res.x - sprite->mWidth / 2, res.y - sprite->mHeight + (tileHeight / 2), highlightColor);
+        mDrawLevelCache.addSprite(sprite, point.x - sprite->mWidth / 2, point.y - sprite->mHeight + (tileHeight / 2), highlightColor, zBufferValue);
     }
 
     constexpr auto bottomMenuSize = 0; // 144; // TODO: pass it as a variable
@@ -242,6 +373,19 @@ namespace FARender
         }
     }
 
+    // The bounding box, in tile coordinates, of all the tiles drawObjectsByTiles will visit
+    static std::pair<Misc::Point, Misc::Point> getVisibleTileBounds(const Misc::Point& toScreen)
+    {
+        Vec2i resolution = getCurrentResolution();
+        Misc::Point topLeft{-2 * tileWidth, -2 * tileHeight};
+        Misc::Point bottomRight{resolution.w + 2 * tileWidth, resolution.h + staticObjectHeight + 2 * tileHeight};
+
+        // getTileFromScreenCoords rounds towards zero, so pad by a tile on each side
+        Misc::Point firstTile(getTileFromScreenCoords(topLeft, toScreen).pos.x - 1, getTileFromScreenCoords({bottomRight.x, topLeft.y}, toScreen).pos.y - 1);
+        Misc::Point lastTile(getTileFromScreenCoords(bottomRight, toScreen).pos.x + 1, getTileFromScreenCoords({topLeft.x, bottomRight.y}, toScreen).pos.y + 1);
+        return {firstTile, lastTile};
+    }
+
     void LevelRenderer::drawLevel(const Level::Level& level,
                                   Render::SpriteGroup* minTops,
                                   Render::SpriteGroup* minBottoms,
@@ -263,17 +407,25 @@ namespace FARender
             return tile.pos.x < 0 || tile.pos.y < 0 || tile.pos.x >= static_cast<int32_t>(level.width()) || tile.pos.y >= static_cast<int32_t>(level.height());
         };
 
-        // draw the ground diamonds
-        drawObjectsByTiles(toScreen, [&](const Render::Tile& tile, const Misc::Point& topLeft) {
-            if (isInvalidTile(tile))
-            {
-                drawTilesetSprite(minBottoms->getFrame(0), topLeft);
-                return;
-            }
+        // All level sprites are positioned in world pixels, and moved onto the screen by the vertex shader
+        auto vertexUniforms = drawLevelUniformCpuBuffer->getMemberPointer<DrawLevelUniforms::Vertex>();
+        vertexUniforms->offsetInPixels[0] = float(toScreen.x);
+        vertexUniforms->offsetInPixels[1] = float(toScreen.y);
+
+        // Every sprite batch shares the one palette texture, whichever layer it draws from
+        drawLevelDescriptorSet->updateItems({{3, &SpriteLoader::get()->getPaletteTexture()}});
+
+        updateStaticGeometryCache(level, minTops, minBottoms, specialSprites, specialSpritesMap, toScreen);
 
-            int32_t index = level.get(tile.pos).index();
-            if (index >= 0 && index < minBottoms->size())
-                drawTilesetSprite(minBottoms->getFrame(index), topLeft); // all static objects have the same sprite size
+        auto visibleTiles = getVisibleTileBounds(toScreen);
+        objs.buildIndex(visibleTiles.first, visibleTiles.second);
+        items.buildIndex(visibleTiles.first, visibleTiles.second);
+
+        // draw the ground diamonds, tiles outside the level aren't cached as there's no end to them
+        drawStaticGeometry(toScreen, false);
+        drawObjectsByTiles(toScreen, [&](const Render::Tile& tile, const Misc::Point&) {
+            if (isInvalidTile(tile))
+                drawTilesetSprite(minBottoms->getFrame(0), Vec2i(tileTopPoint(tile.pos)), groundDepth(tile.pos));
         });
 
         if (mDrawGrid)
@@ -331,39 +483,26 @@ namespace FARender
         }
 
         // draw above ground objects (walls, players, town buildings etc)
-        drawObjectsByTiles(toScreen, [&](const Render::Tile& tile, const Misc::Point& topLeft) {
+        drawStaticGeometry(toScreen, true);
+        drawObjectsByTiles(toScreen, [&](const Render::Tile& tile, const Misc::Point&) {
             if (isInvalidTile(tile))
                 return;
 
-            int32_t index = level.get(tile.pos).index();
-            if (index >= 0 && index < minTops->size())
-            {
-                drawTilesetSprite(minTops->getFrame(index), topLeft);
-
-                // Add special sprites (arches / open door frames) if required.
-                if (specialSpritesMap.count(index))
-                {
-                    int32_t specialSpriteIndex = specialSpritesMap.at(index);
-                    const Render::TextureReference* sprite = specialSprites->getFrame(specialSpriteIndex);
-                    drawTilesetSprite(sprite, topLeft);
-                }
-            }
+            int32_t slot = DepthSlot::firstDynamic;
 
-            const std::vector<LevelObject>& itemsForTile = items.get(tile.pos.x, tile.pos.y);
-            for (const auto& item : itemsForTile)
+            for (const auto& item : items.get(tile.pos))
             {
                 const Render::TextureReference* sprite = item.sprite->getFrame(item.spriteFrame);
                 Vec2Fix position = Vec2Fix(tile.pos) + Vec2Fix(FixedPoint("0.5"), FixedPoint("0.5"));
-                drawAtWorldPosition(sprite, position, toScreen, item.hoverColor);
+                drawAtWorldPosition(sprite, position, aboveGroundDepth(tile.pos, slot++), item.hoverColor);
             }
 
-            const std::vector<LevelObject>& objsForTile = objs.get(tile.pos.x, tile.pos.y);
-            for (auto& obj : objsForTile)
+            for (const auto& obj : objs.get(tile.pos))
             {
                 if (obj.valid)
                 {
                     const Render::TextureReference* sprite = obj.sprite->getFrame(obj.spriteFrame);
-                    drawAtWorldPosition(sprite, obj.fractionalPos, toScreen, obj.hoverColor);
+                    drawAtWorldPosition(sprite, obj.fractionalPos, aboveGroundDepth(tile.pos, slot++), obj.hoverColor);
                 }
             }
         });
@@ -432,6 +571,182 @@ namespace FARender
 
         Render::mainCommandQueue->cmdDraw(0, 6, fullscreenBindings);
     }
+    // Conservative test for whether any sprite of a chunk could be on screen, without needing the chunk to be built
+    static bool staticGeometryChunkIsVisible(Vec2i chunkPosition, const Misc::Point& toScreen)
+    {
+        constexpr int32_t chunkSize = StaticGeometryChunk::SIZE_IN_TILES;
+        Vec2i firstTile = chunkPosition * chunkSize;
+        Vec2i lastTile = firstTile + Vec2i(chunkSize - 1, chunkSize - 1);
+
+        int32_t left = tileTopPoint(Vec2i(firstTile.x, lastTile.y)).x - tileWidth;
+        int32_t right = tileTopPoint(Vec2i(lastTile.x, firstTile.y)).x + tileWidth;
+        int32_t top = tileTopPoint(firstTile).y - staticObjectHeight;
+        int32_t bottom = tileTopPoint(lastTile).y + tileHeight;
+
+        Vec2i resolution = getCurrentResolution();
+        return right > -toScreen.x && left < resolution.w - toScreen.x && bottom > -toScreen.y && top < resolution.h - toScreen.y;
+    }
+
+    void LevelRenderer::updateStaticGeometryCache(const Level::Level& level,
+                                                  Render::SpriteGroup* minTops,
+                                                  Render::SpriteGroup* minBottoms,
+                                                  Render::SpriteGroup* specialSprites,
+                                                  const std::map<int32_t, int32_t>& specialSpritesMap,
+                                                  const Misc::Point& toScreen)
+    {
+        constexpr int32_t chunkSize = StaticGeometryChunk::SIZE_IN_TILES;
+        int32_t chunksWide = (level.width() + chunkSize - 1) / chunkSize;
+        int32_t chunksHigh = (level.height() + chunkSize - 1) / chunkSize;
+
+        const Render::SpriteGroup* tileset[] = {minTops, minBottoms, specialSprites};
+
+        if (mStaticGeometryLevel != &level || !std::equal(std::begin(tileset), std::end(tileset), std::begin(mStaticGeometryTileset)) ||
+            mStaticGeometryChunks.width() != chunksWide || mStaticGeometryChunks.height() != chunksHigh)
+        {
+            mStaticGeometryChunks = Misc::Array2D<StaticGeometryChunk>(chunksWide, chunksHigh);
+            mStaticGeometryLevel = &level;
+            std::copy(std::begin(tileset), std::end(tileset), std::begin(mStaticGeometryTileset));
+        }
+        else if (mStaticGeometryTileRevision != level.getTileRevision())
+        {
+            // Only opening or closing doors changes tiles, so just throw away the chunks that have a tile which doesn't match any more
+            for (int32_t chunkY = 0; chunkY < chunksHigh; chunkY++)
+            {
+                for (int32_t chunkX = 0; chunkX < chunksWide; chunkX++)
+                {
+                    StaticGeometryChunk& chunk = mStaticGeometryChunks.get(chunkX, chunkY);
+                    if (!chunk.built)
+                        continue;
+
+                    size_t i = 0;
+                    bool changed = false;
+                    for (int32_t y = chunkY * chunkSize; y < std::min((chunkY + 1) * chunkSize, level.height()) && !changed; y++)
+                    {
+                        for (int32_t x = chunkX * chunkSize; x < std::min((chunkX + 1) * chunkSize, level.width()) && !changed; x++)
+                            changed = level.get(Misc::Point(x, y)).index() != chunk.pillarIndices[i++];
+                    }
+
+                    if (changed)
+                        chunk = StaticGeometryChunk();
+                }
+            }
+        }
+
+        mStaticGeometryTileRevision = level.getTileRevision();
+
+        for (int32_t chunkY = 0; chunkY < chunksHigh; chunkY++)
+        {
+            for (int32_t chunkX = 0; chunkX < chunksWide; chunkX++)
+            {
+                StaticGeometryChunk& chunk = mStaticGeometryChunks.get(chunkX, chunkY);
+                if (!chunk.built && staticGeometryChunkIsVisible(Vec2i(chunkX, chunkY), toScreen))
+                    buildStaticGeometryChunk(chunk, Vec2i(chunkX, chunkY), level, minTops, minBottoms, specialSprites, specialSpritesMap);
+            }
+        }
+    }
+
+    void LevelRenderer::buildStaticGeometryChunk(StaticGeometryChunk& chunk,
+                                                 Vec2i chunkPosition,
+                                                 const Level::Level& level,
+                                                 Render::SpriteGroup* minTops,
+                                                 Render::SpriteGroup* minBottoms,
+                                                 Render::SpriteGroup* specialSprites,
+                                                 const std::map<int32_t, int32_t>& specialSpritesMap)
+    {
+        using SpriteInstance = std::pair<Render::Texture*, Render::SpriteVertexPerInstance>;
+        std::vector<SpriteInstance> groundSprites;
+        std::vector<SpriteInstance> aboveGroundSprites;
+
+        auto addSprite = [](std::vector<SpriteInstance>& sprites, const Render::TextureReference* sprite, const Misc::Point& tileTop, float zBufferValue) {
+            Misc::Point destination = tilesetSpriteDestination(sprite, tileTop);
+            sprites.emplace_back(sprite->mTexture, makeSpriteInstance(*sprite, destination.x, destination.y, std::nullopt, zBufferValue));
+        };
+
+        constexpr int32_t chunkSize = StaticGeometryChunk::SIZE_IN_TILES;
+        Vec2i firstTile = chunkPosition * chunkSize;
+        Vec2i endTile(std::min(firstTile.x + chunkSize, level.width()), std::min(firstTile.y + chunkSize, level.height()));
+
+        chunk.pillarIndices.clear();
+        for (int32_t y = firstTile.y; y < endTile.y; y++)
+        {
+            for (int32_t x = firstTile.x; x < endTile.x; x++)
+            {
+                Vec2i tile(x, y);
+                Misc::Point tileTop = Vec2i(tileTopPoint(tile));
+
+                int32_t index = level.get(tile).index();
+                chunk.pillarIndices.push_back(index);
+
+                if (index >= 0 && index < minBottoms->size())
+                    addSprite(groundSprites, minBottoms->getFrame(index), tileTop, groundDepth(tile)); // all static objects have the same sprite size
+
+                if (index >= 0 && index < minTops->size())
+                {
+                    addSprite(aboveGroundSprites, minTops->getFrame(index), tileTop, aboveGroundDepth(tile, DepthSlot::pillar));
+
+                    // Add special sprites (arches / open door frames) if required.
+                    auto it = specialSpritesMap.find(index);
+                    if (it != specialSpritesMap.end())
+                        addSprite(aboveGroundSprites, specialSprites->getFrame(it->second), tileTop, aboveGroundDepth(tile, DepthSlot::specialSprite));
+                }
+            }
+        }
+
+        // One instance buffer per atlas layer, as with DrawLevelCache the explicit z values mean draw order doesn't matter
+        auto makeBatches = [&](std::vector<SpriteInstance>& sprites, std::vector<StaticGeometryChunk::Batch>& batches) {
+            std::sort(sprites.begin(), sprites.end(), [](const SpriteInstance& a, const SpriteInstance& b) { return a.first < b.first; });
+
+            std::vector<Render::SpriteVertexPerInstance> instances;
+            for (size_t start = 0; start < sprites.size();)
+            {
+                instances.clear();
+
+                size_t end = start;
+                for (; end < sprites.size() && sprites[end].first == sprites[start].first; end++)
+                    instances.push_back(sprites[end].second);
+
+                StaticGeometryChunk::Batch batch;
+                batch.texture = sprites[start].first;
+                batch.instanceCount = instances.size();
+                batch.vertexArrayObject = Render::mainRenderInstance->createVertexArrayObject({0, 0}, drawLevelPipeline->mSpec.vertexLayouts, 0);
+                batch.vertexArrayObject->getVertexBuffer(0)->setData(spriteBaseVertices, sizeof(spriteBaseVertices));
+                batch.vertexArrayObject->getVertexBuffer(1)->setData(instances.data(), instances.size() * sizeof(Render::SpriteVertexPerInstance));
+                batches.push_back(std::move(batch));
+
+                start = end;
+            }
+        };
+
+        chunk.groundBatches.clear();
+        chunk.aboveGroundBatches.clear();
+        makeBatches(groundSprites, chunk.groundBatches);
+        makeBatches(aboveGroundSprites, chunk.aboveGroundBatches);
+        chunk.built = true;
+    }
+
+    void LevelRenderer::drawStaticGeometry(const Misc::Point& toScreen, bool aboveGround)
+    {
+        for (int32_t chunkY = 0; chunkY < mStaticGeometryChunks.height(); chunkY++)
+        {
+            for (int32_t chunkX = 0; chunkX < mStaticGeometryChunks.width(); chunkX++)
+            {
+                const StaticGeometryChunk& chunk = mStaticGeometryChunks.get(chunkX, chunkY);
+                if (!chunk.built || !staticGeometryChunkIsVisible(Vec2i(chunkX, chunkY), toScreen))
+                    continue;
+
+                for (const auto& batch : aboveGround ? chunk.aboveGroundBatches : chunk.groundBatches)
+                    drawSpriteInstances(*batch.texture,
+                                        batch.instanceCount,
+                                        *drawLevelUniformCpuBuffer,
+                                        *drawLevelUniformBuffer,
+                                        *batch.vertexArrayObject,
+                                        *drawLevelDescriptorSet,
+                                        *drawLevelPipeline,
+                                        levelDrawFramebuffer.get());
+            }
+        }
+    }
+
     LevelRenderer::LevelRenderer()
     {
         mDebugRenderer = std::make_unique<Render::DebugRenderer>(*Render::mainRenderInstance);
@@ -445,6 +760,7 @@ namespace FARender
             {Render::DescriptorType::UniformBuffer, "vertexUniforms"},
             {Render::DescriptorType::UniformBuffer, "fragmentUniforms"},
             {Render::DescriptorType::Texture, "tex"},
+            {Render::DescriptorType::Texture, "palette"},
         }};
 
         drawLevelPipeline = Render::mainRenderInstance->createPipeline(drawLevelPipelineSpec);
@@ -461,18 +777,8 @@ namespace FARender
             {0, Render::BufferSlice{drawLevelUniformBuffer.get(), drawLevelUniformCpuBuffer->getMemberOffset<DrawLevelUniforms::Vertex>(), sizeof(DrawLevelUniforms::Vertex)}},
             {1, Render::BufferSlice{drawLevelUniformBuffer.get(), drawLevelUniformCpuBuffer->getMemberOffset<DrawLevelUniforms::Fragment>(), sizeof(DrawLevelUniforms::Fragment)}},
         });
-
-        Render::SpriteVertexMain baseVertices[] =
-        {
-            {{0, 0},  {0, 0}},
-            {{1, 0},  {1, 0}},
-            {{1, 1},  {1, 1}},
-            {{0, 0},  {0, 0}},
-            {{1, 1},  {1, 1}},
-            {{0, 1},  {0, 1}}
-        };
         // clang-format on
-        vertexArrayObject->getVertexBuffer(0)->setData(baseVertices, sizeof(baseVertices));
+        vertexArrayObject->getVertexBuffer(0)->setData(spriteBaseVertices, sizeof(spriteBaseVertices));
 
         {
             // clang-format off
@@ -502,7 +808,7 @@ namespace FARender
             fullscreenUniformBuffer = Render::mainRenderInstance->createBuffer(sizeof(FullscreenUniforms::Vertex));
             fullscreenDescriptorSet = Render::mainRenderInstance->createDescriptorSet(fullscreenPipelineSpec.descriptorSetSpec);
 
-            fullscreenVao->getVertexBuffer(0)->setData(fullscreenVertices, sizeof(baseVertices));
+            fullscreenVao->getVertexBuffer(0)->setData(fullscreenVertices, sizeof(fullscreenVertices));
             fullscreenDescriptorSet->updateItems({{0, this->fullscreenUniformBuffer.get()}});
         }
 
@@ -4,6 +4,7 @@
 #include <atomic>
 #include <cstdint>
 #include <map>
+#include <misc/array2d.h>
 #include <misc/simplevec2.h>
 #include <render/alignedcpubuffer.h>
 #include <render/atlastexture.h>
@@ -35,8 +36,7 @@ namespace FARender
         struct Vertex
         {
             float screenSizeInPixels[2];
-
-            float pad1[2];
+            float offsetInPixels[2]; ///< Added to every sprite's destination, sprites are positioned in world pixels
         };
 
         struct Fragment
@@ -63,7 +63,7 @@ namespace FARender
     class DrawLevelCache
     {
     public:
-        void addSprite(const Render::TextureReference* atlasEntry, int32_t x, int32_t y, std::optional<ByteColour> highlightColor);
+        void addSprite(const Render::TextureReference* atlasEntry, int32_t x, int32_t y, std::optional<ByteColour> highlightColor, float zBufferValue);
         void end(DrawLevelUniforms::CpuBufferType& drawLevelUniformCpuBuffer,
                  Render::Buffer& drawLevelUniformBuffer,
                  Render::VertexArrayObject& vertexArrayObject,
@@ -114,7 +114,66 @@ namespace FARender
         std::optional<ByteColour> hoverColor;
     };
 
-    typedef Misc::Array2D<std::vector<LevelObject>> LevelObjects; // TODO: get a custom small vector class + use it here
+    /// Level objects bucketed by the tile they are on, so they can be drawn in tile order.
+    /// The objects are kept sorted by tile in one flat array, and only the tiles in the area being drawn get an index entry,
+    /// so rebuilding this every frame costs O(objects + visible tiles) no matter how big the level is.
+    class LevelObjects
+    {
+    public:
+        class TileObjects
+        {
+        public:
+            TileObjects(const LevelObject* begin, const LevelObject* end) : mBegin(begin), mEnd(end) {}
+
+            const LevelObject* begin() const { return mBegin; }
+            const LevelObject* end() const { return mEnd; }
+            bool empty() const { return mBegin == mEnd; }
+
+        private:
+            const LevelObject* mBegin;
+            const LevelObject* mEnd;
+        };
+
+        void clear();
+        void add(const Misc::Point& tile, LevelObject&& object);
+
+        /// Sorts the added objects by tile. Only objects on tiles in the (inclusive) area from firstTile to lastTile can be found by get() afterwards.
+        void buildIndex(const Misc::Point& firstTile, const Misc::Point& lastTile);
+
+        /// @return The objects on tile, in the order they were added
+        TileObjects get(const Misc::Point& tile) const;
+
+    private:
+        int32_t getIndexCell(const Misc::Point& tile) const;
+
+    private:
+        std::vector<std::pair<Misc::Point, LevelObject>> mAdded;
+        std::vector<LevelObject> mSorted;
+        std::vector<uint32_t> mCellStarts; ///< Index into mSorted for each cell of the indexed area, plus one past the end
+        std::vector<uint32_t> mCellCursors;
+        Misc::Point mIndexOrigin;
+        int32_t mIndexWidth = 0;
+        int32_t mIndexHeight = 0;
+    };
+
+    /// Tileset sprites for a square block of level tiles, with their instance data uploaded once and kept on the GPU.
+    /// Ground and above ground sprites are kept apart because the debug grid is drawn in between them.
+    struct StaticGeometryChunk
+    {
+        static constexpr int32_t SIZE_IN_TILES = 16;
+
+        struct Batch
+        {
+            Render::Texture* texture = nullptr;
+            std::unique_ptr<Render::VertexArrayObject> vertexArrayObject;
+            size_t instanceCount = 0;
+        };
+
+        bool built = false;
+        std::vector<int32_t> pillarIndices; ///< The level's pillar index for each tile when this chunk was built, used to spot changed tiles
+        std::vector<Batch> groundBatches;
+        std::vector<Batch> aboveGroundBatches;
+    };
 
     class LevelRenderer
     {
@@ -141,12 +200,25 @@ namespace FARender
     private:
         void createNewLevelDrawFramebuffer();
 
-        void drawTilesetSprite(const Render::TextureReference* sprite,
-                               const Misc::Point& tileScreenPosition,
-                               std::optional<ByteColour> highlightColor = std::nullopt);
+        void updateStaticGeometryCache(const Level::Level& level,
+                                       Render::SpriteGroup* minTops,
+                                       Render::SpriteGroup* minBottoms,
+                                       Render::SpriteGroup* specialSprites,
+                                       const std::map<int32_t, int32_t>& specialSpritesMap,
+                                       const Misc::Point& toScreen);
+        void buildStaticGeometryChunk(StaticGeometryChunk& chunk,
+                                      Vec2i chunkPosition,
+                                      const Level::Level& level,
+                                      Render::SpriteGroup* minTops,
+                                      Render::SpriteGroup* minBottoms,
+                                      Render::SpriteGroup* specialSprites,
+                                      const std::map<int32_t, int32_t>& specialSpritesMap);
+        void drawStaticGeometry(const Misc::Point& toScreen, bool aboveGround);
+
+        void drawTilesetSprite(const Render::TextureReference* sprite, const Misc::Point& tileWorldPosition, float zBufferValue);
         void drawAtWorldPosition(const Render::TextureReference* sprite,
                                  const Vec2Fix& fractionalPos,
-                                 const Misc::Point& toScreen,
+                                 float zBufferValue,
                                  std::optional<ByteColour> highlightColor = std::nullopt);
 
     private:
@@ -160,6 +232,12 @@ namespace FARender
 
         std::unique_ptr<Render::Framebuffer> levelDrawFramebuffer;
 
+        // The static geometry cache is only valid for the level and tileset it was built from
+        const Level::Level* mStaticGeometryLevel = nullptr;
+        const Render::SpriteGroup* mStaticGeometryTileset[3] = {};
+        uint32_t mStaticGeometryTileRevision = 0;
+        Misc::Array2D<StaticGeometryChunk> mStaticGeometryChunks;
+
         std::unique_ptr<Render::Pipeline> fullscreenPipeline;
         std::unique_ptr<Render::VertexArrayObject> fullscreenVao;
         std::unique_ptr<Render::Buffer> fullscreenUniformBuffer;
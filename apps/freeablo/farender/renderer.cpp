@@ -1,5 +1,4 @@
 #include "renderer.h"
-#include "../engine/threadmanager.h"
 #include "../fagui/guimanager.h"
 #include "../faworld/gamelevel.h"
 #include "cel/celdecoder.h"
@@ -77,17 +76,12 @@ namespace FARender
         return sprite;
     }
 
-    Renderer::Renderer(const DiabloExe::DiabloExe& exe, int32_t windowWidth, int32_t windowHeight, bool fullscreen)
+    Renderer::Renderer(const DiabloExe::DiabloExe& exe, const Render::RenderSettings& renderSettings)
         : mSpriteLoader(exe), mDone(false), mWidthHeightTmp(0)
     {
         release_assert(!mRenderer); // singleton, only one instance
 
-        Render::RenderSettings settings = {};
-        settings.windowWidth = windowWidth;
-        settings.windowHeight = windowHeight;
-        settings.fullscreen = fullscreen;
-
-        Render::init("Freeablo", settings);
+        Render::init("Freeablo", renderSettings);
 
         // setup gui
         {
@@ -104,9 +98,7 @@ namespace FARender
             mNuklearGraphicsData = std::make_unique<NuklearDevice>(*Render::mainRenderInstance, std::move(initData));
         }
 
-        mStates.reserve(NUM_RENDER_STATES);
-        for (size_t i = 0; i < NUM_RENDER_STATES; ++i)
-            mStates.emplace_back(*mNuklearGraphicsData);
+        mStates = std::make_unique<Misc::TripleBuffer<RenderState>>(*mNuklearGraphicsData);
 
         mRenderer = this;
 
@@ -141,21 +133,27 @@ namespace FARender
         return tileset;
     }
 
-    RenderState* Renderer::getFreeState()
+    RenderState::RenderState(NuklearDevice& nuklearGraphicsData) : nuklearData(nuklearGraphicsData)
     {
-        for (size_t i = 0; i < mStates.size(); i++)
-        {
-            if (mStates[i].ready)
-            {
-                mStates[i].ready = false;
-                return &mStates[i];
-            }
-        }
+        // Enough for a busy screen, so the game thread doesn't allocate while filling these in normal play
+        mItems.reserve(256);
+        mObjects.reserve(512);
+        debugData.reserve(256);
+    }
 
-        return nullptr;
+    RenderState* Renderer::getFreeState()
+    {
+        RenderState* state = &mStates->getWriteSlot();
+        state->captureTime = std::chrono::steady_clock::now();
+        state->presented = false;
+        return state;
     }
 
-    void Renderer::setCurrentState(RenderState* current) { Engine::ThreadManager::get()->sendRenderState(current); }
+    void Renderer::setCurrentState(RenderState* current)
+    {
+        release_assert(current == &mStates->getWriteSlot());
+        mStates->publish();
+    }
 
     Render::Tile Renderer::getTileByScreenPos(size_t x, size_t y, const FAWorld::Position& screenPos)
     {
@@ -175,30 +173,26 @@ namespace FARender
         int64_t int64;
     };
 
-    static void fill(const FAWorld::GameLevel& level, const std::vector<ObjectToRender> src, LevelObjects& dst)
+    static void fill(const std::vector<ObjectToRender>& src, LevelObjects& dst, const RenderInterpolator& interpolator)
     {
-        if (dst.width() != level.width() || dst.height() != level.height())
-            dst = LevelObjects(level.width(), level.height());
-
-        for (int32_t x = 0; x < dst.width(); x++)
-            for (int32_t y = 0; y < dst.height(); y++)
-                dst.get(x, y).clear();
+        dst.clear();
 
-        for (size_t i = 0; i < src.size(); i++)
+        for (const auto& object : src)
         {
-            auto& object = src[i];
             auto& position = object.position;
 
             LevelObject obj;
             obj.sprite = object.spriteGroup;
             obj.spriteFrame = object.frame;
-            obj.fractionalPos = position.getFractionalPos();
+            obj.fractionalPos = interpolator.getPosition(object);
             obj.hoverColor = object.hoverColor;
             obj.valid = true;
 
-            int32_t x = position.current().x;
-            int32_t y = position.current().y;
-            dst.get(x, y).push_back(std::move(obj));
+            // Objects are bucketed by the tile they're moving from, with their drawn position running ahead of it. Interpolation draws them a
+            // little behind where the game has them, possibly in the tile they just left, so the bucket is moved back by the same number of tiles.
+            Misc::Point tile = position.current() + (Misc::Point(obj.fractionalPos) - Misc::Point(position.getFractionalPos()));
+
+            dst.add(tile, std::move(obj));
         }
     }
 
@@ -218,10 +212,12 @@ namespace FARender
 
         if (state)
         {
+            mInterpolator.update(state->captureTime, state->mPos.getFractionalPos(), state->mObjects, std::chrono::steady_clock::now());
+
             if (state->level)
             {
-                fill(*state->level, state->mObjects, mLevelObjects);
-                fill(*state->level, state->mItems, mItems);
+                fill(state->mObjects, mLevelObjects, mInterpolator);
+                fill(state->mItems, mItems, mInterpolator);
 
                 mLevelRenderer->drawLevel(state->level->mLevel,
                                           state->tileset.minTops,
@@ -230,7 +226,7 @@ namespace FARender
                                           state->tileset.mSpecialSpriteMap,
                                           mLevelObjects,
                                           mItems,
-                                          state->mPos.getFractionalPos(),
+                                          mInterpolator.getCameraPosition(),
                                           state->debugData);
             }
 
@@ -240,6 +236,16 @@ namespace FARender
 
         Render::draw();
 
+        if (state && !state->presented)
+        {
+            state->presented = true;
+
+            std::chrono::steady_clock::duration latency = std::chrono::steady_clock::now() - state->captureTime;
+            mLatencyStats.frames++;
+            mLatencyStats.total += latency;
+            mLatencyStats.max = std::max(mLatencyStats.max, latency);
+        }
+
         I32sAs64 tmp;
         tmp.int32s[0] = Render::WIDTH;
         tmp.int32s[1] = Render::HEIGHT;
@@ -4,18 +4,22 @@
 #include "diabloexe/diabloexe.h"
 #include "fontinfo.h"
 #include "levelrenderer.h"
+#include "renderinterpolator.h"
 #include "spriteloader.h"
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <misc/triplebuffer.h>
 #include <mutex>
 #include <nuklearmisc/nuklearframedump.h>
 #include <render/cursor.h>
 #include <render/render.h>
 #include <tuple>
+#include <utility>
 
 namespace DiabloExe
 {
@@ -49,26 +53,19 @@ namespace FARender
         uint32_t frame = 0;
         FAWorld::Position position;
         std::optional<ByteColour> hoverColor;
+        const void* interpolationKey = nullptr; ///< Identifies the same moving object across render states, null for things that don't move
     };
 
+    /// A snapshot of everything the render thread needs to draw one game tick.
+    /// These are reused from tick to tick, so the game thread should clear and refill the containers rather than replace them.
     class RenderState
     {
     public:
-        explicit RenderState(NuklearDevice& nuklearGraphicsData) : ready(true), nuklearData(nuklearGraphicsData) {}
+        explicit RenderState(NuklearDevice& nuklearGraphicsData);
         RenderState(RenderState&& other) = default;
 
-        struct MoveableAtomicBool
-        {
-            std::atomic_bool val;
-
-            MoveableAtomicBool(bool val) : val(val) {}
-            MoveableAtomicBool(MoveableAtomicBool&& other) : val(other.val.load()) {}
-
-            void operator=(bool newVal) { val = newVal; }
-            operator bool() { return val; }
-        };
-
-        MoveableAtomicBool ready;
+        std::chrono::steady_clock::time_point captureTime; ///< When the game thread started filling this state
+        bool presented = false;                            ///< Set by the render thread once this state has been on screen
 
         FAWorld::Position mPos;
         std::vector<ObjectToRender> mItems;
@@ -80,12 +77,23 @@ namespace FARender
         DebugRenderData debugData;
     };
 
+    /// Time taken from the game thread capturing a RenderState to it first being presented
+    struct RenderLatencyStats
+    {
+        size_t frames = 0;
+        std::chrono::steady_clock::duration total = {};
+        std::chrono::steady_clock::duration max = {};
+
+        double averageMilliseconds() const { return frames ? std::chrono::duration<double, std::milli>(total).count() / frames : 0.0; }
+        double maxMilliseconds() const { return std::chrono::duration<double, std::milli>(max).count(); }
+    };
+
     class Renderer
     {
     public:
         static Renderer* get();
 
-        Renderer(const DiabloExe::DiabloExe& exe, int32_t windowWidth, int32_t windowHeight, bool fullscreen);
+        Renderer(const DiabloExe::DiabloExe& exe, const Render::RenderSettings& renderSettings);
         ~Renderer();
 
         void stop();
@@ -93,8 +101,12 @@ namespace FARender
 
         Tileset getTileset(const FAWorld::GameLevel& level);
 
-        RenderState* getFreeState(); // ooh ah up de ra
+        /// Game thread only. Never null, the state handed out is the same one until it is passed to setCurrentState.
+        RenderState* getFreeState();
+        /// Game thread only. Publishes the state from getFreeState to the render thread.
         void setCurrentState(RenderState* current);
+        /// Render thread only. @return The newest state published by the game thread, or nullptr if there hasn't been one yet
+        RenderState* getLatestState() { return mStates->acquireLatest(); }
 
         Render::Tile getTileByScreenPos(size_t x, size_t y, const FAWorld::Position& screenPos);
 
@@ -102,6 +114,9 @@ namespace FARender
 
         bool renderFrame(RenderState* state); ///< To be called only by Engine::ThreadManager
 
+        /// Render thread only. @return Latency stats for the frames presented since the last call
+        RenderLatencyStats takeLatencyStats() { return std::exchange(mLatencyStats, RenderLatencyStats()); }
+
         nk_context* getNuklearContext() { return &mNuklearContext; }
 
         void getWindowDimensions(int32_t& w, int32_t& h);
@@ -128,9 +143,10 @@ namespace FARender
         std::atomic_bool mDone;
         LevelObjects mLevelObjects;
         LevelObjects mItems;
+        RenderInterpolator mInterpolator;
 
-        static constexpr size_t NUM_RENDER_STATES = 15;
-        std::vector<RenderState> mStates;
+        std::unique_ptr<Misc::TripleBuffer<RenderState>> mStates;
+        RenderLatencyStats mLatencyStats;
 
         const Render::Cursor* mCurrentCursor = nullptr;
 
@@ -0,0 +1,65 @@
+#include "renderinterpolator.h"
+#include "renderer.h"
+#include <algorithm>
+
+namespace FARender
+{
+    // Anything that moves further than this between two states teleported (or is a different object reusing a freed address), so don't slide it
+    static const FixedPoint maxInterpolationDistance = 2;
+
+    void RenderInterpolator::update(std::chrono::steady_clock::time_point captureTime,
+                                    const Vec2Fix& cameraPosition,
+                                    const std::vector<ObjectToRender>& objects,
+                                    std::chrono::steady_clock::time_point now)
+    {
+        if (captureTime != mCurrentCaptureTime)
+        {
+            bool hadState = mCurrentCaptureTime != std::chrono::steady_clock::time_point();
+            mCaptureInterval = hadState ? captureTime - mCurrentCaptureTime : std::chrono::steady_clock::duration::zero();
+            mCurrentCaptureTime = captureTime;
+
+            // The state that was current is about to be handed back to the game thread, so copy out what we need from the new one
+            std::swap(mPreviousPositions, mCurrentPositions);
+            mCurrentPositions.clear();
+            for (const auto& object : objects)
+            {
+                if (object.interpolationKey)
+                    mCurrentPositions.push_back(SnapshotPosition{object.interpolationKey, object.position.getFractionalPos()});
+            }
+            std::sort(mCurrentPositions.begin(), mCurrentPositions.end());
+
+            mPreviousCameraPosition = hadState ? mCurrentCameraPosition : cameraPosition;
+            mCurrentCameraPosition = cameraPosition;
+        }
+
+        mAlpha = 1;
+        if (mCaptureInterval > std::chrono::steady_clock::duration::zero())
+        {
+            int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - mCurrentCaptureTime).count();
+            int64_t interval = std::chrono::duration_cast<std::chrono::microseconds>(mCaptureInterval).count();
+            mAlpha = FixedPoint(std::clamp(elapsed, int64_t(0), interval)) / FixedPoint(interval);
+        }
+    }
+
+    Vec2Fix RenderInterpolator::getPosition(const ObjectToRender& object) const
+    {
+        Vec2Fix current = object.position.getFractionalPos();
+        if (!object.interpolationKey)
+            return current;
+
+        auto it = std::lower_bound(mPreviousPositions.begin(), mPreviousPositions.end(), SnapshotPosition{object.interpolationKey, current});
+        if (it == mPreviousPositions.end() || it->key != object.interpolationKey)
+            return current;
+
+        return interpolate(it->position, current);
+    }
+
+    Vec2Fix RenderInterpolator::interpolate(const Vec2Fix& previous, const Vec2Fix& current) const
+    {
+        Vec2Fix difference = current - previous;
+        if (difference.x.abs() > maxInterpolationDistance || difference.y.abs() > maxInterpolationDistance)
+            return current;
+
+        return previous + difference * mAlpha;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <misc/fixedpoint.h>
+#include <misc/simplevec2.h>
+#include <vector>
+
+namespace FARender
+{
+    struct ObjectToRender;
+
+    /// The game thread only sends a new RenderState once per game tick, but the render thread can present much more often than that.
+    /// To avoid just repeating frames, objects are drawn part way between where they were in the previous state and where they are
+    /// in the current one, by how much of a tick has passed since the current state was captured. This puts what is on screen up to
+    /// a tick behind the simulation, in exchange for smooth movement at any refresh rate or tick rate.
+    class RenderInterpolator
+    {
+    public:
+        /// Render thread only, to be called once before drawing each frame with the RenderState being drawn
+        void update(std::chrono::steady_clock::time_point captureTime,
+                    const Vec2Fix& cameraPosition,
+                    const std::vector<ObjectToRender>& objects,
+                    std::chrono::steady_clock::time_point now);
+
+        Vec2Fix getPosition(const ObjectToRender& object) const;
+        Vec2Fix getCameraPosition() const { return interpolate(mPreviousCameraPosition, mCurrentCameraPosition); }
+
+        FixedPoint getAlpha() const { return mAlpha; }
+
+    private:
+        Vec2Fix interpolate(const Vec2Fix& previous, const Vec2Fix& current) const;
+
+        struct SnapshotPosition
+        {
+            const void* key;
+            Vec2Fix position;
+
+            bool operator<(const SnapshotPosition& other) const { return key < other.key; }
+        };
+
+        std::vector<SnapshotPosition> mPreviousPositions; ///< Sorted by key
+        std::vector<SnapshotPosition> mCurrentPositions;  ///< Sorted by key
+        Vec2Fix mPreviousCameraPosition;
+        Vec2Fix mCurrentCameraPosition;
+
+        std::chrono::steady_clock::time_point mCurrentCaptureTime;
+        std::chrono::steady_clock::duration mCaptureInterval = {};
+        FixedPoint mAlpha = 1;
+    };
+}
@@ -1,22 +1,37 @@
 #include "spriteloader.h"
 #include "renderer.h"
-#include <cel/celfile.h>
+#include <atomic>
+#include <cel/celdecoder.h>
+#include <cel/decodedimagecache.h>
+#include <cel/pal.h>
 #include <cel/tilesetimage.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <diabloexe/baseitem.h>
 #include <diabloexe/diabloexe.h>
 #include <diabloexe/monster.h>
 #include <diabloexe/npc.h>
 #include <fmt/format.h>
+#include <misc/mappedfile.h>
 #include <misc/md5.h>
 #include <misc/stringops.h>
+#include <mutex>
 #include <render/spritegroup.h>
-#include <serial/textstream.h>
+#include <render/texture.h>
+#include <serial/binarystream.h>
 #include <thread>
+#include <zlib.h>
 
 namespace FARender
 {
+    SpriteLoader* SpriteLoader::singletonInstance = nullptr;
+
     SpriteLoader::SpriteLoader(const DiabloExe::DiabloExe& exe)
     {
+        release_assert(singletonInstance == nullptr);
+        singletonInstance = this;
+
         for (const auto& pair : exe.getMonsters())
         {
             const DiabloExe::Monster& monsterData = pair.second;
@@ -186,6 +201,8 @@ namespace FARender
             mSpritesToLoad.insert(*guiSpriteIt);
     }
 
+    SpriteLoader::~SpriteLoader() { singletonInstance = nullptr; }
+
     Render::SpriteGroup* SpriteLoader::getSprite(const SpriteDefinition& definition, GetSpriteFailAction fail)
     {
         if (fail == GetSpriteFailAction::Error)
@@ -198,7 +215,13 @@ namespace FARender
         return it->second.get();
     }
 
-    void SpriteLoader::load()
+    Render::Texture& SpriteLoader::getPaletteTexture() const
+    {
+        release_assert(mAtlasTexture);
+        return mAtlasTexture->getPaletteTexture();
+    }
+
+    void SpriteLoader::removeBrokenSprites()
     {
         // TODO: This is a temporary hack, once we have a proper data loader, we just won't specify these
         static std::unordered_set<std::string> badCelNames{
@@ -219,13 +242,237 @@ namespace FARender
             else
                 ++it;
         }
+    }
+
+    static bool isTilesetDefinition(const SpriteLoader::SpriteDefinition& definition)
+    {
+        return Misc::StringUtils::startsWith(definition.path, "virtual_diablo_tileset/");
+    }
+
+    // Returns the level cel and min paths for a virtual tileset definition
+    static std::pair<std::string, std::string> getTilesetPaths(const SpriteLoader::SpriteDefinition& definition, Cel::TilesetImagePart& imagePart)
+    {
+        std::vector<std::string> tilesetComponents = Misc::StringUtils::split(definition.path, '/');
+        release_assert(tilesetComponents.size() == 3);
+
+        imagePart = tilesetComponents[1] == "top" ? Cel::TilesetImagePart::Top : Cel::TilesetImagePart::Bottom;
+        int32_t i = std::stoi(tilesetComponents[2]);
+
+        if (i == 0)
+            return {"levels/towndata/town.cel", "levels/towndata/town.min"};
+
+        return {fmt::format("levels/l{}data/l{}.cel", i, i), fmt::format("levels/l{}data/l{}.min", i, i)};
+    }
+
+    // Rough relative decode cost, used to hand the expensive definitions out first so they don't end up as the long tail
+    static int32_t estimateDecodeCost(const SpriteLoader::SpriteDefinition& definition)
+    {
+        if (isTilesetDefinition(definition))
+            return 2;
+
+        std::string extension = Misc::StringUtils::getFileExtension(Misc::StringUtils::split(definition.path, '&')[0]);
+        if (Misc::StringUtils::ciEqual(extension, "cl2"))
+            return 1;
+
+        return 0;
+    }
+
+    void SpriteLoader::decodeSprites(const std::unordered_set<SpriteDefinition, SpriteDefinition::Hash>& spritesToLoad,
+                                     bool indexed,
+                                     const std::function<void(std::vector<DecodedSprite>&&)>& consumeDecoded,
+                                     const std::function<void(int32_t)>& progressCallback)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        size_t numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+
+        printf("Decoding + trimming sprites with %d %s...\n", int(numWorkers), numWorkers > 1 ? "threads" : "thread");
+
+        std::vector<const SpriteDefinition*> sortedDefinitions;
+        sortedDefinitions.reserve(spritesToLoad.size());
+        for (const auto& definition : spritesToLoad)
+            sortedDefinitions.push_back(&definition);
+
+        std::stable_sort(sortedDefinitions.begin(), sortedDefinitions.end(), [](const SpriteDefinition* a, const SpriteDefinition* b) {
+            return estimateDecodeCost(*a) > estimateDecodeCost(*b);
+        });
+
+        // The cost of a definition varies wildly (a whole tileset vs. a single small cel), so instead of splitting the work up front
+        // each worker takes from the front of its own queue, and steals from the back of the others' once it runs dry.
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<const SpriteDefinition*> definitions;
+        };
+
+        // Definitions cut from the same file share one decode of it, which is freed once the last of them is done
+        Cel::DecodedImageCache imageCache;
+        for (const SpriteDefinition* definition : sortedDefinitions)
+            imageCache.expectUse(getSourcePath(*definition));
+
+        std::vector<WorkerQueue> queues(numWorkers);
+        for (size_t i = 0; i < sortedDefinitions.size(); i++)
+            queues[i % numWorkers].definitions.push_back(sortedDefinitions[i]);
+
+        auto takeWork = [&queues, numWorkers](size_t workerIndex, bool& stolen) -> const SpriteDefinition* {
+            for (size_t offset = 0; offset < numWorkers; offset++)
+            {
+                WorkerQueue& queue = queues[(workerIndex + offset) % numWorkers];
+                std::scoped_lock lock(queue.mutex);
+
+                if (queue.definitions.empty())
+                    continue;
+
+                const SpriteDefinition* definition = nullptr;
+                if (offset == 0)
+                {
+                    definition = queue.definitions.front();
+                    queue.definitions.pop_front();
+                }
+                else
+                {
+                    definition = queue.definitions.back();
+                    queue.definitions.pop_back();
+                }
+
+                stolen = offset != 0;
+                return definition;
+            }
+
+            return nullptr;
+        };
+
+        std::mutex outputMutex;
+        std::condition_variable outputReady;
+        std::vector<DecodedSprite> decoded;
+        size_t finishedWorkers = 0;
+
+        std::atomic_int64_t busyMicroseconds = 0;
+        std::atomic_int32_t steals = 0;
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < numWorkers; i++)
+        {
+            workers.emplace_back([&, workerIndex(i)] {
+                bool stolen = false;
+                while (const SpriteDefinition* definition = takeWork(workerIndex, stolen))
+                {
+                    auto decodeStart = std::chrono::steady_clock::now();
+                    DecodedSprite sprite = decodeSprite(*definition, imageCache, indexed);
+                    busyMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - decodeStart).count();
+                    steals += stolen ? 1 : 0;
+
+                    {
+                        std::scoped_lock lock(outputMutex);
+                        decoded.emplace_back(std::move(sprite));
+                    }
+                    outputReady.notify_one();
+                }
+
+                {
+                    std::scoped_lock lock(outputMutex);
+                    finishedWorkers++;
+                }
+                outputReady.notify_one();
+            });
+        }
+
+        size_t consumedCount = 0;
+        int32_t lastPercentage = -1;
+
+        std::unique_lock lock(outputMutex);
+        while (true)
+        {
+            outputReady.wait_for(lock, std::chrono::milliseconds(500), [&] { return !decoded.empty() || finishedWorkers == numWorkers; });
+
+            bool allDecoded = finishedWorkers == numWorkers;
+            std::vector<DecodedSprite> batch = std::move(decoded);
+            decoded.clear();
+            lock.unlock();
+
+            consumedCount += batch.size();
+            if (!batch.empty())
+                consumeDecoded(std::move(batch));
+
+            int32_t percentage = int32_t(floorf((float(consumedCount) / std::max(sortedDefinitions.size(), size_t(1))) * 100));
+            percentage = std::min(percentage, 99);
+            if (percentage != lastPercentage)
+                progressCallback(percentage);
+            lastPercentage = percentage;
+
+            lock.lock();
+            if (allDecoded && decoded.empty())
+                break;
+        }
+        lock.unlock();
+
+        for (auto& thread : workers)
+            thread.join();
+
+        release_assert(consumedCount == sortedDefinitions.size());
+
+        float seconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0f;
+        float busySeconds = float(busyMicroseconds) / 1000000.0f;
+        printf("done in %.1f seconds (%.1f seconds of decoding, %.0f%% of the workers' time, %d stolen)\n",
+               seconds,
+               busySeconds,
+               seconds > 0 ? busySeconds / (seconds * numWorkers) * 100.0f : 100.0f,
+               int32_t(steals));
+    }
+
+    void SpriteLoader::packSprites(std::vector<DecodedSprite>& sprites)
+    {
+        struct FrameToPack
+        {
+            const DecodedFrame* frame;
+            const std::string* category;
+            int32_t paletteRow;
+            const Render::TextureReference** destination;
+        };
+
+        std::vector<std::vector<const Render::TextureReference*>> spriteFrames(sprites.size());
+        std::vector<FrameToPack> framesToPack;
+
+        for (size_t i = 0; i < sprites.size(); i++)
+        {
+            int32_t paletteRow = sprites[i].palette ? mAtlasTexture->addPalette(*sprites[i].palette) : -1;
+
+            spriteFrames[i].resize(sprites[i].frames.size());
+            for (size_t j = 0; j < sprites[i].frames.size(); j++)
+                framesToPack.push_back(FrameToPack{&sprites[i].frames[j], &sprites[i].definition->category, paletteRow, &spriteFrames[i][j]});
+        }
+
+        // The rect packer needs its input sorted by height to pack well
+        auto packedHeight = [](const FrameToPack& toPack) {
+            if (toPack.frame->trimmedData)
+                return toPack.frame->trimmedData->trimmedHeight;
+            return toPack.paletteRow >= 0 ? toPack.frame->indices.height() : toPack.frame->image.height();
+        };
+        std::stable_sort(
+            framesToPack.begin(), framesToPack.end(), [&](const FrameToPack& a, const FrameToPack& b) { return packedHeight(a) > packedHeight(b); });
+
+        for (const FrameToPack& toPack : framesToPack)
+        {
+            if (toPack.paletteRow >= 0)
+                *toPack.destination = &mAtlasTexture->addSprite(toPack.frame->indices, toPack.frame->trimmedData, *toPack.category, toPack.paletteRow);
+            else
+                *toPack.destination = &mAtlasTexture->addSprite(toPack.frame->image, toPack.frame->trimmedData, *toPack.category);
+        }
+
+        for (size_t i = 0; i < sprites.size(); i++)
+            mLoadedSprites[*sprites[i].definition] = std::make_unique<Render::SpriteGroup>(std::move(spriteFrames[i]), sprites[i].animationLength);
+    }
+
+    void SpriteLoader::load(bool indexedSprites)
+    {
+        removeBrokenSprites();
 
         Render::setWindowTitle(Render::getWindowTitle() + ", trying to load sprites from cache...");
 
         bool loadedFromCache = false;
         try
         {
-            loadFromCache(mAtlasDirectory);
+            loadFromCache(mAtlasDirectory, indexedSprites);
             loadedFromCache = true;
         }
         catch (std::runtime_error&)
@@ -238,318 +485,488 @@ namespace FARender
             return;
         }
 
-        // Load images into cpu memory + trim
-        LoadedImagesData loadedImagesData;
-        {
-            auto start = std::chrono::steady_clock::now();
+        // Decoding, packing and uploading are pipelined: sprites are packed on this thread in windows as the workers finish them,
+        // and only their trimmed pixels are kept until every layer is uploaded in one go at the end.
+        mAtlasTexture = std::make_unique<Render::AtlasTexture>(*Render::mainRenderInstance, *Render::mainCommandQueue);
 
-            size_t numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<DecodedSprite> packWindow;
+        size_t packWindowFrames = 0;
+        std::chrono::steady_clock::duration packTime = {};
 
-            printf("Decoding + trimming sprites with %d %s...\n", int(numWorkers), numWorkers > 1 ? "threads" : "thread");
+        auto flushPackWindow = [&]() {
+            auto packStart = std::chrono::steady_clock::now();
+            packSprites(packWindow);
+            packTime += std::chrono::steady_clock::now() - packStart;
 
-            size_t spritesToLoadTotal = mSpritesToLoad.size();
+            packWindow.clear();
+            packWindowFrames = 0;
+        };
 
-            std::vector<std::thread> workers;
-            std::vector<LoadedImagesData> threadResults(numWorkers);
-            std::vector<std::atomic_int> progressCounts(numWorkers);
-            std::condition_variable conditionVariable;
+        decodeSprites(
+            mSpritesToLoad,
+            indexedSprites,
+            [&](std::vector<DecodedSprite>&& sprites) {
+                for (DecodedSprite& sprite : sprites)
+                {
+                    packWindowFrames += sprite.frames.size();
+                    packWindow.emplace_back(std::move(sprite));
+                }
 
-            for (size_t i = 0; i < numWorkers; i++)
-            {
-                std::unordered_set<SpriteDefinition, SpriteDefinition::Hash> thisThreadImages;
-                for (size_t j = 0; j < size_t(ceil(double(spritesToLoadTotal) / numWorkers)) && !mSpritesToLoad.empty(); j++)
-                    thisThreadImages.emplace(mSpritesToLoad.extract(mSpritesToLoad.begin()).value());
-
-                workers.emplace_back(
-                    [results(&threadResults[i]), thisThreadImages(std::move(thisThreadImages)), resultCounter(&progressCounts[i]), &conditionVariable] {
-                        *results = loadImagesIntoCpuMemory(thisThreadImages, *resultCounter);
-                        conditionVariable.notify_one();
-                    });
-            }
+                if (packWindowFrames >= PACK_WINDOW_FRAMES)
+                    flushPackWindow();
+            },
+            [](int32_t percentage) { Render::setWindowTitle(Render::getWindowTitle() + ", Loading Sprites: " + std::to_string(percentage) + "%"); });
 
-            release_assert(mSpritesToLoad.empty());
+        flushPackWindow();
+        mSpritesToLoad.clear();
 
-            std::mutex mutex;
-            while (true)
-            {
-                std::unique_lock lock(mutex);
-                conditionVariable.wait_for(lock, std::chrono::milliseconds(500));
+        printf("Uploading sprites to texture atlas...\n");
+        auto uploadStart = std::chrono::steady_clock::now();
+        int32_t uploadedLayers = mAtlasTexture->uploadPendingSprites();
+        auto uploadTime = std::chrono::steady_clock::now() - uploadStart;
 
-                size_t sum = 0;
-                for (const auto& item : progressCounts)
-                    sum += size_t(item);
+        auto toSeconds = [](std::chrono::steady_clock::duration duration) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 1000.0f;
+        };
+        printf("done, packing took %.1f seconds, uploading %d layers took %.1f seconds\n", toSeconds(packTime), uploadedLayers, toSeconds(uploadTime));
 
-                if (sum == spritesToLoadTotal)
-                    break;
+        mAtlasTexture->printUtilisation();
 
-                int32_t percentage = int32_t(floorf((float(sum) / spritesToLoadTotal) * 100));
-                percentage = std::min(percentage, 99);
+        Render::setWindowTitle(Render::getWindowTitle() + ", saving sprite cache...");
+        saveToCache(mAtlasDirectory, indexedSprites);
 
-                Render::setWindowTitle(Render::getWindowTitle() + ", Loading Sprites: " + std::to_string(percentage) + "%");
-            }
+        Render::setWindowTitle(Render::getWindowTitle());
+    }
 
-            // Just to be sure the threads are done
-            for (auto& thread : workers)
-                thread.join();
+    void SpriteLoader::loadHeadless()
+    {
+        removeBrokenSprites();
 
-            for (auto& result : threadResults)
-            {
-                loadedImagesData.allImages.insert(
-                    loadedImagesData.allImages.end(), std::make_move_iterator(result.allImages.begin()), std::make_move_iterator(result.allImages.end()));
+        try
+        {
+            loadFromCache(mAtlasDirectory, false, false);
+            mSpritesToLoad.clear();
+            return;
+        }
+        catch (std::runtime_error&)
+        {
+        }
 
-                while (!result.definitionToImageMap.empty())
-                    loadedImagesData.definitionToImageMap.insert(result.definitionToImageMap.extract(result.definitionToImageMap.begin()));
-            }
+        // The tilesets are by far the most expensive to build, and only the renderer uses them
+        for (auto it = mSpritesToLoad.begin(); it != mSpritesToLoad.end();)
+        {
+            if (isTilesetDefinition(*it))
+                it = mSpritesToLoad.erase(it);
+            else
+                ++it;
+        }
 
-            mSpritesToLoad.clear();
+        decodeSprites(
+            mSpritesToLoad,
+            false,
+            [this](std::vector<DecodedSprite>&& sprites) {
+                for (const DecodedSprite& sprite : sprites)
+                {
+                    std::vector<const Render::TextureReference*> frames;
 
-            auto elapsed = std::chrono::steady_clock::now() - start;
-            int32_t milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+                    for (const DecodedFrame& decodedFrame : sprite.frames)
+                    {
+                        auto frame = std::unique_ptr<Render::TextureReference>(new Render::TextureReference(Render::TextureReference::Tag{}));
 
-            float seconds = float(milliseconds) / 1000.0f;
-            printf("done in %.1f seconds\n", seconds);
-        }
+                        frame->mWidth = decodedFrame.image.width();
+                        frame->mHeight = decodedFrame.image.height();
 
-        printf("Sorting sprites...\n");
-        std::sort(loadedImagesData.allImages.begin(),
-                  loadedImagesData.allImages.end(),
-                  [](const std::unique_ptr<FinalImageData>& a, const std::unique_ptr<FinalImageData>& b) {
-                      int32_t aHeight = a->trimmedData ? a->trimmedData->trimmedHeight : a->image->height();
-                      int32_t bHeight = b->trimmedData ? b->trimmedData->trimmedHeight : b->image->height();
+                        Image::TrimmedData trimmedData = decodedFrame.trimmedData.value_or(Image::TrimmedData{0, 0, frame->mWidth, frame->mHeight});
+                        frame->mTrimmedOffsetX = trimmedData.trimmedOffsetX;
+                        frame->mTrimmedOffsetY = trimmedData.trimmedOffsetY;
+                        frame->mTrimmedWidth = trimmedData.trimmedWidth;
+                        frame->mTrimmedHeight = trimmedData.trimmedHeight;
 
-                      return aHeight > bHeight;
-                  });
-        printf("done\n");
+                        frames.push_back(frame.get());
+                        mHeadlessFrames.push_back(std::move(frame));
+                    }
 
-        std::unordered_map<const Image*, const Render::TextureReference*> imagesToSprites;
+                    mLoadedSprites[*sprite.definition] = std::make_unique<Render::SpriteGroup>(std::move(frames), sprite.animationLength);
+                }
+            },
+            [](int32_t) {});
 
-        printf("Uploading sprites to texture atlas...\n");
-        {
-            mAtlasTexture = std::make_unique<Render::AtlasTexture>(*Render::mainRenderInstance, *Render::mainCommandQueue);
+        mSpritesToLoad.clear();
+    }
 
-            Render::AtlasTexture::SpriteLoadInputMap imagesByCategory;
+    namespace
+    {
+        // The atlas cache is a single file: a header, fixed layout definition / frame / layer / palette tables, and then the pixels of each layer.
+        // It is only ever read back on the machine that wrote it, so everything is in native byte order and the tables are used in place
+        // from a memory mapping. Definitions are stored in sorted order instead of by name, the definitions hash guarantees they match.
+        constexpr uint32_t ATLAS_CACHE_MAGIC = 0x43414146; // "FAAC"
 
-            for (auto& image : loadedImagesData.allImages)
-                imagesByCategory[image->category].push_back(Render::AtlasTexture::LoadImageData{*image->image, image->trimmedData});
+        struct CacheHeader
+        {
+            uint32_t magic;
+            int32_t version;
+            std::array<uint8_t, 16> definitionsHash;
+            uint32_t definitionCount;
+            uint32_t frameCount;
+            uint32_t layerCount;
+            uint32_t paletteCount;
+            uint32_t indexedSprites; ///< Whether the cache was built with indexed sprites, it is rebuilt when the setting changes
+            uint32_t pad;
+        };
 
-            Render::AtlasTexture::SpriteLoadResultMap loadedSpritesByCategory = mAtlasTexture->loadSprites(imagesByCategory);
+        struct CachedDefinition
+        {
+            uint32_t firstFrame;
+            uint32_t frameCount;
+            int32_t animationLength;
+        };
 
-            for (const auto& pair : loadedSpritesByCategory)
-            {
-                const std::string& category = pair.first;
-                const std::vector<Render::AtlasTexture::LoadImageData>& images = imagesByCategory[category];
-                const std::vector<NonNullConstPtr<Render::TextureReference>>& sprites = pair.second;
+        struct CachedFrame
+        {
+            int32_t x;
+            int32_t y;
+            int32_t width;
+            int32_t height;
+            int32_t trimmedOffsetX;
+            int32_t trimmedOffsetY;
+            int32_t trimmedWidth;
+            int32_t trimmedHeight;
+            uint32_t layerIndex;
+            int32_t paletteRow;
+        };
 
-                for (size_t index = 0; index < sprites.size(); index++)
-                    imagesToSprites[&images[index].image] = sprites[index].get();
-            }
-        }
-        printf("done\n");
+        struct CachedLayer
+        {
+            uint32_t categoryIndex;
+            int32_t width;
+            int32_t height;
+            uint32_t compressed;
+            uint32_t indexed; ///< R8 palette indices rather than RGBA8 pixels
+            uint32_t pad;
+            uint64_t offset;
+            uint64_t size;
+        };
 
-        mAtlasTexture->printUtilisation();
+        size_t alignCacheOffset(size_t offset) { return (offset + 7) & ~size_t(7); }
 
-        // Rebuild the sprite groups into collections of frames (where each frame is a reference to the atlas)
-        for (auto& pair : loadedImagesData.definitionToImageMap)
+        struct CacheLayout
         {
-            const SpriteDefinition& definition = pair.first;
-            FinalImageDataFrames& definitionFrames = pair.second;
+            size_t definitionsOffset;
+            size_t framesOffset;
+            size_t layersOffset;
+            size_t palettesOffset;
+            size_t pixelsOffset;
+        };
 
-            std::vector<const Render::TextureReference*> finalSprites;
+        CacheLayout getCacheLayout(const CacheHeader& header)
+        {
+            CacheLayout layout;
+            layout.definitionsOffset = alignCacheOffset(sizeof(CacheHeader));
+            layout.framesOffset = alignCacheOffset(layout.definitionsOffset + size_t(header.definitionCount) * sizeof(CachedDefinition));
+            layout.layersOffset = alignCacheOffset(layout.framesOffset + size_t(header.frameCount) * sizeof(CachedFrame));
+            layout.palettesOffset = alignCacheOffset(layout.layersOffset + size_t(header.layerCount) * sizeof(CachedLayer));
+            layout.pixelsOffset = alignCacheOffset(layout.palettesOffset + size_t(header.paletteCount) * sizeof(IndexedPalette::Colours));
+            return layout;
+        }
 
-            for (FinalImageData* frame : definitionFrames.frames)
-            {
-                const Render::TextureReference* sprite = imagesToSprites[frame->image.get()];
-                finalSprites.push_back(sprite);
-            }
+        template <typename T> const T* getCacheTable(const Misc::MappedFile& file, size_t offset, size_t count)
+        {
+            if (offset > file.size() || count > (file.size() - offset) / sizeof(T))
+                throw std::runtime_error("truncated atlas cache");
 
-            mLoadedSprites[definition] = std::make_unique<Render::SpriteGroup>(std::move(finalSprites), definitionFrames.animationLength);
+            return reinterpret_cast<const T*>(file.data() + offset);
         }
 
-        Render::setWindowTitle(Render::getWindowTitle() + ", saving sprite cache...");
-        saveToCache(mAtlasDirectory);
+        std::vector<SpriteLoader::SpriteDefinition> sortDefinitions(const std::vector<SpriteLoader::SpriteDefinition>& definitions)
+        {
+            std::vector<SpriteLoader::SpriteDefinition> sorted = definitions;
+            std::sort(sorted.begin(), sorted.end());
+            return sorted;
+        }
 
-        Render::setWindowTitle(Render::getWindowTitle());
+        std::vector<std::string> getCategories(const std::vector<SpriteLoader::SpriteDefinition>& definitions)
+        {
+            std::vector<std::string> categories;
+            for (const auto& definition : definitions)
+                categories.push_back(definition.category);
+
+            std::sort(categories.begin(), categories.end());
+            categories.erase(std::unique(categories.begin(), categories.end()), categories.end());
+            return categories;
+        }
+
+        uint32_t getCategoryIndex(const std::vector<std::string>& categories, const std::string& category)
+        {
+            return uint32_t(std::lower_bound(categories.begin(), categories.end(), category) - categories.begin());
+        }
     }
 
-    void SpriteLoader::saveToCache(const filesystem::path& atlasDirectory) const
+    void SpriteLoader::saveToCache(const filesystem::path& atlasDirectory, bool indexedSprites) const
     {
         if (atlasDirectory.exists())
             release_assert(filesystem::remove_all(atlasDirectory));
         filesystem::create_directories(atlasDirectory);
 
-        mAtlasTexture->saveTexturesToCache(atlasDirectory);
-
         std::vector<SpriteDefinition> allSpriteDefinitions;
         {
             for (const auto& pair : mLoadedSprites)
                 allSpriteDefinitions.push_back(pair.first);
 
-            std::sort(allSpriteDefinitions.begin(), allSpriteDefinitions.end());
+            allSpriteDefinitions = sortDefinitions(allSpriteDefinitions);
         }
 
-        Serial::TextWriteStream stream;
-        Serial::Saver saver(stream);
+        std::vector<std::string> categories = getCategories(allSpriteDefinitions);
+
+        // Layers are stored zlib compressed, as they are mostly transparent. Indexed layers are stored as they are, a byte per texel.
+        std::vector<CachedLayer> layers;
+        std::vector<std::vector<uint8_t>> layerPixels;
+        std::unordered_map<const Render::Texture*, uint32_t> layerIndices;
+        {
+            std::vector<uint8_t> rawPixels;
 
-        saver.save(ATLAS_CACHE_VERSION);
+            for (uint32_t categoryIndex = 0; categoryIndex < uint32_t(categories.size()); categoryIndex++)
+            {
+                auto categoryLayers = mAtlasTexture->getLayersByCategory().find(categories[categoryIndex]);
+                if (categoryLayers == mAtlasTexture->getLayersByCategory().end())
+                    continue;
 
-        SpriteDefinitionsHash definitionsHash = hashSpriteDefinitions(allSpriteDefinitions);
-        for (const auto& byte : definitionsHash)
-            saver.save(byte);
+                for (const Render::AtlasTexture::Layer& layer : categoryLayers->second.layers)
+                {
+                    Render::Texture& texture = *layer.texture;
+                    bool indexed = layer.format == Render::Format::R8UNorm;
+                    rawPixels.resize(size_t(texture.width()) * size_t(texture.height()) * (indexed ? 1 : 4));
+                    texture.readImageData(rawPixels.data());
+
+                    std::vector<uint8_t>& pixels = layerPixels.emplace_back(compressBound(uLong(rawPixels.size())));
+                    uLongf compressedSize = uLongf(pixels.size());
+                    bool compressed = compress2(pixels.data(), &compressedSize, rawPixels.data(), uLong(rawPixels.size()), Z_BEST_SPEED) == Z_OK &&
+                                      compressedSize < rawPixels.size();
+
+                    if (compressed)
+                        pixels.resize(compressedSize);
+                    else
+                        pixels = rawPixels;
+
+                    layerIndices[&texture] = uint32_t(layers.size());
+                    layers.push_back(CachedLayer{categoryIndex, texture.width(), texture.height(), compressed, indexed, 0, 0, uint64_t(pixels.size())});
+                }
+            }
+        }
 
-        saver.save(uint32_t(allSpriteDefinitions.size()));
+        std::vector<CachedDefinition> definitions;
+        std::vector<CachedFrame> frames;
 
         for (const auto& definition : allSpriteDefinitions)
         {
-            Serial::ScopedCategory definitionCat("DEF", saver);
-
-            definition.save(saver);
-
             const Render::SpriteGroup* sprite = mLoadedSprites.at(definition).get();
-
-            saver.save(sprite->getAnimationLength());
-            saver.save(sprite->size());
+            definitions.push_back(CachedDefinition{uint32_t(frames.size()), uint32_t(sprite->size()), sprite->getAnimationLength()});
 
             for (int32_t i = 0; i < sprite->size(); i++)
             {
-                Serial::ScopedCategory frameCat("Frame_" + std::to_string(i), saver);
-
                 const Render::TextureReference* frame = sprite->getFrame(i);
 
-                saver.save(frame->mX);
-                saver.save(frame->mY);
-                saver.save(frame->mWidth);
-                saver.save(frame->mHeight);
-                saver.save(frame->mTrimmedOffsetX);
-                saver.save(frame->mTrimmedOffsetY);
-                saver.save(frame->mTrimmedWidth);
-                saver.save(frame->mTrimmedHeight);
-
-                int32_t textureIndex = -1;
-                {
-                    const std::vector<Render::AtlasTexture::Layer>& layers = mAtlasTexture->getLayersByCategory().at(definition.category).layers;
+                auto layerIt = layerIndices.find(frame->mTexture);
+                release_assert(layerIt != layerIndices.end());
+
+                frames.push_back(CachedFrame{frame->mX,
+                                             frame->mY,
+                                             frame->mWidth,
+                                             frame->mHeight,
+                                             frame->mTrimmedOffsetX,
+                                             frame->mTrimmedOffsetY,
+                                             frame->mTrimmedWidth,
+                                             frame->mTrimmedHeight,
+                                             layerIt->second,
+                                             frame->mPaletteRow});
+            }
+        }
 
-                    for (int32_t j = 0; j < int32_t(layers.size()); j++)
-                    {
-                        if (frame->mTexture == layers[j].texture.get())
-                        {
-                            textureIndex = j;
-                            break;
-                        }
-                    }
+        CacheHeader header = {};
+        header.magic = ATLAS_CACHE_MAGIC;
+        header.version = ATLAS_CACHE_VERSION;
+        header.definitionsHash = hashSpriteDefinitions(allSpriteDefinitions);
+        header.definitionCount = uint32_t(definitions.size());
+        header.frameCount = uint32_t(frames.size());
+        header.layerCount = uint32_t(layers.size());
+        header.paletteCount = uint32_t(mAtlasTexture->getPalettes().size());
+        header.indexedSprites = indexedSprites;
 
-                    release_assert(textureIndex != -1);
-                }
+        CacheLayout layout = getCacheLayout(header);
 
-                saver.save(textureIndex);
-            }
+        size_t pixelsOffset = layout.pixelsOffset;
+        for (CachedLayer& layer : layers)
+        {
+            layer.offset = pixelsOffset;
+            pixelsOffset = alignCacheOffset(pixelsOffset + size_t(layer.size));
         }
 
-        std::pair<const uint8_t*, size_t> data = stream.getData();
+        FILE* f = fopen((atlasDirectory / ATLAS_CACHE_FILENAME).str().c_str(), "wb");
+        release_assert(f);
+
+        size_t written = 0;
+        auto write = [&](size_t offset, const void* data, size_t size) {
+            static constexpr uint8_t padding[8] = {};
+            release_assert(offset >= written && offset - written <= sizeof(padding));
+
+            fwrite(padding, 1, offset - written, f);
+            fwrite(data, 1, size, f);
+            written = offset + size;
+        };
+
+        write(0, &header, sizeof(header));
+        write(layout.definitionsOffset, definitions.data(), definitions.size() * sizeof(CachedDefinition));
+        write(layout.framesOffset, frames.data(), frames.size() * sizeof(CachedFrame));
+        write(layout.layersOffset, layers.data(), layers.size() * sizeof(CachedLayer));
+        write(layout.palettesOffset, mAtlasTexture->getPalettes().data(), mAtlasTexture->getPalettes().size() * sizeof(IndexedPalette::Colours));
+
+        for (size_t i = 0; i < layers.size(); i++)
+            write(size_t(layers[i].offset), layerPixels[i].data(), layerPixels[i].size());
 
-        FILE* f = fopen((atlasDirectory / "data.txt").str().c_str(), "wb");
-        fwrite(data.first, 1, data.second, f);
         fclose(f);
     }
 
-    void SpriteLoader::loadFromCache(const filesystem::path& atlasDirectory)
+    void SpriteLoader::loadFromCache(const filesystem::path& atlasDirectory, bool indexedSprites, bool uploadTextures)
     {
-        if (!atlasDirectory.exists())
+        auto start = std::chrono::steady_clock::now();
+
+        if (!filesystem::exists(atlasDirectory / ATLAS_CACHE_FILENAME))
             throw std::runtime_error("no cache to load");
 
-        std::string data;
-        {
-            if (!filesystem::exists(atlasDirectory / "data.txt"))
-                throw std::runtime_error("missing data.txt");
+        // Layers are uploaded lazily, so the mapping is kept alive until the last of them has been drawn
+        auto file = std::make_shared<Misc::MappedFile>(atlasDirectory / ATLAS_CACHE_FILENAME);
+        if (!file->isOpen())
+            throw std::runtime_error("failed to open atlas cache");
 
-            FILE* f = fopen((atlasDirectory / "data.txt").str().c_str(), "rb");
-            fseek(f, 0, SEEK_END);
-            size_t size = ftell(f);
-            fseek(f, 0, SEEK_SET);
-            data.resize(size);
-            fread(data.data(), 1, size, f);
-            fclose(f);
-        }
+        CacheHeader header = *getCacheTable<CacheHeader>(*file, 0, 1);
 
-        Serial::TextReadStream stream(data);
-        Serial::Loader loader(stream);
+        if (header.magic != ATLAS_CACHE_MAGIC || header.version != ATLAS_CACHE_VERSION)
+            throw std::runtime_error("wrong atlas cache version");
 
-        int32_t cachedVersion = loader.load<int32_t>();
+        // Headless loads only use the metadata, which is the same either way
+        if (uploadTextures && bool(header.indexedSprites) != indexedSprites)
+            throw std::runtime_error("atlas cache was built with a different indexed sprites setting");
 
-        if (cachedVersion != ATLAS_CACHE_VERSION)
-            throw std::runtime_error("wrong atlas cache version");
+        std::vector<SpriteDefinition> allSpriteDefinitions = sortDefinitions({mSpritesToLoad.begin(), mSpritesToLoad.end()});
+
+        if (header.definitionsHash != hashSpriteDefinitions(allSpriteDefinitions) || header.definitionCount != allSpriteDefinitions.size())
+            throw std::runtime_error("sprite definitions have changed");
+
+        CacheLayout layout = getCacheLayout(header);
+        const CachedDefinition* definitions = getCacheTable<CachedDefinition>(*file, layout.definitionsOffset, header.definitionCount);
+        const CachedFrame* frames = getCacheTable<CachedFrame>(*file, layout.framesOffset, header.frameCount);
+        const CachedLayer* layers = getCacheTable<CachedLayer>(*file, layout.layersOffset, header.layerCount);
+        const IndexedPalette::Colours* palettes = getCacheTable<IndexedPalette::Colours>(*file, layout.palettesOffset, header.paletteCount);
 
-        SpriteDefinitionsHash spritesToLoadDefinitionsHash;
+        std::vector<std::string> categories = getCategories(allSpriteDefinitions);
+        std::vector<Render::Texture*> layerTextures(header.layerCount, nullptr);
+
+        if (uploadTextures)
         {
-            std::vector<SpriteDefinition> allSpriteDefinitions;
+            mAtlasTexture = std::make_unique<Render::AtlasTexture>(*Render::mainRenderInstance, *Render::mainCommandQueue);
+            int32_t maxTextureSize = Render::mainRenderInstance->capabilities().maxTextureSize;
 
-            for (const auto& definition : mSpritesToLoad)
-                allSpriteDefinitions.push_back(definition);
+            // Palettes were saved in the order they were added, and they're unique, so they get the same rows again
+            for (uint32_t i = 0; i < header.paletteCount; i++)
+            {
+                if (mAtlasTexture->addPalette(palettes[i]) != int32_t(i))
+                    throw std::runtime_error("bad atlas cache palette");
+            }
+            mAtlasTexture->uploadPalettes();
 
-            std::sort(allSpriteDefinitions.begin(), allSpriteDefinitions.end());
+            for (uint32_t i = 0; i < header.layerCount; i++)
+            {
+                const CachedLayer& layer = layers[i];
+                size_t rawSize = size_t(layer.width) * size_t(layer.height) * (layer.indexed ? 1 : 4);
 
-            spritesToLoadDefinitionsHash = hashSpriteDefinitions(allSpriteDefinitions);
-        }
+                if (layer.categoryIndex >= categories.size() || layer.width <= 0 || layer.width > maxTextureSize || layer.height <= 0 ||
+                    layer.height > maxTextureSize || (!layer.compressed && layer.size != rawSize))
+                    throw std::runtime_error("bad atlas cache layer");
 
-        SpriteDefinitionsHash cachedSpriteDefinitionsHash;
-        for (auto& byte : cachedSpriteDefinitionsHash)
-            byte = loader.load<uint8_t>();
+                // Only checks that the pixels are inside the file, they are read when the layer is first drawn
+                getCacheTable<uint8_t>(*file, size_t(layer.offset), size_t(layer.size));
 
-        if (cachedSpriteDefinitionsHash != spritesToLoadDefinitionsHash)
-            throw std::runtime_error("sprite definitions have changed");
+                auto uploadLayer = [file, layer, rawSize](Render::Texture& texture) {
+                    const uint8_t* pixels = file->data() + layer.offset;
 
-        mAtlasTexture = std::make_unique<Render::AtlasTexture>(*Render::mainRenderInstance, *Render::mainCommandQueue);
-        mAtlasTexture->loadTexturesFromCache(atlasDirectory);
+                    std::vector<uint8_t> decompressed;
+                    if (layer.compressed)
+                    {
+                        decompressed.resize(rawSize);
+                        uLongf decompressedSize = uLongf(decompressed.size());
+                        int result = uncompress(decompressed.data(), &decompressedSize, pixels, uLong(layer.size));
+                        release_assert(result == Z_OK && decompressedSize == decompressed.size());
+                        pixels = decompressed.data();
+                    }
+
+                    texture.updateImageData(0, 0, 0, layer.width, layer.height, pixels, layer.width);
+                };
+
+                Render::Format format = layer.indexed ? Render::Format::R8UNorm : Render::Format::RGBA8UNorm;
+                layerTextures[i] = &mAtlasTexture->addLazyLayer(categories[layer.categoryIndex], layer.width, layer.height, format, std::move(uploadLayer));
+            }
+        }
 
-        uint32_t definitionCount = loader.load<uint32_t>();
         std::vector<std::unique_ptr<Render::TextureReference>> allAtlasEntries;
+        allAtlasEntries.reserve(header.frameCount);
 
-        for (uint32_t definitionIndex = 0; definitionIndex < definitionCount; definitionIndex++)
+        for (uint32_t definitionIndex = 0; definitionIndex < header.definitionCount; definitionIndex++)
         {
-            SpriteDefinition definition;
-            definition.load(loader);
+            const SpriteDefinition& definition = allSpriteDefinitions[definitionIndex];
+            const CachedDefinition& cachedDefinition = definitions[definitionIndex];
+            uint32_t categoryIndex = getCategoryIndex(categories, definition.category);
 
-            int32_t animationLength = loader.load<int32_t>();
-            int32_t spriteSize = loader.load<int32_t>();
+            if (cachedDefinition.firstFrame > header.frameCount || cachedDefinition.frameCount > header.frameCount - cachedDefinition.firstFrame)
+                throw std::runtime_error("bad atlas cache definition");
 
-            std::vector<const Render::TextureReference*> frames;
-            const std::vector<Render::AtlasTexture::Layer>& layers = mAtlasTexture->getLayersByCategory().at(definition.category).layers;
+            std::vector<const Render::TextureReference*> spriteFrames;
+            spriteFrames.reserve(cachedDefinition.frameCount);
 
-            for (int32_t frameIndex = 0; frameIndex < spriteSize; frameIndex++)
+            for (uint32_t frameIndex = cachedDefinition.firstFrame; frameIndex < cachedDefinition.firstFrame + cachedDefinition.frameCount; frameIndex++)
             {
-                auto frame = std::unique_ptr<Render::TextureReference>(new Render::TextureReference(Render::TextureReference::Tag{}));
+                const CachedFrame& cachedFrame = frames[frameIndex];
 
-                frame->mX = loader.load<int32_t>();
-                frame->mY = loader.load<int32_t>();
-                frame->mWidth = loader.load<int32_t>();
-                frame->mHeight = loader.load<int32_t>();
-                frame->mTrimmedOffsetX = loader.load<int32_t>();
-                frame->mTrimmedOffsetY = loader.load<int32_t>();
-                frame->mTrimmedWidth = loader.load<int32_t>();
-                frame->mTrimmedHeight = loader.load<int32_t>();
-
-                int32_t textureIndex = loader.load<int32_t>();
+                auto frame = std::unique_ptr<Render::TextureReference>(new Render::TextureReference(Render::TextureReference::Tag{}));
+                frame->mX = cachedFrame.x;
+                frame->mY = cachedFrame.y;
+                frame->mWidth = cachedFrame.width;
+                frame->mHeight = cachedFrame.height;
+                frame->mTrimmedOffsetX = cachedFrame.trimmedOffsetX;
+                frame->mTrimmedOffsetY = cachedFrame.trimmedOffsetY;
+                frame->mTrimmedWidth = cachedFrame.trimmedWidth;
+                frame->mTrimmedHeight = cachedFrame.trimmedHeight;
+
+                if (uploadTextures)
+                {
+                    if (cachedFrame.layerIndex >= header.layerCount || layers[cachedFrame.layerIndex].categoryIndex != categoryIndex)
+                        throw std::runtime_error("bad atlas cache frame");
 
-                if (int32_t(layers.size()) < textureIndex)
-                    throw std::runtime_error("missing layer");
+                    bool indexedLayer = layers[cachedFrame.layerIndex].indexed;
+                    if (indexedLayer != (cachedFrame.paletteRow >= 0) || cachedFrame.paletteRow >= int32_t(header.paletteCount))
+                        throw std::runtime_error("bad atlas cache frame palette");
 
-                frame->mTexture = layers[textureIndex].texture.get();
+                    frame->mTexture = layerTextures[cachedFrame.layerIndex];
+                    frame->mPaletteRow = cachedFrame.paletteRow;
+                }
 
-                frames.push_back(frame.get());
+                spriteFrames.push_back(frame.get());
                 allAtlasEntries.push_back(std::move(frame));
             }
 
-            mLoadedSprites[definition] = std::make_unique<Render::SpriteGroup>(std::move(frames), animationLength);
+            mLoadedSprites[definition] = std::make_unique<Render::SpriteGroup>(std::move(spriteFrames), cachedDefinition.animationLength);
         }
 
-        mAtlasTexture->replaceTextureEntries(std::move(allAtlasEntries));
+        if (uploadTextures)
+            mAtlasTexture->replaceTextureEntries(std::move(allAtlasEntries));
+        else
+            mHeadlessFrames = std::move(allAtlasEntries);
 
-        // for debugging
-        // saveToCache(Misc::getResourcesPath() / "cache" / "atlas_resaved");
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        printf("Loaded sprite atlas cache in %d ms\n", int32_t(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
     }
 
     SpriteLoader::SpriteDefinitionsHash SpriteLoader::hashSpriteDefinitions(const std::vector<SpriteDefinition>& definitions)
     {
-        Serial::TextWriteStream stream;
+        Serial::BinaryWriteStream stream;
         Serial::Saver saver(stream);
 
         saver.save(uint32_t(definitions.size()));
@@ -568,9 +985,10 @@ namespace FARender
         return digest;
     }
 
-    static Image loadNonCelImageTrans(const std::string& path, bool hasTrans, size_t transR, size_t transG, size_t transB)
+    static Image
+    loadNonCelImageTrans(Cel::DecodedImageCache& imageCache, const std::string& path, bool hasTrans, size_t transR, size_t transG, size_t transB)
     {
-        Image image = Image::loadFromFile(path);
+        Image image = std::move(imageCache.take(path).frames.at(0));
 
         if (hasTrans)
         {
@@ -588,244 +1006,269 @@ namespace FARender
         return image;
     }
 
-    SpriteLoader::LoadedImagesData SpriteLoader::loadImagesIntoCpuMemory(const std::unordered_set<SpriteDefinition, SpriteDefinition::Hash>& spritesToLoad,
-                                                                         std::atomic_int32_t& progress)
+    std::string SpriteLoader::getSourcePath(const SpriteDefinition& definition)
     {
-        std::vector<std::unique_ptr<FinalImageData>> allImages;
-        std::unordered_map<SpriteDefinition, FinalImageDataFrames, SpriteDefinition::Hash> definitionToImageMap;
-
-        for (const auto& definition : spritesToLoad)
+        if (isTilesetDefinition(definition))
         {
-            std::vector<std::string> components = Misc::StringUtils::split(definition.path, '&');
-            std::string sourcePath = components[0];
-
-            uint32_t vAnim = 0;
-            bool hasTrans = false;
-            bool resize = false;
-            bool convertToSingleTexture = false;
-            uint32_t tileWidth = 0;
-            uint32_t tileHeight = 0;
-            uint32_t newWidth = 0;
-            uint32_t newHeight = 0;
-            uint32_t r = 0, g = 0, b = 0;
-            int32_t celIndex = 0;
-
-            for (uint32_t i = 1; i < components.size(); i++)
-            {
-                std::vector<std::string> pair = Misc::StringUtils::split(components[i], '=');
+            Cel::TilesetImagePart imagePart;
+            return getTilesetPaths(definition, imagePart).first;
+        }
 
-                if (pair[0] == "trans")
-                {
-                    std::vector<std::string> rgbStr = Misc::StringUtils::split(pair[1], ',');
+        return Misc::StringUtils::split(definition.path, '&')[0];
+    }
 
-                    hasTrans = true;
+    SpriteLoader::DecodedSprite SpriteLoader::decodeSprite(const SpriteDefinition& definition, Cel::DecodedImageCache& imageCache, bool indexed)
+    {
+        std::vector<std::string> components = Misc::StringUtils::split(definition.path, '&');
+        std::string sourcePath = components[0];
+
+        uint32_t vAnim = 0;
+        bool hasTrans = false;
+        bool resize = false;
+        bool convertToSingleTexture = false;
+        uint32_t tileWidth = 0;
+        uint32_t tileHeight = 0;
+        uint32_t newWidth = 0;
+        uint32_t newHeight = 0;
+        uint32_t r = 0, g = 0, b = 0;
+        int32_t celIndex = 0;
+
+        for (uint32_t i = 1; i < components.size(); i++)
+        {
+            std::vector<std::string> pair = Misc::StringUtils::split(components[i], '=');
 
-                    std::istringstream rss(rgbStr[0]);
-                    rss >> r;
+            if (pair[0] == "trans")
+            {
+                std::vector<std::string> rgbStr = Misc::StringUtils::split(pair[1], ',');
 
-                    std::istringstream gss(rgbStr[1]);
-                    gss >> g;
+                hasTrans = true;
 
-                    std::istringstream bss(rgbStr[2]);
-                    bss >> b;
-                }
-                else if (pair[0] == "vanim")
-                {
-                    std::istringstream vanimss(pair[1]);
+                std::istringstream rss(rgbStr[0]);
+                rss >> r;
 
-                    vanimss >> vAnim;
-                }
-                else if (pair[0] == "resize")
-                {
-                    resize = true;
+                std::istringstream gss(rgbStr[1]);
+                gss >> g;
 
-                    std::vector<std::string> newSize = Misc::StringUtils::split(pair[1], 'x');
+                std::istringstream bss(rgbStr[2]);
+                bss >> b;
+            }
+            else if (pair[0] == "vanim")
+            {
+                std::istringstream vanimss(pair[1]);
 
-                    std::istringstream wss(newSize[0]);
-                    wss >> newWidth;
+                vanimss >> vAnim;
+            }
+            else if (pair[0] == "resize")
+            {
+                resize = true;
 
-                    std::istringstream hss(newSize[1]);
-                    hss >> newHeight;
-                }
-                else if (pair[0] == "tileSize")
-                {
-                    std::vector<std::string> tileSize = Misc::StringUtils::split(pair[1], 'x');
+                std::vector<std::string> newSize = Misc::StringUtils::split(pair[1], 'x');
 
-                    std::istringstream wss(tileSize[0]);
-                    wss >> tileWidth;
+                std::istringstream wss(newSize[0]);
+                wss >> newWidth;
 
-                    std::istringstream hss(tileSize[1]);
-                    hss >> tileHeight;
-                }
-                else if (pair[0] == "convertToSingleTexture")
-                {
-                    convertToSingleTexture = true;
-                }
-                else if (pair[0] == "frame")
-                {
-                    std::istringstream ss(pair[1]);
-                    ss >> celIndex;
-                }
+                std::istringstream hss(newSize[1]);
+                hss >> newHeight;
             }
+            else if (pair[0] == "tileSize")
+            {
+                std::vector<std::string> tileSize = Misc::StringUtils::split(pair[1], 'x');
 
-            std::vector<Image> finalImages;
-            int32_t animationLength = 0;
+                std::istringstream wss(tileSize[0]);
+                wss >> tileWidth;
 
-            if (Misc::StringUtils::startsWith(definition.path, "virtual_diablo_tileset/"))
+                std::istringstream hss(tileSize[1]);
+                hss >> tileHeight;
+            }
+            else if (pair[0] == "convertToSingleTexture")
             {
-                std::vector<std::string> tilesetComponents = Misc::StringUtils::split(definition.path, '/');
-                release_assert(tilesetComponents.size() == 3);
+                convertToSingleTexture = true;
+            }
+            else if (pair[0] == "frame")
+            {
+                std::istringstream ss(pair[1]);
+                ss >> celIndex;
+            }
+        }
+
+        std::vector<Image> finalImages;
+        int32_t animationLength = 0;
 
-                Cel::TilesetImagePart imagePart = tilesetComponents[1] == "top" ? Cel::TilesetImagePart::Top : Cel::TilesetImagePart::Bottom;
-                int32_t i = std::stoi(tilesetComponents[2]);
+        if (isTilesetDefinition(definition))
+        {
+            Cel::TilesetImagePart imagePart;
+            std::pair<std::string, std::string> tilesetPaths = getTilesetPaths(definition, imagePart);
 
-                std::string celPath = fmt::format("levels/l{}data/l{}.cel", i, i);
-                std::string minPath = fmt::format("levels/l{}data/l{}.min", i, i);
+            // The top and bottom halves are cut from the same level cel
+            finalImages = Cel::loadTilesetImage(imageCache.share(tilesetPaths.first)->frames, tilesetPaths.second, imagePart);
+        }
+        else if (vAnim != 0)
+        {
+            Image original = loadNonCelImageTrans(imageCache, sourcePath, hasTrans, r, g, b);
 
-                if (i == 0)
-                {
-                    celPath = "levels/towndata/town.cel";
-                    minPath = "levels/towndata/town.min";
-                }
+            std::vector<const Render::TextureReference*> vec;
 
-                finalImages = Cel::loadTilesetImage(celPath, minPath, imagePart);
-            }
-            else if (vAnim != 0)
+            for (size_t srcY = 0; srcY < (size_t)original.height() - 1; srcY += vAnim)
             {
-                Image original = loadNonCelImageTrans(sourcePath, hasTrans, r, g, b);
-
-                std::vector<const Render::TextureReference*> vec;
+                Image tmp(original.width(), vAnim);
 
-                for (size_t srcY = 0; srcY < (size_t)original.height() - 1; srcY += vAnim)
+                for (size_t x = 0; x < (size_t)original.width(); x++)
                 {
-                    Image tmp(original.width(), vAnim);
-
-                    for (size_t x = 0; x < (size_t)original.width(); x++)
+                    for (size_t y = 0; y < vAnim; y++)
                     {
-                        for (size_t y = 0; y < vAnim; y++)
+                        if (srcY + y < (size_t)original.height())
                         {
-                            if (srcY + y < (size_t)original.height())
-                            {
-                                Cel::Colour px = original.get(x, srcY + y);
-                                tmp.get(x, y) = px;
-                            }
+                            Cel::Colour px = original.get(x, srcY + y);
+                            tmp.get(x, y) = px;
                         }
                     }
-
-                    finalImages.push_back(std::move(tmp));
                 }
-                animationLength = int32_t(finalImages.size());
+
+                finalImages.push_back(std::move(tmp));
             }
-            else if (resize)
-            {
-                Image original = loadNonCelImageTrans(sourcePath, hasTrans, r, g, b);
+            animationLength = int32_t(finalImages.size());
+        }
+        else if (resize)
+        {
+            Image original = loadNonCelImageTrans(imageCache, sourcePath, hasTrans, r, g, b);
 
-                Image tmp(newWidth, newHeight);
+            Image tmp(newWidth, newHeight);
 
-                size_t srcX = 0;
-                size_t srcY = 0;
-                size_t dstX = 0;
-                size_t dstY = 0;
+            size_t srcX = 0;
+            size_t srcY = 0;
+            size_t dstX = 0;
+            size_t dstY = 0;
 
-                while (true)
+            while (true)
+            {
+                for (size_t y = 0; y < tileHeight; y += 1)
                 {
-                    for (size_t y = 0; y < tileHeight; y += 1)
-                    {
-                        for (size_t x = 0; x < tileWidth; x += 1)
-                        {
-                            Cel::Colour px = original.get(srcX + x, srcY + y);
-                            tmp.get(dstX + x, dstY + y) = px;
-                        }
-                    }
-
-                    srcX += tileWidth;
-                    if (srcX >= (size_t)original.width())
+                    for (size_t x = 0; x < tileWidth; x += 1)
                     {
-                        srcX = 0;
-                        srcY += tileHeight;
+                        Cel::Colour px = original.get(srcX + x, srcY + y);
+                        tmp.get(dstX + x, dstY + y) = px;
                     }
+                }
 
-                    if (srcY >= (size_t)original.height())
-                        break;
+                srcX += tileWidth;
+                if (srcX >= (size_t)original.width())
+                {
+                    srcX = 0;
+                    srcY += tileHeight;
+                }
 
-                    dstX += tileWidth;
-                    if (dstX >= newWidth)
-                    {
-                        dstX = 0;
-                        dstY += tileHeight;
-                    }
+                if (srcY >= (size_t)original.height())
+                    break;
 
-                    if (dstY >= newHeight)
-                        break;
+                dstX += tileWidth;
+                if (dstX >= newWidth)
+                {
+                    dstX = 0;
+                    dstY += tileHeight;
                 }
 
-                finalImages.push_back(std::move(tmp));
-                animationLength = 1;
+                if (dstY >= newHeight)
+                    break;
             }
-            else if (convertToSingleTexture)
-            {
-                Cel::CelFile cel(sourcePath);
-                std::vector<Image> images = cel.decode();
 
-                int32_t width = 0;
-                int32_t height = 0;
+            finalImages.push_back(std::move(tmp));
+            animationLength = 1;
+        }
+        else if (convertToSingleTexture)
+        {
+            std::shared_ptr<const Cel::DecodedImageCache::DecodedImages> cel = imageCache.share(sourcePath);
+            const std::vector<Image>& images = cel->frames;
 
-                for (int32_t i = 0; i < cel.numFrames(); i++)
-                {
-                    width += images[i].width();
-                    height = (images[i].height() > height ? images[i].height() : height);
-                }
+            int32_t width = 0;
+            int32_t height = 0;
 
-                debug_assert(width > 0);
-                debug_assert(height > 0);
+            for (int32_t i = 0; i < int32_t(images.size()); i++)
+            {
+                width += images[i].width();
+                height = (images[i].height() > height ? images[i].height() : height);
+            }
 
-                Image finalImage(width, height);
+            debug_assert(width > 0);
+            debug_assert(height > 0);
 
-                int32_t x = 0;
-                for (int32_t i = 0; i < cel.numFrames(); i++)
-                {
-                    images[i].blitTo(finalImage, x, 0);
-                    x += images[i].width();
-                }
+            Image finalImage(width, height);
 
-                finalImages.push_back(std::move(finalImage));
-                animationLength = 1;
+            int32_t x = 0;
+            for (int32_t i = 0; i < int32_t(images.size()); i++)
+            {
+                images[i].blitTo(finalImage, x, 0);
+                x += images[i].width();
+            }
+
+            finalImages.push_back(std::move(finalImage));
+            animationLength = 1;
+        }
+        else
+        {
+            std::string extension = Misc::StringUtils::getFileExtension(sourcePath);
+            if (Misc::StringUtils::ciEqual(extension, "cel") || Misc::StringUtils::ciEqual(extension, "cl2"))
+            {
+                Cel::DecodedImageCache::DecodedImages cel = imageCache.take(sourcePath);
+                finalImages = std::move(cel.frames);
+                animationLength = cel.animationLength;
             }
             else
             {
-                std::string extension = Misc::StringUtils::getFileExtension(sourcePath);
-                if (Misc::StringUtils::ciEqual(extension, "cel") || Misc::StringUtils::ciEqual(extension, "cl2"))
-                {
-                    Cel::CelFile cel(sourcePath);
-                    finalImages = cel.decode();
-                    animationLength = cel.animLength();
-                }
-                else
-                {
-                    animationLength = 1;
-                    finalImages.push_back(loadNonCelImageTrans(sourcePath, hasTrans, r, g, b));
-                }
+                animationLength = 1;
+                finalImages.push_back(loadNonCelImageTrans(imageCache, sourcePath, hasTrans, r, g, b));
             }
+        }
 
-            FinalImageDataFrames& definitionFrames = definitionToImageMap[definition];
-            definitionFrames.animationLength = animationLength;
+        DecodedSprite decoded;
+        decoded.definition = &definition;
+        decoded.animationLength = animationLength;
+        decoded.frames.reserve(finalImages.size());
 
-            for (auto& image : finalImages)
-            {
-                std::unique_ptr<FinalImageData> finalImageData = std::make_unique<FinalImageData>();
-                if (definition.trim)
-                    finalImageData->trimmedData = image.calculateTrimTransparentEdges();
+        for (auto& image : finalImages)
+        {
+            DecodedFrame& frame = decoded.frames.emplace_back();
+            if (definition.trim)
+                frame.trimmedData = image.calculateTrimTransparentEdges();
+            frame.image = std::move(image);
+        }
 
-                finalImageData->category = definition.category;
-                finalImageData->image = std::make_unique<Image>(std::move(image));
+        // Only plain cel, cl2 and tileset images are known to be made of one palette's colours
+        std::string extension = Misc::StringUtils::getFileExtension(sourcePath);
+        bool paletted = components.size() == 1 && (isTilesetDefinition(definition) || Misc::StringUtils::ciEqual(extension, "cel") ||
+                                                   Misc::StringUtils::ciEqual(extension, "cl2"));
 
-                definitionFrames.frames.push_back(finalImageData.get());
-                allImages.emplace_back(std::move(finalImageData));
-            }
+        if (indexed && paletted && definition.category != "gui")
+            indexSprite(decoded);
+
+        return decoded;
+    }
 
-            progress += 1;
+    void SpriteLoader::indexSprite(DecodedSprite& sprite)
+    {
+        Cel::Pal sourcePalette(Cel::CelDecoder::getPalettePath(getSourcePath(*sprite.definition)));
+        std::optional<IndexedPalette> palette = IndexedPalette::create(sourcePalette.data(), IndexedPalette::SIZE);
+        if (!palette)
+            return;
+
+        std::vector<IndexedImage> indexedFrames;
+        indexedFrames.reserve(sprite.frames.size());
+
+        for (const DecodedFrame& frame : sprite.frames)
+        {
+            std::optional<IndexedImage> indices = palette->index(frame.image);
+            if (!indices)
+                return;
+
+            indexedFrames.push_back(std::move(*indices));
+        }
+
+        // The frames are converted here on the decode workers, so only the indexed copies are kept around until they're packed
+        for (size_t i = 0; i < sprite.frames.size(); i++)
+        {
+            sprite.frames[i].indices = std::move(indexedFrames[i]);
+            sprite.frames[i].image = Image();
         }
 
-        return LoadedImagesData{std::move(allImages), std::move(definitionToImageMap)};
+        sprite.palette = palette->colours();
     }
 }
@@ -1,13 +1,19 @@
 #pragma once
 #include "../fasavegame/gameloader.h"
 #include <Image/image.h>
-#include <atomic>
+#include <Image/indexedimage.h>
+#include <functional>
 #include <misc/misc.h>
 #include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 
+namespace Cel
+{
+    class DecodedImageCache;
+}
+
 namespace DiabloExe
 {
     class DiabloExe;
@@ -17,6 +23,8 @@ namespace Render
 {
     class AtlasTexture;
     class SpriteGroup;
+    class Texture;
+    class TextureReference;
 }
 
 namespace FARender
@@ -25,7 +33,17 @@ namespace FARender
     {
     public:
         explicit SpriteLoader(const DiabloExe::DiabloExe& exe);
-        void load();
+        ~SpriteLoader();
+
+        static SpriteLoader* get() { return singletonInstance; }
+
+        // With indexedSprites, level sprites that only use their palette's colours are stored as 8-bit palette indices, a quarter of the size.
+        // GUI sprites are always RGBA, as the GUI shaders don't do palette lookups.
+        void load(bool indexedSprites = false);
+
+        // Loads only the sprite metadata the simulation depends on (frame counts, sizes, animation lengths), without touching the GPU.
+        // Sprites loaded this way can't be rendered, their frames have no texture.
+        void loadHeadless();
 
         struct SpriteDefinition
         {
@@ -76,6 +94,8 @@ namespace FARender
         };
         Render::SpriteGroup* getSprite(const SpriteDefinition& definition, GetSpriteFailAction fail = GetSpriteFailAction::Error);
 
+        Render::Texture& getPaletteTexture() const; ///< The palettes that indexed frames (those with a palette row) are drawn through
+
         // TODO: monster sprite definitions are here for now, this stuff will all be moved somewhere more appropriate when we have a modding layer
         struct MonsterSpriteDefinition
         {
@@ -172,30 +192,39 @@ namespace FARender
         } mGuiSprites;
 
     private:
-        struct FinalImageData
+        struct DecodedFrame
         {
-            std::unique_ptr<Image> image;
-            std::string category;
+            Image image;
+            IndexedImage indices; ///< Used instead of image when the sprite is indexed
             std::optional<Image::TrimmedData> trimmedData;
         };
 
-        struct FinalImageDataFrames
+        // All the frames of one definition, trimmed if it asks for that
+        struct DecodedSprite
         {
-            std::vector<FinalImageData*> frames;
+            const SpriteDefinition* definition = nullptr;
+            std::vector<DecodedFrame> frames;
             int32_t animationLength = 0;
+            std::optional<IndexedPalette::Colours> palette; ///< Set when the frames are indexed
         };
 
-        struct LoadedImagesData
-        {
-            std::vector<std::unique_ptr<FinalImageData>> allImages;
-            std::unordered_map<SpriteDefinition, FinalImageDataFrames, SpriteDefinition::Hash> definitionToImageMap;
-        };
+        static std::string getSourcePath(const SpriteDefinition& definition); ///< The file a definition's images are cut from
+        static DecodedSprite decodeSprite(const SpriteDefinition& definition, Cel::DecodedImageCache& imageCache, bool indexed);
+        static void indexSprite(DecodedSprite& sprite); ///< Converts the frames to palette indices, if they fit in the source file's palette
 
-        static LoadedImagesData loadImagesIntoCpuMemory(const std::unordered_set<SpriteDefinition, SpriteDefinition::Hash>& spritesToLoad,
-                                                        std::atomic_int32_t& progress);
+        // Decodes spritesToLoad on all available cores. Finished sprites are handed to consumeDecoded in batches on the calling thread
+        // as they arrive, and progressCallback gets a percentage now and then. The definitions must outlive the consumer's use of them.
+        static void decodeSprites(const std::unordered_set<SpriteDefinition, SpriteDefinition::Hash>& spritesToLoad,
+                                  bool indexed,
+                                  const std::function<void(std::vector<DecodedSprite>&&)>& consumeDecoded,
+                                  const std::function<void(int32_t)>& progressCallback);
 
-        void saveToCache(const filesystem::path& atlasDirectory) const;
-        void loadFromCache(const filesystem::path& atlasDirectory);
+        // Packs a window of decoded sprites into the atlas, tallest frames first
+        void packSprites(std::vector<DecodedSprite>& sprites);
+
+        void removeBrokenSprites();
+        void saveToCache(const filesystem::path& atlasDirectory, bool indexedSprites) const;
+        void loadFromCache(const filesystem::path& atlasDirectory, bool indexedSprites, bool uploadTextures = true);
 
         typedef std::array<uint8_t, 16> SpriteDefinitionsHash;
         static SpriteDefinitionsHash hashSpriteDefinitions(const std::vector<SpriteDefinition>& definitions);
@@ -204,8 +233,13 @@ namespace FARender
         std::unordered_set<SpriteDefinition, SpriteDefinition::Hash> mSpritesToLoad;
         std::unordered_map<SpriteDefinition, std::unique_ptr<Render::SpriteGroup>, SpriteDefinition::Hash> mLoadedSprites;
         std::unique_ptr<Render::AtlasTexture> mAtlasTexture;
+        std::vector<std::unique_ptr<Render::TextureReference>> mHeadlessFrames; ///< Texture-less frames, owned here when there is no atlas
+
+        static SpriteLoader* singletonInstance;
 
         const filesystem::path mAtlasDirectory = Misc::getResourcesPath() / "cache" / "atlas";
-        static constexpr int32_t ATLAS_CACHE_VERSION = 1;
+        static constexpr const char* ATLAS_CACHE_FILENAME = "atlas.bin";
+        static constexpr int32_t ATLAS_CACHE_VERSION = 4;
+        static constexpr size_t PACK_WINDOW_FRAMES = 2048; ///< How many decoded frames are gathered and sorted before being packed
     };
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "actor.h"
+#include "../engine/enginemain.h"
 #include "../engine/threadmanager.h"
 #include "../fasavegame/gameloader.h"
 #include "actor/basestate.h"
@@ -8,12 +9,15 @@
 #include "findpath.h"
 #include "missile/missile.h"
 #include "player.h"
+#include "simprofile.h"
 #include "spells.h"
 #include "world.h"
+#include <diabloexe/diabloexe.h>
 #include <diabloexe/monster.h>
 #include <diabloexe/npc.h>
 #include <engine/debugsettings.h>
 #include <fmt/format.h>
+#include <misc/statehash.h>
 
 namespace FAWorld
 {
@@ -24,10 +28,16 @@ namespace FAWorld
         if (!isDead())
         {
             if (getLevel() && !isRecoveringFromHit())
+            {
+                ScopedSimTimer timer(SimSection::ActorStates);
                 mActorStateMachine->update(noclip);
+            }
 
             if (mBehaviour)
+            {
+                ScopedSimTimer timer(SimSection::Behaviours);
                 mBehaviour->update();
+            }
         }
         else if (!mDeadLastTick)
         {
@@ -40,8 +50,12 @@ namespace FAWorld
             mDeadLastTick = true;
         }
 
-        mAnimation.update();
+        {
+            ScopedSimTimer timer(SimSection::Animations);
+            mAnimation.update();
+        }
 
+        ScopedSimTimer timer(SimSection::Missiles);
         for (auto& missile : mMissiles)
             missile->update();
         mMissiles.erase(
@@ -175,6 +189,17 @@ namespace FAWorld
         saver.save(uint8_t(mType));
     }
 
+    void Actor::hashState(Misc::StateHasher& hasher) const
+    {
+        hasher.add(mId);
+        mMoveHandler.hashState(hasher);
+        mStats.hashState(hasher);
+        hasher.add(mFaction.getType());
+        hasher.add(mTarget.getType());
+        hasher.add(mDeadLastTick);
+        hasher.add(mMissiles.size());
+    }
+
     Actor::~Actor() = default;
 
     void Actor::takeDamage(int32_t amount, Actor* attacker, DamageType type)
@@ -219,7 +244,7 @@ namespace FAWorld
 
         if (mStats.getHp().current > 0)
         {
-            Engine::ThreadManager::get()->playSound(getHitWav()); // TODO: should this only play when doing hit recovery?
+            Engine::ThreadManager::get()->playSound(getHitSound()); // TODO: should this only play when doing hit recovery?
 
             if (amount >= mStats.getCalculatedStats().hitRecoveryDamageThreshold)
                 mAnimation.interruptAnimation(AnimState::hit, FARender::AnimationPlayer::AnimationType::Once);
@@ -244,7 +269,7 @@ namespace FAWorld
         mMoveHandler.setDestination(getPos().current());
         mAnimation.playAnimation(AnimState::dead, FARender::AnimationPlayer::AnimationType::FreezeAtEnd);
         mStats.getHp().current = 0;
-        Engine::ThreadManager::get()->playSound(getDieWav());
+        Engine::ThreadManager::get()->playSound(getDieSound());
     }
 
     bool Actor::isDead() const { return mStats.getHp().current <= 0; }
@@ -290,20 +315,43 @@ namespace FAWorld
     GameLevel* Actor::getLevel() { return mMoveHandler.getLevel(); }
     const GameLevel* Actor::getLevel() const { return mMoveHandler.getLevel(); }
 
-    std::string Actor::getDieWav() const
+    FAAudio::SoundId Actor::getDieSound() const
+    {
+        if (!mDieSounds[0].isValid())
+            return FAAudio::SoundId();
+
+        return mDieSounds[mWorld.mRng->randomInRange(1, 2) - 1];
+    }
+
+    FAAudio::SoundId Actor::getHitSound() const
     {
-        if (mSoundPath.empty())
-            return "";
+        if (!mHitSounds[0].isValid())
+            return FAAudio::SoundId();
+
+        return mHitSounds[mWorld.mRng->randomInRange(1, 2) - 1];
+    }
 
-        return fmt::format(mSoundPath, 'd', mWorld.mRng->randomInRange(1, 2));
+    void Actor::setSoundPath(const std::string& soundPath)
+    {
+        // The path has two placeholders, one for the type of sound and one for which of the two variants it is
+        for (int32_t variant = 0; variant < 2; variant++)
+        {
+            mHitSounds[variant] = FAAudio::SoundId::intern(fmt::format(soundPath, 'h', variant + 1));
+            mDieSounds[variant] = FAAudio::SoundId::intern(fmt::format(soundPath, 'd', variant + 1));
+        }
     }
 
-    std::string Actor::getHitWav() const
+    void Actor::getPreloadSounds(std::vector<FAAudio::SoundId>& sounds) const
     {
-        if (mSoundPath.empty())
-            return "";
+        sounds.insert(sounds.end(), mHitSounds.begin(), mHitSounds.end());
+        sounds.insert(sounds.end(), mDieSounds.begin(), mDieSounds.end());
 
-        return fmt::format(mSoundPath, 'h', mWorld.mRng->randomInRange(1, 2));
+        for (const auto& missile : mMissiles)
+        {
+            const Missile::Missile::Sounds& missileSounds = Missile::Missile::getSounds(missile->getMissileId());
+            sounds.push_back(missileSounds.sound);
+            sounds.push_back(missileSounds.impact);
+        }
     }
 
     bool Actor::canIAttack(Actor* actor)
@@ -366,7 +414,9 @@ namespace FAWorld
 
     void Actor::doMeleeHit(Actor* enemy)
     {
-        Engine::ThreadManager::get()->playSound(mWorld.mRng->chooseOne({"sfx/misc/swing2.wav", "sfx/misc/swing.wav"}));
+        static const FAAudio::SoundId swing2 = FAAudio::SoundId::intern("sfx/misc/swing2.wav");
+        static const FAAudio::SoundId swing = FAAudio::SoundId::intern("sfx/misc/swing.wav");
+        Engine::ThreadManager::get()->playSound(mWorld.mRng->chooseOne({swing2, swing}));
 
         const LiveActorStats& stats = mStats.getCalculatedStats();
         int32_t toHit = stats.toHitMelee.getCombined();
@@ -410,7 +460,8 @@ namespace FAWorld
 
     void Actor::doRangedAttack(Misc::Point targetPoint)
     {
-        Engine::ThreadManager::get()->playSound("sfx/misc/bfire.wav");
+        static const FAAudio::SoundId bowFire = FAAudio::SoundId::intern("sfx/misc/bfire.wav");
+        Engine::ThreadManager::get()->playSound(bowFire);
         // Note: Fire and lightning arrows are also possible.
         activateMissile(MissileId::arrow, targetPoint);
     }
@@ -424,7 +475,7 @@ namespace FAWorld
     void Actor::doSpellEffect(SpellId spell, Misc::Point targetPoint)
     {
         auto spellData = SpellData(spell);
-        Engine::ThreadManager::get()->playSound(spellData.soundEffect());
+        Engine::ThreadManager::get()->playSound(spellData.soundEffectId());
         for (auto missileId : spellData.missiles())
             activateMissile(missileId, targetPoint);
     }
@@ -437,7 +488,7 @@ namespace FAWorld
 
     void Actor::restoreAnimationsForNpc()
     {
-        FARender::SpriteLoader& spriteLoader = FARender::Renderer::get()->mSpriteLoader;
+        FARender::SpriteLoader& spriteLoader = *FARender::SpriteLoader::get();
         mAnimation.setAnimationSprites(AnimState::idle, spriteLoader.getSprite(spriteLoader.mNpcIdleAnimations[mNpcId]));
         mAnimation.markAnimationsRestoredAfterGameLoad();
     }
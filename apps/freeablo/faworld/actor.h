@@ -16,6 +16,8 @@
 #include "spellenums.h"
 #include "target.h"
 #include "world.h"
+#include <array>
+#include <faaudio/soundid.h>
 #include <misc/direction.h>
 #include <misc/misc.h>
 #include <unordered_map>
@@ -47,6 +49,7 @@ namespace FAWorld
         Actor(World& world, FASaveGame::GameLoader& loader);
         virtual ~Actor();
         virtual void save(FASaveGame::GameSaver& saver) const;
+        void hashState(Misc::StateHasher& hasher) const;
 
         virtual int32_t getOnKilledExperience() const { return 0; }
         void pickupItem(Target::ItemTarget target);
@@ -59,8 +62,10 @@ namespace FAWorld
         void doMeleeHit(Actor* enemy);
         void doMeleeHit(const Misc::Point& point);
         void forceAttack(Misc::Point pos);
-        std::string getDieWav() const;
-        std::string getHitWav() const;
+        FAAudio::SoundId getDieSound() const;
+        FAAudio::SoundId getHitSound() const;
+        /// Adds the sounds this actor is likely to play to sounds, so they can be loaded before they're needed
+        virtual void getPreloadSounds(std::vector<FAAudio::SoundId>& sounds) const;
         bool canIAttack(Actor* actor);
         virtual void update(bool noclip);
         void takeDamage(int32_t amount, Actor* attacker, DamageType type);
@@ -119,7 +124,11 @@ namespace FAWorld
 
     protected:
         std::unique_ptr<StateMachine> mActorStateMachine;
-        std::string mSoundPath;
+        void setSoundPath(const std::string& soundPath);
+
+        // Interned once when the actor is set up, as these are played a lot in combat
+        std::array<FAAudio::SoundId, 2> mHitSounds;
+        std::array<FAAudio::SoundId, 2> mDieSounds;
         std::unique_ptr<Behaviour> mBehaviour;
         Faction mFaction;
         std::string mName; ///< Name as it appears in-game
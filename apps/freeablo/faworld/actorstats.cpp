@@ -1,6 +1,7 @@
 #include "actorstats.h"
 #include "../fasavegame/gameloader.h"
 #include "actor.h"
+#include <misc/statehash.h>
 
 namespace FAWorld
 {
@@ -41,6 +42,14 @@ namespace FAWorld
             saver.save(mLevelXpCounts[i]);
     }
 
+    void ActorStats::hashState(Misc::StateHasher& hasher) const
+    {
+        hasher.add(getHp().current);
+        hasher.add(getMana().current);
+        hasher.add(mLevel);
+        hasher.add(mExperience);
+    }
+
     int32_t ActorStats::experiencePointsToLevel(uint32_t experience) const
     {
         int32_t i;
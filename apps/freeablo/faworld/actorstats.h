@@ -100,6 +100,7 @@ namespace FAWorld
 
         ActorStats(const Actor& actor, FASaveGame::GameLoader& loader);
         void save(FASaveGame::GameSaver& saver) const;
+        void hashState(Misc::StateHasher& hasher) const;
 
         ActorStats& operator=(const ActorStats& other) = default;
 
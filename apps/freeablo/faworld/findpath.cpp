@@ -2,38 +2,20 @@
 #include "gamelevel.h"
 #include <algorithm>
 #include <cmath>
-#include <cstring>
-#include <misc/array2d.h>
-#include <misc/stdhashes.h>
-#include <queue>
+#include <functional>
 
 namespace
 {
     const int STRAIGHT_WEIGHT = 10;
     const int DIAGONAL_WEIGHT = 14;
 
+    const int32_t MAX_ITERATIONS = 1000;
+
     int distanceCost(const Misc::Point& a, const Misc::Point& b) { return (a.x != b.x && a.y != b.y) ? DIAGONAL_WEIGHT : STRAIGHT_WEIGHT; }
 }
 
 namespace FAWorld
 {
-    template <typename T, typename Number = size_t> struct PriorityQueue
-    {
-        typedef std::pair<Number, T> PQElement;
-        std::priority_queue<PQElement, std::vector<PQElement>, std::greater<PQElement>> elements;
-
-        inline bool empty() { return elements.empty(); }
-
-        inline void put(T item, Number priority) { elements.emplace(priority, item); }
-
-        inline T get()
-        {
-            T best_item = elements.top().second;
-            elements.pop();
-            return best_item;
-        }
-    };
-
     bool inBounds(GameLevelImpl* level, Misc::Point location)
     {
         int x = location.x;
@@ -41,28 +23,31 @@ namespace FAWorld
         return 0 <= x && x < (int)level->width() && 0 <= y && y < (int)level->height();
     }
 
-    Misc::Points neighbors(GameLevelImpl* level, const Actor* actor, const Misc::Point& location)
+    // Calls func on every passable point in the 3x3 square centred on location, in the same order neighbors() returns them
+    template <typename Func> inline void forEachNeighbor(GameLevelImpl* level, const Actor* actor, const Misc::Point& location, Func&& func)
     {
-        int x = location.x;
-        int y = location.y;
-
-        Misc::Points result;
-        result.reserve(9);
-
         for (int32_t dy = -1; dy <= 1; dy++)
         {
             for (int32_t dx = -1; dx <= 1; dx++)
             {
-                Misc::Point next(x + dx, y + dy);
+                Misc::Point next(location.x + dx, location.y + dy);
                 if (inBounds(level, next) && level->isPassable(next, actor))
-                    result.push_back(next);
+                    func(next);
             }
         }
+    }
+
+    Misc::Points neighbors(GameLevelImpl* level, const Actor* actor, const Misc::Point& location)
+    {
+        Misc::Points result;
+        result.reserve(9);
+
+        forEachNeighbor(level, actor, location, [&](const Misc::Point& next) { result.push_back(next); });
 
         return result;
     }
 
-    size_t heuristic(Misc::Point a, Misc::Point b)
+    int32_t heuristic(Misc::Point a, Misc::Point b)
     {
         auto dx = abs(b.x - a.x);
         auto dy = abs(b.y - a.y);
@@ -73,29 +58,63 @@ namespace FAWorld
         return straight * STRAIGHT_WEIGHT + diagonal * DIAGONAL_WEIGHT;
     }
 
-    bool AStarSearch(GameLevelImpl* level,
-                     const Actor* actor,
-                     Misc::Point start,
-                     Misc::Point& goal,
-                     std::unordered_map<Misc::Point, Misc::Point>& came_from,
-                     bool findAdjacent)
+    void PathFinder::prepare(int32_t width, int32_t height)
     {
-        auto goalPassable = level->isPassable(goal, actor);
-        PriorityQueue<Misc::Point> frontier;
-        frontier.put(start, 0);
-        came_from[start] = start;
+        if (width != mWidth || height != mHeight)
+        {
+            mWidth = width;
+            mHeight = height;
+            mNodes.assign(size_t(width * height), Node());
+            mGeneration = 0;
+        }
 
-        static Misc::Array2D<int32_t> costSoFar;
-        costSoFar.resize(level->width(), level->height());
-        memset(costSoFar.data(), 0xff, level->width() * level->height() * sizeof(int32_t));
+        mGeneration++;
 
-        costSoFar.get(start.x, start.y) = 0;
+        // On wraparound, old stamps could alias the new generation, so we have to clear them after all
+        if (mGeneration == 0)
+        {
+            for (Node& n : mNodes)
+                n.generation = 0;
+            mGeneration = 1;
+        }
 
+        mOpen.clear();
+    }
+
+    void PathFinder::pushOpen(Misc::Point point, int32_t priority)
+    {
+        mOpen.push_back(OpenEntry{priority, point});
+        std::push_heap(mOpen.begin(), mOpen.end(), std::greater<OpenEntry>());
+    }
+
+    Misc::Point PathFinder::popOpen()
+    {
+        std::pop_heap(mOpen.begin(), mOpen.end(), std::greater<OpenEntry>());
+        Misc::Point point = mOpen.back().point;
+        mOpen.pop_back();
+        return point;
+    }
+
+    bool PathFinder::search(GameLevelImpl* level, const Actor* actor, Misc::Point start, Misc::Point& goal, bool findAdjacent)
+    {
+        prepare(level->width(), level->height());
+
+        auto goalPassable = level->isPassable(goal, actor);
+        pushOpen(start, 0);
+
+        Node& startNode = node(start);
+        startNode.generation = mGeneration;
+        startNode.cost = 0;
+        startNode.cameFromDx = 0;
+        startNode.cameFromDy = 0;
+
+        // NOTE: stale duplicate entries are left in the open set and count towards the iteration limit, rather than using a
+        // decrease-key operation, as that would change how far searches get before giving up, and so change the results.
         int32_t iterations = 0;
-        while (!frontier.empty() && iterations < 1000)
+        while (!mOpen.empty() && iterations < MAX_ITERATIONS)
         {
             iterations++;
-            Misc::Point current = frontier.get();
+            Misc::Point current = popOpen();
 
             // Early exit
             if (current == goal)
@@ -109,47 +128,61 @@ namespace FAWorld
                 }
             }
 
-            for (const auto& next : neighbors(level, actor, current))
-            {
-                auto new_cost = costSoFar.get(current.x, current.y) + distanceCost(current, next);
+            int32_t currentCost = node(current).cost;
+
+            forEachNeighbor(level, actor, current, [&](const Misc::Point& next) {
+                int32_t newCost = currentCost + distanceCost(current, next);
+                Node& nextNode = node(next);
 
-                if (costSoFar.get(next.x, next.y) == -1 || new_cost < costSoFar.get(next.x, next.y))
+                if (nextNode.generation != mGeneration || newCost < nextNode.cost)
                 {
-                    costSoFar.get(next.x, next.y) = new_cost;
-                    frontier.put(next, new_cost + heuristic(next, goal));
-                    came_from[next] = current;
+                    nextNode.generation = mGeneration;
+                    nextNode.cost = newCost;
+                    nextNode.cameFromDx = int8_t(current.x - next.x);
+                    nextNode.cameFromDy = int8_t(current.y - next.y);
+                    pushOpen(next, newCost + heuristic(next, goal));
                 }
-            }
+            });
         }
 
         return false;
     }
 
-    Misc::Points reconstructPath(Misc::Point start, Misc::Point goal, std::unordered_map<Misc::Point, Misc::Point>& cameFrom)
+    void PathFinder::reconstructPath(Misc::Point start, Misc::Point goal, Misc::Points& path)
     {
-        Misc::Points path;
+        path.clear();
+
         Misc::Point current = goal;
         path.push_back(current);
         while (current != start)
         {
-            current = cameFrom[current];
+            const Node& currentNode = node(current);
+            current = Misc::Point(current.x + currentNode.cameFromDx, current.y + currentNode.cameFromDy);
             if (current != start)
                 path.push_back(current);
         }
         path.push_back(start);
         std::reverse(path.begin(), path.end());
-        return path;
     }
 
-    Misc::Points pathFind(GameLevelImpl* level, const Actor* actor, const Misc::Point& start, const Misc::Point& goal, bool& bArrivable, bool findAdjacent)
+    bool PathFinder::findPath(GameLevelImpl* level, const Actor* actor, Misc::Point start, Misc::Point goal, bool findAdjacent, Misc::Points& path)
     {
-        auto adjustedGoal = goal;
-        std::unordered_map<Misc::Point, Misc::Point> cameFrom;
+        if (!search(level, actor, start, goal, findAdjacent))
+        {
+            path.clear();
+            return false;
+        }
 
-        bArrivable = AStarSearch(level, actor, start, adjustedGoal, cameFrom, findAdjacent);
-        if (!bArrivable)
-            return {};
+        reconstructPath(start, goal, path);
+        return true;
+    }
+
+    Misc::Points pathFind(GameLevelImpl* level, const Actor* actor, const Misc::Point& start, const Misc::Point& goal, bool& bArrivable, bool findAdjacent)
+    {
+        static PathFinder pathFinder;
 
-        return reconstructPath(start, adjustedGoal, cameFrom);
+        Misc::Points path;
+        bArrivable = pathFinder.findPath(level, actor, start, goal, findAdjacent, path);
+        return path;
     }
 }
@@ -1,11 +1,57 @@
 #pragma once
 #include <misc/simplevec2.h>
+#include <vector>
 
 namespace FAWorld
 {
     class GameLevelImpl;
     class Actor;
 
+    // Reusable A* search state.
+    // The cost / parent grid is generation stamped, so it doesn't need to be cleared between searches, and the open set is a flat binary
+    // heap, so once the buffers have grown to fit a level, searches don't allocate at all. Keep one around and reuse it for repeated
+    // searches (GameLevel owns one that everything on that level shares), rather than creating a new one each time.
+    class PathFinder
+    {
+    public:
+        // Fills path with the points from start to goal (inclusive) and returns true, or clears it and returns false if no path was found.
+        // Results are identical to what the original per-call A* implementation produced, as the lockstep multiplayer depends on it.
+        bool findPath(GameLevelImpl* level, const Actor* actor, Misc::Point start, Misc::Point goal, bool findAdjacent, Misc::Points& path);
+
+    private:
+        // Kept small, as there is one per tile. The generation wraps fairly often, but clearing all the stamps then is cheap when amortised.
+        struct Node
+        {
+            int32_t cost = 0;
+            uint16_t generation = 0;
+            int8_t cameFromDx = 0;
+            int8_t cameFromDy = 0;
+        };
+
+        struct OpenEntry
+        {
+            int32_t priority;
+            Misc::Point point;
+
+            // Orders the open set exactly like the std::priority_queue<std::pair<priority, Point>> this replaced, ie: lowest
+            // priority first, with ties broken by point. Changing this would change which paths are chosen.
+            bool operator>(const OpenEntry& other) const { return priority != other.priority ? priority > other.priority : other.point < point; }
+        };
+
+        void prepare(int32_t width, int32_t height);
+        Node& node(Misc::Point point) { return mNodes[point.x + point.y * mWidth]; }
+        void pushOpen(Misc::Point point, int32_t priority);
+        Misc::Point popOpen();
+        bool search(GameLevelImpl* level, const Actor* actor, Misc::Point start, Misc::Point& goal, bool findAdjacent);
+        void reconstructPath(Misc::Point start, Misc::Point goal, Misc::Points& path);
+
+        int32_t mWidth = 0;
+        int32_t mHeight = 0;
+        uint16_t mGeneration = 0;
+        std::vector<Node> mNodes;
+        std::vector<OpenEntry> mOpen;
+    };
+
     Misc::Points neighbors(GameLevelImpl* level, const Actor* actor, const Misc::Point& location);
     Misc::Points pathFind(GameLevelImpl* level, const Actor* actor, const Misc::Point& start, const Misc::Point& goal, bool& bArrivable, bool findAdjacent);
 }
@@ -4,10 +4,13 @@
 #include "actorstats.h"
 #include "itemmap.h"
 #include "missile/missile.h"
+#include "simprofile.h"
 #include "world.h"
+#include <algorithm>
 #include <diabloexe/diabloexe.h>
 #include <engine/debugsettings.h>
 #include <misc/assert.h>
+#include <misc/statehash.h>
 #include <render/spritegroup.h>
 
 namespace FAWorld
@@ -15,6 +18,7 @@ namespace FAWorld
     GameLevel::GameLevel(World& world, Level::Level&& level, size_t levelIndex)
         : mWorld(world), mLevel(std::move(level)), mLevelIndex(levelIndex), mItemMap(new ItemMap(this))
     {
+        initPassabilityMaps();
     }
 
     GameLevel::GameLevel(World& world, FASaveGame::GameLoader& loader)
@@ -23,6 +27,8 @@ namespace FAWorld
         release_assert(loader.currentlyLoadingLevel == nullptr);
         loader.currentlyLoadingLevel = this;
 
+        initPassabilityMaps();
+
         uint32_t actorsSize = loader.load<uint32_t>();
 
         mActors.reserve(actorsSize);
@@ -57,6 +63,16 @@ namespace FAWorld
         }
     }
 
+    void GameLevel::hashState(Misc::StateHasher& hasher) const
+    {
+        hasher.add(mLevelIndex);
+        mItemMap->hashState(hasher);
+
+        hasher.add(mActors.size());
+        for (const Actor* actor : mActors)
+            actor->hashState(hasher);
+    }
+
     GameLevel::~GameLevel()
     {
         for (size_t i = 0; i < mActors.size(); i++)
@@ -90,6 +106,13 @@ namespace FAWorld
             return false;
 
         bool retval = mLevel.activateDoor(point);
+        if (retval)
+        {
+            // Doors toggle a whole 2x2 dun tile
+            Misc::Point topLeft(point.x - (point.x % 2), point.y - (point.y % 2));
+            refreshFreeTiles(topLeft, topLeft + Misc::Point(1, 1));
+            mNavigation.invalidate();
+        }
 
 #ifndef NDEBUG
         for (const auto& actor : mActors)
@@ -116,10 +139,14 @@ namespace FAWorld
         for (auto& actor : mActors)
             actor->update(noclip);
 
-        for (auto& p : mItemMap->mItems)
-            p.second.update();
+        {
+            ScopedSimTimer timer(SimSection::Items);
+            for (auto& p : mItemMap->mItems)
+                p.second.update();
+        }
 
-        if (DebugSettings::DebugLevelTransitions)
+        FARender::Renderer* renderer = FARender::Renderer::get();
+        if (DebugSettings::DebugLevelTransitions && renderer)
         {
             for (const Level::LevelTransitionArea& transition : {upStairsArea(), downStairsArea()})
             {
@@ -133,15 +160,15 @@ namespace FAWorld
                             highlightColor = Render::Colors::red;
 
                         highlightColor.a = 0.1f;
-                        FARender::Renderer::get()->mTmpDebugRenderData.push_back(TileData{{x, y}, highlightColor});
+                        renderer->mTmpDebugRenderData.push_back(TileData{{x, y}, highlightColor});
                     }
                 }
 
                 Vec2Fix centre = Vec2Fix(transition.offset + transition.playerSpawnOffset) + Vec2Fix(FixedPoint("0.5"), FixedPoint("0.5"));
-                FARender::Renderer::get()->mTmpDebugRenderData.push_back(PointData{centre, Render::Colors::red, 2});
+                renderer->mTmpDebugRenderData.push_back(PointData{centre, Render::Colors::red, 2});
 
                 centre = Vec2Fix(transition.offset + transition.exitOffset) + Vec2Fix(FixedPoint("0.5"), FixedPoint("0.5"));
-                FARender::Renderer::get()->mTmpDebugRenderData.push_back(PointData{centre, Render::Colors::green, 2});
+                renderer->mTmpDebugRenderData.push_back(PointData{centre, Render::Colors::green, 2});
             }
         }
     }
@@ -164,35 +191,70 @@ namespace FAWorld
         actorMapInsert(actor);
     }
 
-    void GameLevel::actorMapInsert(Actor* actor)
+    void GameLevel::initPassabilityMaps()
     {
-        Actor* blocking = nullptr;
-        if (mActorMap2D.count(actor->getPos().current()))
-            blocking = mActorMap2D[actor->getPos().current()];
-        debug_assert(blocking == actor || blocking == nullptr || (blocking->getWorld()->mLoading || blocking->isDead()));
+        mActorMap2D = Misc::Array2D<Actor*>(width(), height());
+        mStaticPassable.assign(width() * height(), 0);
+        mFreeTiles.assign((width() * height() + 63) / 64, 0);
 
-        mActorMap2D[actor->getPos().current()] = actor;
+        refreshFreeTiles(Misc::Point(0, 0), Misc::Point(width() - 1, height() - 1));
+    }
 
-        if (actor->getPos().isMoving())
+    void GameLevel::refreshFreeTiles(const Misc::Point& topLeft, const Misc::Point& bottomRight)
+    {
+        for (int32_t y = std::max(topLeft.y, 0); y <= std::min(bottomRight.y, height() - 1); y++)
         {
-            if (mActorMap2D.count(actor->getPos().next()))
-                blocking = mActorMap2D[actor->getPos().next()];
-            debug_assert(blocking == actor || blocking == nullptr || (blocking->getWorld()->mLoading || blocking->isDead()));
-
-            mActorMap2D[actor->getPos().next()] = actor;
+            for (int32_t x = std::max(topLeft.x, 0); x <= std::min(bottomRight.x, width() - 1); x++)
+            {
+                int32_t index = tileIndex(Misc::Point(x, y));
+                mStaticPassable[index] = mLevel.get(Misc::Point(x, y)).passable();
+                setFreeTile(index, mStaticPassable[index] && mActorMap2D.get(x, y) == nullptr);
+            }
         }
     }
 
+    void GameLevel::setFreeTile(int32_t index, bool free)
+    {
+        uint64_t bit = uint64_t(1) << (index % 64);
+        mFreeTiles[index / 64] = free ? (mFreeTiles[index / 64] | bit) : (mFreeTiles[index / 64] & ~bit);
+    }
+
+    void GameLevel::actorMapInsert(Actor* actor)
+    {
+        auto insertAt = [&](const Misc::Point& point) {
+            release_assert(mActorMap2D.pointIsValid(point.x, point.y));
+
+            Actor*& slot = mActorMap2D.get(point.x, point.y);
+            debug_assert(slot == actor || slot == nullptr || (slot->getWorld()->mLoading || slot->isDead()));
+
+            slot = actor;
+            setFreeTile(tileIndex(point), false);
+        };
+
+        insertAt(actor->getPos().current());
+
+        if (actor->getPos().isMoving())
+            insertAt(actor->getPos().next());
+    }
+
     void GameLevel::actorMapRemove(const Actor* actor, Misc::Point point)
     {
-#ifndef NDEBUG
-        Actor* currentlyPresent = mActorMap2D[point];
-        debug_assert(currentlyPresent == actor || currentlyPresent == nullptr);
-#endif
-        mActorMap2D.erase(point);
+        if (!mActorMap2D.pointIsValid(point.x, point.y))
+            return;
+
+        Actor*& slot = mActorMap2D.get(point.x, point.y);
+        debug_assert(slot == actor || slot == nullptr);
+
+        slot = nullptr;
+        setFreeTile(tileIndex(point), mStaticPassable[tileIndex(point)]);
     }
 
-    void GameLevel::actorMapClear() { mActorMap2D.clear(); }
+    void GameLevel::actorMapClear()
+    {
+        std::fill(mActorMap2D.begin(), mActorMap2D.end(), nullptr);
+        for (size_t i = 0; i < mStaticPassable.size(); i++)
+            setFreeTile(int32_t(i), mStaticPassable[i]);
+    }
 
     void GameLevel::actorMapRefresh()
     {
@@ -241,20 +303,27 @@ namespace FAWorld
         if (forActor && forActor->mIsTowner)
             return true;
 
-        if (point.x < 0 || point.x >= width() || point.y < 0 || point.y >= height() || !mLevel.get(point).passable())
+        if (point.x < 0 || point.x >= width() || point.y < 0 || point.y >= height())
             return false;
 
-        FAWorld::Actor* actor = getActorAt(point);
-        return actor == nullptr || actor == forActor;
+        int32_t index = tileIndex(point);
+        if (isFreeTile(index))
+            return true;
+
+        return forActor && mStaticPassable[index] && mActorMap2D.get(point.x, point.y) == forActor;
+    }
+
+    bool GameLevel::isPassableStatic(const Misc::Point& point) const
+    {
+        return point.x >= 0 && point.x < width() && point.y >= 0 && point.y < height() && mStaticPassable[tileIndex(point)];
     }
 
     Actor* GameLevel::getActorAt(const Misc::Point& point) const
     {
-        auto it = mActorMap2D.find(point);
-        if (it == mActorMap2D.end())
+        if (!mActorMap2D.pointIsValid(point.x, point.y))
             return nullptr;
 
-        return it->second;
+        return mActorMap2D.get(point.x, point.y);
     }
 
     static ByteColour friendHoverColor() { return {180, 110, 110, true}; }
@@ -280,7 +349,7 @@ namespace FAWorld
             if (sprite)
             {
                 frame += static_cast<int32_t>(mActors[i]->getPos().getDirection().getDirection8()) * sprite->getAnimationLength();
-                state->mObjects.push_back({sprite, static_cast<uint32_t>(frame), mActors[i]->getPos(), hoverColor});
+                state->mObjects.push_back({sprite, static_cast<uint32_t>(frame), mActors[i]->getPos(), hoverColor, mActors[i]});
             }
         }
 
@@ -290,7 +359,7 @@ namespace FAWorld
             auto spriteGroup = tmp.first;
             auto frame = tmp.second;
             if (spriteGroup)
-                state->mObjects.push_back({spriteGroup, static_cast<uint32_t>(frame), graphic->mCurPos, std::nullopt});
+                state->mObjects.push_back({spriteGroup, static_cast<uint32_t>(frame), graphic->mCurPos, std::nullopt, graphic});
         }
 
         for (auto& p : mItemMap->mItems)
@@ -1,13 +1,19 @@
 #pragma once
+#include "findpath.h"
 #include "hoverstate.h"
 #include "itemmap.h" // TODO: remove, only included for the Tile type
+#include "levelnavigation.h"
 #include <faworld/item/item.h>
 #include <functional>
 #include <level/level.h>
-#include <misc/stdhashes.h>
-#include <unordered_map>
+#include <misc/array2d.h>
 #include <unordered_set>
 
+namespace Misc
+{
+    class StateHasher;
+}
+
 namespace FARender
 {
     class Renderer;
@@ -46,6 +52,9 @@ namespace FAWorld
         virtual int32_t height() const = 0;
 
         virtual bool isPassable(const Misc::Point& point, const FAWorld::Actor* forActor) const = 0;
+
+        /// Passability of the level geometry alone, ignoring actors. Out of bounds points are not passable.
+        virtual bool isPassableStatic(const Misc::Point& point) const = 0;
     };
 
     class GameLevel : public GameLevelImpl
@@ -56,6 +65,7 @@ namespace FAWorld
         GameLevel(World& world, FASaveGame::GameLoader& gameLoader);
 
         void save(FASaveGame::GameSaver& gameSaver) const;
+        void hashState(Misc::StateHasher& hasher) const;
 
         ~GameLevel();
 
@@ -93,6 +103,7 @@ namespace FAWorld
                                     const std::function<bool(const Misc::Point& point)>& additionalConstraints = nullptr) const;
 
         virtual bool isPassable(const Misc::Point& point, const FAWorld::Actor* forActor) const;
+        virtual bool isPassableStatic(const Misc::Point& point) const;
 
         Actor* getActorAt(const Misc::Point& point) const;
 
@@ -106,6 +117,7 @@ namespace FAWorld
         bool dropItemClosestEmptyTile(std::unique_ptr<Item>& item, const Actor& actor, const Misc::Point& position, Misc::Direction direction);
 
         Actor* getActorById(int32_t id);
+        const std::vector<Actor*>& getActors() const { return mActors; }
 
         ItemMap& getItemMap();
 
@@ -113,6 +125,10 @@ namespace FAWorld
 
         World* getWorld() { return &mWorld; }
 
+        // Shared by everything on this level, so searches don't need to allocate
+        PathFinder& getPathFinder() { return mPathFinder; }
+        LevelNavigation& getNavigation() { return mNavigation; }
+
         // This list avoids having to check every actor in world to find missile graphics on a level.
         // It is not saved, items are added/removed in MissileGraphic constructor/destructor.
         // This is currently only intended for rendering so order is unimportant, hence using std::unordered_set
@@ -126,11 +142,23 @@ namespace FAWorld
         Level::Level mLevel;
         int32_t mLevelIndex = 0;
 
+        void initPassabilityMaps();
+        void refreshFreeTiles(const Misc::Point& topLeft, const Misc::Point& bottomRight);
+        int32_t tileIndex(const Misc::Point& point) const { return point.x + point.y * width(); }
+        bool isFreeTile(int32_t index) const { return (mFreeTiles[index / 64] >> (index % 64)) & 1; }
+        void setFreeTile(int32_t index, bool free);
+
         std::vector<Actor*> mActors;
-        std::unordered_map<Misc::Point, Actor*> mActorMap2D; ///< Map of points to actors.
+        Misc::Array2D<Actor*> mActorMap2D; ///< Grid of actors, nullptr where there is none.
         ///< Where an actor straddles two squares, they shall be placed in both.
         friend class FARender::Renderer;
 
+        std::vector<uint8_t> mStaticPassable; ///< Cached Level passability, so we don't have to go through the tileset for every query.
+        std::vector<uint64_t> mFreeTiles;     ///< Bitset of tiles that are both statically passable and unoccupied, for fast isPassable checks.
+
         std::unique_ptr<ItemMap> mItemMap;
+
+        PathFinder mPathFinder;
+        LevelNavigation mNavigation{*this};
     };
 }
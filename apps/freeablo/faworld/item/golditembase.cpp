@@ -7,7 +7,7 @@ namespace FAWorld
 {
     GoldItemBase::GoldItemBase(const DiabloExe::ExeItem& exeItem) : super(exeItem)
     {
-        FARender::SpriteLoader& spriteLoader = FARender::Renderer::get()->mSpriteLoader;
+        FARender::SpriteLoader& spriteLoader = *FARender::SpriteLoader::get();
         std::vector<Image> itemCursorImages = Cel::CelDecoder(spriteLoader.mGuiSprites.itemCursors.path).decode();
 
         mInventoryIcon = spriteLoader.getSprite(spriteLoader.mGuiSprites.itemCursors)->getFrame(15);
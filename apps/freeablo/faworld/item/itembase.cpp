@@ -11,7 +11,7 @@ namespace FAWorld
           mSize(exeItem.invSizeX, exeItem.invSizeY), mPrice(exeItem.price), mQualityLevel(exeItem.qualityLevel), mDropRate(exeItem.dropRate),
           mDropItemSoundPath(exeItem.dropItemSoundPath), mInventoryPlaceItemSoundPath(exeItem.invPlaceItemSoundPath)
     {
-        FARender::SpriteLoader& spriteLoader = FARender::Renderer::get()->mSpriteLoader;
+        FARender::SpriteLoader& spriteLoader = *FARender::SpriteLoader::get();
         mDropItemAnimation = spriteLoader.getSprite(spriteLoader.mItemDrops[mId]);
 
         Render::SpriteGroup* itemIcons = spriteLoader.getSprite(spriteLoader.mGuiSprites.itemCursors);
@@ -6,6 +6,7 @@
 #include "world.h"
 #include <engine/enginemain.h>
 #include <memory>
+#include <misc/statehash.h>
 #include <render/spritegroup.h>
 
 namespace FAWorld
@@ -68,6 +69,16 @@ namespace FAWorld
         }
     }
 
+    void ItemMap::hashState(Misc::StateHasher& hasher) const
+    {
+        hasher.add(mItems.size());
+        for (const auto& pair : mItems)
+        {
+            hasher.add(pair.first);
+            hasher.add(pair.second.item().getBase()->mId);
+        }
+    }
+
     ItemMap::~ItemMap() {}
 
     bool ItemMap::dropItem(std::unique_ptr<Item>& item, const Actor& actor, Misc::Point tile)
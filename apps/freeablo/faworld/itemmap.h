@@ -6,6 +6,11 @@
 #include <optional>
 #include <vector>
 
+namespace Misc
+{
+    class StateHasher;
+}
+
 namespace Render
 {
     class SpriteGroup;
@@ -60,6 +65,7 @@ namespace FAWorld
         ItemMap(FASaveGame::GameLoader& loader, const GameLevel* level);
 
         void save(FASaveGame::GameSaver& saver) const;
+        void hashState(Misc::StateHasher& hasher) const;
 
         ~ItemMap();
         bool dropItem(std::unique_ptr<FAWorld::Item>& item, const Actor& actor, Misc::Point tile);
@@ -0,0 +1,252 @@
+#include "levelnavigation.h"
+#include "gamelevel.h"
+#include <algorithm>
+#include <functional>
+#include <misc/assert.h>
+
+namespace FAWorld
+{
+    namespace
+    {
+        // Must match findpath.cpp
+        const int32_t STRAIGHT_WEIGHT = 10;
+        const int32_t DIAGONAL_WEIGHT = 14;
+
+        const Misc::Point NEIGHBOR_OFFSETS[] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+
+        int32_t stepCost(const Misc::Point& offset) { return (offset.x != 0 && offset.y != 0) ? DIAGONAL_WEIGHT : STRAIGHT_WEIGHT; }
+    }
+
+    void LevelNavigation::invalidate()
+    {
+        mRegionsValid = false;
+        mFlowFields.clear();
+    }
+
+    int32_t LevelNavigation::index(const Misc::Point& point) const { return point.x + point.y * mLevel.width(); }
+
+    bool LevelNavigation::inBounds(const Misc::Point& point) const
+    {
+        return point.x >= 0 && point.x < mLevel.width() && point.y >= 0 && point.y < mLevel.height();
+    }
+
+    void LevelNavigation::buildRegions()
+    {
+        mRegions.assign(size_t(mLevel.width() * mLevel.height()), NoRegion);
+
+        int32_t nextRegion = 0;
+        std::vector<Misc::Point> stack;
+
+        for (int32_t y = 0; y < mLevel.height(); y++)
+        {
+            for (int32_t x = 0; x < mLevel.width(); x++)
+            {
+                Misc::Point seed(x, y);
+                if (mRegions[index(seed)] != NoRegion || !mLevel.isPassableStatic(seed))
+                    continue;
+
+                mRegions[index(seed)] = nextRegion;
+                stack.push_back(seed);
+
+                while (!stack.empty())
+                {
+                    Misc::Point current = stack.back();
+                    stack.pop_back();
+
+                    for (const Misc::Point& offset : NEIGHBOR_OFFSETS)
+                    {
+                        Misc::Point next = current + offset;
+                        if (inBounds(next) && mRegions[index(next)] == NoRegion && mLevel.isPassableStatic(next))
+                        {
+                            mRegions[index(next)] = nextRegion;
+                            stack.push_back(next);
+                        }
+                    }
+                }
+
+                nextRegion++;
+            }
+        }
+
+        mRegionsValid = true;
+    }
+
+    int32_t LevelNavigation::getRegion(const Misc::Point& point)
+    {
+        if (!inBounds(point))
+            return NoRegion;
+
+        if (!mRegionsValid)
+            buildRegions();
+
+        return mRegions[index(point)];
+    }
+
+    bool LevelNavigation::canPossiblyReach(const Misc::Point& start, const Misc::Point& goal)
+    {
+        int32_t startRegion = getRegion(start);
+
+        // We don't know anything about searches that start off the navigable area, so we can't rule them out
+        if (startRegion == NoRegion)
+            return true;
+
+        for (int32_t dy = -1; dy <= 1; dy++)
+        {
+            for (int32_t dx = -1; dx <= 1; dx++)
+            {
+                if (getRegion(Misc::Point(goal.x + dx, goal.y + dy)) == startRegion)
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    void LevelNavigation::startFlowField(FlowField& field)
+    {
+        field.distances.assign(size_t(mLevel.width() * mLevel.height()), Unreachable);
+        field.open.clear();
+
+        if (!inBounds(field.target))
+            return;
+
+        field.distances[index(field.target)] = 0;
+        field.open.emplace_back(0, index(field.target));
+    }
+
+    void LevelNavigation::expandFlowField(FlowField& field, int32_t untilIndex)
+    {
+        std::vector<OpenEntry>& open = field.open;
+
+        while (!open.empty())
+        {
+            // Nothing left in the open set can lower this any further
+            if (untilIndex != -1 && field.distances[untilIndex] != Unreachable && open.front().first >= field.distances[untilIndex])
+                return;
+
+            std::pop_heap(open.begin(), open.end(), std::greater<OpenEntry>());
+            OpenEntry entry = open.back();
+            open.pop_back();
+
+            if (entry.first > field.distances[entry.second])
+                continue;
+
+            Misc::Point current(entry.second % mLevel.width(), entry.second / mLevel.width());
+            for (const Misc::Point& offset : NEIGHBOR_OFFSETS)
+            {
+                Misc::Point next = current + offset;
+                if (!inBounds(next) || !mLevel.isPassableStatic(next))
+                    continue;
+
+                int32_t distance = entry.first + stepCost(offset);
+                int32_t& nextDistance = field.distances[index(next)];
+                if (nextDistance == Unreachable || distance < nextDistance)
+                {
+                    nextDistance = distance;
+                    open.emplace_back(distance, index(next));
+                    std::push_heap(open.begin(), open.end(), std::greater<OpenEntry>());
+                }
+            }
+        }
+    }
+
+    LevelNavigation::FlowField& LevelNavigation::getFlowFieldStarted(const Misc::Point& target)
+    {
+        mUseCounter++;
+
+        for (FlowField& field : mFlowFields)
+        {
+            if (field.target == target)
+            {
+                field.lastUsed = mUseCounter;
+                return field;
+            }
+        }
+
+        FlowField* field = nullptr;
+        if (mFlowFields.size() < MAX_FLOW_FIELDS)
+        {
+            mFlowFields.emplace_back();
+            field = &mFlowFields.back();
+        }
+        else
+        {
+            field = &*std::min_element(
+                mFlowFields.begin(), mFlowFields.end(), [](const FlowField& a, const FlowField& b) { return a.lastUsed < b.lastUsed; });
+        }
+
+        field->target = target;
+        field->lastUsed = mUseCounter;
+        startFlowField(*field);
+
+        return *field;
+    }
+
+    const std::vector<int32_t>& LevelNavigation::getFlowField(const Misc::Point& target)
+    {
+        FlowField& field = getFlowFieldStarted(target);
+        expandFlowField(field, -1);
+        return field.distances;
+    }
+
+    bool LevelNavigation::findFlowFieldPath(const Actor* actor, const Misc::Point& start, const Misc::Point& target, Misc::Points& path)
+    {
+        path.clear();
+
+        if (!inBounds(start))
+            return false;
+
+        FlowField& field = getFlowFieldStarted(target);
+        expandFlowField(field, index(start));
+
+        // Every tile closer to the target than start has its final distance now, and those are the only ones the walk below can step on,
+        // so the path is the same however far the field had been expanded before
+        const std::vector<int32_t>& distances = field.distances;
+        if (distances[index(start)] == Unreachable)
+            return false;
+
+        path.push_back(start);
+
+        Misc::Point current = start;
+        while (true)
+        {
+            int32_t currentDistance = distances[index(current)];
+
+            // Ties are broken by the fixed neighbour order, so the result is deterministic
+            int32_t bestDistance = currentDistance;
+            Misc::Point best = current;
+            for (const Misc::Point& offset : NEIGHBOR_OFFSETS)
+            {
+                Misc::Point next = current + offset;
+                if (!inBounds(next))
+                    continue;
+
+                int32_t nextDistance = distances[index(next)];
+                if (nextDistance == Unreachable || nextDistance >= bestDistance)
+                    continue;
+
+                // The target is occupied by whatever we're chasing, so we stop next to it instead
+                if (next != target && !mLevel.isPassable(next, actor))
+                    continue;
+
+                bestDistance = nextDistance;
+                best = next;
+            }
+
+            if (best == target || current == target)
+                break;
+
+            // Other actors are in the way of every downhill step, and we're not next to the target yet
+            if (best == current)
+            {
+                path.clear();
+                return false;
+            }
+
+            path.push_back(best);
+            current = best;
+        }
+
+        return true;
+    }
+}
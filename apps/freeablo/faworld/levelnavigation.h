@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <misc/simplevec2.h>
+#include <utility>
+#include <vector>
+
+namespace FAWorld
+{
+    class Actor;
+    class GameLevelImpl;
+
+    // Shared navigation data for one level, built from static passability only (ie: ignoring actors).
+    // Everything in here is a cache, a pure function of the level's static passability and the query parameters. It doesn't
+    // matter when or in what order anything is computed, which is what keeps it safe to use in the lockstep simulation.
+    // invalidate() must be called whenever static passability changes (ie: when a door is opened or closed).
+    class LevelNavigation
+    {
+    public:
+        static constexpr int32_t NoRegion = -1;
+        static constexpr int32_t Unreachable = -1;
+
+        explicit LevelNavigation(GameLevelImpl& level) : mLevel(level) {}
+
+        void invalidate();
+
+        // Id of the 8-connected region of statically passable tiles containing point, or NoRegion if the point is not passable
+        int32_t getRegion(const Misc::Point& point);
+
+        // Returns false only if there is definitely no path from start to goal, or to any tile adjacent to goal.
+        // Any search that could succeed also passes this check, so it can be used to skip doomed searches without changing results.
+        bool canPossiblyReach(const Misc::Point& start, const Misc::Point& goal);
+
+        // Dijkstra map of the distance from every tile to target, using the same weights as the A* pathfinder, or Unreachable.
+        // Fields are shared, so many actors chasing the same target only pay for one search between them.
+        const std::vector<int32_t>& getFlowField(const Misc::Point& target);
+
+        // Builds a path towards target by walking downhill in its flow field, stopping on a tile adjacent to target.
+        // Every step avoids tiles that actors are standing on. Returns false if the walk runs out of free downhill steps before it gets
+        // next to the target, in which case path is cleared and the caller should fall back to a search that can route around them.
+        bool findFlowFieldPath(const Actor* actor, const Misc::Point& start, const Misc::Point& target, Misc::Points& path);
+
+    private:
+        using OpenEntry = std::pair<int32_t, int32_t>; // distance, tile index
+
+        // Fields are expanded outwards from the target only as far as the tiles they have been asked about, as the player being chased
+        // moves to a new tile every few ticks, and the monsters chasing them are usually close by. Tiles closer to the target than the
+        // front of the open set have their final distance, and the rest are expanded to on demand.
+        struct FlowField
+        {
+            Misc::Point target;
+            uint32_t lastUsed = 0;
+            std::vector<int32_t> distances;
+            std::vector<OpenEntry> open;
+        };
+
+        int32_t index(const Misc::Point& point) const;
+        bool inBounds(const Misc::Point& point) const;
+        void buildRegions();
+        FlowField& getFlowFieldStarted(const Misc::Point& target);
+        void startFlowField(FlowField& field);
+        void expandFlowField(FlowField& field, int32_t untilIndex); ///< Expands until untilIndex has its final distance, or -1 for everything
+
+        GameLevelImpl& mLevel;
+
+        bool mRegionsValid = false;
+        std::vector<int32_t> mRegions;
+
+        // A handful is enough to cover every player in a multiplayer game without rebuilding fields for each other every tick
+        static constexpr size_t MAX_FLOW_FIELDS = 8;
+        std::vector<FlowField> mFlowFields;
+        uint32_t mUseCounter = 0;
+    };
+}
@@ -4,6 +4,7 @@
 #include "engine/threadmanager.h"
 #include "fasavegame/gameloader.h"
 #include "faworld/actor.h"
+#include <map>
 
 namespace FAWorld::Missile
 {
@@ -12,8 +13,8 @@ namespace FAWorld::Missile
     {
         mAttr.mCreation(*this, dest, creator.getLevel());
 
-        if (!missileData().mSoundEffect.empty())
-            Engine::ThreadManager::get()->playSound(missileData().mSoundEffect);
+        if (getSounds(missileId).sound.isValid())
+            Engine::ThreadManager::get()->playSound(getSounds(missileId).sound);
 
         const LiveActorStats& stats = creator.mStats.getCalculatedStats();
         mToHitRanged = stats.toHitRanged;
@@ -70,7 +71,7 @@ namespace FAWorld::Missile
 
     const FARender::SpriteLoader::SpriteDefinition& Missile::getGraphic(int32_t i) const
     {
-        FARender::SpriteLoader& spriteLoader = FARender::Renderer::get()->mSpriteLoader;
+        FARender::SpriteLoader& spriteLoader = *FARender::SpriteLoader::get();
 
         const std::vector<FARender::SpriteLoader::SpriteDefinition>& directions = spriteLoader.mMissileAnimations[missileData().mMissileGraphicsId];
         release_assert(i >= 0 && i < int32_t(directions.size()));
@@ -80,8 +81,22 @@ namespace FAWorld::Missile
 
     void Missile::playImpactSound()
     {
-        if (!missileData().mImpactSoundEffect.empty())
-            Engine::ThreadManager::get()->playSound(missileData().mImpactSoundEffect);
+        if (getSounds(mMissileId).impact.isValid())
+            Engine::ThreadManager::get()->playSound(getSounds(mMissileId).impact);
+    }
+
+    const Missile::Sounds& Missile::getSounds(MissileId missileId)
+    {
+        static std::map<MissileId, Sounds> sounds;
+
+        auto it = sounds.find(missileId);
+        if (it == sounds.end())
+        {
+            const DiabloExe::MissileData& data = Engine::EngineMain::get()->exe().getMissileDataTable().at((size_t)missileId);
+            it = sounds.emplace(missileId, Sounds{FAAudio::SoundId::intern(data.mSoundEffect), FAAudio::SoundId::intern(data.mImpactSoundEffect)}).first;
+        }
+
+        return it->second;
     }
 
     void Missile::update()
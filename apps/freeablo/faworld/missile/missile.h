@@ -1,6 +1,7 @@
 #pragma once
 #include "missileenums.h"
 #include "missilegraphic.h"
+#include <faaudio/soundid.h>
 #include <faworld/actorstats.h>
 #include <functional>
 #include <misc/misc.h>
@@ -33,6 +34,15 @@ namespace FAWorld::Missile
         MissileId getMissileId() const { return mMissileId; }
         const std::vector<std::unique_ptr<MissileGraphic>>& getGraphics() const { return mGraphics; }
 
+        struct Sounds
+        {
+            FAAudio::SoundId sound;  ///< played when the missile is created
+            FAAudio::SoundId impact; ///< played when it hits something
+        };
+
+        /// Interned the first time each type of missile is used, rather than every time one is created
+        static const Sounds& getSounds(MissileId missileId);
+
     protected:
         // Static inner classes for missile attribute composition.
         class Creation
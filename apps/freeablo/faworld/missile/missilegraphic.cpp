@@ -17,7 +17,7 @@ namespace FAWorld::Missile
     {
         level->mMissileGraphics.insert(this);
 
-        FARender::SpriteLoader& spriteLoader = FARender::Renderer::get()->mSpriteLoader;
+        FARender::SpriteLoader& spriteLoader = *FARender::SpriteLoader::get();
         if (!mInitialGraphic.empty())
         {
             Render::SpriteGroup* sprite = spriteLoader.getSprite(mInitialGraphic);
@@ -55,9 +55,9 @@ namespace FAWorld::Missile
         if (!mComplete)
         {
             if (!mInitialGraphic.empty())
-                mAnimationPlayer.replaceAnimation(FARender::Renderer::get()->mSpriteLoader.getSprite(mInitialGraphic));
+                mAnimationPlayer.replaceAnimation(FARender::SpriteLoader::get()->getSprite(mInitialGraphic));
             else if (!mMainGraphic.empty())
-                mAnimationPlayer.replaceAnimation(FARender::Renderer::get()->mSpriteLoader.getSprite(mMainGraphic));
+                mAnimationPlayer.replaceAnimation(FARender::SpriteLoader::get()->getSprite(mMainGraphic));
         }
         else
         {
@@ -87,11 +87,12 @@ namespace FAWorld::Missile
 
     void MissileGraphic::update()
     {
-        if (DebugSettings::DebugMissiles)
+        FARender::Renderer* renderer = FARender::Renderer::get();
+        if (DebugSettings::DebugMissiles && renderer)
         {
             Vec2Fix currentTileCentre = Vec2Fix(mCurPos.current()) + Vec2Fix(FixedPoint("0.5"), FixedPoint("0.5"));
-            FARender::Renderer::get()->mTmpDebugRenderData.push_back(PointData{currentTileCentre, Render::Colors::green, 5});
-            FARender::Renderer::get()->mTmpDebugRenderData.push_back(PointData{mCurPos.getFractionalPos(), Render::Colors::red, 1});
+            renderer->mTmpDebugRenderData.push_back(PointData{currentTileCentre, Render::Colors::green, 5});
+            renderer->mTmpDebugRenderData.push_back(PointData{mCurPos.getFractionalPos(), Render::Colors::red, 1});
         }
 
         mTicksSinceStarted++;
@@ -104,7 +105,7 @@ namespace FAWorld::Missile
         if (!mAnimationPlayer.isPlaying())
         {
             mInitialGraphic.clear();
-            playAnimation(FARender::Renderer::get()->mSpriteLoader.getSprite(mMainGraphic), FARender::AnimationPlayer::AnimationType::Looped);
+            playAnimation(FARender::SpriteLoader::get()->getSprite(mMainGraphic), FARender::AnimationPlayer::AnimationType::Looped);
         }
     }
 
@@ -25,10 +25,6 @@ namespace FAWorld
         mName = monsterData.monsterName;
         mMonsterId = monsterData.idName;
 
-        mSoundPath = monsterData.soundPath;
-        Misc::StringUtils::replace(mSoundPath, "%c", "{}");
-        Misc::StringUtils::replace(mSoundPath, "%i", "{}");
-
         mStats.mLevel = monsterData.level;
         mType = ActorType(monsterData.type);
         mStats.getHp() = Misc::MaxCurrentItem(world.mRng->randomInRange(monsterData.minHp, monsterData.maxHp));
@@ -47,6 +43,11 @@ namespace FAWorld
     {
         const DiabloExe::Monster& monsterProperties = mWorld.mDiabloExe.getMonster(mMonsterId);
         mMeleeHitFrame = monsterProperties.hitFrame;
+
+        std::string soundPath = monsterProperties.soundPath;
+        Misc::StringUtils::replace(soundPath, "%c", "{}");
+        Misc::StringUtils::replace(soundPath, "%i", "{}");
+        setSoundPath(soundPath);
         restoreAnimations();
 
         mInitialised = true;
@@ -152,7 +153,7 @@ namespace FAWorld
 
     void Monster::restoreAnimations()
     {
-        FARender::SpriteLoader& spriteLoader = FARender::Renderer::get()->mSpriteLoader;
+        FARender::SpriteLoader& spriteLoader = *FARender::SpriteLoader::get();
         FARender::SpriteLoader::MonsterSpriteDefinition spriteDefinitions = spriteLoader.mMonsterSpriteDefinitions[mMonsterId];
 
         mAnimation.setAnimationSprites(AnimState::walk, spriteLoader.getSprite(spriteDefinitions.walk));
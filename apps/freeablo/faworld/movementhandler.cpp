@@ -2,6 +2,9 @@
 #include "../fasavegame/gameloader.h"
 #include "actor.h"
 #include "findpath.h"
+#include "player.h"
+#include "simprofile.h"
+#include <misc/statehash.h>
 
 namespace FAWorld
 {
@@ -59,6 +62,16 @@ namespace FAWorld
         mSpeedTilesPerSecond.save(saver);
     }
 
+    void MovementHandler::hashState(Misc::StateHasher& hasher) const
+    {
+        hasher.add(mLevel ? mLevel->getLevelIndex() : -1);
+        mCurrentPos.hashState(hasher);
+        hasher.add(mDestination);
+        hasher.add(mCurrentPathIndex);
+        hasher.add(mCurrentPath.size());
+        hasher.add(mLastRepathed);
+    }
+
     Misc::Point MovementHandler::getDestination() const { return mDestination; }
 
     void MovementHandler::setDestination(Misc::Point dest, bool adjacent)
@@ -80,6 +93,29 @@ namespace FAWorld
             moveDistance = updateInternal(actor, moveDistance);
     }
 
+    void MovementHandler::repath(const Actor& actor)
+    {
+        ScopedSimTimer timer(SimSection::Pathfinding);
+
+        LevelNavigation& navigation = mLevel->getNavigation();
+        Misc::Point start = mCurrentPos.current();
+
+        // Towners ignore passability (see GameLevel::isPassable), so the static regions don't apply to them
+        if (!actor.mIsTowner && !navigation.canPossiblyReach(start, mDestination))
+        {
+            mCurrentPath.clear();
+            return;
+        }
+
+        // Monsters chasing a player share one flow field per target, instead of each running their own search
+        Actor* target = mLevel->getActorAt(mDestination);
+        if (!dynamic_cast<const Player*>(&actor) && dynamic_cast<Player*>(target) &&
+            navigation.findFlowFieldPath(&actor, start, mDestination, mCurrentPath))
+            return;
+
+        mLevel->getPathFinder().findPath(mLevel, &actor, start, mDestination, mAdjacent, mCurrentPath);
+    }
+
     FixedPoint MovementHandler::updateInternal(Actor& actor, FixedPoint moveDistance)
     {
         debug_assert(mLevel);
@@ -153,8 +189,7 @@ namespace FAWorld
                 {
                     mLastRepathed = mLevel->getWorld()->getCurrentTick();
 
-                    bool _;
-                    mCurrentPath = pathFind(mLevel, &actor, mCurrentPos.current(), mDestination, _, mAdjacent);
+                    repath(actor);
                     mCurrentPathIndex = 1;
 
                     if (mCurrentPath.size() <= 1)
@@ -19,6 +19,7 @@ namespace FAWorld
         MovementHandler() = default;
         explicit MovementHandler(FASaveGame::GameLoader& loader);
         void save(FASaveGame::GameSaver& saver) const;
+        void hashState(Misc::StateHasher& hasher) const;
 
         Misc::Point getDestination() const;
         void setDestination(Misc::Point dest, bool adjacent = false);
@@ -33,6 +34,7 @@ namespace FAWorld
 
     private:
         FixedPoint updateInternal(Actor& actor, FixedPoint moveDistance);
+        void repath(const Actor& actor);
 
     public:
         FixedPoint mSpeedTilesPerSecond;
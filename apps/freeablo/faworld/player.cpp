@@ -462,13 +462,13 @@ namespace FAWorld
                 weapon = weapon + "-shield";
         }
 
-        FARender::Renderer* renderer = FARender::Renderer::get();
-        if (!renderer) // TODO: some sort of headless mode for tests
+        FARender::SpriteLoader* spriteLoader = FARender::SpriteLoader::get();
+        if (!spriteLoader) // unit tests have no sprites at all
             return;
 
         auto getAnimation = [&](const std::string& animation) {
             FARender::SpriteLoader::PlayerSpriteKey spriteLookupKey({{"animation", animation}, {"class", classCode}, {"armor", armor}, {"weapon", weapon}});
-            return renderer->mSpriteLoader.getSprite(renderer->mSpriteLoader.mPlayerSpriteDefinitions.at(spriteLookupKey));
+            return spriteLoader->getSprite(spriteLoader->mPlayerSpriteDefinitions.at(spriteLookupKey));
         };
 
         mAnimation.setAnimationSprites(AnimState::dead, getAnimation("dead"));
@@ -657,6 +657,25 @@ namespace FAWorld
         Actor::doSpellEffect(spell, targetPoint);
     }
 
+    void Player::getPreloadSounds(std::vector<FAAudio::SoundId>& sounds) const
+    {
+        Actor::getPreloadSounds(sounds);
+
+        for (const char* path : {"sfx/misc/swing.wav", "sfx/misc/swing2.wav", "sfx/misc/bfire.wav", "sfx/items/invgrab.wav"})
+            sounds.push_back(FAAudio::SoundId::intern(path));
+
+        SpellData skill(defaultSkill());
+        sounds.push_back(skill.soundEffectId());
+
+        std::vector<MissileId> missiles = skill.missiles();
+        missiles.push_back(MissileId::arrow);
+        for (MissileId missileId : missiles)
+        {
+            sounds.push_back(Missile::Missile::getSounds(missileId).sound);
+            sounds.push_back(Missile::Missile::getSounds(missileId).impact);
+        }
+    }
+
     SpellId Player::defaultSkill() const
     {
         switch (mPlayerClass)
@@ -32,6 +32,7 @@ namespace FAWorld
         bool castSpell(SpellId spell, Misc::Point targetPoint) override;
         void doSpellEffect(SpellId spell, Misc::Point targetPoint) override;
         SpellId defaultSkill() const;
+        void getPreloadSounds(std::vector<FAAudio::SoundId>& sounds) const override;
 
         virtual void calculateStats(LiveActorStats& stats, const ActorStats& actorStats) const override;
 
@@ -3,6 +3,7 @@
 #include "world.h"
 #include <algorithm>
 #include <cstdlib>
+#include <misc/statehash.h>
 
 namespace FAWorld
 {
@@ -31,6 +32,14 @@ namespace FAWorld
         mFractionalPos.save(saver);
     }
 
+    void Position::hashState(Misc::StateHasher& hasher) const
+    {
+        hasher.add(mDirection.getDegrees());
+        hasher.add(mMovementType);
+        hasher.add(mCurrent);
+        hasher.add(mFractionalPos);
+    }
+
     FixedPoint Position::update(FixedPoint moveDistance)
     {
         if (isMoving())
@@ -4,6 +4,11 @@
 #include <cmath>
 #include <utility>
 
+namespace Misc
+{
+    class StateHasher;
+}
+
 namespace FASaveGame
 {
     class GameLoader;
@@ -20,6 +25,7 @@ namespace FAWorld
 
         Position(FASaveGame::GameLoader& loader);
         void save(FASaveGame::GameSaver& saver) const;
+        void hashState(Misc::StateHasher& hasher) const;
 
         FixedPoint update(FixedPoint moveDistance);
 
@@ -0,0 +1,30 @@
+#include "simprofile.h"
+#include <misc/assert.h>
+
+namespace FAWorld
+{
+    SimProfile* SimProfile::active = nullptr;
+
+    const char* simSectionToString(SimSection section)
+    {
+        switch (section)
+        {
+            case SimSection::ActorStates:
+                return "actor states";
+            case SimSection::Behaviours:
+                return "behaviours";
+            case SimSection::Pathfinding:
+                return "pathfinding";
+            case SimSection::Animations:
+                return "animations";
+            case SimSection::Missiles:
+                return "missiles";
+            case SimSection::Items:
+                return "items";
+            case SimSection::ENUM_END:
+                break;
+        }
+
+        invalid_enum(SimSection, section);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace FAWorld
+{
+    // Coarse timing of the parts of a simulation tick, used by the headless benchmark.
+    // Sections can nest (eg: pathfinding happens inside actor state updates), so times are inclusive and don't sum to the tick time.
+    enum class SimSection : uint8_t
+    {
+        ActorStates,
+        Behaviours,
+        Pathfinding,
+        Animations,
+        Missiles,
+        Items,
+
+        ENUM_END
+    };
+
+    const char* simSectionToString(SimSection section);
+
+    struct SimProfile
+    {
+        std::array<std::chrono::steady_clock::duration, size_t(SimSection::ENUM_END)> time = {};
+        std::array<uint64_t, size_t(SimSection::ENUM_END)> count = {};
+
+        // Set to start collecting, nullptr (the default) disables profiling, which then costs a single branch per section
+        static SimProfile* active;
+    };
+
+    class ScopedSimTimer
+    {
+    public:
+        explicit ScopedSimTimer(SimSection section) : mProfile(SimProfile::active), mSection(section)
+        {
+            if (mProfile)
+                mStart = std::chrono::steady_clock::now();
+        }
+
+        ~ScopedSimTimer()
+        {
+            if (mProfile)
+            {
+                mProfile->time[size_t(mSection)] += std::chrono::steady_clock::now() - mStart;
+                mProfile->count[size_t(mSection)]++;
+            }
+        }
+
+        ScopedSimTimer(const ScopedSimTimer&) = delete;
+        ScopedSimTimer& operator=(const ScopedSimTimer&) = delete;
+
+    private:
+        SimProfile* mProfile;
+        SimSection mSection;
+        std::chrono::steady_clock::time_point mStart;
+    };
+}
@@ -3,6 +3,8 @@
 #include "engine/enginemain.h"
 #include "missile/missileenums.h"
 #include "spellenums.h"
+#include <faaudio/soundid.h>
+#include <map>
 
 namespace FAWorld
 {
@@ -19,6 +21,18 @@ namespace FAWorld
 
         const std::string& soundEffect() const { return mSpellData.mSoundEffect; }
 
+        /// Interned the first time each spell is used, rather than every time it's cast
+        FAAudio::SoundId soundEffectId() const
+        {
+            static std::map<SpellId, FAAudio::SoundId> soundEffects;
+
+            auto it = soundEffects.find(mId);
+            if (it == soundEffects.end())
+                it = soundEffects.emplace(mId, FAAudio::SoundId::intern(mSpellData.mSoundEffect)).first;
+
+            return it->second;
+        }
+
         DiabloExe::SpellData::SpellType getType() const { return mSpellData.mType; }
 
         std::vector<MissileId> missiles() const
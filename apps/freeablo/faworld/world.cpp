@@ -17,9 +17,11 @@
 #include "player.h"
 #include "playerbehaviour.h"
 #include "storedata.h"
+#include <algorithm>
 #include <diabloexe/diabloexe.h>
 #include <iostream>
 #include <misc/assert.h>
+#include <misc/statehash.h>
 #include <serial/textstream.h>
 #include <tuple>
 
@@ -102,6 +104,25 @@ namespace FAWorld
         mStoreData->save(saver);
     }
 
+    uint64_t World::getStateHash() const
+    {
+        Misc::StateHasher hasher;
+
+        mRng->hashState(hasher);
+        mLevelRng->hashState(hasher);
+        hasher.add(mTicksPassed);
+        hasher.add(mNextId);
+
+        for (const auto& pair : mLevels)
+        {
+            hasher.add(pair.first);
+            if (pair.second)
+                pair.second->hashState(hasher);
+        }
+
+        return hasher.getHash();
+    }
+
     void World::setupObjectIdMappers()
     {
         mObjectIdMapper.addClass(Actor::typeId, [&](FASaveGame::GameLoader& loader) { return new Actor(*this, loader); });
@@ -281,6 +302,24 @@ namespace FAWorld
         }
     }
 
+    void World::preloadLevelSounds(size_t level)
+    {
+        GameLevel* gameLevel = getLevel(level);
+        if (!gameLevel)
+            return;
+
+        std::vector<FAAudio::SoundId> sounds;
+        for (const Actor* actor : gameLevel->getActors())
+            actor->getPreloadSounds(sounds);
+
+        // Most of these are shared between several monsters of the same type
+        sounds.erase(std::remove(sounds.begin(), sounds.end(), FAAudio::SoundId()), sounds.end());
+        std::sort(sounds.begin(), sounds.end());
+        sounds.erase(std::unique(sounds.begin(), sounds.end()), sounds.end());
+
+        Engine::ThreadManager::get()->preloadSounds(std::move(sounds));
+    }
+
     GameLevel* World::getLevel(size_t level)
     {
         auto p = mLevels.find(level);
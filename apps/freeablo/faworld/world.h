@@ -9,6 +9,11 @@
 #include <utility>
 #include <vector>
 
+namespace Misc
+{
+    class StateHasher;
+}
+
 namespace Random
 {
     class Rng;
@@ -59,6 +64,8 @@ namespace FAWorld
     public:
         World(const DiabloExe::DiabloExe& exe, uint32_t seed);
         void save(FASaveGame::GameSaver& saver) const;
+        // Cheap digest of the simulation state, for detecting desyncs between machines. See Misc::StateHasher.
+        uint64_t getStateHash() const;
         void load(FASaveGame::GameLoader& loader);
         ~World();
 
@@ -106,6 +113,8 @@ namespace FAWorld
         StoreData& getStoreData() { return *mStoreData; }
 
         void playLevelMusic(size_t level);
+        /// Loads the sounds used by the actors on a level ahead of time, so playing them doesn't have to wait on the audio thread
+        void preloadLevelSounds(size_t level);
 
         static const Tick ticksPerSecond = 60; ///< number of times per second that game state will be updated
         FASaveGame::ObjectIdMapper mObjectIdMapper;
@@ -0,0 +1,81 @@
+#include "engine/headlessbenchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <faio/fafileobject.h>
+#include <iostream>
+#include <misc/misc.h>
+#include <new>
+#include <settings/settings.h>
+
+// Counts every heap allocation in the process, so the benchmark can report allocations per tick
+static std::atomic<uint64_t> allocationCount{0};
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* ptr = malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+int main(int argc, char** argv)
+{
+    Misc::saveArgv0(argv[0]);
+
+    Engine::HeadlessBenchmark::Options options;
+
+    cxxopts::Options desc("freeablo_headless", "Runs the simulation without a window or audio, and reports its throughput");
+    desc.add_options()("h,help", "Print help")(
+        "levels", "Dungeon levels to generate", cxxopts::value<int32_t>()->default_value(std::to_string(options.levels)))(
+        "monsters", "Extra monsters to spawn on each level", cxxopts::value<int32_t>()->default_value(std::to_string(options.extraMonstersPerLevel)))(
+        "players", "Scripted players to spawn", cxxopts::value<int32_t>()->default_value(std::to_string(options.players)))(
+        "ticks", "Ticks to simulate", cxxopts::value<int64_t>()->default_value(std::to_string(options.ticks)))(
+        "seed", "World and script seed", cxxopts::value<uint32_t>()->default_value(std::to_string(options.seed)));
+
+    try
+    {
+        cxxopts::ParseResult variables = desc.parse(argc, argv);
+
+        if (variables.count("help"))
+        {
+            std::cout << desc.help() << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        options.levels = std::clamp(variables["levels"].as<int32_t>(), 0, 16);
+        options.extraMonstersPerLevel = variables["monsters"].as<int32_t>();
+        options.players = variables["players"].as<int32_t>();
+        options.ticks = variables["ticks"].as<int64_t>();
+        options.seed = variables["seed"].as<uint32_t>();
+    }
+    catch (cxxopts::OptionParseException& e)
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
+        std::cerr << desc.help() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    options.allocationCounter = [] { return allocationCount.load(std::memory_order_relaxed); };
+
+    Settings::Settings settings;
+    if (!settings.loadUserSettings())
+    {
+        std::cerr << "Failed to load settings, run freeablo once to configure the game data paths" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!FAIO::init(settings.get<std::string>("Game", "PathMPQ")))
+        return EXIT_FAILURE;
+
+    int retval = Engine::HeadlessBenchmark::run(settings, options) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    FAIO::FAFileObject::quit();
+    return retval;
+}
@@ -0,0 +1,73 @@
+#include "engine/enginemain.h"
+#include <csignal>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <faio/fafileobject.h>
+#include <iostream>
+#include <misc/misc.h>
+#include <settings/settings.h>
+
+// Only touches EngineMain::mDone, which is a lock free atomic, so this is safe to run as a signal handler
+static void onInterrupt(int)
+{
+    if (Engine::EngineMain::get())
+        Engine::EngineMain::get()->stop();
+}
+
+int main(int argc, char** argv)
+{
+    Misc::saveArgv0(argv[0]);
+
+    Engine::DedicatedServerOptions options;
+
+    cxxopts::Options desc("freeablo_server", "Hosts a multiplayer game without a window, audio or local player");
+    desc.add_options()("h,help", "Print help")(
+        "port", "Port to listen on", cxxopts::value<uint16_t>()->default_value(std::to_string(options.port)))(
+        "max-peers", "Maximum number of connected players", cxxopts::value<size_t>()->default_value(std::to_string(options.maxPeers)))(
+        "seed", "World seed, 0 for random", cxxopts::value<uint32_t>()->default_value(std::to_string(options.seed)))(
+        "stats-interval",
+        "Seconds between stats lines, 0 to disable",
+        cxxopts::value<int32_t>()->default_value(std::to_string(options.statsIntervalSeconds)));
+
+    try
+    {
+        cxxopts::ParseResult variables = desc.parse(argc, argv);
+
+        if (variables.count("help"))
+        {
+            std::cout << desc.help() << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        options.port = variables["port"].as<uint16_t>();
+        options.maxPeers = variables["max-peers"].as<size_t>();
+        options.seed = variables["seed"].as<uint32_t>();
+        options.statsIntervalSeconds = variables["stats-interval"].as<int32_t>();
+    }
+    catch (cxxopts::OptionParseException& e)
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
+        std::cerr << desc.help() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Settings::Settings settings;
+    if (!settings.loadUserSettings())
+    {
+        std::cerr << "Failed to load settings, run freeablo once to configure the game data paths" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!FAIO::init(settings.get<std::string>("Game", "PathMPQ")))
+        return EXIT_FAILURE;
+
+    Engine::EngineMain engine;
+
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+
+    engine.runDedicatedServer(options);
+
+    FAIO::FAFileObject::quit();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include <Image/indexedimage.h>
+#include <cstring>
+
+IndexedImage::IndexedImage(int32_t width, int32_t height) : mData(width, height) {}
+
+void IndexedImage::blitTo(
+    IndexedImage& other, int32_t srcOffsetX, int32_t srcOffsetY, int32_t srcW, int32_t srcH, int32_t destOffsetX, int32_t destOffsetY) const
+{
+    release_assert(destOffsetX >= 0 && destOffsetY >= 0);
+    release_assert(destOffsetX + srcW <= other.width() && destOffsetY + srcH <= other.height());
+    release_assert(srcOffsetX + srcW <= this->width() && srcOffsetY + srcH <= this->height());
+
+    for (int32_t y = 0; y < srcH; y++)
+        memcpy(&other.get(destOffsetX, y + destOffsetY), &this->mData.get(srcOffsetX, y + srcOffsetY), size_t(srcW));
+}
+
+Image IndexedImage::toImage(const IndexedPalette& palette) const
+{
+    Image image(width(), height());
+    for (int32_t y = 0; y < height(); y++)
+    {
+        for (int32_t x = 0; x < width(); x++)
+            image.get(x, y) = palette.colours()[get(x, y)];
+    }
+
+    return image;
+}
+
+std::optional<IndexedPalette> IndexedPalette::create(const ByteColour* colours, size_t count)
+{
+    IndexedPalette palette;
+    int32_t used = 1;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (palette.mIndices.count(getKey(colours[i])))
+            continue;
+
+        if (used == SIZE)
+            return std::nullopt;
+
+        palette.mColours[used] = ByteColour(colours[i].r, colours[i].g, colours[i].b, true);
+        palette.mIndices[getKey(colours[i])] = uint8_t(used);
+        used++;
+    }
+
+    return palette;
+}
+
+std::optional<IndexedImage> IndexedPalette::index(const Image& image) const
+{
+    IndexedImage indexed(image.width(), image.height());
+
+    // Neighbouring pixels are usually the same colour, so remembering the last one skips most of the lookups
+    uint32_t lastKey = 0;
+    uint8_t lastIndex = 0;
+    bool haveLast = false;
+
+    for (int32_t y = 0; y < image.height(); y++)
+    {
+        for (int32_t x = 0; x < image.width(); x++)
+        {
+            const ByteColour& colour = image.get(x, y);
+            if (colour.a == 0)
+                continue;
+            if (colour.a != 255)
+                return std::nullopt;
+
+            uint32_t key = getKey(colour);
+            if (!haveLast || key != lastKey)
+            {
+                auto it = mIndices.find(key);
+                if (it == mIndices.end())
+                    return std::nullopt;
+
+                lastKey = key;
+                lastIndex = it->second;
+                haveLast = true;
+            }
+
+            indexed.get(x, y) = lastIndex;
+        }
+    }
+
+    return indexed;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <Image/image.h>
+#include <array>
+#include <cstdint>
+#include <misc/array2d.h>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+class IndexedPalette;
+
+// An image of 8-bit indices into an IndexedPalette, a quarter of the size of the same Image. Index 0 is always transparent.
+class IndexedImage
+{
+public:
+    IndexedImage() = default;
+    IndexedImage(int32_t width, int32_t height);
+    IndexedImage(const IndexedImage&) = delete;
+    IndexedImage(IndexedImage&&) = default;
+    IndexedImage& operator=(IndexedImage&&) = default;
+
+    uint8_t get(int32_t x, int32_t y) const { return mData.get(x, y); }
+    uint8_t& get(int32_t x, int32_t y) { return mData.get(x, y); }
+
+    int32_t width() const { return mData.width(); }
+    int32_t height() const { return mData.height(); }
+
+    void blitTo(IndexedImage& other, int32_t srcOffsetX, int32_t srcOffsetY, int32_t srcW, int32_t srcH, int32_t destOffsetX, int32_t destOffsetY) const;
+    void blitTo(IndexedImage& other, int32_t destOffsetX, int32_t destOffsetY) const
+    {
+        blitTo(other, 0, 0, this->width(), this->height(), destOffsetX, destOffsetY);
+    }
+
+    Image toImage(const IndexedPalette& palette) const;
+
+public:
+    Misc::Array2D<uint8_t> mData;
+};
+
+// Maps the colours of a source palette onto indices 1 to 255, leaving index 0 for transparency.
+// Duplicate colours in the source share an index, so a 256 entry palette fits as long as it has a duplicate or two.
+class IndexedPalette
+{
+public:
+    static constexpr int32_t SIZE = 256;
+    typedef std::array<ByteColour, SIZE> Colours;
+
+    // Returns nothing when the colours don't fit in 255 indices
+    static std::optional<IndexedPalette> create(const ByteColour* colours, size_t count);
+
+    // Returns nothing when the image has a partially transparent pixel, or a colour that isn't in the palette
+    std::optional<IndexedImage> index(const Image& image) const;
+
+    const Colours& colours() const { return mColours; }
+
+private:
+    IndexedPalette() = default;
+
+    static uint32_t getKey(const ByteColour& colour) { return uint32_t(colour.r) | uint32_t(colour.g) << 8 | uint32_t(colour.b) << 16; }
+
+private:
+    Colours mColours = {};
+    std::unordered_map<uint32_t, uint8_t> mIndices;
+};
@@ -1,12 +1,35 @@
 #include "celdecoder.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <faio/fafileobject.h>
-#include <functional>
 #include <misc/stringops.h>
-#include <set>
+#include <string_view>
 #include <utility>
 
 namespace Cel
 {
+    namespace
+    {
+        // The level tilesets, which are the only cels with frames of types 0 and 2 to 5
+        struct TilesetCel
+        {
+            std::string_view name;
+            std::array<int32_t, 5> notType0Frames; ///< Frames that are 0x400 bytes but not plain 32x32 images, padded with -1
+        };
+
+        constexpr std::array<TilesetCel, 5> tilesetCels = {{
+            {"l1.cel", {148, 159, 181, 186, 188}},
+            {"l2.cel", {47, 1397, 1399, 1411, -1}},
+            {"l3.cel", {-1, -1, -1, -1, -1}},
+            {"l4.cel", {336, 639, -1, -1, -1}},
+            {"town.cel", {2328, 2367, 2593, -1, -1}},
+        }};
+
+        constexpr std::array<uint8_t, 16> type2or4ZeroPositions = {0, 1, 8, 9, 24, 25, 48, 49, 80, 81, 120, 121, 168, 169, 224, 225};
+        constexpr std::array<uint8_t, 16> type3or5ZeroPositions = {2, 3, 14, 15, 34, 35, 62, 63, 98, 99, 142, 143, 194, 195, 254, 255};
+    }
+
     std::unique_ptr<Settings::Settings> CelDecoder::mSettingsCel;
     std::unique_ptr<Settings::Settings> CelDecoder::mSettingsCl2;
 
@@ -36,6 +59,13 @@ namespace Cel
 
         mCelName = celPathComponents[celPathComponents.size() - 1];
         mCelName = Misc::StringUtils::toLower(mCelName);
+        mIsCl2 = Misc::StringUtils::endsWith(mCelName, "cl2");
+
+        for (size_t i = 0; i < tilesetCels.size(); i++)
+        {
+            if (tilesetCels[i].name == mCelName)
+                mTilesetCelIndex = int32_t(i);
+        }
     }
 
     void CelDecoder::readConfiguration()
@@ -72,9 +102,10 @@ namespace Cel
         mIsCharbutCel = mCelName == "charbut.cel";
     }
 
-    void CelDecoder::readPalette()
+    void CelDecoder::readPalette() { mPal = Pal(getPalettePath(mCelPath)); }
+
+    std::string CelDecoder::getPalettePath(const std::string& filename)
     {
-        std::string& filename = mCelPath;
         std::string palFilename;
         if (Misc::StringUtils::startsWith(filename, "levels") && Misc::StringUtils::endsWith(filename, "l1.cel"))
             palFilename = Misc::StringUtils::replaceEnd("l1.cel", "l1.pal", filename);
@@ -93,10 +124,14 @@ namespace Cel
         else
             palFilename = "levels/towndata/town.pal";
 
-        mPal = Pal(palFilename);
+        return palFilename;
     }
 
-    std::vector<Image> CelDecoder::decode()
+    std::vector<Image> CelDecoder::decode() { return decode(false); }
+
+    std::vector<Image> CelDecoder::decodeReference() { return decode(true); }
+
+    std::vector<Image> CelDecoder::decode(bool reference)
     {
         std::vector<Image> images;
         images.reserve(mFrames.size());
@@ -105,7 +140,7 @@ namespace Cel
         for (FrameBytesRef frame : mFrames)
         {
             CelFrame celFrame;
-            decodeFrame(frameNumber, frame, celFrame);
+            decodeFrame(frameNumber, frame, celFrame, reference);
             images.emplace_back(std::move(celFrame));
 
             frameNumber++;
@@ -193,9 +228,9 @@ namespace Cel
         }
     }
 
-    void CelDecoder::decodeFrame(int32_t index, FrameBytesRef frame, CelFrame& celFrame)
+    void CelDecoder::decodeFrame(int32_t index, FrameBytesRef frame, CelFrame& celFrame, bool reference)
     {
-        auto decoder = getFrameDecoder(mCelName, frame, index);
+        FrameType type = getFrameType(frame, index);
 
         if (mIsObjcursCel)
         {
@@ -207,96 +242,87 @@ namespace Cel
         }
 
         celFrame = CelFrame(mFrameWidth, mFrameHeight);
-        decoder(frame, mPal, celFrame);
-        // assert (it == celFrame.mRawImage.end ());
+
+        if (reference)
+            decodeFrameReference(type, frame, mPal, celFrame);
+        else
+            decodeFrameFast(type, frame, mPal, celFrame);
     }
 
-    CelDecoder::FrameDecoder CelDecoder::getFrameDecoder(const std::string& celName, FrameBytesRef frame, int frameNumber)
+    CelDecoder::FrameType CelDecoder::getFrameType(FrameBytesRef frame, int32_t frameNumber) const
     {
-        static std::set<std::string> filenames = {"l1.cel", "l2.cel", "l3.cel", "l4.cel", "town.cel"};
-        int frameSize = frame.size();
-        bool isInFilenames = filenames.find(celName) != filenames.end();
-
-        if (isInFilenames)
+        if (mTilesetCelIndex != -1)
         {
-            switch (frameSize)
+            switch (frame.size())
             {
                 case 0x400:
-                    if (isType0(celName, frameNumber))
-                        return CelDecoder::decodeFrameType0;
+                    if (isType0(mTilesetCelIndex, frameNumber))
+                        return FrameType::Type0;
                     break;
                 case 0x220:
                     if (isType2or4(frame))
-                        return CelDecoder::decodeFrameType2;
+                        return FrameType::Type2;
                     else if (isType3or5(frame))
-                        return CelDecoder::decodeFrameType3;
+                        return FrameType::Type3;
                     break;
                 case 0x320:
                     if (isType2or4(frame))
-                        return CelDecoder::decodeFrameType4;
+                        return FrameType::Type4;
                     else if (isType3or5(frame))
-                        return CelDecoder::decodeFrameType5;
+                        return FrameType::Type5;
                     break;
             }
         }
-        else if (Misc::StringUtils::endsWith(celName, "cl2"))
+        else if (mIsCl2)
         {
-            return CelDecoder::decodeFrameType6;
+            return FrameType::Type6;
         }
 
-        return CelDecoder::decodeFrameType1;
+        return FrameType::Type1;
     }
 
     // isType0 returns true if the image is a plain 32x32.
-    bool CelDecoder::isType0(const std::string& celName, int frameNumber)
+    bool CelDecoder::isType0(int32_t tilesetCelIndex, int32_t frameNumber)
     {
-        std::set<int> numbers;
-
-        if (celName == "l1.cel")
-            numbers = {148, 159, 181, 186, 188};
-        else if (celName == "l2.cel")
-            numbers = {47, 1397, 1399, 1411};
-        else if (celName == "l4.cel")
-            numbers = {336, 639};
-        else if (celName == "town.cel")
-            numbers = {2328, 2367, 2593};
-
-        if (numbers.find(frameNumber) != numbers.end())
-        {
-            return false;
-        }
-
-        return true;
+        const std::array<int32_t, 5>& notType0Frames = tilesetCels[tilesetCelIndex].notType0Frames;
+        return std::find(notType0Frames.begin(), notType0Frames.end(), frameNumber) == notType0Frames.end();
     }
 
     // isType2or4 returns true if the image is a triangle or a trapezoid pointing to
     // the left.
     bool CelDecoder::isType2or4(FrameBytesRef frame)
     {
-
-        std::vector<int> zeroPositions = {0, 1, 8, 9, 24, 25, 48, 49, 80, 81, 120, 121, 168, 169, 224, 225};
-        for (int i : zeroPositions)
-        {
-            if (frame[i] != 0)
-                return false;
-        }
-
-        return true;
+        return std::all_of(type2or4ZeroPositions.begin(), type2or4ZeroPositions.end(), [&frame](uint8_t i) { return frame[i] == 0; });
     }
 
     // isType3or5 returns true if the image is a triangle or a trapezoid pointing to
     // the right.
     bool CelDecoder::isType3or5(FrameBytesRef frame)
     {
+        return std::all_of(type3or5ZeroPositions.begin(), type3or5ZeroPositions.end(), [&frame](uint8_t i) { return frame[i] == 0; });
+    }
 
-        std::vector<int> zeroPositions = {2, 3, 14, 15, 34, 35, 62, 63, 98, 99, 142, 143, 194, 195, 254, 255};
-        for (int i : zeroPositions)
+    void CelDecoder::decodeFrameReference(FrameType type, FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame)
+    {
+        switch (type)
         {
-            if (frame[i] != 0)
-                return false;
+            case FrameType::Type0:
+                return decodeFrameType0(frame, pal, decodedFrame);
+            case FrameType::Type1:
+                return decodeFrameType1(frame, pal, decodedFrame);
+            case FrameType::Type2:
+                return decodeFrameType2(frame, pal, decodedFrame);
+            case FrameType::Type3:
+                return decodeFrameType3(frame, pal, decodedFrame);
+            case FrameType::Type4:
+                return decodeFrameType4(frame, pal, decodedFrame);
+            case FrameType::Type5:
+                return decodeFrameType5(frame, pal, decodedFrame);
+            case FrameType::Type6:
+                return decodeFrameType6(frame, pal, decodedFrame);
         }
 
-        return true;
+        invalid_enum(FrameType, type);
     }
 
     // DecodeFrameType0 returns an image after decoding the frame in the following
@@ -790,6 +816,216 @@ namespace Cel
         }
     }
 
+    namespace
+    {
+        void expandPaletteIndices(const uint8_t* source, const Colour* palette, Colour* dest, int32_t count)
+        {
+            // Palette entries are a single 32 bit word, so this is just a table lookup and a store per pixel.
+            // There's no gather before AVX2, so unrolling is the best we can do without raising the minimum cpu.
+            int32_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                dest[i + 0] = palette[source[i + 0]];
+                dest[i + 1] = palette[source[i + 1]];
+                dest[i + 2] = palette[source[i + 2]];
+                dest[i + 3] = palette[source[i + 3]];
+            }
+
+            for (; i < count; i++)
+                dest[i] = palette[source[i]];
+        }
+
+        // Writes pixels in the same order as a flipped XYIterator (left to right, bottom row first), but a whole span at a time.
+        // Anything that would go past the top of the image is dropped.
+        class SpanWriter
+        {
+        public:
+            explicit SpanWriter(CelFrame& frame) : mData(frame.mData.data()), mWidth(frame.width()), mRow(frame.width() > 0 ? frame.height() - 1 : -1) {}
+
+            bool done() const { return mRow < 0; }
+
+            void transparent(int32_t count)
+            {
+                write(count, [](Colour* dest, int32_t spanSize) { memset(static_cast<void*>(dest), 0, spanSize * sizeof(Colour)); });
+            }
+
+            void fill(Colour colour, int32_t count)
+            {
+                write(count, [colour](Colour* dest, int32_t spanSize) { std::fill_n(dest, spanSize, colour); });
+            }
+
+            void paletteIndices(const uint8_t* source, const Pal& pal, int32_t count)
+            {
+                write(count, [&source, &pal](Colour* dest, int32_t spanSize) {
+                    expandPaletteIndices(source, pal.data(), dest, spanSize);
+                    source += spanSize;
+                });
+            }
+
+        private:
+            template <typename WriteSpan> void write(int32_t count, WriteSpan&& writeSpan)
+            {
+                while (count > 0 && mRow >= 0)
+                {
+                    int32_t spanSize = std::min(count, mWidth - mX);
+                    writeSpan(mData + mRow * mWidth + mX, spanSize);
+
+                    count -= spanSize;
+                    mX += spanSize;
+                    if (mX == mWidth)
+                    {
+                        mX = 0;
+                        mRow--;
+                    }
+                }
+            }
+
+        private:
+            Colour* mData = nullptr;
+            int32_t mWidth = 0;
+            int32_t mX = 0;
+            int32_t mRow = 0;
+        };
+
+        void decodeFrameType0Fast(CelDecoder::FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame)
+        {
+            for (int32_t y = 0; y < decodedFrame.height(); y++)
+            {
+                int32_t lineStartIndex = int32_t(frame.size()) - decodedFrame.width() * (y + 1);
+                expandPaletteIndices(frame.data() + lineStartIndex, pal.data(), &decodedFrame.mData.get(0, y), decodedFrame.width());
+            }
+        }
+
+        void decodeFrameType1Fast(CelDecoder::FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame)
+        {
+            SpanWriter writer(decodedFrame);
+
+            int32_t len = frame.size();
+            for (int32_t pos = 0; pos < len && !writer.done();)
+            {
+                int32_t chunkSize = int32_t(int8_t(frame[pos]));
+                pos++;
+
+                if (chunkSize < 0)
+                {
+                    writer.transparent(-chunkSize);
+                }
+                else
+                {
+                    writer.paletteIndices(frame.data() + pos, pal, std::min(chunkSize, len - pos));
+                    pos += chunkSize;
+                }
+            }
+        }
+
+        void decodeFrameType6Fast(CelDecoder::FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame)
+        {
+            SpanWriter writer(decodedFrame);
+
+            // Stopping when the image is full also skips the rubbish on the end of some broken cl2s, as in decodeFrameType6
+            int32_t len = frame.size();
+            for (int32_t pos = 0; pos < len && !writer.done();)
+            {
+                int32_t chunkSize = int32_t(int8_t(frame[pos]));
+                pos++;
+
+                if (chunkSize >= 0)
+                {
+                    writer.transparent(chunkSize);
+                }
+                else if (-chunkSize <= 65)
+                {
+                    writer.paletteIndices(frame.data() + pos, pal, std::min(-chunkSize, len - pos));
+                    pos += -chunkSize;
+                }
+                else if (pos < len)
+                {
+                    writer.fill(pal[frame[pos]], -chunkSize - 65);
+                    pos++;
+                }
+            }
+        }
+
+        void decodeTileLineFast(const uint8_t*& framePtr, const Pal& pal, SpanWriter& writer, int32_t regularCount, bool transparentLeft)
+        {
+            int32_t transparentCount = 32 - regularCount;
+
+            if (transparentLeft)
+            {
+                writer.transparent(transparentCount);
+                writer.paletteIndices(framePtr, pal, regularCount);
+            }
+            else
+            {
+                // decodeLineTransparencyRight leaves green in its transparent pixels, so we do too
+                writer.paletteIndices(framePtr, pal, regularCount);
+                writer.fill(Colour(0, 255, 0, false), transparentCount);
+            }
+
+            framePtr += regularCount;
+        }
+
+        void decodeFrameType2or3Fast(CelDecoder::FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame, bool frameType2)
+        {
+            SpanWriter writer(decodedFrame);
+            const uint8_t* framePtr = frame.data();
+
+            for (int32_t row = 0; row <= 32; row++)
+            {
+                if (row == 15)
+                    row++;
+
+                // Type 2 has two padding bytes on even rows of the top half and odd rows of the bottom, type 3 the other way around
+                bool typeTwoPadding = (row < 16) == (row % 2 == 0);
+                if (typeTwoPadding == frameType2)
+                    framePtr += 2;
+
+                int32_t regularCount = row < 16 ? 2 + (row * 2) : 32 - ((row - 16) * 2);
+                decodeTileLineFast(framePtr, pal, writer, regularCount, frameType2);
+            }
+        }
+
+        void decodeFrameType4or5Fast(CelDecoder::FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame, bool frameType4)
+        {
+            SpanWriter writer(decodedFrame);
+            const uint8_t* framePtr = frame.data();
+
+            for (int32_t row = 0; row < 15; row++)
+            {
+                if ((row % 2 == 0) == frameType4)
+                    framePtr += 2;
+
+                decodeTileLineFast(framePtr, pal, writer, 2 + (row * 2), frameType4);
+            }
+
+            if (frame.size() > 256)
+                writer.paletteIndices(frame.data() + 256, pal, int32_t(frame.size()) - 256);
+        }
+    }
+
+    void CelDecoder::decodeFrameFast(FrameType type, FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame)
+    {
+        switch (type)
+        {
+            case FrameType::Type0:
+                return decodeFrameType0Fast(frame, pal, decodedFrame);
+            case FrameType::Type1:
+                return decodeFrameType1Fast(frame, pal, decodedFrame);
+            case FrameType::Type2:
+                return decodeFrameType2or3Fast(frame, pal, decodedFrame, true);
+            case FrameType::Type3:
+                return decodeFrameType2or3Fast(frame, pal, decodedFrame, false);
+            case FrameType::Type4:
+                return decodeFrameType4or5Fast(frame, pal, decodedFrame, true);
+            case FrameType::Type5:
+                return decodeFrameType4or5Fast(frame, pal, decodedFrame, false);
+            case FrameType::Type6:
+                return decodeFrameType6Fast(frame, pal, decodedFrame);
+        }
+
+        invalid_enum(FrameType, type);
+    }
+
     void CelDecoder::setObjcursCelDimensions(int frameNumber)
     {
         mFrameWidth = 56;
@@ -1,7 +1,6 @@
 #pragma once
 #include "celframe.h"
 #include "pal.h"
-#include <functional>
 #include <map>
 #include <settings/settings.h>
 #include <stdint.h>
@@ -15,31 +14,53 @@ namespace Cel
     class CelDecoder
     {
     public:
+        typedef std::vector<uint8_t> FrameBytes;
+        typedef const std::vector<uint8_t>& FrameBytesRef;
+
+        // See the comments on the decodeFrameTypeN functions for what each type looks like
+        enum class FrameType : uint8_t
+        {
+            Type0,
+            Type1,
+            Type2,
+            Type3,
+            Type4,
+            Type5,
+            Type6,
+        };
+
         explicit CelDecoder(std::string celPath);
         std::vector<Image> decode();
+        std::vector<Image> decodeReference(); ///< Same as decode, but through the original pixel-at-a-time decoders
         int32_t numFrames() const;
         int32_t animationLength() const;
 
         static void loadConfigFiles();
 
+        // The palette a cel file is decoded with, which is picked from its path
+        static std::string getPalettePath(const std::string& celPath);
+
+        // Decodes whole spans at a time, writing straight into the rows of decodedFrame
+        static void decodeFrameFast(FrameType type, FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame);
+        // The original decoders, kept as a reference for the fast ones
+        static void decodeFrameReference(FrameType type, FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame);
+
     private:
-        typedef std::vector<uint8_t> FrameBytes;
-        typedef const std::vector<uint8_t>& FrameBytesRef;
         typedef std::vector<Colour>& ColoursRef;
         typedef std::vector<Colour>::iterator ColoursRefIterator;
-        typedef std::function<void(FrameBytesRef, const Pal&, CelFrame&)> FrameDecoder;
 
         void readConfiguration();
         void readCelName();
         void readPalette();
         void getFrames();
-        void decodeFrame(int32_t index, FrameBytesRef frame, CelFrame& celFrame);
+        std::vector<Image> decode(bool reference);
+        void decodeFrame(int32_t index, FrameBytesRef frame, CelFrame& celFrame, bool reference);
+        FrameType getFrameType(FrameBytesRef frame, int32_t frameNumber) const;
         void setObjcursCelDimensions(int frame);
         void setCharbutCelDimensions(int frame);
 
     private:
-        static FrameDecoder getFrameDecoder(const std::string& celName, FrameBytesRef frame, int frameNumber);
-        static bool isType0(const std::string& celName, int frameNumber);
+        static bool isType0(int32_t tilesetCelIndex, int32_t frameNumber);
         static bool isType2or4(FrameBytesRef frame);
         static bool isType3or5(FrameBytesRef frame);
         static void decodeFrameType0(FrameBytesRef frame, const Pal& pal, CelFrame& decodedFrame);
@@ -61,6 +82,8 @@ namespace Cel
         Pal mPal;
         bool mIsObjcursCel = false;
         bool mIsCharbutCel = false;
+        bool mIsCl2 = false;
+        int32_t mTilesetCelIndex = -1; ///< Index into the tileset cel table in celdecoder.cpp, or -1 if this isn't one of the level tilesets
         int mImageCount = 0;
         int mFrameWidth = 0;
         int mFrameHeight = 0;
@@ -0,0 +1,139 @@
+#include "decodedimagecache.h"
+#include <cel/celdecoder.h>
+#include <misc/stringops.h>
+
+namespace Cel
+{
+    DecodedImageCache::DecodedImageCache() : DecodedImageCache(decodeFile) {}
+
+    DecodedImageCache::DecodedImageCache(Decoder decoder) : mDecoder(std::move(decoder)) {}
+
+    void DecodedImageCache::expectUse(const std::string& path)
+    {
+        std::scoped_lock lock(mMutex);
+
+        std::shared_ptr<Entry>& entry = mEntries[getKey(path)];
+        if (!entry)
+            entry = std::make_shared<Entry>();
+
+        entry->remainingUses++;
+    }
+
+    std::shared_ptr<const DecodedImageCache::DecodedImages> DecodedImageCache::share(const std::string& path) { return acquire(path); }
+
+    DecodedImageCache::DecodedImages DecodedImageCache::take(const std::string& path)
+    {
+        std::shared_ptr<DecodedImages> images = acquire(path);
+
+        // Once an entry is dropped from the map nobody can get a new reference to it, so if ours is the only one left we can have the frames
+        if (images.use_count() == 1)
+            return std::move(*images);
+
+        DecodedImages copy;
+        copy.animationLength = images->animationLength;
+        copy.frames.reserve(images->frames.size());
+
+        for (const Image& frame : images->frames)
+        {
+            Image& frameCopy = copy.frames.emplace_back(frame.width(), frame.height());
+            frame.blitTo(frameCopy, 0, 0);
+        }
+
+        return copy;
+    }
+
+    std::shared_ptr<DecodedImageCache::DecodedImages> DecodedImageCache::acquire(const std::string& path)
+    {
+        std::string key = getKey(path);
+
+        std::unique_lock lock(mMutex);
+
+        std::shared_ptr<Entry>& slot = mEntries[key];
+        if (!slot)
+            slot = std::make_shared<Entry>();
+
+        // Our own reference, as the map slot can go away while we don't hold the lock
+        std::shared_ptr<Entry> entry = slot;
+
+        while (!entry->images)
+        {
+            if (!entry->decoding)
+            {
+                entry->decoding = true;
+                lock.unlock();
+
+                std::shared_ptr<DecodedImages> images;
+                try
+                {
+                    images = std::make_shared<DecodedImages>(mDecoder(path));
+                }
+                catch (...)
+                {
+                    // Wake the waiters so one of them can have a go, rather than leaving them waiting for a decode that will never finish
+                    lock.lock();
+                    entry->decoding = false;
+                    mDecoded.notify_all();
+                    release(key, entry);
+                    throw;
+                }
+
+                lock.lock();
+                entry->images = std::move(images);
+                entry->decoding = false;
+                mDecoded.notify_all();
+                break;
+            }
+
+            entry->waiters++;
+            mDecoded.wait(lock, [&entry] { return entry->images || !entry->decoding; });
+            entry->waiters--;
+        }
+
+        std::shared_ptr<DecodedImages> images = entry->images;
+        release(key, entry);
+
+        return images;
+    }
+
+    void DecodedImageCache::release(const std::string& key, const std::shared_ptr<Entry>& entry)
+    {
+        entry->remainingUses--;
+        if (entry->remainingUses > 0 || entry->waiters > 0)
+            return;
+
+        auto it = mEntries.find(key);
+        if (it != mEntries.end() && it->second == entry)
+            mEntries.erase(it);
+    }
+
+    DecodedImageCache::DecodedImages DecodedImageCache::decodeFile(const std::string& path)
+    {
+        DecodedImages images;
+
+        std::string extension = Misc::StringUtils::getFileExtension(path);
+        if (Misc::StringUtils::ciEqual(extension, "cel") || Misc::StringUtils::ciEqual(extension, "cl2"))
+        {
+            CelDecoder decoder(path);
+            images.frames = decoder.decode();
+            images.animationLength = decoder.animationLength();
+        }
+        else
+        {
+            images.frames.push_back(Image::loadFromFile(path));
+        }
+
+        return images;
+    }
+
+    std::string DecodedImageCache::getKey(const std::string& path)
+    {
+        std::string key = Misc::StringUtils::lowerCase(path);
+        Misc::StringUtils::replace(key, "\\", "/");
+
+        std::string extension = Misc::StringUtils::getFileExtension(path);
+        if (Misc::StringUtils::ciEqual(extension, "cel") || Misc::StringUtils::ciEqual(extension, "cl2"))
+            key += "|" + CelDecoder::getPalettePath(path);
+
+        return key;
+    }
+}
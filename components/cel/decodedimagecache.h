@@ -0,0 +1,64 @@
+#pragma once
+#include <Image/image.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Cel
+{
+    /**
+     * @brief Decoded frames of source image files (cel, cl2 or anything Image::loadFromFile reads), shared between users on any thread.
+     *
+     * Entries are keyed by the normalised path and the palette the file decodes with. They are reference counted against the
+     * number of uses announced with expectUse, so each file is decoded once and freed as soon as its last expected user has it.
+     * Files that weren't announced are simply decoded and not kept.
+     */
+    class DecodedImageCache
+    {
+    public:
+        struct DecodedImages
+        {
+            std::vector<Image> frames;
+            int32_t animationLength = 1;
+        };
+
+        typedef std::function<DecodedImages(const std::string&)> Decoder;
+
+        DecodedImageCache();
+        explicit DecodedImageCache(Decoder decoder);
+
+        void expectUse(const std::string& path);
+
+        // Both of these count as one use. If another thread is already decoding the file, they wait for it rather than decoding it again.
+        // If the decoder throws, the exception goes to the caller that was decoding, and anyone waiting on it tries the decode again.
+        std::shared_ptr<const DecodedImages> share(const std::string& path);
+        DecodedImages take(const std::string& path); ///< Moves the frames out when nobody else can use them any more, otherwise copies them
+
+        static DecodedImages decodeFile(const std::string& path);
+        static std::string getKey(const std::string& path);
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<DecodedImages> images;
+            bool decoding = false;
+            int32_t remainingUses = 0;
+            int32_t waiters = 0;
+        };
+
+        std::shared_ptr<DecodedImages> acquire(const std::string& path);
+        void release(const std::string& key, const std::shared_ptr<Entry>& entry); ///< Called with mMutex held, once per acquire
+
+    private:
+        Decoder mDecoder;
+        std::mutex mMutex;
+        std::condition_variable mDecoded;
+        // Entries are shared so each acquire can hold on to its own, and an entry is only dropped from the map once nobody is waiting on it
+        std::unordered_map<std::string, std::shared_ptr<Entry>> mEntries;
+    };
+}
@@ -1,5 +1,8 @@
 #include "pal.h"
-#include <faio/fafileobject.h>
+#include <algorithm>
+#include <cstring>
+#include <faio/faio.h>
+#include <misc/assert.h>
 
 namespace Cel
 {
@@ -7,16 +10,21 @@ namespace Cel
 
     Pal::Pal(const std::string& filename) : Pal()
     {
-        FAIO::FAFileObject pal_file(filename);
+        FAIO::FileBuffer data = FAIO::readWholeFile(filename);
+        std::vector<uint8_t> bytes(256 * 3);
+        if (data)
+            memcpy(bytes.data(), data->data(), std::min(data->size(), bytes.size()));
 
         for (int i = 0; i < 256; i++)
         {
-            pal_file.FAfread(&contents[i].r, 1, 1);
-            pal_file.FAfread(&contents[i].g, 1, 1);
-            pal_file.FAfread(&contents[i].b, 1, 1);
+            contents[i].r = bytes[i * 3];
+            contents[i].g = bytes[i * 3 + 1];
+            contents[i].b = bytes[i * 3 + 2];
             contents[i].a = 255;
         }
     }
 
+    Pal::Pal(std::vector<Colour> colours) : contents(std::move(colours)) { release_assert(contents.size() == 256); }
+
     const Colour& Pal::operator[](size_t index) const { return contents[index]; }
 }
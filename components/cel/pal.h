@@ -13,8 +13,10 @@ namespace Cel
     public:
         Pal();
         explicit Pal(const std::string& filename);
+        explicit Pal(std::vector<Colour> colours);
 
         const Colour& operator[](size_t index) const;
+        const Colour* data() const { return contents.data(); } ///< All 256 entries, for decoders that expand whole spans at once
 
     private:
         std::vector<Colour> contents;
@@ -4,14 +4,17 @@
 
 namespace Cel
 {
-    static void drawMinPillar(CelFrame& frame, int x, int y, const std::vector<int16_t>& pillar, std::vector<Image>& tilesetCel, TilesetImagePart part);
-    static void drawMinTile(CelFrame& frame, std::vector<Image>& tilesetCel, int x, int y, int16_t leftImageIndex, int16_t rightImageIndex);
+    static void drawMinPillar(CelFrame& frame, int x, int y, const std::vector<int16_t>& pillar, const std::vector<Image>& tilesetCel, TilesetImagePart part);
+    static void drawMinTile(CelFrame& frame, const std::vector<Image>& tilesetCel, int x, int y, int16_t leftImageIndex, int16_t rightImageIndex);
 
     std::vector<CelFrame> loadTilesetImage(const std::string& celPath, const std::string& minPath, TilesetImagePart part)
     {
         CelFile tilesetCelDecoder(celPath);
-        std::vector<Image> tilesetCel = tilesetCelDecoder.decode();
+        return loadTilesetImage(tilesetCelDecoder.decode(), minPath, part);
+    }
 
+    std::vector<CelFrame> loadTilesetImage(const std::vector<Image>& tilesetCel, const std::string& minPath, TilesetImagePart part)
+    {
         Level::Min min(minPath);
 
         std::vector<CelFrame> retval;
@@ -26,7 +29,7 @@ namespace Cel
         return retval;
     }
 
-    static void drawMinPillar(CelFrame& frame, int x, int y, const std::vector<int16_t>& pillar, std::vector<Image>& tilesetCel, TilesetImagePart part)
+    static void drawMinPillar(CelFrame& frame, int x, int y, const std::vector<int16_t>& pillar, const std::vector<Image>& tilesetCel, TilesetImagePart part)
     {
         // compensate for maps using 5-row min files
         if (pillar.size() == 10)
@@ -63,7 +66,7 @@ namespace Cel
         }
     }
 
-    static void drawMinTile(CelFrame& frame, std::vector<Image>& tilesetCel, int x, int y, int16_t leftImageIndex, int16_t rightImageIndex)
+    static void drawMinTile(CelFrame& frame, const std::vector<Image>& tilesetCel, int x, int y, int16_t leftImageIndex, int16_t rightImageIndex)
     {
         if (leftImageIndex != -1)
             tilesetCel[leftImageIndex].blitTo(frame, x, y);
@@ -10,4 +10,6 @@ namespace Cel
         Whole
     };
     std::vector<CelFrame> loadTilesetImage(const std::string& celPath, const std::string& minPath, TilesetImagePart part);
+    // Builds the pillars from an already decoded level cel, so the top and bottom parts can share one decode
+    std::vector<CelFrame> loadTilesetImage(const std::vector<Image>& tilesetCel, const std::string& minPath, TilesetImagePart part);
 }
\ No newline at end of file
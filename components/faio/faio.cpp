@@ -1,9 +1,14 @@
 #include "faio.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <filesystem/path.h>
 #include <iostream>
+#include <memory>
 #include <misc/assert.h>
 #include <misc/stringops.h>
 #include <mutex>
+#include <thread>
 
 namespace bfs = filesystem;
 
@@ -18,12 +23,71 @@ namespace FAIO
     FAFile::FAFile() {}
 
     const std::string DIABDAT_MPQ = "DIABDAT.MPQ";
-    std::mutex m;
 
     // StormLib needs paths with windows style \'s
     std::string getStormLibPath(const bfs::path& path) { return path.str(filesystem::path::path_type::windows_path); }
 
-    HANDLE diabdat = NULL;
+    // A StormLib archive handle can only be used by one thread at a time, so we keep a few handles to the same MPQ and
+    // hand them out to threads round robin, rather than queueing every thread up behind one handle.
+    struct Archive
+    {
+        std::mutex mutex;
+        HANDLE handle = NULL;
+    };
+
+    std::string mpqPath;
+    std::string mpqListFile;
+    std::vector<std::unique_ptr<Archive>> archives;
+    std::atomic<size_t> nextArchive = 0;
+
+    // The MPQ never changes while we're running, so files from it can be cached. Plain files are left alone, as someone might be editing them.
+    FileCache mpqFileCache(32 * 1024 * 1024);
+
+    // Opening an archive isn't safe to do concurrently (it sets up some global tables in StormLib), so only one thread does it at a time
+    std::mutex openMutex;
+
+    HANDLE openArchive(Archive& archive)
+    {
+        if (archive.handle == NULL)
+        {
+            std::lock_guard<std::mutex> lock(openMutex);
+
+            if (!SFileOpenArchive(mpqPath.c_str(), 0, STREAM_FLAG_READ_ONLY, &archive.handle))
+            {
+                std::cerr << "Failed to open " << mpqPath << " with error " << GetLastError() << std::endl;
+                archive.handle = NULL;
+                return NULL;
+            }
+
+            if (!mpqListFile.empty())
+                SFileAddListFile(archive.handle, mpqListFile.c_str());
+        }
+
+        return archive.handle;
+    }
+
+    // Calls func with an archive handle that no other thread is using, preferring the calling thread's own one, but
+    // taking any free handle before waiting for a busy one.
+    template <typename Func> auto withArchive(Func&& func)
+    {
+        if (archives.empty())
+            return func(HANDLE(NULL));
+
+        thread_local size_t preferred = nextArchive++;
+
+        for (size_t i = 0; i < archives.size(); i++)
+        {
+            Archive& archive = *archives[(preferred + i) % archives.size()];
+
+            std::unique_lock<std::mutex> lock(archive.mutex, std::try_to_lock);
+            if (lock.owns_lock())
+                return func(openArchive(archive));
+        }
+
+        Archive& archive = *archives[preferred % archives.size()];
+        std::lock_guard<std::mutex> lock(archive.mutex);
+        return func(openArchive(archive));
+    }
 
     bool init(const std::string pathMPQ, const std::string listFile)
     {
@@ -33,44 +97,56 @@ namespace FAIO
             return true;
         }
 
-        const bool success = SFileOpenArchive(pathMPQ.c_str(), 0, STREAM_FLAG_READ_ONLY, &diabdat);
+        quit();
 
-        if (!success)
+        mpqPath = pathMPQ;
+        mpqListFile = listFile;
+
+        size_t archiveCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8);
+        for (size_t i = 0; i < archiveCount; i++)
+            archives.push_back(std::make_unique<Archive>());
+
+        // Open one handle now so we can report a missing MPQ, the others are opened as threads need them
+        if (openArchive(*archives[0]) == NULL)
         {
-            std::cerr << "Failed to open " << pathMPQ.c_str() << " with error " << GetLastError() << std::endl;
+            archives.clear();
+            return false;
         }
 
-        if (!listFile.empty())
-            SFileAddListFile(diabdat, listFile.c_str());
-
-        return success;
+        return true;
     }
 
     std::vector<std::string> listMpqFiles(const std::string& pattern)
     {
-        SFILE_FIND_DATA findFileData;
-        HANDLE findHandle = SFileFindFirstFile(diabdat, pattern.c_str(), &findFileData, NULL);
+        return withArchive([&](HANDLE archive) {
+            SFILE_FIND_DATA findFileData;
+            HANDLE findHandle = SFileFindFirstFile(archive, pattern.c_str(), &findFileData, NULL);
 
-        std::vector<std::string> results;
+            std::vector<std::string> results;
 
-        results.push_back(findFileData.cFileName);
-
-        while (SFileFindNextFile(findHandle, &findFileData))
-        {
             results.push_back(findFileData.cFileName);
-        }
 
-        SFileFindClose(findHandle);
+            while (SFileFindNextFile(findHandle, &findFileData))
+            {
+                results.push_back(findFileData.cFileName);
+            }
+
+            SFileFindClose(findHandle);
 
-        return results;
+            return results;
+        });
     }
 
     void quit()
     {
-        if (NULL != diabdat)
+        for (auto& archive : archives)
         {
-            SFileCloseArchive(diabdat);
+            if (NULL != archive->handle)
+                SFileCloseArchive(archive->handle);
         }
+
+        archives.clear();
+        mpqFileCache.clear();
     }
 
     bool exists(const std::string& filename)
@@ -78,13 +154,12 @@ namespace FAIO
         if (bfs::exists(filename))
             return true;
 
-        std::lock_guard<std::mutex> lock(m);
         std::string stormPath = getStormLibPath(filename);
 
-        return SFileHasFile(diabdat, stormPath.c_str());
+        return withArchive([&](HANDLE archive) { return bool(SFileHasFile(archive, stormPath.c_str())); });
     }
 
-    FAFile* FAfopen(const std::string& filename)
+    void abortIfBroken(const std::string& filename)
     {
         if (Misc::StringUtils::endsWith(filename, "banner2.dun") || Misc::StringUtils::endsWith(filename, "dmagew.cl2") ||
             Misc::StringUtils::endsWith(filename, "unravw.cel"))
@@ -94,31 +169,85 @@ namespace FAIO
                                   "https://github.com/mewrnd/blizzconv/blob/master/cmd/mpqfix/mpqfix.go for more information",
                                   filename.c_str());
         }
+    }
 
-        bfs::path path(filename);
-
-        if (!bfs::exists(path))
-        {
-            std::lock_guard<std::mutex> lock(m);
-            std::string stormPath = getStormLibPath(path);
+    FileBuffer readMpqFile(const std::string& filename)
+    {
+        std::string stormPath = getStormLibPath(filename);
 
-            if (!SFileHasFile(diabdat, stormPath.c_str()))
+        return withArchive([&](HANDLE archive) -> FileBuffer {
+            if (!SFileHasFile(archive, stormPath.c_str()))
             {
-                std::cerr << "File " << path << " not found" << std::endl;
-                return NULL;
+                std::cerr << "File " << filename << " not found" << std::endl;
+                return nullptr;
             }
 
-            FAFile* file = new FAFile();
-            file->data.mpqFile = malloc(sizeof(HANDLE));
-
-            if (!SFileOpenFileEx(diabdat, stormPath.c_str(), 0, (HANDLE*)file->data.mpqFile))
+            HANDLE mpqFile = NULL;
+            if (!SFileOpenFileEx(archive, stormPath.c_str(), 0, &mpqFile))
             {
                 std::cerr << "Failed to open " << filename << " in " << DIABDAT_MPQ;
-                delete file;
-                return NULL;
+                return nullptr;
             }
 
-            file->mode = FAFile::FAFileMode::MPQFile;
+            DWORD fileSize = SFileGetFileSize(mpqFile, NULL);
+            if (fileSize == SFILE_INVALID_SIZE)
+                fileSize = 0;
+
+            std::vector<uint8_t> data(fileSize);
+
+            DWORD dwBytes = 0;
+            if (!data.empty() && !SFileReadFile(mpqFile, data.data(), DWORD(data.size()), &dwBytes, NULL))
+                std::cout << "Error reading from file, error code: " << GetLastError() << std::endl;
+
+            data.resize(dwBytes);
+            SFileCloseFile(mpqFile);
+
+            return std::make_shared<const std::vector<uint8_t>>(std::move(data));
+        });
+    }
+
+    FileBuffer readCachedMpqFile(const std::string& filename)
+    {
+        // Paths in the MPQ are case insensitive and can use either slash
+        std::string key = Misc::StringUtils::lowerCase(filename);
+        std::replace(key.begin(), key.end(), '\\', '/');
+
+        return mpqFileCache.get(key, [&] { return readMpqFile(filename); });
+    }
+
+    FileBuffer readWholeFile(const std::string& filename)
+    {
+        abortIfBroken(filename);
+
+        if (!bfs::exists(filename))
+            return readCachedMpqFile(filename);
+
+        FILE* plainFile = fopen(filename.c_str(), "rb");
+        if (plainFile == NULL)
+            return nullptr;
+
+        std::vector<uint8_t> data(bfs::path(filename).file_size());
+        data.resize(fread(data.data(), 1, data.size(), plainFile));
+        fclose(plainFile);
+
+        return std::make_shared<const std::vector<uint8_t>>(std::move(data));
+    }
+
+    FAFile* FAfopen(const std::string& filename)
+    {
+        abortIfBroken(filename);
+
+        bfs::path path(filename);
+
+        if (!bfs::exists(path))
+        {
+            FileBuffer data = readCachedMpqFile(filename);
+            if (!data)
+                return NULL;
+
+            FAFile* file = new FAFile();
+            file->mode = FAFile::FAFileMode::ResidentFile;
+            file->residentData = std::move(data);
 
             return file;
         }
@@ -130,8 +259,8 @@ namespace FAIO
 
             FAFile* file = new FAFile();
             file->mode = FAFile::FAFileMode::PlainFile;
-            file->data.plainFile.file = plainFile;
-            file->data.plainFile.filename = new std::string(filename);
+            file->plainFile = plainFile;
+            file->plainFilename = filename;
 
             return file;
         }
@@ -142,27 +271,20 @@ namespace FAIO
         switch (stream->mode)
         {
             case FAFile::FAFileMode::PlainFile:
-                return fread(ptr, size, count, stream->data.plainFile.file);
+                return fread(ptr, size, count, stream->plainFile);
 
-            case FAFile::FAFileMode::MPQFile:
+            case FAFile::FAFileMode::ResidentFile:
             {
-                std::lock_guard<std::mutex> lock(m);
+                // Like reading from StormLib, reads that go over the end of the file are truncated and return the number of bytes read
+                const std::vector<uint8_t>& data = *stream->residentData;
+                size_t position = std::min(stream->residentPosition, data.size());
+                size_t bytes = std::min(size * count, data.size() - position);
 
-                DWORD dwBytes = 1;
-                if (!SFileReadFile(*((HANDLE*)stream->data.mpqFile), ptr, size * count, &dwBytes, NULL))
-                {
-                    int errorCode = GetLastError();
-
-                    // if the error code is ERROR_HANDLE_EOF, it's not really an error,
-                    // we just requested a read that goes over the end of the file.
-                    // The normal fread behaviour in this case is to truncate the read to fit within
-                    // the file, and return the actual number of bytes read, which we do,
-                    // so there is no need to print an error message.
-                    if (errorCode != ERROR_HANDLE_EOF)
-                        std::cout << "Error reading from file, error code: " << errorCode << std::endl;
-                }
+                if (bytes)
+                    memcpy(ptr, data.data() + position, bytes);
 
-                return dwBytes;
+                stream->residentPosition = position + bytes;
+                return bytes;
             }
         }
         return 0;
@@ -172,28 +294,8 @@ namespace FAIO
     {
         int retval = 0;
 
-        switch (stream->mode)
-        {
-            case FAFile::FAFileMode::PlainFile:
-            {
-                delete stream->data.plainFile.filename;
-                retval = fclose(stream->data.plainFile.file);
-                break;
-            }
-
-            case FAFile::FAFileMode::MPQFile:
-            {
-                std::lock_guard<std::mutex> lock(m);
-
-                int res = SFileCloseFile(*((HANDLE*)stream->data.mpqFile));
-                free(stream->data.mpqFile);
-
-                if (res != 0)
-                    retval = EOF;
-
-                break;
-            }
-        }
+        if (stream->mode == FAFile::FAFileMode::PlainFile)
+            retval = fclose(stream->plainFile);
 
         delete stream;
 
@@ -205,36 +307,29 @@ namespace FAIO
         switch (stream->mode)
         {
             case FAFile::FAFileMode::PlainFile:
-                return fseek(stream->data.plainFile.file, offset, origin);
+                return fseek(stream->plainFile, offset, origin);
 
-            case FAFile::FAFileMode::MPQFile:
+            case FAFile::FAFileMode::ResidentFile:
             {
-                std::lock_guard<std::mutex> lock(m);
-                DWORD moveMethod;
-
                 switch (origin)
                 {
                     case SEEK_SET:
-                        moveMethod = FILE_BEGIN;
+                        stream->residentPosition = offset;
                         break;
 
                     case SEEK_CUR:
-                        moveMethod = FILE_CURRENT;
+                        stream->residentPosition += offset;
                         break;
 
                     case SEEK_END:
-                        moveMethod = FILE_END;
+                        stream->residentPosition = stream->residentData->size() + offset;
                         break;
 
                     default:
                         return 1; // error, incorrect origin
                 }
 
-                SFileSetFilePointer(*((HANDLE*)stream->data.mpqFile), offset, NULL, moveMethod);
-                int nError = ERROR_SUCCESS;
-                nError = GetLastError();
-
-                return nError != ERROR_SUCCESS;
+                return 0;
             }
         }
 
@@ -246,13 +341,10 @@ namespace FAIO
         switch (stream->mode)
         {
             case FAFile::FAFileMode::PlainFile:
-                return ftell(stream->data.plainFile.file);
+                return ftell(stream->plainFile);
 
-            case FAFile::FAFileMode::MPQFile:
-            {
-                std::lock_guard<std::mutex> lock(m);
-                return SFileSetFilePointer(*((HANDLE*)stream->data.mpqFile), 0, NULL, FILE_CURRENT);
-            }
+            case FAFile::FAFileMode::ResidentFile:
+                return stream->residentPosition;
 
             default:
                 return 0;
@@ -264,13 +356,10 @@ namespace FAIO
         switch (stream->mode)
         {
             case FAFile::FAFileMode::PlainFile:
-                return bfs::path(*(stream->data.plainFile.filename)).file_size();
+                return bfs::path(stream->plainFilename).file_size();
 
-            case FAFile::FAFileMode::MPQFile:
-            {
-                std::lock_guard<std::mutex> lock(m);
-                return SFileGetFileSize(*((HANDLE*)stream->data.mpqFile), NULL);
-            }
+            case FAFile::FAFileMode::ResidentFile:
+                return stream->residentData->size();
         }
 
         return 0;
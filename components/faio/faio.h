@@ -1,4 +1,5 @@
 #pragma once
+#include "filecache.h"
 #include <cstdint>
 #include <cstdio>
 #include <string>
@@ -7,27 +8,25 @@
 // The functions in this header are designed to behave roughly like the normal fopen, fread family.
 // The difference is, if FAfopen is called on a file that doesn't exist, it will try to use StormLib
 // to open it in the MPQ file DIABDAT.MPQ.
+// All of them are safe to call from multiple threads at once, as long as each FAFile is only used by one thread at a time.
 
 namespace FAIO
 {
-    // A FILE* like container for either a normal FILE*, or a StormLib HANDLE
+    // A FILE* like container for either a normal FILE*, or the contents of a file from the MPQ.
+    // MPQ files are read whole when they are opened, so reading, seeking and getting the size of one never touches StormLib.
     struct FAFile
     {
     private:
-        union FAFileUnion
-        {
-            struct
-            {
-                FILE* file;
-                std::string* filename;
-            } plainFile;
-            void* mpqFile; // This is a pointer to a StormLib HANDLE type, I jist didn't want to #include StormLib here
-        } data;
+        FILE* plainFile = nullptr;
+        std::string plainFilename;
+
+        FileBuffer residentData;
+        size_t residentPosition = 0;
 
         enum class FAFileMode
         {
             PlainFile,
-            MPQFile
+            ResidentFile
         } mode;
 
         FAFile();
@@ -46,6 +45,11 @@ namespace FAIO
     void quit();
 
     bool exists(const std::string& filename);
+
+    // Reads the whole of a file into memory. Files from the MPQ are kept in an LRU cache of recently read files, so reading
+    // the same one again (and FAfopen, which uses this for MPQ files) doesn't decompress it again. Returns null if the file can't be read.
+    FileBuffer readWholeFile(const std::string& filename);
+
     FAFile* FAfopen(const std::string& filename);
     size_t FAfread(void* ptr, size_t size, size_t count, FAFile* stream);
     int FAfclose(FAFile* stream);
@@ -0,0 +1,62 @@
+#include "filecache.h"
+
+namespace FAIO
+{
+    FileCache::FileCache(size_t maxBytes) : mMaxBytes(maxBytes) {}
+
+    FileBuffer FileCache::get(const std::string& key, const std::function<FileBuffer()>& load)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto it = mLookup.find(key);
+            if (it != mLookup.end())
+            {
+                mEntries.splice(mEntries.begin(), mEntries, it->second);
+                return it->second->second;
+            }
+        }
+
+        FileBuffer buffer = load();
+        if (!buffer || buffer->size() > mMaxBytes / 4)
+            return buffer;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Another thread might have loaded the same file while we were
+        auto it = mLookup.find(key);
+        if (it != mLookup.end())
+        {
+            mEntries.splice(mEntries.begin(), mEntries, it->second);
+            return it->second->second;
+        }
+
+        mEntries.emplace_front(key, buffer);
+        mLookup[key] = mEntries.begin();
+        mBytes += buffer->size();
+
+        while (mBytes > mMaxBytes)
+        {
+            mBytes -= mEntries.back().second->size();
+            mLookup.erase(mEntries.back().first);
+            mEntries.pop_back();
+        }
+
+        return buffer;
+    }
+
+    void FileCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mEntries.clear();
+        mLookup.clear();
+        mBytes = 0;
+    }
+
+    size_t FileCache::sizeInBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mBytes;
+    }
+}
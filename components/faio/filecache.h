@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace FAIO
+{
+    // The whole contents of a file. It's immutable, so one buffer can be handed out to any number of readers at once.
+    typedef std::shared_ptr<const std::vector<uint8_t>> FileBuffer;
+
+    // A thread safe cache of whole files that drops the least recently used ones once it holds more than maxBytes.
+    class FileCache
+    {
+    public:
+        explicit FileCache(size_t maxBytes);
+
+        // Returns the cached buffer for key, or the result of calling load if it isn't cached.
+        // load is called without the cache locked, so different threads can load different files at the same time.
+        // Null results, and buffers bigger than a quarter of the cache, are passed through without being cached.
+        FileBuffer get(const std::string& key, const std::function<FileBuffer()>& load);
+
+        void clear();
+
+        size_t sizeInBytes() const;
+        size_t maxBytes() const { return mMaxBytes; }
+
+    private:
+        typedef std::list<std::pair<std::string, FileBuffer>> Entries;
+
+        mutable std::mutex mMutex;
+        size_t mMaxBytes = 0;
+        size_t mBytes = 0;
+        Entries mEntries; ///< most recently used first
+        std::unordered_map<std::string, Entries::iterator> mLookup;
+    };
+}
@@ -1,5 +1,6 @@
 #include "dun.h"
-#include <faio/fafileobject.h>
+#include <cstring>
+#include <faio/faio.h>
 #include <iostream>
 #include <misc/stringops.h>
 #include <serial/loader.h>
@@ -10,14 +11,16 @@ namespace Level
 {
     Dun::Dun(const std::string& filename)
     {
-        FAIO::FAFileObject f(filename);
+        FAIO::FileBuffer file = FAIO::readWholeFile(filename);
+        release_assert(file && file->size() >= 4);
 
         int16_t width, height;
-        f.FAfread(&width, 2, 1);
-        f.FAfread(&height, 2, 1);
+        memcpy(&width, file->data(), 2);
+        memcpy(&height, file->data() + 2, 2);
 
         std::vector<int16_t> buf(width * height);
-        f.FAfread(buf.data(), 2, width * height);
+        release_assert(file->size() >= 4 + buf.size() * 2);
+        memcpy(buf.data(), file->data() + 4, buf.size() * 2);
 
         std::vector<int32_t> data(buf.size());
         std::copy(buf.begin(), buf.end(), data.begin());
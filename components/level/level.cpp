@@ -1,4 +1,5 @@
 #include "level.h"
+#include <atomic>
 #include <iostream>
 #include <serial/loader.h>
 
@@ -16,15 +17,15 @@ namespace Level
                  const LevelTransitionArea& downStairs,
                  std::map<int32_t, int32_t> doorMap)
         : mTilesetId(tilesetId), mTilesetCelPath(tileSetPath), mSpecialCelPath(specialCelPath), mSpecialCelMap(specialCelMap), mTilPath(tilPath),
-          mMinPath(minPath), mSolPath(solPath), mDun(std::move(dun)), mTil(mTilPath), mMin(mMinPath), mSol(mSolPath), mDoorMap(doorMap), mUpStairs(upStairs),
-          mDownStairs(downStairs)
+          mMinPath(minPath), mSolPath(solPath), mDun(std::move(dun)), mTilesetData(TilesetData::get(mTilPath, mMinPath, mSolPath)), mDoorMap(doorMap),
+          mUpStairs(upStairs), mDownStairs(downStairs)
     {
     }
 
     Level::Level(Serial::Loader& loader)
         : mTilesetId(loader.load<int32_t>()), mTilesetCelPath(loader.load<std::string>()), mSpecialCelPath(loader.load<std::string>()),
-          mTilPath(loader.load<std::string>()), mMinPath(loader.load<std::string>()), mSolPath(loader.load<std::string>()), mDun(loader), mTil(mTilPath),
-          mMin(mMinPath), mSol(mSolPath)
+          mTilPath(loader.load<std::string>()), mMinPath(loader.load<std::string>()), mSolPath(loader.load<std::string>()), mDun(loader),
+          mTilesetData(TilesetData::get(mTilPath, mMinPath, mSolPath))
     {
         uint32_t specialCelMapSize = loader.load<uint32_t>();
         for (uint32_t i = 0; i < specialCelMapSize; i++)
@@ -128,9 +129,9 @@ namespace Level
         if (dunIndex == -1)
             return MinPillar(Level::mEmpty, 0, -1);
 
-        int32_t minIndex = mTil[dunIndex][locationData.tilIndex];
+        int32_t minIndex = mTilesetData->til()[dunIndex][locationData.tilIndex];
 
-        return MinPillar(mMin[minIndex], mSol.passable(minIndex), minIndex);
+        return MinPillar(mTilesetData->min()[minIndex], mTilesetData->sol().passable(minIndex), minIndex);
     }
 
     bool Level::isDoor(const Misc::Point& point) const
@@ -145,8 +146,9 @@ namespace Level
             // open doors when clicked on
             if (mDoorMap.find(dunIndex) != mDoorMap.end())
             {
-                bool passableNow = mSol.passable(mTil[dunIndex - 1][locationData.tilIndex]);
-                bool passableWhenToggled = mSol.passable(mTil[mDoorMap.at(dunIndex) - 1][locationData.tilIndex]);
+                const TileSet& til = mTilesetData->til();
+                bool passableNow = mTilesetData->sol().passable(til[dunIndex - 1][locationData.tilIndex]);
+                bool passableWhenToggled = mTilesetData->sol().passable(til[mDoorMap.at(dunIndex) - 1][locationData.tilIndex]);
 
                 // Only mark the tile(s) that actually change as a door tile
                 return passableNow != passableWhenToggled;
@@ -177,6 +179,7 @@ namespace Level
             if (mDoorMap.find(index) != mDoorMap.end())
             {
                 mDun.get(xDunIndex, yDunIndex) = mDoorMap[index];
+                mTileRevision = newTileRevision();
                 return true;
             }
         }
@@ -184,6 +187,12 @@ namespace Level
         return false;
     }
 
+    uint32_t Level::newTileRevision()
+    {
+        static std::atomic<uint32_t> nextTileRevision = 0;
+        return ++nextTileRevision;
+    }
+
     int32_t Level::width() const { return mDun.width() * 2; }
 
     int32_t Level::height() const { return mDun.height() * 2; }
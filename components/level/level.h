@@ -2,9 +2,9 @@
 #include "baseitemmanager.h"
 #include "dun.h"
 #include "min.h"
-#include "sol.h"
-#include "tileset.h"
+#include "tilesetdata.h"
 #include <map>
+#include <memory>
 #include <misc/misc.h>
 #include <utility>
 
@@ -79,6 +79,10 @@ namespace Level
         bool isDoor(const Misc::Point& point) const;
         bool activateDoor(const Misc::Point& point); /// @return If the door was activated
 
+        /// Changes whenever any tile of this level changes (doors opening), and is unique across all Level instances,
+        /// so renderers can cache geometry built from the tiles and only revalidate it when this changes.
+        uint32_t getTileRevision() const { return mTileRevision; }
+
         MinPillar get(const Misc::Point& point) const;
 
         int32_t width() const;
@@ -102,6 +106,7 @@ namespace Level
         };
 
         InternalLocationData getInternalLocationData(const Misc::Point& point) const;
+        static uint32_t newTileRevision();
 
     private:
         int32_t mTilesetId = 0;
@@ -113,15 +118,15 @@ namespace Level
         std::string mSolPath;                      ///< path to sol file for this level
 
         Dun mDun;
-        TileSet mTil;
-        Min mMin;
-        Sol mSol;
+        std::shared_ptr<const TilesetData> mTilesetData; ///< shared with every other level using the same til, min and sol files
 
         std::map<int32_t, int32_t> mDoorMap; ///< Map from closed door indices to open door indices + vice-versa
 
         LevelTransitionArea mUpStairs;
         LevelTransitionArea mDownStairs;
 
+        uint32_t mTileRevision = newTileRevision();
+
         static std::vector<int16_t> mEmpty;
     };
 }
@@ -1,12 +1,15 @@
 #include "min.h"
-#include <faio/fafileobject.h>
+#include <cstring>
+#include <faio/faio.h>
 #include <misc/stringops.h>
 
 namespace Level
 {
     Min::Min(const std::string& filename)
     {
-        FAIO::FAFileObject minF(filename);
+        FAIO::FileBuffer data = FAIO::readWholeFile(filename);
+        if (!data)
+            return;
 
         size_t minSize;
         // These two files contain 16 blocks, all else are 10. Nothing to do but a workaround...
@@ -15,14 +18,13 @@ namespace Level
         else
             minSize = 10;
 
-        size_t numPillars = minF.FAsize() / (minSize * 2);
-
-        minF.FAfseek(0, SEEK_SET);
+        size_t numPillars = data->size() / (minSize * 2);
+        mPillars.reserve(numPillars);
 
         for (size_t i = 0; i < numPillars; i++)
         {
             std::vector<int16_t> temp(minSize);
-            minF.FAfread(&temp[0], 2, minSize);
+            memcpy(temp.data(), data->data() + i * minSize * 2, minSize * 2);
             mPillars.emplace_back(std::move(temp));
         }
     }
@@ -1,15 +1,13 @@
 #include "sol.h"
-#include <faio/fafileobject.h>
+#include <faio/faio.h>
 
 namespace Level
 {
     Sol::Sol(const std::string& path)
     {
-        FAIO::FAFileObject solF(path);
-        size_t size = solF.FAsize();
-        mData.resize(size);
-
-        solF.FAfread(&mData[0], 1, size);
+        FAIO::FileBuffer data = FAIO::readWholeFile(path);
+        if (data)
+            mData = *data;
     }
 
     bool Sol::passable(size_t index) const
@@ -1,23 +1,23 @@
 #include "tileset.h"
-#include <stdio.h>
-
-#include <faio/fafileobject.h>
+#include <cstring>
+#include <faio/faio.h>
 
 namespace Level
 {
     TileSet::TileSet(const std::string& filename)
     {
-        FAIO::FAFileObject tFile(filename);
-
-        size_t numBlocks = tFile.FAsize() / (4 * 2);
+        FAIO::FileBuffer data = FAIO::readWholeFile(filename);
+        if (!data)
+            return;
 
-        tFile.FAfseek(0, SEEK_SET);
+        size_t numBlocks = data->size() / (4 * 2);
+        mBlocks.reserve(numBlocks);
 
         TilBlock tmp(4);
 
         for (size_t i = 0; i < numBlocks; i++)
         {
-            tFile.FAfread(&tmp[0], 2, 4);
+            memcpy(tmp.data(), data->data() + i * 4 * 2, 4 * 2);
             mBlocks.push_back(tmp);
         }
     }
@@ -0,0 +1,31 @@
+#include "tilesetdata.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace Level
+{
+    TilesetData::TilesetData(const std::string& tilPath, const std::string& minPath, const std::string& solPath)
+        : mTil(tilPath), mMin(minPath), mSol(solPath)
+    {
+    }
+
+    std::shared_ptr<const TilesetData> TilesetData::get(const std::string& tilPath, const std::string& minPath, const std::string& solPath)
+    {
+        static std::mutex mutex;
+        static std::map<std::tuple<std::string, std::string, std::string>, std::weak_ptr<const TilesetData>> loaded;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::weak_ptr<const TilesetData>& entry = loaded[{tilPath, minPath, solPath}];
+        std::shared_ptr<const TilesetData> data = entry.lock();
+
+        if (!data)
+        {
+            data = std::make_shared<const TilesetData>(tilPath, minPath, solPath);
+            entry = data;
+        }
+
+        return data;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "min.h"
+#include "sol.h"
+#include "tileset.h"
+#include <memory>
+#include <string>
+
+namespace Level
+{
+    /// The til, min and sol data for one dungeon type. It never changes once loaded, so every level of the same type shares one copy.
+    class TilesetData
+    {
+    public:
+        TilesetData(const std::string& tilPath, const std::string& minPath, const std::string& solPath);
+
+        /// Returns the data already loaded for these paths if any level is still using it, otherwise loads it. Safe to call from any thread.
+        static std::shared_ptr<const TilesetData> get(const std::string& tilPath, const std::string& minPath, const std::string& solPath);
+
+        const TileSet& til() const { return mTil; }
+        const Min& min() const { return mMin; }
+        const Sol& sol() const { return mSol; }
+
+    private:
+        TileSet mTil;
+        Min mMin;
+        Sol mSol;
+    };
+}
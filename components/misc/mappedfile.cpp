@@ -0,0 +1,93 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Misc
+{
+#ifdef _WIN32
+    MappedFile::MappedFile(const filesystem::path& path)
+    {
+        HANDLE file = CreateFileW(path.wstr().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        mFileHandle = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+            return;
+
+        mSize = size_t(size.QuadPart);
+        mOpen = true;
+
+        // Zero sized files can't be mapped, but they're still valid files
+        if (mSize == 0)
+            return;
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            mOpen = false;
+            return;
+        }
+
+        mMappingHandle = mapping;
+        mData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        mOpen = mData != nullptr;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (mData)
+            UnmapViewOfFile(mData);
+        if (mMappingHandle)
+            CloseHandle(mMappingHandle);
+        if (mFileHandle)
+            CloseHandle(mFileHandle);
+    }
+#else
+    MappedFile::MappedFile(const filesystem::path& path)
+    {
+        int fd = open(path.str().c_str(), O_RDONLY);
+        if (fd == -1)
+            return;
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0)
+        {
+            mSize = size_t(fileStat.st_size);
+
+            // Zero sized files can't be mapped, but they're still valid files
+            if (mSize == 0)
+            {
+                mOpen = true;
+            }
+            else
+            {
+                void* mapped = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED)
+                {
+                    mData = static_cast<const uint8_t*>(mapped);
+                    mOpen = true;
+                }
+            }
+        }
+
+        // The mapping stays valid after the descriptor is closed
+        close(fd);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (mData)
+            munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem/path.h>
+
+namespace Misc
+{
+    // Read-only memory mapping of a whole file, so it can be parsed in place without copying it into a buffer first.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() const { return mOpen; }
+        const uint8_t* data() const { return mData; }
+        size_t size() const { return mSize; }
+
+    private:
+        bool mOpen = false;
+        const uint8_t* mData = nullptr;
+        size_t mSize = 0;
+
+#ifdef _WIN32
+        void* mFileHandle = nullptr;
+        void* mMappingHandle = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "fixedpoint.h"
+#include "simplevec2.h"
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace Misc
+{
+    // Builds a 64 bit digest of game state, so two simulations can be compared without serialising them.
+    // Values are mixed in order, so callers must visit things in a deterministic order. Not cryptographic, and only
+    // meant to be compared between machines running the same build.
+    class StateHasher
+    {
+    public:
+        template <typename T> std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>> add(T value) { mix(uint64_t(value)); }
+
+        void add(FixedPoint value) { mix(uint64_t(value.rawValue())); }
+
+        template <typename T> void add(const Vec2<T>& value)
+        {
+            add(value.x);
+            add(value.y);
+        }
+
+        void add(const std::string& value)
+        {
+            add(value.size());
+            for (char c : value)
+                mix(uint64_t(uint8_t(c)));
+        }
+
+        uint64_t getHash() const { return mHash; }
+
+    private:
+        void mix(uint64_t value)
+        {
+            // boost::hash_combine, with the splitmix64 finaliser as the value hash
+            value += 0x9E3779B97F4A7C15ull;
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+            value ^= value >> 31;
+
+            mHash ^= value + 0x9E3779B97F4A7C15ull + (mHash << 6) + (mHash >> 2);
+        }
+
+        uint64_t mHash = 0;
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Misc
+{
+    /// Lock free handoff of the latest value from one producer thread to one consumer thread, using three slots.
+    /// The producer always has a slot of its own to write into and the consumer always gets the newest published slot,
+    /// so neither side ever waits for the other. Slots are reused rather than reset, so containers in them keep their capacity.
+    template <typename T> class TripleBuffer
+    {
+    public:
+        /// Each slot is constructed from args
+        template <typename... Args> explicit TripleBuffer(Args&&... args) : mSlots{{T(args...), T(args...), T(args...)}} {}
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        /// Producer only. Contains whatever was last written into this slot, not what was last published.
+        T& getWriteSlot() { return mSlots[mWriteIndex]; }
+
+        /// Producer only. Hands the write slot over to the consumer, replacing any published slot it hasn't picked up yet.
+        void publish() { mWriteIndex = mShared.exchange(mWriteIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK; }
+
+        /// Consumer only. Picks up the newest published slot, if there is one since the last call.
+        /// @return The newest published value, which stays untouched by the producer until the next call, or nullptr if nothing has been published yet
+        T* acquireLatest()
+        {
+            if (mShared.load(std::memory_order_relaxed) & FRESH_BIT)
+            {
+                mReadIndex = mShared.exchange(mReadIndex, std::memory_order_acq_rel) & INDEX_MASK;
+                mHasRead = true;
+            }
+
+            return mHasRead ? &mSlots[mReadIndex] : nullptr;
+        }
+
+    private:
+        static constexpr uint32_t INDEX_MASK = 3;
+        static constexpr uint32_t FRESH_BIT = 4;
+
+        std::array<T, 3> mSlots;
+
+        // Each of these is only touched by one side (or atomically), so keep them on separate cache lines
+        alignas(64) std::atomic<uint32_t> mShared = 1;
+        alignas(64) uint32_t mWriteIndex = 0;
+        alignas(64) uint32_t mReadIndex = 2;
+        bool mHasRead = false;
+    };
+}
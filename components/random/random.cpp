@@ -1,6 +1,7 @@
 #include "random.h"
 #include <locale>
 #include <misc/assert.h>
+#include <misc/statehash.h>
 #include <serial/loader.h>
 #include <sstream>
 
@@ -30,6 +31,16 @@ namespace Random
         saver.save(rngStr);
     }
 
+    void RngMersenneTwister::hashState(Misc::StateHasher& hasher) const
+    {
+        // The engine doesn't expose its state directly, so hash the same text the savegame stores, which is all 624 words plus the position
+        std::stringstream ss;
+        ss.imbue(std::locale::classic());
+        ss << mRng;
+
+        hasher.add(ss.str());
+    }
+
     // This should generate random numbers weighted towards min, ie, if you were to generate a bunch of samples
     // between eg 0 and 5, and plot them in a histogram, it should look roughly like:
     // 0: ************
@@ -12,6 +12,11 @@ namespace Serial
     class Saver;
 }
 
+namespace Misc
+{
+    class StateHasher;
+}
+
 namespace Random
 {
     class Rng
@@ -26,6 +31,7 @@ namespace Random
 
         virtual void load(Serial::Loader& loader) = 0;
         virtual void save(Serial::Saver& saver) const = 0;
+        virtual void hashState(Misc::StateHasher& hasher) const = 0;
 
         template <typename T> T chooseOne(std::initializer_list<T> parameters)
         {
@@ -51,6 +57,7 @@ namespace Random
 
         virtual void load(Serial::Loader& loader) override;
         virtual void save(Serial::Saver& saver) const override;
+        virtual void hashState(Misc::StateHasher& hasher) const override;
 
         virtual int32_t squaredRand(int32_t min, int32_t max) override;
         virtual int32_t randomInRange(int32_t min, int32_t max) override;
@@ -69,6 +76,7 @@ namespace Random
 
         virtual void load(Serial::Loader&) override { message_and_abort("cannot load DummRng"); }
         virtual void save(Serial::Saver&) const override { message_and_abort("cannot save DummRng"); }
+        virtual void hashState(Misc::StateHasher&) const override {}
 
         static DummyRng instance;
 
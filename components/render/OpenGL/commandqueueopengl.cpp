@@ -33,6 +33,7 @@ namespace Render
                 case DescriptorType::Texture:
                 {
                     auto texture = safe_downcast<TextureOpenGL*>(std::get<Texture*>(item.item));
+                    texture->resolvePendingData();
                     mBinders.emplace_back(texture, GL_TEXTURE0 + pipeline->getUniformLocation(bindingIndex));
                     break;
                 }
@@ -115,7 +116,7 @@ namespace Render
         glClear(clearFlags);
     }
 
-    void CommandQueueOpenGL::cmdPresent() { SDL_GL_SwapWindow(&getInstance().mWindow); }
+    void CommandQueueOpenGL::cmdPresent() { SDL_GL_SwapWindow(getInstance().mWindow); }
 
     std::unique_ptr<CommandQueueOpenGL::DrawScopedBinderGL> CommandQueueOpenGL::setupState(Bindings& bindings)
     {
@@ -23,14 +23,14 @@ namespace Render
     }
 #endif
 
-    RenderInstanceOpenGL::RenderInstanceOpenGL(SDL_Window& window) : super(window)
+    RenderInstanceOpenGL::RenderInstanceOpenGL(SDL_Window& window) : super(&window)
     {
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
         SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
-        mGlContext = SDL_GL_CreateContext(&mWindow);
+        mGlContext = SDL_GL_CreateContext(mWindow);
 
         if (!gladLoadGL())
             message_and_abort("gladLoadGL failed");
@@ -20,6 +20,11 @@ namespace Render
                 format = GL_RGBA;
                 type = GL_UNSIGNED_BYTE;
                 break;
+            case Format::R8UNorm:
+                internalFormat = GL_R8;
+                format = GL_RED;
+                type = GL_UNSIGNED_BYTE;
+                break;
             case Format::RGBA32F:
                 internalFormat = GL_RGBA32F;
                 format = GL_RGBA;
@@ -70,25 +75,29 @@ namespace Render
 
     TextureOpenGL::~TextureOpenGL() { glDeleteTextures(1, &mId); }
 
-    void
-    TextureOpenGL::updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* rgba8UnormData, int32_t pitchInPixels)
+    void TextureOpenGL::updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* data, int32_t pitchInPixels)
     {
         ScopedBindGL thisBind(this);
 
+        GLenum format = getPixelFormat();
         glPixelStorei(GL_UNPACK_ROW_LENGTH, pitchInPixels);
 
         if (isTextureArray())
-            glTexSubImage3D(getBindPoint(), 0, x, y, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba8UnormData);
+            glTexSubImage3D(getBindPoint(), 0, x, y, layer, width, height, 1, format, GL_UNSIGNED_BYTE, data);
         else
-            glTexSubImage2D(getBindPoint(), 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba8UnormData);
+            glTexSubImage2D(getBindPoint(), 0, x, y, width, height, format, GL_UNSIGNED_BYTE, data);
     }
 
-    void TextureOpenGL::readImageData(uint8_t* rgba8UnormDestination)
+    void TextureOpenGL::readImageData(uint8_t* destination)
     {
-        release_assert(mInfo.format == Format::RGBA8UNorm);
-
         ScopedBindGL thisBind(this);
-        glGetTexImage(getBindPoint(), 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba8UnormDestination);
+        glGetTexImage(getBindPoint(), 0, getPixelFormat(), GL_UNSIGNED_BYTE, destination);
+    }
+
+    GLenum TextureOpenGL::getPixelFormat() const
+    {
+        release_assert(mInfo.format == Format::RGBA8UNorm || mInfo.format == Format::R8UNorm);
+        return mInfo.format == Format::R8UNorm ? GL_RED : GL_RGBA;
     }
 
     void TextureOpenGL::setFilter(Filter minFilter, Filter magFilter)
@@ -15,8 +15,8 @@ namespace Render
         TextureOpenGL(RenderInstanceOpenGL& instance, const BaseTextureInfo& info);
         ~TextureOpenGL() override;
 
-        void updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* rgba8UnormData, int32_t pitchInPixels) override;
-        void readImageData(uint8_t* rgba8UnormDestination) override;
+        void updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* data, int32_t pitchInPixels) override;
+        void readImageData(uint8_t* destination) override;
 
         void setFilter(Filter minFilter, Filter magFilter) override;
 
@@ -26,6 +26,7 @@ namespace Render
 
     private:
         GLenum getBindPoint() const;
+        GLenum getPixelFormat() const; ///< The client side format of image data, for the formats updateImageData supports
         bool isTextureArray() const { return mInfo.arrayLayers > 1 || mInfo.forceTextureToBeATextureArray; }
 
     private:
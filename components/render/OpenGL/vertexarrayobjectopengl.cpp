@@ -52,6 +52,11 @@ namespace Render
                     normalized = GL_TRUE;
                     size = 4;
                     break;
+                case Format::R8UNorm:
+                    type = GL_UNSIGNED_BYTE;
+                    normalized = GL_TRUE;
+                    size = 1;
+                    break;
                 case Format::RGBA32F:
                     type = GL_FLOAT;
                     normalized = GL_FALSE;
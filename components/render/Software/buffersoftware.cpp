@@ -0,0 +1,15 @@
+#include <cstring>
+#include <render/Software/buffersoftware.h>
+
+namespace Render
+{
+    BufferSoftware::BufferSoftware(size_t sizeInBytes) : super(sizeInBytes) { mData.reserve(sizeInBytes); }
+
+    void BufferSoftware::setData(void* data, size_t dataSizeInBytes)
+    {
+        // Like the OpenGL backend, buffers are resized to fit whatever is uploaded.
+        mData.resize(dataSizeInBytes);
+        if (dataSizeInBytes)
+            memcpy(mData.data(), data, dataSizeInBytes);
+    }
+}
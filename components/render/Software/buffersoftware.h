@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <render/buffer.h>
+#include <vector>
+
+namespace Render
+{
+    class BufferSoftware final : public Buffer
+    {
+        using super = Buffer;
+
+    public:
+        explicit BufferSoftware(size_t sizeInBytes);
+        ~BufferSoftware() override = default;
+
+        void setData(void* data, size_t dataSizeInBytes) override;
+
+        const uint8_t* data() const { return mData.data(); }
+        size_t dataSize() const { return mData.size(); }
+
+    private:
+        std::vector<uint8_t> mData;
+    };
+}
@@ -0,0 +1,585 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <render/Software/buffersoftware.h>
+#include <render/Software/commandqueuesoftware.h>
+#include <render/Software/descriptorsetsoftware.h>
+#include <render/Software/pipelinesoftware.h>
+#include <render/Software/texturesoftware.h>
+#include <render/Software/vertexarrayobjectsoftware.h>
+#include <render/framebuffer.h>
+#include <render/vertextypes.h>
+
+namespace Render
+{
+    using SoftwareRaster::RasterTriangle;
+    using SoftwareRaster::Rect;
+    using SoftwareRaster::RenderTarget;
+
+    // Draws covering fewer pixels than this are rasterised on the calling thread, waking the workers would cost more than it saves
+    static constexpr int64_t PARALLEL_DRAW_MIN_PIXELS = 128 * 128;
+
+    namespace
+    {
+        // These mirror the std140 uniform blocks declared in resources/shaders
+        struct SpriteVertexUniforms
+        {
+            float screenSizeInPixels[2];
+            float offsetInPixels[2];
+        };
+
+        struct FullscreenVertexUniforms
+        {
+            float scaleOrigin[2];
+            float scale;
+            float pad;
+        };
+
+        struct GuiVertexUniforms
+        {
+            float projection[4][4];
+        };
+
+        struct GuiFragmentUniforms
+        {
+            float hoverColor[4];
+            float imageSize[2];
+            float atlasSize[2];
+            float atlasOffset[2];
+            float checkerboarded;
+            float pad;
+        };
+
+        class VertexFetcher
+        {
+        public:
+            static constexpr size_t MAX_ATTRIBUTES = 8;
+
+            VertexFetcher(const VertexArrayObjectSoftware& vao, size_t bindingIndex)
+                : mLayout(*vao.getBindings()[bindingIndex]), mBuffer(vao.getVertexBufferSoftware(bindingIndex))
+            {
+                release_assert(mLayout.getElements().size() <= MAX_ATTRIBUTES);
+            }
+
+            /// Reads every attribute of a vertex as floats, converting them the same way the OpenGL backend's attribute pointers do.
+            void fetch(size_t vertexIndex, float attributes[][4]) const
+            {
+                size_t stride = mLayout.getSizeInBytes();
+                release_assert((vertexIndex + 1) * stride <= mBuffer.dataSize());
+
+                const uint8_t* data = mBuffer.data() + vertexIndex * stride;
+                for (size_t i = 0; i < mLayout.getElements().size(); i++)
+                {
+                    Format format = mLayout.getElements()[i];
+                    readAttribute(data, format, attributes[i]);
+                    data += formatSize(format);
+                }
+            }
+
+        private:
+            template <typename T> static void readComponents(const uint8_t* data, int32_t count, float scale, float* destination)
+            {
+                for (int32_t i = 0; i < count; i++)
+                {
+                    T value;
+                    memcpy(&value, data + i * sizeof(T), sizeof(T));
+                    destination[i] = float(value) * scale;
+                }
+            }
+
+            static void readAttribute(const uint8_t* data, Format format, float destination[4])
+            {
+                destination[0] = destination[1] = destination[2] = 0.0f;
+                destination[3] = 1.0f;
+
+                switch (format)
+                {
+                    case Format::RGBA8UNorm:
+                        return readComponents<uint8_t>(data, 4, 1.0f / 255.0f, destination);
+                    case Format::R8UNorm:
+                        return readComponents<uint8_t>(data, 1, 1.0f / 255.0f, destination);
+                    case Format::RGBA32F:
+                        return readComponents<float>(data, 4, 1.0f, destination);
+                    case Format::RGB32F:
+                        return readComponents<float>(data, 3, 1.0f, destination);
+                    case Format::RG32F:
+                        return readComponents<float>(data, 2, 1.0f, destination);
+                    case Format::R32F:
+                        return readComponents<float>(data, 1, 1.0f, destination);
+                    case Format::RGBA16U:
+                        return readComponents<uint16_t>(data, 4, 1.0f, destination);
+                    case Format::RGB16U:
+                        return readComponents<uint16_t>(data, 3, 1.0f, destination);
+                    case Format::RG16U:
+                        return readComponents<uint16_t>(data, 2, 1.0f, destination);
+                    case Format::RGBA16I:
+                        return readComponents<int16_t>(data, 4, 1.0f, destination);
+                    case Format::RGB16I:
+                        return readComponents<int16_t>(data, 3, 1.0f, destination);
+                    case Format::RG16I:
+                        return readComponents<int16_t>(data, 2, 1.0f, destination);
+                    case Format::Depth24Stencil8:
+                        break;
+                }
+
+                invalid_enum(Format, format);
+            }
+
+        private:
+            const VertexLayout& mLayout;
+            const BufferSoftware& mBuffer;
+        };
+
+        /// Samples a texture at a position given in texels rather than normalised coordinates, using its magnification filter.
+        void sampleTexture(const TextureSoftware& texture, float x, float y, float rgba[4])
+        {
+            debug_assert(texture.getInfo().format == Format::RGBA8UNorm);
+
+            auto fetch = [&](int32_t texelX, int32_t texelY) -> uint32_t {
+                if (texelX < 0 || texelY < 0 || texelX >= texture.width() || texelY >= texture.height())
+                    return 0;
+                return texture.colorData()[size_t(texelY) * size_t(texture.width()) + size_t(texelX)];
+            };
+
+            if (texture.getInfo().magFilter == Filter::Nearest)
+            {
+                SoftwareRaster::unpackColor(fetch(int32_t(std::floor(x)), int32_t(std::floor(y))), rgba);
+                return;
+            }
+
+            x -= 0.5f;
+            y -= 0.5f;
+            float floorX = std::floor(x);
+            float floorY = std::floor(y);
+            float fractionX = x - floorX;
+            float fractionY = y - floorY;
+            int32_t texelX = int32_t(floorX);
+            int32_t texelY = int32_t(floorY);
+
+            float texels[4][4];
+            SoftwareRaster::unpackColor(fetch(texelX, texelY), texels[0]);
+            SoftwareRaster::unpackColor(fetch(texelX + 1, texelY), texels[1]);
+            SoftwareRaster::unpackColor(fetch(texelX, texelY + 1), texels[2]);
+            SoftwareRaster::unpackColor(fetch(texelX + 1, texelY + 1), texels[3]);
+
+            for (int32_t i = 0; i < 4; i++)
+            {
+                float top = texels[0][i] + (texels[1][i] - texels[0][i]) * fractionX;
+                float bottom = texels[2][i] + (texels[3][i] - texels[2][i]) * fractionX;
+                rgba[i] = top + (bottom - top) * fractionY;
+            }
+        }
+
+        // CPU versions of the shader programs. shadeVertex outputs a position in normalised device coordinates.
+
+        struct GuiProgram
+        {
+            static constexpr int32_t VARYING_COUNT = 6;
+
+            GuiVertexUniforms vertexUniforms = {};
+            GuiFragmentUniforms fragmentUniforms = {};
+            const TextureSoftware* texture = nullptr;
+
+            void shadeVertex(const float attributes[][4], float position[2], float* varyings) const
+            {
+                const float(&matrix)[4][4] = vertexUniforms.projection;
+                float x = attributes[0][0];
+                float y = attributes[0][1];
+
+                float w = matrix[0][3] * x + matrix[1][3] * y + matrix[3][3];
+                position[0] = (matrix[0][0] * x + matrix[1][0] * y + matrix[3][0]) / w;
+                position[1] = (matrix[0][1] * x + matrix[1][1] * y + matrix[3][1]) / w;
+
+                varyings[0] = attributes[1][0];
+                varyings[1] = attributes[1][1];
+                for (int32_t i = 0; i < 4; i++)
+                    varyings[2 + i] = attributes[2][i];
+            }
+
+            bool shadeFragment(const float* varyings, const RasterTriangle&, float rgba[4], float&) const
+            {
+                const GuiFragmentUniforms& uniforms = fragmentUniforms;
+
+                float texelX = uniforms.atlasOffset[0] + varyings[0] * uniforms.imageSize[0];
+                float texelY = uniforms.atlasOffset[1] + varyings[1] * uniforms.imageSize[1];
+
+                float texel[4];
+                sampleTexture(*texture, texelX, texelY, texel);
+                for (int32_t i = 0; i < 4; i++)
+                    rgba[i] = varyings[2 + i] * texel[i];
+
+                if (rgba[3] == 0.0f && uniforms.hoverColor[3] > 0.0f)
+                {
+                    for (int32_t offsetX = -1; offsetX <= 1; offsetX++)
+                    {
+                        for (int32_t offsetY = -1; offsetY <= 1; offsetY++)
+                        {
+                            float neighbour[4];
+                            sampleTexture(*texture, texelX + float(offsetX), texelY + float(offsetY), neighbour);
+                            if (neighbour[3] > 0.0f && (neighbour[0] > 0.0f || neighbour[1] > 0.0f || neighbour[2] > 0.0f))
+                                std::copy_n(uniforms.hoverColor, 4, rgba);
+                        }
+                    }
+                }
+
+                if (uniforms.checkerboarded != 0.0f)
+                {
+                    float sum = std::floor(varyings[0] * uniforms.imageSize[0]) + std::floor(varyings[1] * uniforms.imageSize[1]);
+                    // GLSL mod(), which is always positive
+                    if (sum - 2.0f * std::floor(sum / 2.0f) == 1.0f)
+                        rgba[3] = 0.0f;
+                }
+
+                return true;
+            }
+        };
+
+        struct FullscreenProgram
+        {
+            static constexpr int32_t VARYING_COUNT = 2;
+
+            FullscreenVertexUniforms vertexUniforms = {};
+            const TextureSoftware* texture = nullptr;
+
+            void shadeVertex(const float attributes[][4], float position[2], float* varyings) const
+            {
+                for (int32_t i = 0; i < 2; i++)
+                {
+                    float origin = vertexUniforms.scaleOrigin[i];
+                    position[i] = (attributes[0][i] - origin) * vertexUniforms.scale + origin;
+                    varyings[i] = attributes[1][i];
+                }
+            }
+
+            bool shadeFragment(const float* varyings, const RasterTriangle&, float rgba[4], float&) const
+            {
+                sampleTexture(*texture, varyings[0] * float(texture->width()), varyings[1] * float(texture->height()), rgba);
+                return true;
+            }
+        };
+
+        struct DebugProgram
+        {
+            static constexpr int32_t VARYING_COUNT = 4;
+
+            void shadeVertex(const float attributes[][4], float position[2], float* varyings) const
+            {
+                position[0] = attributes[0][0] * 2.0f - 1.0f;
+                position[1] = -(attributes[0][1] * 2.0f - 1.0f);
+
+                for (int32_t i = 0; i < 4; i++)
+                    varyings[i] = attributes[1][i];
+            }
+
+            bool shadeFragment(const float* varyings, const RasterTriangle&, float rgba[4], float&) const
+            {
+                std::copy_n(varyings, 4, rgba);
+                return true;
+            }
+        };
+    }
+
+    static const DescriptorSet::Item& findDescriptor(Bindings& bindings, const char* glName)
+    {
+        auto descriptorSet = safe_downcast<DescriptorSetSoftware*>(bindings.descriptorSet);
+        release_assert(descriptorSet);
+
+        const auto& specItems = descriptorSet->getSpec().items;
+        for (uint32_t bindingIndex = 0; bindingIndex < specItems.size(); bindingIndex++)
+        {
+            if (specItems[bindingIndex].glName == glName)
+                return descriptorSet->getItem(bindingIndex);
+        }
+
+        message_and_abort_fmt("Descriptor \"%s\" is missing from the bound descriptor set\n", glName);
+    }
+
+    template <typename T> static T readUniforms(Bindings& bindings, const char* glName)
+    {
+        const BufferSlice& slice = std::get<BufferSlice>(findDescriptor(bindings, glName).item);
+        auto buffer = safe_downcast<const BufferSoftware*>(slice.buffer);
+        release_assert(slice.offset + sizeof(T) <= buffer->dataSize());
+
+        T uniforms;
+        memcpy(&uniforms, buffer->data() + slice.offset, sizeof(T));
+        return uniforms;
+    }
+
+    static const TextureSoftware* getTexture(Bindings& bindings, const char* glName)
+    {
+        auto texture = safe_downcast<TextureSoftware*>(std::get<Texture*>(findDescriptor(bindings, glName).item));
+        release_assert(texture && !texture->isDepth());
+        texture->resolvePendingData();
+        return texture;
+    }
+
+    CommandQueueSoftware::CommandQueueSoftware(RenderInstanceSoftware& instance) : super(instance) {}
+
+    void CommandQueueSoftware::cmdClearTexture(Texture& texture, const Color& clearColor)
+    {
+        float rgba[4] = {clearColor.r, clearColor.g, clearColor.b, clearColor.a};
+        safe_downcast<TextureSoftware&>(texture).clearColor(SoftwareRaster::packColor(rgba));
+    }
+
+    void CommandQueueSoftware::cmdDraw(size_t firstVertex, size_t vertexCount, Bindings& bindings)
+    {
+        super::cmdDraw(firstVertex, vertexCount, bindings);
+        drawVertices(nullptr, firstVertex, vertexCount, bindings);
+    }
+
+    void CommandQueueSoftware::cmdDrawIndexed(size_t firstIndex, size_t vertexCount, Bindings& bindings)
+    {
+        super::cmdDrawIndexed(firstIndex, vertexCount, bindings);
+
+        // As with glDrawElements, firstIndex is a byte offset into the index buffer
+        const BufferSoftware* indexBuffer = safe_downcast<const VertexArrayObjectSoftware*>(bindings.vao)->getIndexBufferSoftware();
+        release_assert(indexBuffer && firstIndex + vertexCount * sizeof(uint16_t) <= indexBuffer->dataSize());
+
+        drawVertices(reinterpret_cast<const uint16_t*>(indexBuffer->data() + firstIndex), 0, vertexCount, bindings);
+    }
+
+    void CommandQueueSoftware::cmdDrawInstances(size_t firstVertex, size_t vertexCount, size_t instanceCount, Bindings& bindings)
+    {
+        super::cmdDrawInstances(firstVertex, vertexCount, instanceCount, bindings);
+
+        auto pipeline = safe_downcast<PipelineSoftware*>(bindings.pipeline);
+        release_assert(pipeline->getProgram() == PipelineSoftware::Program::Sprite);
+
+        // The base vertices are always the unit quad LevelRenderer uploads, so each instance is just a rectangle
+        release_assert(firstVertex == 0 && vertexCount == 6);
+
+        drawSprites(instanceCount, bindings);
+    }
+
+    void CommandQueueSoftware::cmdClearFramebuffer(std::optional<Color> color, bool clearDepth, Framebuffer* nonDefaultFramebuffer)
+    {
+        RenderTarget target = getRenderTarget(nonDefaultFramebuffer);
+        size_t pixelCount = size_t(target.width) * size_t(target.height);
+
+        if (color)
+        {
+            float rgba[4] = {color->r, color->g, color->b, color->a};
+            std::fill_n(target.color, pixelCount, SoftwareRaster::packColor(rgba));
+        }
+
+        if (clearDepth && target.depth)
+            std::fill_n(target.depth, pixelCount, 1.0f);
+    }
+
+    void CommandQueueSoftware::cmdPresent() { getInstance().present(); }
+
+    RenderTarget CommandQueueSoftware::getRenderTarget(Framebuffer* nonDefaultFramebuffer)
+    {
+        if (!nonDefaultFramebuffer)
+            return getInstance().getDefaultRenderTarget();
+
+        auto& colorBuffer = safe_downcast<TextureSoftware&>(nonDefaultFramebuffer->getColorBuffer());
+        auto depthBuffer = safe_downcast<TextureSoftware*>(nonDefaultFramebuffer->getDepthBuffer());
+
+        RenderTarget target;
+        target.color = colorBuffer.colorData();
+        target.depth = depthBuffer ? depthBuffer->depthData() : nullptr;
+        target.width = colorBuffer.width();
+        target.height = colorBuffer.height();
+        return target;
+    }
+
+    Rect CommandQueueSoftware::getClipRect(const PipelineSoftware& pipeline, const RenderTarget& target) const
+    {
+        Rect clip = target.rect();
+        if (pipeline.mSpec.scissor)
+            clip = clip.intersect(Rect{mScissor.x, mScissor.y, mScissor.x + mScissor.w, mScissor.y + mScissor.h});
+        return clip;
+    }
+
+    void CommandQueueSoftware::drawVertices(const uint16_t* indices, size_t firstVertex, size_t vertexCount, Bindings& bindings)
+    {
+        auto pipeline = safe_downcast<PipelineSoftware*>(bindings.pipeline);
+
+        switch (pipeline->getProgram())
+        {
+            case PipelineSoftware::Program::Gui:
+            {
+                GuiProgram program;
+                program.vertexUniforms = readUniforms<GuiVertexUniforms>(bindings, "vertexUniforms");
+                program.fragmentUniforms = readUniforms<GuiFragmentUniforms>(bindings, "fragmentUniforms");
+                program.texture = getTexture(bindings, "Texture");
+                drawTriangles(program, indices, firstVertex, vertexCount, bindings);
+                return;
+            }
+            case PipelineSoftware::Program::Fullscreen:
+            {
+                FullscreenProgram program;
+                program.vertexUniforms = readUniforms<FullscreenVertexUniforms>(bindings, "vertexUniforms");
+                program.texture = getTexture(bindings, "tex");
+                drawTriangles(program, indices, firstVertex, vertexCount, bindings);
+                return;
+            }
+            case PipelineSoftware::Program::Debug:
+            {
+                drawTriangles(DebugProgram(), indices, firstVertex, vertexCount, bindings);
+                return;
+            }
+            case PipelineSoftware::Program::Sprite:
+                message_and_abort("The software renderer only supports the level sprite pipeline with cmdDrawInstances");
+        }
+
+        invalid_enum(PipelineSoftware::Program, pipeline->getProgram());
+    }
+
+    template <typename Program>
+    void CommandQueueSoftware::drawTriangles(const Program& program, const uint16_t* indices, size_t firstVertex, size_t vertexCount, Bindings& bindings)
+    {
+        auto pipeline = safe_downcast<PipelineSoftware*>(bindings.pipeline);
+        auto vao = safe_downcast<const VertexArrayObjectSoftware*>(bindings.vao);
+
+        RenderTarget target = getRenderTarget(bindings.nonDefaultFramebuffer);
+        Rect clip = getClipRect(*pipeline, target);
+
+        VertexFetcher fetcher(*vao, 0);
+
+        mTriangles.clear();
+        mPrimitiveBounds.clear();
+
+        for (size_t triangleStart = 0; triangleStart + 3 <= vertexCount; triangleStart += 3)
+        {
+            RasterTriangle triangle;
+
+            for (size_t i = 0; i < 3; i++)
+            {
+                size_t vertexIndex = indices ? indices[triangleStart + i] : firstVertex + triangleStart + i;
+
+                float attributes[VertexFetcher::MAX_ATTRIBUTES][4];
+                fetcher.fetch(vertexIndex, attributes);
+
+                float position[2];
+                SoftwareRaster::RasterVertex& vertex = triangle.vertices[i];
+                program.shadeVertex(attributes, position, vertex.varyings);
+
+                vertex.x = (position[0] + 1.0f) * 0.5f * float(target.width);
+                vertex.y = (position[1] + 1.0f) * 0.5f * float(target.height);
+            }
+
+            if (SoftwareRaster::setupTriangle(triangle, clip))
+            {
+                mTriangles.push_back(triangle);
+                mPrimitiveBounds.push_back(triangle.bounds);
+            }
+        }
+
+        bool depthTest = pipeline->mSpec.depthTest;
+        auto fragment = [&](const float* varyings, const RasterTriangle& triangle, float rgba[4], float& depth) {
+            return program.shadeFragment(varyings, triangle, rgba, depth);
+        };
+
+        rasterisePrimitives(target, clip, [&](uint32_t primitiveIndex, const Rect& area) {
+            SoftwareRaster::rasterizeTriangle<Program::VARYING_COUNT>(target, area, mTriangles[primitiveIndex], depthTest, fragment);
+        });
+    }
+
+    void CommandQueueSoftware::drawSprites(size_t instanceCount, Bindings& bindings)
+    {
+        auto pipeline = safe_downcast<PipelineSoftware*>(bindings.pipeline);
+        auto vao = safe_downcast<const VertexArrayObjectSoftware*>(bindings.vao);
+        release_assert(vao->getBindings().size() == 2 && vao->getBindings()[1].get() == &SpriteVertexPerInstance::layout());
+
+        RenderTarget target = getRenderTarget(bindings.nonDefaultFramebuffer);
+        if (!pipeline->mSpec.depthTest)
+            target.depth = nullptr;
+
+        Rect clip = getClipRect(*pipeline, target);
+
+        // LevelRenderer always sizes its framebuffer to the screen size it passes in, so sprites map 1:1 onto the target.
+        // We only use the uniforms to check that, in case the window was resized mid frame.
+        auto vertexUniforms = readUniforms<SpriteVertexUniforms>(bindings, "vertexUniforms");
+        if (int32_t(vertexUniforms.screenSizeInPixels[0]) != target.width || int32_t(vertexUniforms.screenSizeInPixels[1]) != target.height)
+            return;
+
+        const TextureSoftware* atlas = getTexture(bindings, "tex");
+        bool indexed = atlas->getInfo().format == Format::R8UNorm;
+
+        SoftwareRaster::SourceImage atlasImage;
+        atlasImage.width = atlas->width();
+        atlasImage.height = atlas->height();
+        if (indexed)
+            atlasImage.indices = atlas->r8Data();
+        else
+            atlasImage.texels = atlas->colorData();
+
+        // Only indexed atlases need the palette, so drawers of RGBA sprites don't have to bind one
+        const TextureSoftware* palette = indexed ? getTexture(bindings, "palette") : nullptr;
+        release_assert(!palette || palette->width() == 256);
+
+        int32_t offsetX = int32_t(vertexUniforms.offsetInPixels[0]);
+        int32_t offsetY = int32_t(vertexUniforms.offsetInPixels[1]);
+
+        const BufferSoftware& instanceBuffer = vao->getVertexBufferSoftware(1);
+        release_assert(instanceCount * sizeof(SpriteVertexPerInstance) <= instanceBuffer.dataSize());
+
+        mSprites.clear();
+        mPrimitiveBounds.clear();
+
+        for (size_t i = 0; i < instanceCount; i++)
+        {
+            SpriteVertexPerInstance instance;
+            memcpy(&instance, instanceBuffer.data() + i * sizeof(SpriteVertexPerInstance), sizeof(SpriteVertexPerInstance));
+
+            SoftwareRaster::SpriteBlit sprite;
+            sprite.destX = instance.v_destinationInPixels[0] + offsetX;
+            sprite.topRow = target.height - 1 - (instance.v_destinationInPixels[1] + offsetY);
+            sprite.atlasX = instance.v_atlasOffsetInPixels[0];
+            sprite.atlasY = instance.v_atlasOffsetInPixels[1];
+            sprite.z = instance.v_zValue;
+            memcpy(&sprite.hoverColor, instance.v_hoverColor, sizeof(sprite.hoverColor));
+
+            if (indexed)
+            {
+                int32_t paletteRow = int32_t(instance.v_paletteRow);
+                release_assert(paletteRow >= 0 && paletteRow < palette->height());
+                sprite.palette = palette->colorData() + size_t(paletteRow) * 256;
+            }
+
+            int32_t width = instance.v_spriteSizeInPixels[0];
+            int32_t height = instance.v_spriteSizeInPixels[1];
+            sprite.bounds = Rect{sprite.destX, sprite.topRow - height + 1, sprite.destX + width, sprite.topRow + 1}.intersect(clip);
+
+            if (sprite.bounds.empty())
+                continue;
+
+            mSprites.push_back(sprite);
+            mPrimitiveBounds.push_back(sprite.bounds);
+        }
+
+        rasterisePrimitives(target, clip, [&](uint32_t primitiveIndex, const Rect& area) {
+            SoftwareRaster::blitSprite(target, area, mSprites[primitiveIndex], atlasImage);
+        });
+    }
+
+    template <typename RasterisePrimitive>
+    void CommandQueueSoftware::rasterisePrimitives(const RenderTarget& target, const Rect& clip, RasterisePrimitive&& rasterisePrimitive)
+    {
+        int64_t coveredPixels = 0;
+        for (const auto& bounds : mPrimitiveBounds)
+            coveredPixels += bounds.area();
+
+        if (coveredPixels < PARALLEL_DRAW_MIN_PIXELS || getInstance().getWorkerPool().getThreadCount() == 0)
+        {
+            for (uint32_t primitiveIndex = 0; primitiveIndex < mPrimitiveBounds.size(); primitiveIndex++)
+                rasterisePrimitive(primitiveIndex, clip);
+            return;
+        }
+
+        mTileBinner.reset(target.width, target.height);
+        for (uint32_t primitiveIndex = 0; primitiveIndex < mPrimitiveBounds.size(); primitiveIndex++)
+            mTileBinner.add(primitiveIndex, mPrimitiveBounds[primitiveIndex]);
+
+        const std::vector<uint32_t>& tiles = mTileBinner.getActiveTiles();
+        getInstance().getWorkerPool().run(tiles.size(), [&](size_t job) {
+            uint32_t tileIndex = tiles[job];
+            Rect tileClip = mTileBinner.getTileRect(tileIndex).intersect(clip);
+
+            for (uint32_t primitiveIndex : mTileBinner.getBin(tileIndex))
+                rasterisePrimitive(primitiveIndex, tileClip);
+        });
+    }
+}
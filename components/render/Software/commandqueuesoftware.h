@@ -0,0 +1,53 @@
+#pragma once
+#include <render/Software/rastersoftware.h>
+#include <render/Software/renderinstancesoftware.h>
+#include <render/commandqueue.h>
+#include <vector>
+
+namespace Render
+{
+    class PipelineSoftware;
+    class TextureSoftware;
+
+    /**
+     * @brief Executes commands on the CPU as they are recorded.
+     *
+     * Each draw is split into screen tiles which are rasterised in parallel on the instance's worker pool.
+     * Draws that cover only a few pixels (most nuklear commands, for example) are rasterised on the calling thread instead.
+     */
+    class CommandQueueSoftware final : public CommandQueue
+    {
+        using super = CommandQueue;
+
+    public:
+        explicit CommandQueueSoftware(RenderInstanceSoftware& instance);
+        ~CommandQueueSoftware() override = default;
+
+        void cmdClearTexture(Texture& texture, const Color& clearColor) override;
+        void cmdDraw(size_t firstVertex, size_t vertexCount, Bindings& bindings) override;
+        void cmdDrawIndexed(size_t firstIndex, size_t vertexCount, Bindings& bindings) override;
+        void cmdDrawInstances(size_t firstVertex, size_t vertexCount, size_t instanceCount, Bindings& bindings) override;
+        void cmdClearFramebuffer(std::optional<Color> color, bool clearDepth, Framebuffer* nonDefaultFramebuffer) override;
+        void cmdPresent() override;
+
+    private:
+        RenderInstanceSoftware& getInstance() { return safe_downcast<RenderInstanceSoftware&>(mInstance); }
+
+        SoftwareRaster::RenderTarget getRenderTarget(Framebuffer* nonDefaultFramebuffer);
+        SoftwareRaster::Rect getClipRect(const PipelineSoftware& pipeline, const SoftwareRaster::RenderTarget& target) const;
+
+        void drawVertices(const uint16_t* indices, size_t firstVertex, size_t vertexCount, Bindings& bindings);
+        template <typename Program>
+        void drawTriangles(const Program& program, const uint16_t* indices, size_t firstVertex, size_t vertexCount, Bindings& bindings);
+        void drawSprites(size_t instanceCount, Bindings& bindings);
+
+        template <typename RasterisePrimitive>
+        void rasterisePrimitives(const SoftwareRaster::RenderTarget& target, const SoftwareRaster::Rect& clip, RasterisePrimitive&& rasterisePrimitive);
+
+    private:
+        std::vector<SoftwareRaster::SpriteBlit> mSprites;
+        std::vector<SoftwareRaster::RasterTriangle> mTriangles;
+        std::vector<SoftwareRaster::Rect> mPrimitiveBounds;
+        SoftwareRaster::TileBinner mTileBinner;
+    };
+}
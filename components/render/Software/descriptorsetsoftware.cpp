@@ -0,0 +1,21 @@
+#include <misc/assert.h>
+#include <render/Software/descriptorsetsoftware.h>
+
+namespace Render
+{
+    DescriptorSetSoftware::DescriptorSetSoftware(DescriptorSetSpec spec) : DescriptorSet(std::move(spec)) { mCurrentItems.resize(mSourceSpec.items.size()); }
+
+    void DescriptorSetSoftware::updateItems(const std::vector<Item>& items)
+    {
+        super::updateItems(items);
+
+        for (const auto& item : items)
+            mCurrentItems[item.bindingIndex] = item;
+    }
+
+    const DescriptorSet::Item& DescriptorSetSoftware::getItem(uint32_t bindingIndex) const
+    {
+        release_assert(mCurrentItems[bindingIndex].has_value());
+        return *mCurrentItems[bindingIndex];
+    }
+}
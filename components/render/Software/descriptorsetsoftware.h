@@ -0,0 +1,23 @@
+#pragma once
+#include <optional>
+#include <render/descriptorset.h>
+
+namespace Render
+{
+    class DescriptorSetSoftware final : public DescriptorSet
+    {
+        using super = DescriptorSet;
+
+    public:
+        explicit DescriptorSetSoftware(DescriptorSetSpec spec);
+        ~DescriptorSetSoftware() override = default;
+
+        void updateItems(const std::vector<Item>& items) override;
+
+    public:
+        const Item& getItem(uint32_t bindingIndex) const;
+
+    private:
+        std::vector<std::optional<Item>> mCurrentItems;
+    };
+}
@@ -0,0 +1,22 @@
+#include <misc/assert.h>
+#include <render/Software/pipelinesoftware.h>
+#include <render/Software/renderinstancesoftware.h>
+
+namespace Render
+{
+    PipelineSoftware::PipelineSoftware(RenderInstanceSoftware& instance, PipelineSpec spec) : super(instance, std::move(spec))
+    {
+        std::string fragmentShader = mSpec.fragmentShaderPath.filename();
+
+        if (fragmentShader == "basic.frag")
+            mProgram = Program::Sprite;
+        else if (fragmentShader == "gui.frag")
+            mProgram = Program::Gui;
+        else if (fragmentShader == "fullscreen.frag")
+            mProgram = Program::Fullscreen;
+        else if (fragmentShader == "debug.frag")
+            mProgram = Program::Debug;
+        else
+            message_and_abort_fmt("The software renderer has no implementation of shader \"%s\"\n", fragmentShader.c_str());
+    }
+}
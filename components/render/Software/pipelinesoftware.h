@@ -0,0 +1,35 @@
+#pragma once
+#include <render/pipeline.h>
+
+namespace Render
+{
+    class RenderInstanceSoftware;
+
+    /**
+     * @brief A pipeline for the software renderer.
+     *
+     * There is no shader compiler, so each of the shader programs in resources/shaders has a hand written CPU equivalent,
+     * picked by the name of the pipeline's fragment shader.
+     */
+    class PipelineSoftware final : public Pipeline
+    {
+        using super = Pipeline;
+
+    public:
+        enum class Program
+        {
+            Sprite,     ///< basic.vert / basic.frag, instanced level sprites
+            Gui,        ///< gui.vert / gui.frag, nuklear draw lists
+            Fullscreen, ///< fullscreen.vert / fullscreen.frag
+            Debug,      ///< debug.vert / debug.frag
+        };
+
+        PipelineSoftware(RenderInstanceSoftware& instance, PipelineSpec spec);
+        ~PipelineSoftware() override = default;
+
+        Program getProgram() const { return mProgram; }
+
+    private:
+        Program mProgram = Program::Sprite;
+    };
+}
@@ -0,0 +1,286 @@
+#include <cmath>
+#include <cstring>
+#include <render/Software/rastersoftware.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FA_SOFTWARE_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Render
+{
+    namespace SoftwareRaster
+    {
+        static uint8_t toUnorm8(float value)
+        {
+            value = std::min(std::max(value, 0.0f), 1.0f);
+            return uint8_t(value * 255.0f + 0.5f);
+        }
+
+        uint32_t packColor(const float rgba[4])
+        {
+            uint8_t bytes[4] = {toUnorm8(rgba[0]), toUnorm8(rgba[1]), toUnorm8(rgba[2]), toUnorm8(rgba[3])};
+
+            uint32_t color = 0;
+            memcpy(&color, bytes, sizeof(color));
+            return color;
+        }
+
+        void unpackColor(uint32_t color, float rgba[4])
+        {
+            uint8_t bytes[4];
+            memcpy(bytes, &color, sizeof(color));
+
+            for (int32_t i = 0; i < 4; i++)
+                rgba[i] = float(bytes[i]) * (1.0f / 255.0f);
+        }
+
+        uint8_t getAlpha(uint32_t color)
+        {
+            uint8_t bytes[4];
+            memcpy(bytes, &color, sizeof(color));
+            return bytes[3];
+        }
+
+        void blendPixel(uint32_t& destination, const float sourceRgba[4])
+        {
+            float alpha = std::min(std::max(sourceRgba[3], 0.0f), 1.0f);
+
+            float destinationRgba[4];
+            unpackColor(destination, destinationRgba);
+
+            float result[4];
+            for (int32_t i = 0; i < 4; i++)
+                result[i] = sourceRgba[i] * alpha + destinationRgba[i] * (1.0f - alpha);
+
+            destination = packColor(result);
+        }
+
+        static uint32_t fetchTexel(const SourceImage& image, const uint32_t* palette, int32_t x, int32_t y)
+        {
+            // Matches GL_CLAMP_TO_BORDER with the default transparent black border
+            if (x < 0 || y < 0 || x >= image.width || y >= image.height)
+                return 0;
+
+            size_t index = size_t(y) * size_t(image.width) + size_t(x);
+            return image.indices ? palette[image.indices[index]] : image.texels[index];
+        }
+
+        static bool hasVisibleNeighbour(const SourceImage& atlas, const uint32_t* palette, int32_t x, int32_t y)
+        {
+            for (int32_t offsetY = -1; offsetY <= 1; offsetY++)
+            {
+                for (int32_t offsetX = -1; offsetX <= 1; offsetX++)
+                {
+                    uint8_t bytes[4];
+                    uint32_t neighbour = fetchTexel(atlas, palette, x + offsetX, y + offsetY);
+                    memcpy(bytes, &neighbour, sizeof(neighbour));
+
+                    if (bytes[3] > 0 && (bytes[0] > 0 || bytes[1] > 0 || bytes[2] > 0))
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+        static void writeSpritePixel(uint32_t texel, uint32_t& color, float* depth, float z)
+        {
+            uint8_t alpha = getAlpha(texel);
+            if (alpha == 0)
+                return;
+
+            if (depth)
+            {
+                // gl_FragDepth = mix(1.0, z, alpha)
+                float fragmentDepth = alpha == 255 ? z : 1.0f + (z - 1.0f) * (float(alpha) * (1.0f / 255.0f));
+                if (!(fragmentDepth < *depth))
+                    return;
+                *depth = fragmentDepth;
+            }
+
+            if (alpha == 255)
+            {
+                color = texel;
+            }
+            else
+            {
+                float rgba[4];
+                unpackColor(texel, rgba);
+                blendPixel(color, rgba);
+            }
+        }
+
+        // Copies a row of opaque or fully transparent texels four at a time, falling back to the scalar path for partially transparent ones.
+        static void blitSpriteRowDepthTested(const uint32_t* source, uint32_t* color, float* depth, int32_t count, float z)
+        {
+            int32_t i = 0;
+
+#ifdef FA_SOFTWARE_RASTER_SSE2
+            const __m128 zValue = _mm_set1_ps(z);
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i opaqueAlpha = _mm_set1_epi32(255);
+
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+                __m128i alpha = _mm_srli_epi32(texels, 24);
+
+                __m128i transparent = _mm_cmpeq_epi32(alpha, zero);
+                if (_mm_movemask_epi8(transparent) == 0xFFFF)
+                    continue;
+
+                __m128i opaque = _mm_cmpeq_epi32(alpha, opaqueAlpha);
+                if (_mm_movemask_epi8(_mm_or_si128(transparent, opaque)) != 0xFFFF)
+                {
+                    for (int32_t j = i; j < i + 4; j++)
+                        writeSpritePixel(source[j], color[j], depth + j, z);
+                    continue;
+                }
+
+                __m128 existingDepth = _mm_loadu_ps(depth + i);
+                __m128i passed = _mm_and_si128(opaque, _mm_castps_si128(_mm_cmplt_ps(zValue, existingDepth)));
+                if (_mm_movemask_epi8(passed) == 0)
+                    continue;
+
+                __m128i existingColor = _mm_loadu_si128(reinterpret_cast<const __m128i*>(color + i));
+                __m128i newColor = _mm_or_si128(_mm_and_si128(passed, texels), _mm_andnot_si128(passed, existingColor));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(color + i), newColor);
+
+                __m128 passedMask = _mm_castsi128_ps(passed);
+                __m128 newDepth = _mm_or_ps(_mm_and_ps(passedMask, zValue), _mm_andnot_ps(passedMask, existingDepth));
+                _mm_storeu_ps(depth + i, newDepth);
+            }
+#endif
+
+            for (; i < count; i++)
+                writeSpritePixel(source[i], color[i], depth + i, z);
+        }
+
+        void blitSprite(const RenderTarget& target, const Rect& clip, const SpriteBlit& sprite, const SourceImage& atlas)
+        {
+            Rect area = clip.intersect(sprite.bounds);
+            if (area.empty())
+                return;
+
+            int32_t sourceX0 = sprite.atlasX + (area.x0 - sprite.destX);
+            int32_t sourceX1 = sourceX0 + (area.x1 - area.x0);
+            int32_t sourceYTop = sprite.atlasY + (sprite.topRow - (area.y1 - 1));
+            int32_t sourceYBottom = sprite.atlasY + (sprite.topRow - area.y0);
+
+            bool insideAtlas = sourceX0 >= 0 && sourceX1 <= atlas.width && sourceYTop >= 0 && sourceYBottom < atlas.height;
+            bool outline = getAlpha(sprite.hoverColor) > 0;
+
+            // Indexed rows are expanded through the palette a chunk at a time, so they can take the same row blit as RGBA ones
+            constexpr int32_t EXPANDED_CHUNK = 256;
+            uint32_t expanded[EXPANDED_CHUNK];
+
+            for (int32_t y = area.y0; y < area.y1; y++)
+            {
+                int32_t sourceY = sprite.atlasY + (sprite.topRow - y);
+
+                uint32_t* colorRow = target.color + size_t(y) * size_t(target.width);
+                float* depthRow = target.depth ? target.depth + size_t(y) * size_t(target.width) : nullptr;
+
+                if (insideAtlas && !outline && depthRow)
+                {
+                    size_t sourceOffset = size_t(sourceY) * size_t(atlas.width) + size_t(sourceX0);
+                    if (!atlas.indices)
+                    {
+                        blitSpriteRowDepthTested(atlas.texels + sourceOffset, colorRow + area.x0, depthRow + area.x0, area.x1 - area.x0, sprite.z);
+                        continue;
+                    }
+
+                    for (int32_t x = area.x0; x < area.x1; x += EXPANDED_CHUNK)
+                    {
+                        int32_t count = std::min(EXPANDED_CHUNK, area.x1 - x);
+                        const uint8_t* indices = atlas.indices + sourceOffset + size_t(x - area.x0);
+                        for (int32_t i = 0; i < count; i++)
+                            expanded[i] = sprite.palette[indices[i]];
+
+                        blitSpriteRowDepthTested(expanded, colorRow + x, depthRow + x, count, sprite.z);
+                    }
+                    continue;
+                }
+
+                for (int32_t x = area.x0; x < area.x1; x++)
+                {
+                    int32_t sourceX = sprite.atlasX + (x - sprite.destX);
+                    uint32_t texel = fetchTexel(atlas, sprite.palette, sourceX, sourceY);
+
+                    if (outline && getAlpha(texel) == 0 && hasVisibleNeighbour(atlas, sprite.palette, sourceX, sourceY))
+                        texel = sprite.hoverColor;
+
+                    writeSpritePixel(texel, colorRow[x], depthRow ? depthRow + x : nullptr, sprite.z);
+                }
+            }
+        }
+
+        bool setupTriangle(RasterTriangle& triangle, const Rect& clip)
+        {
+            RasterVertex* v = triangle.vertices;
+
+            float doubleArea = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+            if (doubleArea == 0.0f || !std::isfinite(doubleArea))
+                return false;
+
+            // Culling is disabled, so just flip clockwise triangles around
+            if (doubleArea < 0.0f)
+                std::swap(v[1], v[2]);
+
+            float minX = std::min({v[0].x, v[1].x, v[2].x});
+            float maxX = std::max({v[0].x, v[1].x, v[2].x});
+            float minY = std::min({v[0].y, v[1].y, v[2].y});
+            float maxY = std::max({v[0].y, v[1].y, v[2].y});
+
+            auto clampX = [&](float value) { return std::min(std::max(value, float(clip.x0)), float(clip.x1)); };
+            auto clampY = [&](float value) { return std::min(std::max(value, float(clip.y0)), float(clip.y1)); };
+
+            triangle.bounds.x0 = int32_t(std::floor(clampX(minX)));
+            triangle.bounds.y0 = int32_t(std::floor(clampY(minY)));
+            triangle.bounds.x1 = int32_t(std::ceil(clampX(maxX)));
+            triangle.bounds.y1 = int32_t(std::ceil(clampY(maxY)));
+            return !triangle.bounds.empty();
+        }
+
+        void TileBinner::reset(int32_t width, int32_t height)
+        {
+            for (uint32_t tileIndex : mActiveTiles)
+                mBins[tileIndex].clear();
+            mActiveTiles.clear();
+
+            mWidth = width;
+            mHeight = height;
+            mTilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+            mTilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+            if (mBins.size() < size_t(mTilesX) * size_t(mTilesY))
+                mBins.resize(size_t(mTilesX) * size_t(mTilesY));
+        }
+
+        void TileBinner::add(uint32_t primitiveIndex, const Rect& bounds)
+        {
+            Rect area = bounds.intersect(Rect{0, 0, mWidth, mHeight});
+            if (area.empty())
+                return;
+
+            for (int32_t tileY = area.y0 / TILE_SIZE; tileY <= (area.y1 - 1) / TILE_SIZE; tileY++)
+            {
+                for (int32_t tileX = area.x0 / TILE_SIZE; tileX <= (area.x1 - 1) / TILE_SIZE; tileX++)
+                {
+                    uint32_t tileIndex = uint32_t(tileY * mTilesX + tileX);
+                    if (mBins[tileIndex].empty())
+                        mActiveTiles.push_back(tileIndex);
+                    mBins[tileIndex].push_back(primitiveIndex);
+                }
+            }
+        }
+
+        Rect TileBinner::getTileRect(uint32_t tileIndex) const
+        {
+            int32_t x = int32_t(tileIndex) % mTilesX * TILE_SIZE;
+            int32_t y = int32_t(tileIndex) / mTilesX * TILE_SIZE;
+            return Rect{x, y, std::min(x + TILE_SIZE, mWidth), std::min(y + TILE_SIZE, mHeight)};
+        }
+    }
+}
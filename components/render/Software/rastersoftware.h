@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Render
+{
+    namespace SoftwareRaster
+    {
+        // Half open rectangle of pixels, in render target coordinates. Like OpenGL, row 0 is the bottom row.
+        struct Rect
+        {
+            int32_t x0 = 0;
+            int32_t y0 = 0;
+            int32_t x1 = 0;
+            int32_t y1 = 0;
+
+            bool empty() const { return x0 >= x1 || y0 >= y1; }
+            int64_t area() const { return empty() ? 0 : int64_t(x1 - x0) * int64_t(y1 - y0); }
+
+            Rect intersect(const Rect& other) const
+            {
+                return Rect{std::max(x0, other.x0), std::max(y0, other.y0), std::min(x1, other.x1), std::min(y1, other.y1)};
+            }
+        };
+
+        struct RenderTarget
+        {
+            uint32_t* color = nullptr;
+            float* depth = nullptr; ///< nullptr when the target has no depth buffer
+            int32_t width = 0;
+            int32_t height = 0;
+
+            Rect rect() const { return Rect{0, 0, width, height}; }
+        };
+
+        struct SourceImage
+        {
+            const uint32_t* texels = nullptr;
+            const uint8_t* indices = nullptr; ///< Set instead of texels for R8 images, whose texels are palette indices
+            int32_t width = 0;
+            int32_t height = 0;
+        };
+
+        // Colours are packed as r, g, b, a bytes in memory order, the same layout as RGBA8UNorm texture data.
+        uint32_t packColor(const float rgba[4]);
+        void unpackColor(uint32_t color, float rgba[4]);
+        uint8_t getAlpha(uint32_t color);
+
+        // Blends with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA on all four channels, matching the OpenGL backend's global blend state.
+        void blendPixel(uint32_t& destination, const float sourceRgba[4]);
+
+        struct SpriteBlit
+        {
+            Rect bounds;         ///< area covered in the render target
+            int32_t destX = 0;   ///< target column of sprite column 0
+            int32_t topRow = 0;  ///< target row of sprite row 0, the following sprite rows go downwards
+            int32_t atlasX = 0;  ///< atlas texel of sprite row 0, column 0
+            int32_t atlasY = 0;
+            float z = 0.0f;
+            uint32_t hoverColor = 0; ///< outline colour drawn around the sprite, alpha 0 for no outline
+            const uint32_t* palette = nullptr; ///< the 256 colours an indexed atlas's texels are looked up in
+        };
+
+        /// Draws the part of a sprite that falls inside clip, 1:1 from the atlas. This is the CPU equivalent of the level sprite shader (basic.frag):
+        /// texels with zero alpha are skipped, and when the target has a depth buffer the sprite's explicit z value is depth tested.
+        /// Indexed atlases are resolved through the sprite's palette first.
+        void blitSprite(const RenderTarget& target, const Rect& clip, const SpriteBlit& sprite, const SourceImage& atlas);
+
+        constexpr int32_t MAX_VARYINGS = 8;
+
+        struct RasterVertex
+        {
+            float x = 0.0f; ///< position in target pixels
+            float y = 0.0f;
+            float varyings[MAX_VARYINGS] = {};
+        };
+
+        struct RasterTriangle
+        {
+            RasterVertex vertices[3];
+            Rect bounds;
+            uint32_t flatIndex = 0; ///< passed through to the fragment function, for per-instance data
+        };
+
+        /// Computes the bounds of a triangle within clip, and orients it counter-clockwise. Returns false if nothing would be drawn.
+        bool setupTriangle(RasterTriangle& triangle, const Rect& clip);
+
+        /// Rasterises the part of a triangle that falls inside clip, sampling at pixel centres with a top-left style fill rule so shared edges are
+        /// only drawn once. The fragment function is called as fragment(const float* varyings, const RasterTriangle&, float rgba[4], float& depth),
+        /// and returns false to discard the fragment.
+        template <int32_t VaryingCount, typename FragmentFunc>
+        void rasterizeTriangle(const RenderTarget& target, const Rect& clip, const RasterTriangle& triangle, bool depthTest, FragmentFunc&& fragment)
+        {
+            static_assert(VaryingCount <= MAX_VARYINGS);
+
+            Rect area = clip.intersect(triangle.bounds);
+            if (area.empty())
+                return;
+
+            const RasterVertex& a = triangle.vertices[0];
+            const RasterVertex& b = triangle.vertices[1];
+            const RasterVertex& c = triangle.vertices[2];
+
+            float doubleArea = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            float invDoubleArea = 1.0f / doubleArea;
+
+            // Edge i is opposite vertex i, so its edge function is the (unnormalised) barycentric weight of that vertex.
+            const RasterVertex* edgeStart[3] = {&b, &c, &a};
+            const RasterVertex* edgeEnd[3] = {&c, &a, &b};
+
+            float stepX[3];
+            float stepY[3];
+            float rowStart[3];
+            bool includeZero[3];
+
+            float startX = float(area.x0) + 0.5f;
+            float startY = float(area.y0) + 0.5f;
+
+            for (int32_t i = 0; i < 3; i++)
+            {
+                float dx = edgeEnd[i]->x - edgeStart[i]->x;
+                float dy = edgeEnd[i]->y - edgeStart[i]->y;
+
+                stepX[i] = -dy;
+                stepY[i] = dx;
+                rowStart[i] = dx * (startY - edgeStart[i]->y) - dy * (startX - edgeStart[i]->x);
+                includeZero[i] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+            }
+
+            float varyings[MAX_VARYINGS];
+
+            for (int32_t y = area.y0; y < area.y1; y++)
+            {
+                float edge[3] = {rowStart[0], rowStart[1], rowStart[2]};
+
+                uint32_t* colorRow = target.color + size_t(y) * size_t(target.width);
+                float* depthRow = target.depth ? target.depth + size_t(y) * size_t(target.width) : nullptr;
+
+                for (int32_t x = area.x0; x < area.x1; x++)
+                {
+                    bool inside = true;
+                    for (int32_t i = 0; i < 3; i++)
+                        inside = inside && (edge[i] > 0.0f || (edge[i] == 0.0f && includeZero[i]));
+
+                    if (inside)
+                    {
+                        float weightA = edge[0] * invDoubleArea;
+                        float weightB = edge[1] * invDoubleArea;
+                        float weightC = edge[2] * invDoubleArea;
+
+                        for (int32_t i = 0; i < VaryingCount; i++)
+                            varyings[i] = a.varyings[i] * weightA + b.varyings[i] * weightB + c.varyings[i] * weightC;
+
+                        float rgba[4];
+                        float depth = 0.5f;
+                        if (fragment(static_cast<const float*>(varyings), triangle, rgba, depth))
+                        {
+                            bool passed = true;
+                            if (depthTest && depthRow)
+                            {
+                                passed = depth < depthRow[x];
+                                if (passed)
+                                    depthRow[x] = depth;
+                            }
+
+                            if (passed)
+                                blendPixel(colorRow[x], rgba);
+                        }
+                    }
+
+                    for (int32_t i = 0; i < 3; i++)
+                        edge[i] += stepX[i];
+                }
+
+                for (int32_t i = 0; i < 3; i++)
+                    rowStart[i] += stepY[i];
+            }
+        }
+
+        /// Sorts primitives into fixed size screen tiles, so each tile can be rasterised independently on a worker thread.
+        /// Primitives keep their submission order within a tile, so blending results match a serial draw.
+        class TileBinner
+        {
+        public:
+            static constexpr int32_t TILE_SIZE = 64;
+
+            void reset(int32_t width, int32_t height);
+            void add(uint32_t primitiveIndex, const Rect& bounds);
+
+            const std::vector<uint32_t>& getActiveTiles() const { return mActiveTiles; }
+            const std::vector<uint32_t>& getBin(uint32_t tileIndex) const { return mBins[tileIndex]; }
+            Rect getTileRect(uint32_t tileIndex) const;
+
+        private:
+            int32_t mWidth = 0;
+            int32_t mHeight = 0;
+            int32_t mTilesX = 0;
+            int32_t mTilesY = 0;
+            std::vector<std::vector<uint32_t>> mBins;
+            std::vector<uint32_t> mActiveTiles;
+        };
+    }
+}
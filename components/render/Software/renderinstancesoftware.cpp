@@ -0,0 +1,144 @@
+#include <SDL.h>
+#include <algorithm>
+#include <cstring>
+#include <render/Software/buffersoftware.h>
+#include <render/Software/commandqueuesoftware.h>
+#include <render/Software/descriptorsetsoftware.h>
+#include <render/Software/pipelinesoftware.h>
+#include <render/Software/renderinstancesoftware.h>
+#include <render/Software/texturesoftware.h>
+#include <render/Software/vertexarrayobjectsoftware.h>
+#include <render/framebuffer.h>
+
+namespace Render
+{
+    // Atlas layers live in main memory here, so keep them smaller than a GPU would allow
+    static constexpr int32_t SOFTWARE_MAX_TEXTURE_SIZE = 4096;
+    static constexpr int32_t SOFTWARE_UNIFORM_BUFFER_ALIGNMENT = 16;
+
+    static size_t defaultWorkerThreadCount()
+    {
+        // The thread submitting draws takes part in rasterising too
+        unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        return size_t(hardwareThreads - 1);
+    }
+
+    RenderInstanceSoftware::RenderInstanceSoftware(SDL_Window& window) : super(&window), mWorkerPool(defaultWorkerThreadCount())
+    {
+        mRenderCapabilities = {SOFTWARE_MAX_TEXTURE_SIZE, SOFTWARE_UNIFORM_BUFFER_ALIGNMENT};
+
+        int32_t width = 0;
+        int32_t height = 0;
+        SDL_GetWindowSize(&window, &width, &height);
+        createDefaultFramebuffer(width, height);
+    }
+
+    RenderInstanceSoftware::RenderInstanceSoftware(int32_t width, int32_t height, size_t workerThreads) : super(nullptr), mWorkerPool(workerThreads)
+    {
+        mRenderCapabilities = {SOFTWARE_MAX_TEXTURE_SIZE, SOFTWARE_UNIFORM_BUFFER_ALIGNMENT};
+        createDefaultFramebuffer(width, height);
+    }
+
+    RenderInstanceSoftware::~RenderInstanceSoftware() = default;
+
+    std::unique_ptr<DescriptorSet> RenderInstanceSoftware::createDescriptorSet(DescriptorSetSpec spec)
+    {
+        return std::unique_ptr<DescriptorSet>(new DescriptorSetSoftware(std::move(spec)));
+    }
+
+    std::unique_ptr<Pipeline> RenderInstanceSoftware::createPipeline(const PipelineSpec& spec)
+    {
+        return std::unique_ptr<Pipeline>(new PipelineSoftware(*this, spec));
+    }
+
+    std::unique_ptr<Texture> RenderInstanceSoftware::createTexture(const BaseTextureInfo& info)
+    {
+        return std::unique_ptr<Texture>(new TextureSoftware(*this, info));
+    }
+
+    std::unique_ptr<Framebuffer> RenderInstanceSoftware::createFramebuffer(const FramebufferInfo& info)
+    {
+        return std::unique_ptr<Framebuffer>(new Framebuffer(info));
+    }
+
+    std::unique_ptr<Buffer> RenderInstanceSoftware::createBuffer(size_t sizeInBytes) { return std::unique_ptr<Buffer>(new BufferSoftware(sizeInBytes)); }
+
+    std::unique_ptr<VertexArrayObject> RenderInstanceSoftware::createVertexArrayObject(std::vector<size_t> bufferSizeCounts,
+                                                                                       std::vector<NonNullConstPtr<VertexLayout>> bindings,
+                                                                                       size_t indexBufferSizeInElements)
+    {
+        return std::unique_ptr<VertexArrayObject>(new VertexArrayObjectSoftware(std::move(bufferSizeCounts), std::move(bindings), indexBufferSizeInElements));
+    }
+
+    std::unique_ptr<CommandQueue> RenderInstanceSoftware::createCommandQueue() { return std::unique_ptr<CommandQueue>(new CommandQueueSoftware(*this)); }
+
+    void RenderInstanceSoftware::onWindowResized(int32_t width, int32_t height) { createDefaultFramebuffer(width, height); }
+
+    SoftwareRaster::RenderTarget RenderInstanceSoftware::getDefaultRenderTarget()
+    {
+        SoftwareRaster::RenderTarget target;
+        target.color = mDefaultColorBuffer->colorData();
+        target.depth = mDefaultDepthBuffer->depthData();
+        target.width = mDefaultColorBuffer->width();
+        target.height = mDefaultColorBuffer->height();
+        return target;
+    }
+
+    void RenderInstanceSoftware::present()
+    {
+        if (!mWindow)
+            return;
+
+        SDL_Surface* surface = SDL_GetWindowSurface(mWindow);
+        if (!surface)
+            return;
+
+        int32_t width = std::min(surface->w, mDefaultColorBuffer->width());
+        int32_t height = std::min(surface->h, mDefaultColorBuffer->height());
+
+        if (SDL_MUSTLOCK(surface))
+            SDL_LockSurface(surface);
+
+        // Our rows are stored bottom up, like OpenGL's, so flip while converting
+        for (int32_t y = 0; y < height; y++)
+        {
+            const uint32_t* source = mDefaultColorBuffer->colorData() + size_t(mDefaultColorBuffer->height() - 1 - y) * size_t(mDefaultColorBuffer->width());
+            uint8_t* destination = static_cast<uint8_t*>(surface->pixels) + size_t(y) * size_t(surface->pitch);
+
+            SDL_ConvertPixels(width, 1, SDL_PIXELFORMAT_RGBA32, source, width * 4, surface->format->format, destination, surface->pitch);
+        }
+
+        if (SDL_MUSTLOCK(surface))
+            SDL_UnlockSurface(surface);
+
+        SDL_UpdateWindowSurface(mWindow);
+    }
+
+    Image RenderInstanceSoftware::captureFrame() const
+    {
+        int32_t width = mDefaultColorBuffer->width();
+        int32_t height = mDefaultColorBuffer->height();
+
+        Image image(width, height);
+        for (int32_t y = 0; y < height; y++)
+        {
+            const uint32_t* source = mDefaultColorBuffer->colorData() + size_t(height - 1 - y) * size_t(width);
+            memcpy(static_cast<void*>(&image.get(0, y)), source, size_t(width) * sizeof(ByteColour));
+        }
+
+        return image;
+    }
+
+    void RenderInstanceSoftware::createDefaultFramebuffer(int32_t width, int32_t height)
+    {
+        BaseTextureInfo info;
+        info.width = std::max(width, 1);
+        info.height = std::max(height, 1);
+
+        info.format = Format::RGBA8UNorm;
+        mDefaultColorBuffer = std::make_unique<TextureSoftware>(*this, info);
+
+        info.format = Format::Depth24Stencil8;
+        mDefaultDepthBuffer = std::make_unique<TextureSoftware>(*this, info);
+    }
+}
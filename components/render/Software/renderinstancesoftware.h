@@ -0,0 +1,57 @@
+#pragma once
+#include <Image/image.h>
+#include <memory>
+#include <render/Software/rastersoftware.h>
+#include <render/Software/workerpoolsoftware.h>
+#include <render/renderinstance.h>
+
+namespace Render
+{
+    class TextureSoftware;
+
+    /**
+     * @brief A RenderInstance that rasterises on the CPU, for machines without a usable GPU and for deterministic frame captures.
+     *
+     * The default framebuffer lives in main memory. It is copied to the window's SDL surface on present,
+     * or can be read back with captureFrame() when the instance is created without a window.
+     */
+    class RenderInstanceSoftware final : public RenderInstance
+    {
+        using super = RenderInstance;
+
+    public:
+        explicit RenderInstanceSoftware(SDL_Window& window);
+        RenderInstanceSoftware(int32_t width, int32_t height, size_t workerThreads);
+        ~RenderInstanceSoftware() override;
+
+        std::unique_ptr<DescriptorSet> createDescriptorSet(DescriptorSetSpec spec) override;
+        std::unique_ptr<Pipeline> createPipeline(const PipelineSpec& spec) override;
+        std::unique_ptr<Texture> createTexture(const BaseTextureInfo& info) override;
+        std::unique_ptr<Framebuffer> createFramebuffer(const FramebufferInfo& info) override;
+        std::unique_ptr<Buffer> createBuffer(size_t sizeInBytes) override;
+        std::unique_ptr<VertexArrayObject> createVertexArrayObject(std::vector<size_t> bufferSizeCounts,
+                                                                   std::vector<NonNullConstPtr<VertexLayout>> bindings,
+                                                                   size_t indexBufferSizeInElements) override;
+        std::unique_ptr<CommandQueue> createCommandQueue() override;
+
+        void onWindowResized(int32_t width, int32_t height) override;
+
+    public:
+        SoftwareRaster::RenderTarget getDefaultRenderTarget();
+        WorkerPoolSoftware& getWorkerPool() { return mWorkerPool; }
+
+        /// Copies the default framebuffer to the window, if there is one.
+        void present();
+
+        /// Returns the contents of the default framebuffer, top row first.
+        Image captureFrame() const;
+
+    private:
+        void createDefaultFramebuffer(int32_t width, int32_t height);
+
+    private:
+        WorkerPoolSoftware mWorkerPool;
+        std::unique_ptr<TextureSoftware> mDefaultColorBuffer;
+        std::unique_ptr<TextureSoftware> mDefaultDepthBuffer;
+    };
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstring>
+#include <misc/assert.h>
+#include <render/Software/renderinstancesoftware.h>
+#include <render/Software/texturesoftware.h>
+
+namespace Render
+{
+    TextureSoftware::TextureSoftware(RenderInstanceSoftware& instance, const BaseTextureInfo& info) : super(instance, info)
+    {
+        release_assert(mInfo.width > 0 && mInfo.height > 0 && mInfo.arrayLayers > 0);
+
+        switch (mInfo.format)
+        {
+            case Format::RGBA8UNorm:
+                mColor.resize(layerSize() * size_t(mInfo.arrayLayers), 0);
+                break;
+            case Format::R8UNorm:
+                release_assert(mInfo.arrayLayers == 1);
+                mR8.resize(layerSize(), 0);
+                break;
+            case Format::Depth24Stencil8:
+                release_assert(mInfo.arrayLayers == 1);
+                mDepth.resize(layerSize(), 1.0f);
+                break;
+            case Format::RGBA32F:
+            case Format::RGB32F:
+            case Format::RG32F:
+            case Format::R32F:
+            case Format::RGBA16U:
+            case Format::RGB16U:
+            case Format::RG16U:
+            case Format::RGBA16I:
+            case Format::RGB16I:
+            case Format::RG16I:
+                invalid_enum(Format, mInfo.format);
+        }
+    }
+
+    void TextureSoftware::updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* data, int32_t pitchInPixels)
+    {
+        release_assert(!isDepth());
+        release_assert(x >= 0 && y >= 0 && x + width <= mInfo.width && y + height <= mInfo.height);
+        release_assert(layer >= 0 && layer < mInfo.arrayLayers);
+
+        if (mInfo.format == Format::R8UNorm)
+        {
+            for (int32_t row = 0; row < height; row++)
+                memcpy(mR8.data() + size_t(y + row) * mInfo.width + x, data + size_t(row) * pitchInPixels, size_t(width));
+            return;
+        }
+
+        uint32_t* destination = colorData(layer);
+        for (int32_t row = 0; row < height; row++)
+            memcpy(destination + size_t(y + row) * mInfo.width + x, data + size_t(row) * pitchInPixels * 4, size_t(width) * 4);
+    }
+
+    void TextureSoftware::readImageData(uint8_t* destination)
+    {
+        if (mInfo.format == Format::R8UNorm)
+        {
+            memcpy(destination, mR8.data(), layerSize());
+            return;
+        }
+
+        release_assert(mInfo.format == Format::RGBA8UNorm);
+        memcpy(destination, colorData(0), layerSize() * 4);
+    }
+
+    void TextureSoftware::clearColor(uint32_t packedColor)
+    {
+        release_assert(!isDepth());
+        std::fill(mColor.begin(), mColor.end(), packedColor);
+    }
+
+    void TextureSoftware::clearDepth(float depth)
+    {
+        release_assert(isDepth());
+        std::fill(mDepth.begin(), mDepth.end(), depth);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <render/texture.h>
+#include <vector>
+
+namespace Render
+{
+    class RenderInstanceSoftware;
+
+    /**
+     * @brief A texture stored in main memory.
+     *
+     * Colour textures hold packed RGBA8 texels (r, g, b, a in memory order), R8 textures one byte per texel and depth textures one float per texel.
+     * Rows are stored in OpenGL order, so texel row 0 of a texture used as a render target is the bottom of the image.
+     */
+    class TextureSoftware final : public Texture
+    {
+        using super = Texture;
+
+    public:
+        TextureSoftware(RenderInstanceSoftware& instance, const BaseTextureInfo& info);
+        ~TextureSoftware() override = default;
+
+        void updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* data, int32_t pitchInPixels) override;
+        void readImageData(uint8_t* destination) override;
+
+    public:
+        bool isDepth() const { return mInfo.format == Format::Depth24Stencil8; }
+
+        uint32_t* colorData(int32_t layer = 0) { return mColor.data() + size_t(layer) * layerSize(); }
+        const uint32_t* colorData(int32_t layer = 0) const { return mColor.data() + size_t(layer) * layerSize(); }
+        const uint8_t* r8Data() const { return mR8.data(); }
+        float* depthData() { return mDepth.data(); }
+
+        void clearColor(uint32_t packedColor);
+        void clearDepth(float depth);
+
+    private:
+        size_t layerSize() const { return size_t(mInfo.width) * size_t(mInfo.height); }
+
+    private:
+        std::vector<uint32_t> mColor;
+        std::vector<uint8_t> mR8;
+        std::vector<float> mDepth;
+    };
+}
@@ -0,0 +1,19 @@
+#include <misc/assert.h>
+#include <render/Software/vertexarrayobjectsoftware.h>
+
+namespace Render
+{
+    VertexArrayObjectSoftware::VertexArrayObjectSoftware(std::vector<size_t> bufferSizeCounts,
+                                                         std::vector<NonNullConstPtr<VertexLayout>> bindings,
+                                                         size_t indexBufferSizeInElements)
+        : super(std::move(bindings))
+    {
+        debug_assert(bufferSizeCounts.size() == mBindings.size());
+
+        for (size_t bindingIndex = 0; bindingIndex < mBindings.size(); bindingIndex++)
+            mBuffers.emplace_back(new BufferSoftware(bufferSizeCounts[bindingIndex]));
+
+        if (indexBufferSizeInElements > 0)
+            mIndexBuffer.reset(new BufferSoftware(indexBufferSizeInElements));
+    }
+}
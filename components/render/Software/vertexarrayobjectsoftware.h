@@ -0,0 +1,26 @@
+#pragma once
+#include <memory>
+#include <render/Software/buffersoftware.h>
+#include <render/vertexarrayobject.h>
+
+namespace Render
+{
+    class VertexArrayObjectSoftware final : public VertexArrayObject
+    {
+        using super = VertexArrayObject;
+
+    public:
+        VertexArrayObjectSoftware(std::vector<size_t> bufferSizeCounts, std::vector<NonNullConstPtr<VertexLayout>> bindings, size_t indexBufferSizeInElements);
+        ~VertexArrayObjectSoftware() override = default;
+
+        Buffer* getVertexBuffer(size_t index) override { return mBuffers[index].get(); }
+        Buffer* getIndexBuffer() override { return mIndexBuffer.get(); }
+
+        const BufferSoftware& getVertexBufferSoftware(size_t index) const { return *mBuffers[index]; }
+        const BufferSoftware* getIndexBufferSoftware() const { return mIndexBuffer.get(); }
+
+    private:
+        std::vector<std::unique_ptr<BufferSoftware>> mBuffers;
+        std::unique_ptr<BufferSoftware> mIndexBuffer;
+    };
+}
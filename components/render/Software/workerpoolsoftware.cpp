@@ -0,0 +1,78 @@
+#include <render/Software/workerpoolsoftware.h>
+
+namespace Render
+{
+    WorkerPoolSoftware::WorkerPoolSoftware(size_t threadCount)
+    {
+        for (size_t i = 0; i < threadCount; i++)
+            mThreads.emplace_back([this] { workerLoop(); });
+    }
+
+    WorkerPoolSoftware::~WorkerPoolSoftware()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQuit = true;
+        }
+        mWakeCondition.notify_all();
+
+        for (auto& thread : mThreads)
+            thread.join();
+    }
+
+    void WorkerPoolSoftware::run(size_t jobCount, const std::function<void(size_t)>& job)
+    {
+        if (mThreads.empty() || jobCount <= 1)
+        {
+            for (size_t i = 0; i < jobCount; i++)
+                job(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJob = &job;
+            mJobCount = jobCount;
+            mNextJob = 0;
+            mBusyWorkers = mThreads.size();
+            mGeneration++;
+        }
+        mWakeCondition.notify_all();
+
+        runJobs();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCondition.wait(lock, [&] { return mBusyWorkers == 0; });
+        mJob = nullptr;
+    }
+
+    void WorkerPoolSoftware::workerLoop()
+    {
+        uint64_t lastGeneration = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWakeCondition.wait(lock, [&] { return mQuit || mGeneration != lastGeneration; });
+
+                if (mQuit)
+                    return;
+
+                lastGeneration = mGeneration;
+            }
+
+            runJobs();
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mBusyWorkers == 0)
+                mDoneCondition.notify_one();
+        }
+    }
+
+    void WorkerPoolSoftware::runJobs()
+    {
+        for (size_t i = mNextJob++; i < mJobCount; i = mNextJob++)
+            (*mJob)(i);
+    }
+}
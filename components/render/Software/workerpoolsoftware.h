@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Render
+{
+    /// A fixed set of threads that the software renderer spreads tile jobs over.
+    /// Threads are started once and sleep between draws, so dispatching a draw costs a wakeup rather than a thread launch.
+    class WorkerPoolSoftware
+    {
+    public:
+        explicit WorkerPoolSoftware(size_t threadCount);
+        WorkerPoolSoftware(const WorkerPoolSoftware&) = delete;
+        ~WorkerPoolSoftware();
+
+        size_t getThreadCount() const { return mThreads.size(); }
+
+        /// Calls job(i) for every i in [0, jobCount), on the worker threads and the calling thread. Blocks until all jobs have finished.
+        void run(size_t jobCount, const std::function<void(size_t)>& job);
+
+    private:
+        void workerLoop();
+        void runJobs();
+
+    private:
+        std::vector<std::thread> mThreads;
+
+        std::mutex mMutex;
+        std::condition_variable mWakeCondition;
+        std::condition_variable mDoneCondition;
+
+        const std::function<void(size_t)>* mJob = nullptr;
+        size_t mJobCount = 0;
+        std::atomic<size_t> mNextJob{0};
+        size_t mBusyWorkers = 0;
+        uint64_t mGeneration = 0;
+        bool mQuit = false;
+    };
+}
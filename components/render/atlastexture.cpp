@@ -1,11 +1,11 @@
 #include "atlastexture.h"
 #include "texture.h"
-#include <filesystem/path.h>
+#include <cstring>
 #include <memory>
 #include <misc/assert.h>
-#include <misc/stringops.h>
 #include <render/commandqueue.h>
 #include <render/renderinstance.h>
+#include <type_traits>
 
 /* Stores many small textures into a large texture (or array of textures)
  * to allow batched drawing commands that increase performance. */
@@ -19,291 +19,255 @@ namespace Render
 
     AtlasTexture::~AtlasTexture() = default;
 
-    AtlasTexture::SpriteLoadResultMap AtlasTexture::loadSprites(const SpriteLoadInputMap& allSpriteData)
+    const TextureReference& AtlasTexture::addSprite(const Image& image, std::optional<Image::TrimmedData> trimmedData, const std::string& category)
     {
-        SpriteLoadResultMap result;
-
-        for (const auto& pair : allSpriteData)
-        {
-            const std::string& category = pair.first;
-            const std::vector<Render::AtlasTexture::LoadImageData>& images = pair.second;
+        Layers& categoryLayers = mLayersByCategory[category];
 
-            result[category] = addCategorySprites(category, images);
-        }
+        Image::TrimmedData usedData = trimmedData.value_or(Image::TrimmedData{0, 0, image.width(), image.height()});
+        if (usedData.trimmedWidth == 0 && usedData.trimmedHeight == 0)
+            return getEmptySprite(categoryLayers);
 
-        return result;
+        return packSprite(categoryLayers, image, usedData);
     }
 
-    std::vector<NonNullConstPtr<TextureReference>> AtlasTexture::addCategorySprites(const std::string& category, const std::vector<LoadImageData>& images)
+    const TextureReference&
+    AtlasTexture::addSprite(const IndexedImage& image, std::optional<Image::TrimmedData> trimmedData, const std::string& category, int32_t paletteRow)
     {
+        release_assert(paletteRow >= 0 && paletteRow < int32_t(mPalettes.size()));
         Layers& categoryLayers = mLayersByCategory[category];
 
-        int64_t requiredSize = 0;
-        for (const auto& imageData : images)
-        {
-            int32_t requiredWidth = imageData.trimmedData ? imageData.trimmedData->trimmedWidth : imageData.image.width();
-            int32_t requiredHeight = imageData.trimmedData ? imageData.trimmedData->trimmedHeight : imageData.image.height();
+        Image::TrimmedData usedData = trimmedData.value_or(Image::TrimmedData{0, 0, image.width(), image.height()});
+        if (usedData.trimmedWidth == 0 && usedData.trimmedHeight == 0)
+            return getEmptySprite(categoryLayers);
 
-            requiredSize += (requiredWidth + PADDING) * (requiredHeight + PADDING);
-        }
+        TextureReference& atlasEntry = packSprite(categoryLayers, image, usedData);
+        atlasEntry.mPaletteRow = paletteRow;
+        return atlasEntry;
+    }
 
-        while (requiredSize > 0)
+    const TextureReference& AtlasTexture::getEmptySprite(Layers& categoryLayers)
+    {
+        if (!categoryLayers.emptySpriteId)
         {
-            int32_t layerSize = mInstance.capabilities().maxTextureSize;
-            int64_t requiredSizePadded = requiredSize + (requiredSize / 100) * 2;
-
-            while (((layerSize / 2) * (layerSize / 2)) > requiredSizePadded)
-                layerSize = layerSize / 2;
-
-            requiredSize -= layerSize * layerSize;
-
-            int32_t layerWidth = layerSize;
-            int32_t layerHeight = layerSize;
-
-            // If we are about to create a layer where we're likely to waste a large chunk of it, just halve the height
-            if (requiredSize < 0 && layerSize != MINIMUM_ATLAS_SIZE)
-            {
-                int64_t unusedSpace = std::abs(requiredSize);
-                int64_t unusedSpacePadded = unusedSpace - (unusedSpace / 100) * 2;
-
-                if (unusedSpacePadded > (layerWidth * layerWidth) / 2)
-                    layerHeight = layerHeight / 2;
-            }
-
-            // Minimum size layers are added at need when we are actually uploading the data, no need to create it here.
-            // This means we shouldn't ever accidentally create a small layer at the end that we never use.
-            if (layerWidth != MINIMUM_ATLAS_SIZE || layerHeight != MINIMUM_ATLAS_SIZE)
-                categoryLayers.addLayer(mInstance, mCommandQueue, layerWidth, layerHeight);
+            Image blankImage(1, 1);
+            categoryLayers.emptySpriteId = &packSprite(categoryLayers, blankImage, Image::TrimmedData{0, 0, 1, 1});
         }
 
-        Image blankImage(1, 1);
-        categoryLayers.emptySpriteId = &this->addTexture(blankImage, std::nullopt, category);
-
-        std::vector<NonNullConstPtr<TextureReference>> ids;
-        ids.reserve(images.size());
-
-        for (const auto& imageData : images)
-            ids.push_back(&addTexture(imageData.image, imageData.trimmedData, category));
-
-        return ids;
+        return *categoryLayers.emptySpriteId;
     }
 
-    const TextureReference& AtlasTexture::addTexture(const Image& image, std::optional<Image::TrimmedData> trimmedData, std::string category)
+    template <typename ImageType>
+    TextureReference& AtlasTexture::packSprite(Layers& categoryLayers, const ImageType& image, const Image::TrimmedData& trimmedData)
     {
-        Layers& categoryLayers = mLayersByCategory.at(category);
+        constexpr bool indexed = std::is_same_v<ImageType, IndexedImage>;
+        constexpr Format format = indexed ? Format::R8UNorm : Format::RGBA8UNorm;
 
-        int32_t trimmedOffsetX = 0;
-        int32_t trimmedOffsetY = 0;
-        int32_t trimmedWidth = image.width();
-        int32_t trimmedHeight = image.height();
+        int32_t paddedWidth = trimmedData.trimmedWidth + PADDING;
+        int32_t paddedHeight = trimmedData.trimmedHeight + PADDING;
 
-        if (trimmedData)
-        {
-            trimmedOffsetX = trimmedData->trimmedOffsetX;
-            trimmedOffsetY = trimmedData->trimmedOffsetY;
-            trimmedWidth = trimmedData->trimmedWidth;
-            trimmedHeight = trimmedData->trimmedHeight;
-        }
-
-        if (trimmedWidth == 0 && trimmedHeight == 0)
-            return *categoryLayers.emptySpriteId;
+        // We don't know how much more is coming, so every layer is packed as if it was the largest size allowed.
+        // Its texture is cut down to the area that was actually used when it is uploaded.
+        int32_t layerSize = mInstance.capabilities().maxTextureSize;
+        release_assert(paddedWidth + PADDING <= layerSize && paddedHeight + PADDING <= layerSize);
 
-        RectPacker::Rect dataDestinationRect = {};
+        RectPacker::Rect packedPos{0, 0, paddedWidth, paddedHeight};
         Layer* layer = nullptr;
-        {
-            int32_t paddedWidth = trimmedWidth + PADDING;
-            int32_t paddedHeight = trimmedHeight + PADDING;
 
-            for (int32_t layerIndex = 0;; layerIndex++)
+        for (Layer& existingLayer : categoryLayers.layers)
+        {
+            if (!existingLayer.texture && existingLayer.format == format && existingLayer.rectPacker->addRect(packedPos))
             {
-                if (layerIndex >= int32_t(categoryLayers.layers.size()))
-                {
-                    // If we have a huge texture that won't fit, we just make a dedicated layer for it, otherwise we add a new layer for general use
-                    if ((trimmedWidth + PADDING * 2) >= MINIMUM_ATLAS_SIZE || (trimmedHeight + PADDING * 2) >= MINIMUM_ATLAS_SIZE)
-                        categoryLayers.addLayer(mInstance, mCommandQueue, trimmedWidth + PADDING * 2, trimmedHeight + PADDING * 2);
-                    else
-                        categoryLayers.addLayer(mInstance, mCommandQueue, MINIMUM_ATLAS_SIZE, MINIMUM_ATLAS_SIZE);
-                }
-
-                layer = &categoryLayers.layers[layerIndex];
-
-                RectPacker::Rect packedPos{0, 0, paddedWidth, paddedHeight};
-                if (layer->rectPacker->addRect(packedPos))
-                {
-                    dataDestinationRect = {packedPos.x + PADDING, packedPos.y + PADDING, trimmedWidth, trimmedHeight};
-                    break;
-                }
+                layer = &existingLayer;
+                break;
             }
         }
 
-        const uint8_t* firstPixel = reinterpret_cast<const uint8_t*>(&image.get(trimmedOffsetX, trimmedOffsetY));
-        layer->texture->updateImageData(dataDestinationRect.x, dataDestinationRect.y, 0, trimmedWidth, trimmedHeight, firstPixel, image.width());
+        if (!layer)
+        {
+            categoryLayers.layers.emplace_back();
+            layer = &categoryLayers.layers.back();
+            layer->format = format;
+            layer->rectPacker = std::make_unique<RectPacker>(layerSize - PADDING, layerSize - PADDING);
+
+            bool added = layer->rectPacker->addRect(packedPos);
+            release_assert(added);
+        }
 
         TextureReference* atlasEntry = new TextureReference(TextureReference::Tag{});
-        atlasEntry->mX = dataDestinationRect.x;
-        atlasEntry->mY = dataDestinationRect.y;
+        atlasEntry->mX = packedPos.x + PADDING;
+        atlasEntry->mY = packedPos.y + PADDING;
         atlasEntry->mWidth = image.width();
         atlasEntry->mHeight = image.height();
-        atlasEntry->mTrimmedOffsetX = trimmedOffsetX;
-        atlasEntry->mTrimmedOffsetY = trimmedOffsetY;
-        atlasEntry->mTrimmedWidth = trimmedWidth;
-        atlasEntry->mTrimmedHeight = trimmedHeight;
-        atlasEntry->mTexture = layer->texture.get();
-
+        atlasEntry->mTrimmedOffsetX = trimmedData.trimmedOffsetX;
+        atlasEntry->mTrimmedOffsetY = trimmedData.trimmedOffsetY;
+        atlasEntry->mTrimmedWidth = trimmedData.trimmedWidth;
+        atlasEntry->mTrimmedHeight = trimmedData.trimmedHeight;
         mAtlasEntries.emplace_back(atlasEntry);
-        return *atlasEntry;
-    }
 
-    void AtlasTexture::printUtilisation() const
-    {
-        printf("Texture atlas utilisation by category:\n");
+        // Only keep the trimmed pixels, so the caller can free the decoded image as soon as we return
+        PendingSprite& pending = layer->pendingSprites.emplace_back();
+        pending.reference = atlasEntry;
 
-        for (const auto& pair : mLayersByCategory)
+        if constexpr (indexed)
         {
-            printf("    %s:\n", pair.first.c_str());
-
-            const Layers& categoryLayer = pair.second;
+            pending.indices = IndexedImage(trimmedData.trimmedWidth, trimmedData.trimmedHeight);
+            image.blitTo(
+                pending.indices, trimmedData.trimmedOffsetX, trimmedData.trimmedOffsetY, trimmedData.trimmedWidth, trimmedData.trimmedHeight, 0, 0);
+        }
+        else
+        {
+            pending.pixels = Image(trimmedData.trimmedWidth, trimmedData.trimmedHeight);
+            image.blitTo(pending.pixels,
+                         trimmedData.trimmedOffsetX,
+                         trimmedData.trimmedOffsetY,
+                         trimmedData.trimmedWidth,
+                         trimmedData.trimmedHeight,
+                         0,
+                         0,
+                         true);
+        }
 
-            float summedOccupancy = 0;
-            for (int32_t i = 0; i < int32_t(categoryLayer.layers.size()); i++)
-            {
-                const RectPacker& rectPacker = *categoryLayer.layers[i].rectPacker;
-                int32_t width = categoryLayer.layers[i].texture->width();
-                int32_t height = categoryLayer.layers[i].texture->height();
-                printf("        Layer %d (%dx%d) utilisation %.1f%%\n", i, width, height, rectPacker.utilisation() * 100.0f);
-                summedOccupancy += rectPacker.utilisation();
-            }
+        layer->packedWidth = std::max(layer->packedWidth, atlasEntry->mX + atlasEntry->mTrimmedWidth);
+        layer->packedHeight = std::max(layer->packedHeight, atlasEntry->mY + atlasEntry->mTrimmedHeight);
 
-            if (categoryLayer.layers.size() > 1)
-                printf("        All layers utilisation %.1f%%\n", (summedOccupancy / categoryLayer.layers.size()) * 100.0f);
-        }
+        return *atlasEntry;
     }
 
-    void AtlasTexture::saveTexturesToCache(const filesystem::path& atlasPath) const
+    int32_t AtlasTexture::uploadPendingSprites()
     {
-        for (const auto& pair : mLayersByCategory)
+        std::vector<Layer*> layersToUpload;
+        for (auto& pair : mLayersByCategory)
         {
-            const std::string& category = pair.first;
-            const Layers& layers = pair.second;
-
-            filesystem::path destinationFolder = atlasPath / category;
-            if (!filesystem::exists(destinationFolder))
-                release_assert(filesystem::create_directories(destinationFolder));
-
-            for (size_t i = 0; i < layers.layers.size(); i++)
+            for (Layer& layer : pair.second.layers)
             {
-                Render::Texture& texture = *layers.layers[i].texture;
-                Image image(texture.width(), texture.height());
+                if (!layer.pendingSprites.empty())
+                    layersToUpload.push_back(&layer);
+            }
+        }
 
-                texture.readImageData(reinterpret_cast<uint8_t*>(image.mData.data()));
+        uploadPalettes();
 
-                std::ostringstream ss;
-                ss << std::setfill('0') << std::setw(2) << i;
+        if (layersToUpload.empty())
+            return 0;
 
-                FILE* f = fopen((destinationFolder / (ss.str() + ".dmp")).str().c_str(), "wb");
+        for (Layer* layer : layersToUpload)
+        {
+            BaseTextureInfo textureInfo{};
+            textureInfo.width = layer->packedWidth + PADDING;
+            textureInfo.height = layer->packedHeight + PADDING;
+            textureInfo.arrayLayers = 1;
+            textureInfo.format = layer->format;
+            textureInfo.minFilter = Filter::Nearest;
+            textureInfo.magFilter = Filter::Nearest;
 
-                int32_t sizes[] = {image.width(), image.height()};
-                fwrite(sizes, sizeof(int32_t), 2, f);
-                fwrite(image.mData.data(), 1, image.width() * image.height() * 4, f);
+            layer->texture = mInstance.createTexture(textureInfo);
+            mCommandQueue.cmdClearTexture(*layer->texture, Colors::transparent);
 
-                fclose(f);
+            // Each sprite is written straight into its rectangle, so there is never a copy of the whole layer on the CPU
+            for (PendingSprite& sprite : layer->pendingSprites)
+            {
+                TextureReference& reference = *sprite.reference;
+                const uint8_t* data = layer->format == Format::R8UNorm ? sprite.indices.mData.data()
+                                                                       : reinterpret_cast<const uint8_t*>(sprite.pixels.mData.data());
 
-                // for debugging
-                // Image::saveToPng(image, (destinationFolder / (ss.str() + ".png")).str());
+                layer->texture->updateImageData(
+                    reference.mX, reference.mY, 0, reference.mTrimmedWidth, reference.mTrimmedHeight, data, reference.mTrimmedWidth);
+                reference.mTexture = layer->texture.get();
             }
+
+            layer->pendingSprites.clear();
+            layer->pendingSprites.shrink_to_fit();
         }
+
+        return int32_t(layersToUpload.size());
     }
 
-    void AtlasTexture::loadTexturesFromCache(const filesystem::path& atlasPath)
+    int32_t AtlasTexture::addPalette(const IndexedPalette::Colours& colours)
     {
-        for (auto& categoryEntry : filesystem::directory_iterator(atlasPath))
+        for (int32_t i = 0; i < int32_t(mPalettes.size()); i++)
         {
-            if (!categoryEntry.path().is_directory())
-                continue;
+            if (memcmp(mPalettes[i].data(), colours.data(), sizeof(colours)) == 0)
+                return i;
+        }
 
-            Layers categoryLayers;
+        release_assert(int32_t(mPalettes.size()) < mInstance.capabilities().maxTextureSize);
+        mPalettes.push_back(colours);
+        return int32_t(mPalettes.size()) - 1;
+    }
 
-            std::string category = categoryEntry.path().filename();
+    void AtlasTexture::uploadPalettes()
+    {
+        if (mPaletteTexture && mPaletteTexture->height() == std::max(int32_t(mPalettes.size()), 1))
+            return;
+
+        BaseTextureInfo textureInfo{};
+        textureInfo.width = IndexedPalette::SIZE;
+        textureInfo.height = std::max(int32_t(mPalettes.size()), 1);
+        textureInfo.arrayLayers = 1;
+        textureInfo.format = Format::RGBA8UNorm;
+        textureInfo.minFilter = Filter::Nearest;
+        textureInfo.magFilter = Filter::Nearest;
+
+        mPaletteTexture = mInstance.createTexture(textureInfo);
+        if (!mPalettes.empty())
+            mPaletteTexture->updateImageData(
+                0, 0, 0, IndexedPalette::SIZE, int32_t(mPalettes.size()), reinterpret_cast<const uint8_t*>(mPalettes.data()), IndexedPalette::SIZE);
+    }
 
-            std::vector<filesystem::path> sortedFilesToLoad;
-            for (auto& imageEntry : filesystem::directory_iterator(categoryEntry.path()))
-            {
-                if (Misc::StringUtils::getFileExtension(imageEntry.path().filename()) != "dmp")
-                    continue;
-                sortedFilesToLoad.emplace_back(imageEntry.path());
-            }
-            std::sort(sortedFilesToLoad.begin(), sortedFilesToLoad.end());
+    Texture& AtlasTexture::getPaletteTexture() const
+    {
+        release_assert(mPaletteTexture);
+        return *mPaletteTexture;
+    }
 
-            for (int32_t i = 0; i < int32_t(sortedFilesToLoad.size()); i++)
-            {
-                std::ostringstream ss;
-                ss << std::setfill('0') << std::setw(2) << i;
+    void AtlasTexture::printUtilisation() const
+    {
+        printf("Texture atlas utilisation by category:\n");
 
-                std::string filename = ss.str() + ".dmp";
+        for (const auto& pair : mLayersByCategory)
+        {
+            printf("    %s:\n", pair.first.c_str());
 
-                if (sortedFilesToLoad[i].filename() != filename)
-                    throw std::runtime_error("missing layer");
-            }
+            const Layers& categoryLayer = pair.second;
 
-            for (auto& path : sortedFilesToLoad)
+            float summedOccupancy = 0;
+            for (int32_t i = 0; i < int32_t(categoryLayer.layers.size()); i++)
             {
-                Image image;
-                {
-                    FILE* f = fopen(path.str().c_str(), "rb");
-
-                    int32_t sizes[] = {0, 0};
-                    fread(sizes, sizeof(int32_t), 2, f);
-
-                    if (sizes[0] < 0 || sizes[0] > mInstance.capabilities().maxTextureSize || sizes[1] < 0 ||
-                        sizes[1] > mInstance.capabilities().maxTextureSize)
-                        throw std::runtime_error("Texture is too large");
-
-                    image = Image(sizes[0], sizes[1]);
-                    fread(image.mData.data(), 1, image.width() * image.height() * 4, f);
-
-                    fclose(f);
-                }
-
-                Layer newLayer;
-                {
-                    BaseTextureInfo textureInfo{};
-                    textureInfo.width = image.width();
-                    textureInfo.height = image.height();
-                    textureInfo.arrayLayers = 1;
-                    textureInfo.format = Format::RGBA8UNorm;
-                    textureInfo.minFilter = Filter::Nearest;
-                    textureInfo.magFilter = Filter::Nearest;
-
-                    newLayer.texture = mInstance.createTexture(textureInfo);
-                }
-
-                newLayer.texture->updateImageData(0, 0, 0, image.width(), image.height(), reinterpret_cast<const uint8_t*>(image.mData.data()), image.width());
+                const RectPacker& rectPacker = *categoryLayer.layers[i].rectPacker;
+                int32_t width = categoryLayer.layers[i].texture->width();
+                int32_t height = categoryLayer.layers[i].texture->height();
 
-                categoryLayers.layers.push_back(std::move(newLayer));
+                // The packer covers the largest possible layer, but the texture only the part of it that was used
+                float utilisation = float(rectPacker.usedArea()) / (float(width) * float(height));
+                const char* format = categoryLayer.layers[i].format == Format::R8UNorm ? ", indexed" : "";
+                printf("        Layer %d (%dx%d%s) utilisation %.1f%%\n", i, width, height, format, utilisation * 100.0f);
+                summedOccupancy += utilisation;
             }
 
-            mLayersByCategory[category] = std::move(categoryLayers);
+            if (categoryLayer.layers.size() > 1)
+                printf("        All layers utilisation %.1f%%\n", (summedOccupancy / categoryLayer.layers.size()) * 100.0f);
         }
     }
 
-    void AtlasTexture::Layers::addLayer(RenderInstance& instance, CommandQueue& commandQueue, int32_t width, int32_t height)
+    Texture& AtlasTexture::addLazyLayer(const std::string& category, int32_t width, int32_t height, Format format, std::function<void(Texture&)> provideData)
     {
-        Layer newLayer;
-        newLayer.rectPacker = std::make_unique<RectPacker>(width - PADDING, height - PADDING);
+        release_assert(format == Format::RGBA8UNorm || format == Format::R8UNorm);
 
-        {
-            BaseTextureInfo textureInfo{};
-            textureInfo.width = width;
-            textureInfo.height = height;
-            textureInfo.arrayLayers = 1;
-            textureInfo.format = Format::RGBA8UNorm;
-            textureInfo.minFilter = Filter::Nearest;
-            textureInfo.magFilter = Filter::Nearest;
+        BaseTextureInfo textureInfo{};
+        textureInfo.width = width;
+        textureInfo.height = height;
+        textureInfo.arrayLayers = 1;
+        textureInfo.format = format;
+        textureInfo.minFilter = Filter::Nearest;
+        textureInfo.magFilter = Filter::Nearest;
 
-            newLayer.texture = instance.createTexture(textureInfo);
-            commandQueue.cmdClearTexture(*newLayer.texture, Colors::transparent);
-        }
+        Layer newLayer;
+        newLayer.format = format;
+        newLayer.texture = mInstance.createTexture(textureInfo);
+        newLayer.texture->setPendingData(std::move(provideData));
 
-        layers.push_back(std::move(newLayer));
+        Texture& texture = *newLayer.texture;
+        mLayersByCategory[category].layers.push_back(std::move(newLayer));
+        return texture;
     }
 }
@@ -1,13 +1,16 @@
 #pragma once
 #include <Image/image.h>
+#include <Image/indexedimage.h>
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <misc/misc.h>
 #include <optional>
 #include <render/rectpack.h>
 #include <render/texturereference.h>
+#include <render/vertexlayout.h>
 #include <unordered_map>
 #include <vector>
 
@@ -24,41 +27,65 @@ namespace Render
         explicit AtlasTexture(RenderInstance& instance, CommandQueue& commandQueue);
         ~AtlasTexture();
 
-        struct LoadImageData
-        {
-            const Image& image;
-            std::optional<Image::TrimmedData> trimmedData;
-        };
+        // Packs the image into a layer of its category straight away, but only copies its pixels aside.
+        // The returned reference has no texture until uploadPendingSprites is called.
+        const TextureReference& addSprite(const Image& image, std::optional<Image::TrimmedData> trimmedData, const std::string& category);
+
+        // Indexed sprites go in separate R8 layers of the same category, and are drawn through the palette row that addPalette returned
+        const TextureReference&
+        addSprite(const IndexedImage& image, std::optional<Image::TrimmedData> trimmedData, const std::string& category, int32_t paletteRow);
+
+        // Returns the row of the palette texture that holds these colours, sprites with the same palette share a row
+        int32_t addPalette(const IndexedPalette::Colours& colours);
+        const std::vector<IndexedPalette::Colours>& getPalettes() const { return mPalettes; }
+
+        // Creates the textures for all layers with sprites added since the last call, and writes each sprite into its rectangle.
+        // Returns the number of layers uploaded. Uploaded layers are closed, later sprites go into new layers.
+        int32_t uploadPendingSprites();
+
+        // (Re)creates the palette texture from all palettes added so far, this is done by uploadPendingSprites too
+        void uploadPalettes();
 
-        typedef std::unordered_map<std::string, std::vector<LoadImageData>> SpriteLoadInputMap;
-        typedef std::unordered_map<std::string, std::vector<NonNullConstPtr<TextureReference>>> SpriteLoadResultMap;
+        // One RGBA8 row of IndexedPalette::SIZE colours per palette. There is always one, so it can be bound even when nothing is indexed.
+        Texture& getPaletteTexture() const;
 
-        SpriteLoadResultMap loadSprites(const SpriteLoadInputMap& allSpriteData);
         void printUtilisation() const;
 
-        void saveTexturesToCache(const filesystem::path& atlasPath) const;
-        void loadTexturesFromCache(const filesystem::path& atlasPath);
+        // Adds a finished layer whose pixels are only provided (through provideData) the first time it is drawn from
+        Texture& addLazyLayer(const std::string& category, int32_t width, int32_t height, Format format, std::function<void(Texture&)> provideData);
         void replaceTextureEntries(std::vector<std::unique_ptr<TextureReference>>&& entries) { mAtlasEntries = std::move(entries); }
 
+        struct PendingSprite
+        {
+            TextureReference* reference = nullptr;
+            Image pixels;
+            IndexedImage indices; ///< Used instead of pixels in indexed layers
+        };
+
         struct Layer
         {
+            Format format = Format::RGBA8UNorm; ///< RGBA8UNorm, or R8UNorm for indexed sprites
             std::unique_ptr<Texture> texture;
             std::unique_ptr<RectPacker> rectPacker;
+
+            // Sprites packed into this layer, waiting for its texture to be created
+            std::vector<PendingSprite> pendingSprites;
+            int32_t packedWidth = 0;
+            int32_t packedHeight = 0;
         };
 
         struct Layers
         {
             const TextureReference* emptySpriteId = nullptr;
             std::vector<Layer> layers;
-            void addLayer(RenderInstance& instance, CommandQueue& commandQueue, int32_t width, int32_t height);
         };
         const std::unordered_map<std::string, Layers>& getLayersByCategory() const { return mLayersByCategory; }
 
         static constexpr int32_t PADDING = 2;
 
     private:
-        std::vector<NonNullConstPtr<TextureReference>> addCategorySprites(const std::string& category, const std::vector<LoadImageData>& images);
-        const TextureReference& addTexture(const Image& image, std::optional<Image::TrimmedData> trimmedData = std::nullopt, std::string category = "default");
+        template <typename ImageType> TextureReference& packSprite(Layers& categoryLayers, const ImageType& image, const Image::TrimmedData& trimmedData);
+        const TextureReference& getEmptySprite(Layers& categoryLayers);
 
     private:
         static constexpr int32_t MINIMUM_ATLAS_SIZE = 1024;
@@ -69,5 +96,8 @@ namespace Render
         std::vector<std::unique_ptr<TextureReference>> mAtlasEntries;
 
         std::unordered_map<std::string, Layers> mLayersByCategory;
+
+        std::vector<IndexedPalette::Colours> mPalettes;
+        std::unique_ptr<Texture> mPaletteTexture;
     };
 }
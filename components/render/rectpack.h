@@ -18,6 +18,7 @@ namespace Render
         // NOTE! sort rects by height (descending) before calling this, or utilisation will be terrible
         bool addRect(Rect& rect);
         float utilisation() const { return float(usedSurfaceArea) / totalSurfaceArea; }
+        int32_t usedArea() const { return usedSurfaceArea; }
 
     private:
         std::vector<std::unique_ptr<Rect>> spaces;
@@ -1,10 +1,10 @@
 #pragma once
 #include <cstdint>
 #include <misc/simplevec2.h>
+#include <render/renderinstance.h>
 
 namespace Render
 {
-    class RenderInstance;
     class CommandQueue;
 
     extern int32_t WIDTH;
@@ -33,6 +33,7 @@ namespace Render
         int32_t windowWidth;
         int32_t windowHeight;
         bool fullscreen;
+        RenderInstance::Type renderer = RenderInstance::Type::OpenGL;
     };
 
     void init(const std::string& title, const RenderSettings& settings);
@@ -2,6 +2,7 @@
 #include <glad/glad.h>
 #include <misc/misc.h>
 #include <render/OpenGL/renderinstanceopengl.h>
+#include <render/Software/renderinstancesoftware.h>
 
 namespace Render
 {
@@ -11,6 +12,8 @@ namespace Render
         {
             case Type::OpenGL:
                 return new RenderInstanceOpenGL(window);
+            case Type::Software:
+                return new RenderInstanceSoftware(window);
         }
 
         invalid_enum(Type, type);
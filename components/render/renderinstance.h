@@ -30,7 +30,7 @@ namespace Render
     {
     public:
         RenderInstance(RenderInstance&) = delete;
-        explicit RenderInstance(SDL_Window& window) : mWindow(window) {}
+        explicit RenderInstance(SDL_Window* window) : mWindow(window) {}
         virtual ~RenderInstance() = default;
 
         virtual std::unique_ptr<DescriptorSet> createDescriptorSet(DescriptorSetSpec spec) = 0;
@@ -49,12 +49,13 @@ namespace Render
 
         enum class Type
         {
-            OpenGL
+            OpenGL,
+            Software,
         };
         static RenderInstance* createRenderInstance(Type type, SDL_Window& window);
 
     public:
-        SDL_Window& mWindow;
+        SDL_Window* mWindow = nullptr; ///< nullptr for offscreen instances
 
     protected:
         RenderCapabilities mRenderCapabilities = {};
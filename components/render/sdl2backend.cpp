@@ -43,7 +43,7 @@ namespace Render
     {
         WIDTH = settings.windowWidth;
         HEIGHT = settings.windowHeight;
-        int flags = SDL_WINDOW_OPENGL;
+        int flags = settings.renderer == RenderInstance::Type::OpenGL ? SDL_WINDOW_OPENGL : 0;
         windowTitle = title;
 
         if (settings.fullscreen)
@@ -60,7 +60,7 @@ namespace Render
         if (screen == nullptr)
             printf("Could not create window: %s\n", SDL_GetError());
 
-        renderInstance = RenderInstance::createRenderInstance(RenderInstance::Type::OpenGL, *screen);
+        renderInstance = RenderInstance::createRenderInstance(settings.renderer, *screen);
         mainCommandQueue = renderInstance->createCommandQueue().release();
         mainCommandQueue->begin();
 
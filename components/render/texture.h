@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <functional>
 #include <render/vertexlayout.h>
 
 namespace Render
@@ -36,9 +37,23 @@ namespace Render
         int32_t width() const { return mInfo.width; }
         int32_t height() const { return mInfo.height; }
 
-        virtual void
-        updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* rgba8UnormData, int32_t pitchInPixels) = 0;
-        virtual void readImageData(uint8_t* rgba8UnormDestination) = 0;
+        // Image data is tightly packed texels of the texture's own format, which must be RGBA8UNorm or R8UNorm
+        virtual void updateImageData(int32_t x, int32_t y, int32_t layer, int32_t width, int32_t height, const uint8_t* data, int32_t pitchInPixels) = 0;
+        virtual void readImageData(uint8_t* destination) = 0;
+
+        // Lets the contents be provided the first time the texture is drawn from, rather than when it is created.
+        // The backends call resolvePendingData when binding a texture, so the provider runs on the render thread.
+        void setPendingData(std::function<void(Texture&)> provideData) { mPendingData = std::move(provideData); }
+        bool hasPendingData() const { return bool(mPendingData); }
+        void resolvePendingData()
+        {
+            if (!mPendingData)
+                return;
+
+            std::function<void(Texture&)> provideData = std::move(mPendingData);
+            mPendingData = nullptr;
+            provideData(*this);
+        }
 
         virtual void setFilter(Filter minFilter, Filter magFilter)
         {
@@ -49,5 +64,8 @@ namespace Render
     protected:
         RenderInstance& mInstance;
         BaseTextureInfo mInfo;
+
+    private:
+        std::function<void(Texture&)> mPendingData;
     };
 }
\ No newline at end of file
@@ -43,6 +43,9 @@ namespace Render
 
         Render::Texture* mTexture = nullptr;
 
+        // Row of the atlas palette texture that the texels are looked up in, if mTexture is an indexed (R8) layer
+        int32_t mPaletteRow = -1;
+
     protected:
         struct Tag
         {
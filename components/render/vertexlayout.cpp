@@ -9,6 +9,8 @@ namespace Render
         {
             case Format::RGBA8UNorm:
                 return 4;
+            case Format::R8UNorm:
+                return 1;
             case Format::RGBA32F:
                 return 4 * 4;
             case Format::RGB32F:
@@ -7,6 +7,7 @@ namespace Render
     enum class Format
     {
         RGBA8UNorm,
+        R8UNorm,
         RGBA32F,
         RGB32F,
         RG32F,
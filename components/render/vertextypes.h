@@ -70,6 +70,7 @@ namespace Render
         int16_t v_destinationInPixels[2];
         uint8_t v_hoverColor[4];
         uint16_t v_atlasOffsetInPixels[2];
+        float v_paletteRow; ///< Row of the palette texture that an indexed atlas layer is resolved through, or -1 for RGBA layers
 
         static const VertexLayout& layout()
         {
@@ -79,6 +80,7 @@ namespace Render
                                            Format::RG16I,
                                            Format::RGBA8UNorm,
                                            Format::RG16U,
+                                           Format::R32F,
                                        },
                                        VertexInputRate::ByInstance};
 
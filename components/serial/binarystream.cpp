@@ -0,0 +1,302 @@
+#include "binarystream.h"
+#include <limits>
+#include <misc/assert.h>
+
+namespace Serial
+{
+    namespace
+    {
+        // Type tags are only written in debug builds, see the comment in binarystream.h
+#ifdef NDEBUG
+        constexpr bool WRITE_TYPED = false;
+#else
+        constexpr bool WRITE_TYPED = true;
+#endif
+
+        namespace Tag
+        {
+            enum : uint8_t
+            {
+                Bool = 1,
+                I64,
+                U64,
+                I32,
+                U32,
+                I16,
+                U16,
+                I8,
+                U8,
+                String,
+                Category,
+                CategoryEnd,
+            };
+        }
+
+        uint64_t zigzagEncode(int64_t val) { return (uint64_t(val) << 1) ^ uint64_t(val >> 63); }
+        int64_t zigzagDecode(uint64_t val) { return int64_t(val >> 1) ^ -int64_t(val & 1); }
+
+        template <typename T> T checkedNarrow(int64_t val)
+        {
+            release_assert(val >= int64_t(std::numeric_limits<T>::min()) && val <= int64_t(std::numeric_limits<T>::max()));
+            return T(val);
+        }
+
+        template <typename T> T checkedNarrow(uint64_t val)
+        {
+            release_assert(val <= uint64_t(std::numeric_limits<T>::max()));
+            return T(val);
+        }
+    }
+
+    BinaryReadStream::BinaryReadStream(const uint8_t* data, size_t size) : mData(data), mSize(size)
+    {
+        uint8_t magic = readByte();
+        release_assert(magic == BinaryStreamHeader::Magic);
+        uint8_t flags = readByte();
+        mTyped = flags & BinaryStreamHeader::FlagTyped;
+    }
+
+    uint8_t BinaryReadStream::readByte()
+    {
+        release_assert(mPosition < mSize);
+        return mData[mPosition++];
+    }
+
+    uint64_t BinaryReadStream::readVarUint()
+    {
+        uint64_t val = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7)
+        {
+            uint8_t byte = readByte();
+            val |= uint64_t(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+                return val;
+        }
+
+        message_and_abort("malformed varint in binary stream");
+    }
+
+    int64_t BinaryReadStream::readVarInt() { return zigzagDecode(readVarUint()); }
+
+    std::string BinaryReadStream::readRawString()
+    {
+        uint64_t size = readVarUint();
+        release_assert(size <= mSize - mPosition);
+
+        std::string retval(reinterpret_cast<const char*>(mData) + mPosition, size_t(size));
+        mPosition += size_t(size);
+        return retval;
+    }
+
+    void BinaryReadStream::readTag(uint8_t expectedTag)
+    {
+        if (!mTyped)
+            return;
+
+        uint8_t tag = readByte();
+
+        // Loading code doesn't have to mirror the categories used when saving, so skip over them, like TextReadStream does
+        while (tag == Tag::Category || tag == Tag::CategoryEnd)
+        {
+            readRawString();
+            tag = readByte();
+        }
+
+        release_assert(tag == expectedTag);
+    }
+
+    bool BinaryReadStream::read_bool()
+    {
+        readTag(Tag::Bool);
+        uint8_t val = readByte();
+        release_assert(val <= 1);
+        return val == 1;
+    }
+
+    int64_t BinaryReadStream::read_int64_t()
+    {
+        readTag(Tag::I64);
+        return readVarInt();
+    }
+
+    uint64_t BinaryReadStream::read_uint64_t()
+    {
+        readTag(Tag::U64);
+        return readVarUint();
+    }
+
+    int32_t BinaryReadStream::read_int32_t()
+    {
+        readTag(Tag::I32);
+        return checkedNarrow<int32_t>(readVarInt());
+    }
+
+    uint32_t BinaryReadStream::read_uint32_t()
+    {
+        readTag(Tag::U32);
+        return checkedNarrow<uint32_t>(readVarUint());
+    }
+
+    int16_t BinaryReadStream::read_int16_t()
+    {
+        readTag(Tag::I16);
+        return checkedNarrow<int16_t>(readVarInt());
+    }
+
+    uint16_t BinaryReadStream::read_uint16_t()
+    {
+        readTag(Tag::U16);
+        return checkedNarrow<uint16_t>(readVarUint());
+    }
+
+    int8_t BinaryReadStream::read_int8_t()
+    {
+        readTag(Tag::I8);
+        return int8_t(readByte());
+    }
+
+    uint8_t BinaryReadStream::read_uint8_t()
+    {
+        readTag(Tag::U8);
+        return readByte();
+    }
+
+    std::string BinaryReadStream::read_string()
+    {
+        readTag(Tag::String);
+        return readRawString();
+    }
+
+    void BinaryReadStream::readCategoryMarker(uint8_t expectedTag, const std::string& name)
+    {
+        if (!mTyped)
+            return;
+
+        release_assert(readByte() == expectedTag);
+        std::string data = readRawString();
+        release_assert(name == data);
+    }
+
+    void BinaryReadStream::startCategory(const std::string& name) { readCategoryMarker(Tag::Category, name); }
+
+    void BinaryReadStream::endCategory(const std::string& name) { readCategoryMarker(Tag::CategoryEnd, name); }
+
+    BinaryWriteStream::BinaryWriteStream()
+    {
+        mData.push_back(BinaryStreamHeader::Magic);
+        mData.push_back(WRITE_TYPED ? BinaryStreamHeader::FlagTyped : 0);
+    }
+
+    size_t BinaryWriteStream::getCurrentSize() const { return mData.size(); }
+
+    void BinaryWriteStream::resize(size_t size)
+    {
+        release_assert(size >= BinaryStreamHeader::Size);
+        mData.resize(size);
+    }
+
+    std::pair<uint8_t*, size_t> BinaryWriteStream::getData() { return std::make_pair(mData.data(), mData.size()); }
+
+    void BinaryWriteStream::writeTag(uint8_t tag)
+    {
+        if (WRITE_TYPED)
+            mData.push_back(tag);
+    }
+
+    void BinaryWriteStream::writeVarUint(uint64_t val)
+    {
+        while (val >= 0x80)
+        {
+            mData.push_back(uint8_t(val) | 0x80);
+            val >>= 7;
+        }
+        mData.push_back(uint8_t(val));
+    }
+
+    void BinaryWriteStream::writeVarInt(int64_t val) { writeVarUint(zigzagEncode(val)); }
+
+    void BinaryWriteStream::writeRawString(const std::string& val)
+    {
+        writeVarUint(val.size());
+        mData.insert(mData.end(), val.begin(), val.end());
+    }
+
+    void BinaryWriteStream::write(bool val)
+    {
+        writeTag(Tag::Bool);
+        mData.push_back(val ? 1 : 0);
+    }
+
+    void BinaryWriteStream::write(int64_t val)
+    {
+        writeTag(Tag::I64);
+        writeVarInt(val);
+    }
+
+    void BinaryWriteStream::write(uint64_t val)
+    {
+        writeTag(Tag::U64);
+        writeVarUint(val);
+    }
+
+    void BinaryWriteStream::write(int32_t val)
+    {
+        writeTag(Tag::I32);
+        writeVarInt(val);
+    }
+
+    void BinaryWriteStream::write(uint32_t val)
+    {
+        writeTag(Tag::U32);
+        writeVarUint(val);
+    }
+
+    void BinaryWriteStream::write(int16_t val)
+    {
+        writeTag(Tag::I16);
+        writeVarInt(val);
+    }
+
+    void BinaryWriteStream::write(uint16_t val)
+    {
+        writeTag(Tag::U16);
+        writeVarUint(val);
+    }
+
+    void BinaryWriteStream::write(int8_t val)
+    {
+        writeTag(Tag::I8);
+        mData.push_back(uint8_t(val));
+    }
+
+    void BinaryWriteStream::write(uint8_t val)
+    {
+        writeTag(Tag::U8);
+        mData.push_back(val);
+    }
+
+    void BinaryWriteStream::write(const std::string& val)
+    {
+        writeTag(Tag::String);
+        writeRawString(val);
+    }
+
+    void BinaryWriteStream::startCategory(const std::string& name)
+    {
+        if (!WRITE_TYPED)
+            return;
+
+        mData.push_back(Tag::Category);
+        writeRawString(name);
+    }
+
+    void BinaryWriteStream::endCategory(const std::string& name)
+    {
+        if (!WRITE_TYPED)
+            return;
+
+        mData.push_back(Tag::CategoryEnd);
+        writeRawString(name);
+    }
+}
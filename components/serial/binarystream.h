@@ -0,0 +1,88 @@
+#pragma once
+#include "streaminterface.h"
+#include <string>
+#include <vector>
+
+namespace Serial
+{
+    // Compact binary encoding of the same data the Text streams handle.
+    // Integers are stored as LEB128 varints (zigzag encoded if signed), which makes the format endian-independent,
+    // and strings are length prefixed.
+    // Debug builds additionally prefix every value with a type tag and write category markers, so mismatched save / load
+    // code is caught like it is with text streams. Readers handle both variants, so debug and release builds can still talk to each other.
+    // The stream begins with a small header, so readers can tell binary and text data apart (see streamformat.h).
+    namespace BinaryStreamHeader
+    {
+        static constexpr uint8_t Magic = 0xFA;
+        static constexpr uint8_t FlagTyped = 1 << 0;
+        static constexpr size_t Size = 2;
+    }
+
+    // Reads directly from the data passed in, without copying it, so the data must outlive the stream
+    class BinaryReadStream : public ReadStreamInterface
+    {
+    public:
+        BinaryReadStream(const uint8_t* data, size_t size);
+        explicit BinaryReadStream(const std::string& data) : BinaryReadStream(reinterpret_cast<const uint8_t*>(data.data()), data.size()) {}
+        explicit BinaryReadStream(std::string&&) = delete;
+
+        virtual bool read_bool() override;
+        virtual int64_t read_int64_t() override;
+        virtual uint64_t read_uint64_t() override;
+        virtual int32_t read_int32_t() override;
+        virtual uint32_t read_uint32_t() override;
+        virtual int16_t read_int16_t() override;
+        virtual uint16_t read_uint16_t() override;
+        virtual int8_t read_int8_t() override;
+        virtual uint8_t read_uint8_t() override;
+        virtual std::string read_string() override;
+
+        virtual void startCategory(const std::string& name) override;
+        virtual void endCategory(const std::string& name) override;
+
+    private:
+        uint8_t readByte();
+        uint64_t readVarUint();
+        int64_t readVarInt();
+        std::string readRawString();
+        void readTag(uint8_t expectedTag);
+        void readCategoryMarker(uint8_t expectedTag, const std::string& name);
+
+        const uint8_t* mData = nullptr;
+        size_t mSize = 0;
+        size_t mPosition = 0;
+        bool mTyped = false;
+    };
+
+    class BinaryWriteStream : public WriteStreamInterface
+    {
+    public:
+        BinaryWriteStream();
+
+        virtual size_t getCurrentSize() const override;
+        virtual void resize(size_t size) override;
+        virtual std::pair<uint8_t*, size_t> getData() override;
+
+        virtual void write(bool val) override;
+        virtual void write(int64_t val) override;
+        virtual void write(uint64_t val) override;
+        virtual void write(int32_t val) override;
+        virtual void write(uint32_t val) override;
+        virtual void write(int16_t val) override;
+        virtual void write(uint16_t val) override;
+        virtual void write(int8_t val) override;
+        virtual void write(uint8_t val) override;
+        virtual void write(const std::string& val) override;
+
+        virtual void startCategory(const std::string& name) override;
+        virtual void endCategory(const std::string& name) override;
+
+    private:
+        void writeTag(uint8_t tag);
+        void writeVarUint(uint64_t val);
+        void writeVarInt(int64_t val);
+        void writeRawString(const std::string& val);
+
+        std::vector<uint8_t> mData;
+    };
+}
@@ -0,0 +1,44 @@
+#include "streamformat.h"
+#include "binarystream.h"
+#include "textstream.h"
+#include <misc/assert.h>
+
+namespace Serial
+{
+    std::unique_ptr<WriteStreamInterface> createWriteStream(StreamFormat format)
+    {
+        switch (format)
+        {
+            case StreamFormat::Text:
+                return std::make_unique<TextWriteStream>();
+            case StreamFormat::Binary:
+                return std::make_unique<BinaryWriteStream>();
+        }
+
+        invalid_enum(StreamFormat, format);
+    }
+
+    StreamFormat detectStreamFormat(const uint8_t* data, size_t size)
+    {
+        // Text streams always start with a type name, so the binary magic byte can never appear first
+        if (size > 0 && data[0] == BinaryStreamHeader::Magic)
+            return StreamFormat::Binary;
+
+        return StreamFormat::Text;
+    }
+
+    std::unique_ptr<ReadStreamInterface> createReadStream(const uint8_t* data, size_t size)
+    {
+        StreamFormat format = detectStreamFormat(data, size);
+
+        switch (format)
+        {
+            case StreamFormat::Text:
+                return std::make_unique<TextReadStream>(data, size);
+            case StreamFormat::Binary:
+                return std::make_unique<BinaryReadStream>(data, size);
+        }
+
+        invalid_enum(StreamFormat, format);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "streaminterface.h"
+#include <memory>
+#include <string>
+
+namespace Serial
+{
+    enum class StreamFormat
+    {
+        // Human readable, useful for debugging save / load code and diffing world states.
+        Text,
+        // Compact and fast, for anything where size or speed matters.
+        Binary,
+    };
+
+    std::unique_ptr<WriteStreamInterface> createWriteStream(StreamFormat format);
+
+    // Detects the format from the stream header, so readers don't need to know what format the data was written with.
+    // The returned stream reads directly from the data passed in, so the data must outlive it.
+    StreamFormat detectStreamFormat(const uint8_t* data, size_t size);
+    std::unique_ptr<ReadStreamInterface> createReadStream(const uint8_t* data, size_t size);
+
+    inline StreamFormat detectStreamFormat(const std::string& data) { return detectStreamFormat(reinterpret_cast<const uint8_t*>(data.data()), data.size()); }
+    inline std::unique_ptr<ReadStreamInterface> createReadStream(const std::string& data)
+    {
+        return createReadStream(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+    std::unique_ptr<ReadStreamInterface> createReadStream(std::string&&) = delete;
+}
@@ -1,129 +1,114 @@
 #include "textstream.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <misc/assert.h>
-#include <misc/stringops.h>
 
 namespace Serial
 {
-    std::string TextReadStream::readTypedLine(const std::string& expectedType)
+    std::string_view TextReadStream::readLine()
     {
-        mLine++;
-        std::string line;
-        std::getline(mData, line);
+        const char* lineStart = mData + mPosition;
+        size_t remaining = mSize - mPosition;
+
+        const char* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', remaining));
+        if (lineEnd == nullptr)
+        {
+            mPosition = mSize;
+            return std::string_view(lineStart, remaining);
+        }
+
+        mPosition += size_t(lineEnd - lineStart) + 1;
+        return std::string_view(lineStart, size_t(lineEnd - lineStart));
+    }
+
+    std::string_view TextReadStream::readTypedLine(std::string_view expectedType)
+    {
+        while (true)
+        {
+            mLine++;
+            std::string_view line = readLine();
 
-        line.erase(0, line.find_first_not_of(" "));
+            size_t indentEnd = line.find_first_not_of(' ');
+            line.remove_prefix(indentEnd == std::string_view::npos ? line.size() : indentEnd);
 
-        std::vector<std::string> data = Misc::StringUtils::split(line, ' ');
+            size_t separator = line.find(' ');
+            release_assert(separator != std::string_view::npos);
 
-        release_assert(data.size() == 2);
+            std::string_view type = line.substr(0, separator);
+            std::string_view data = line.substr(separator + 1);
+            release_assert(!data.empty() && data.find(' ') == std::string_view::npos);
 
-        if (data[0] == "CATEGORY" || data[0] == "CATEGORY_END")
-            return readTypedLine(expectedType); // ignore
+            if (type == "CATEGORY" || type == "CATEGORY_END")
+                continue; // ignore
 
-        release_assert(data[0] == expectedType);
+            release_assert(type == expectedType);
 
-        return std::string(std::move(data[1]));
+            return data;
+        }
     }
 
-    template <typename T> T fromString(const std::string& str)
+    template <typename T> T TextReadStream::readTypedNumber(std::string_view expectedType)
     {
-        std::istringstream iss;
-        iss.str(str);
-        T retval;
-        iss >> retval;
+        std::string_view data = readTypedLine(expectedType);
+
+        T retval = 0;
+        std::from_chars_result result = std::from_chars(data.data(), data.data() + data.size(), retval);
+        release_assert(result.ec == std::errc() && result.ptr == data.data() + data.size());
+
         return retval;
     }
 
     bool TextReadStream::read_bool()
     {
-        std::string data = readTypedLine("BOOL");
+        std::string_view data = readTypedLine("BOOL");
         release_assert(data == "true" || data == "false");
         return data == "true";
     }
 
-    int64_t TextReadStream::read_int64_t()
-    {
-        std::string data = readTypedLine("I64");
-        return fromString<int64_t>(data);
-    }
+    int64_t TextReadStream::read_int64_t() { return readTypedNumber<int64_t>("I64"); }
 
-    uint64_t TextReadStream::read_uint64_t()
-    {
-        std::string data = readTypedLine("U64");
-        return fromString<uint64_t>(data);
-    }
+    uint64_t TextReadStream::read_uint64_t() { return readTypedNumber<uint64_t>("U64"); }
 
-    int32_t TextReadStream::read_int32_t()
-    {
-        std::string data = readTypedLine("I32");
-        return fromString<int32_t>(data);
-    }
+    int32_t TextReadStream::read_int32_t() { return readTypedNumber<int32_t>("I32"); }
 
-    uint32_t TextReadStream::read_uint32_t()
-    {
-        std::string data = readTypedLine("U32");
-        return fromString<uint32_t>(data);
-    }
+    uint32_t TextReadStream::read_uint32_t() { return readTypedNumber<uint32_t>("U32"); }
 
-    int16_t TextReadStream::read_int16_t()
-    {
-        std::string data = readTypedLine("I16");
-        return fromString<int16_t>(data);
-    }
+    int16_t TextReadStream::read_int16_t() { return readTypedNumber<int16_t>("I16"); }
 
-    uint16_t TextReadStream::read_uint16_t()
-    {
-        std::string data = readTypedLine("U16");
-        return fromString<uint16_t>(data);
-    }
+    uint16_t TextReadStream::read_uint16_t() { return readTypedNumber<uint16_t>("U16"); }
 
-    int8_t TextReadStream::read_int8_t()
-    {
-        std::string data = readTypedLine("I8");
-        return fromString<int32_t>(data); // use 32 here to stop it being interpreted as char
-    }
+    int8_t TextReadStream::read_int8_t() { return readTypedNumber<int8_t>("I8"); }
 
-    uint8_t TextReadStream::read_uint8_t()
-    {
-        std::string data = readTypedLine("U8");
-        return fromString<uint32_t>(data); // use 32 here to stop it being interpreted as char
-    }
+    uint8_t TextReadStream::read_uint8_t() { return readTypedNumber<uint8_t>("U8"); }
 
     std::string TextReadStream::read_string()
     {
-        std::string sizeData = readTypedLine("STRING");
-        uint32_t size = fromString<uint32_t>(sizeData);
+        uint32_t size = readTypedNumber<uint32_t>("STRING");
 
-        mData >> std::noskipws;
+        // +1 for the trailing newline
+        release_assert(size_t(size) + 1 <= mSize - mPosition);
 
-        std::string tmp;
-        char c;
-        for (uint32_t i = 0; i < size; i++)
-        {
-            mData >> c;
-            tmp += c;
-
-            if (c == '\n')
-                mLine++;
-        }
+        std::string tmp(mData + mPosition, size);
+        mPosition += size;
+        mLine += uint32_t(std::count(tmp.begin(), tmp.end(), '\n'));
 
-        mData >> c;
-        release_assert(c == '\n'); // trailing newline
+        release_assert(mData[mPosition] == '\n'); // trailing newline
+        mPosition++;
         mLine++;
 
-        mData >> std::skipws;
-
         return tmp;
     }
 
     void TextReadStream::startCategory(const std::string& name)
     {
-        std::string data = readTypedLine("CATEGORY");
+        std::string_view data = readTypedLine("CATEGORY");
         release_assert(name == data);
     }
 
     void TextReadStream::endCategory(const std::string& name)
     {
-        std::string data = readTypedLine("CATEGORY_END");
+        std::string_view data = readTypedLine("CATEGORY_END");
         release_assert(name == data);
     }
 
@@ -1,15 +1,18 @@
 #pragma once
 #include "streaminterface.h"
 #include <limits>
-#include <sstream>
 #include <string>
+#include <string_view>
 
 namespace Serial
 {
+    // Reads directly from the data passed in, without copying it, so the data must outlive the stream
     class TextReadStream : public ReadStreamInterface
     {
     public:
-        TextReadStream(const std::string& data) : mData(data) {}
+        TextReadStream(const uint8_t* data, size_t size) : mData(reinterpret_cast<const char*>(data)), mSize(size) {}
+        explicit TextReadStream(const std::string& data) : TextReadStream(reinterpret_cast<const uint8_t*>(data.data()), data.size()) {}
+        explicit TextReadStream(std::string&&) = delete;
 
         virtual bool read_bool() override;
         virtual int64_t read_int64_t() override;
@@ -26,10 +29,14 @@ namespace Serial
         virtual void endCategory(const std::string& name) override;
 
     private:
-        std::string readTypedLine(const std::string& expectedType);
+        std::string_view readLine();
+        std::string_view readTypedLine(std::string_view expectedType);
+        template <typename T> T readTypedNumber(std::string_view expectedType);
 
         uint32_t mLine = 0;
-        std::istringstream mData;
+        const char* mData = nullptr;
+        size_t mSize = 0;
+        size_t mPosition = 0;
     };
 
     class TextWriteStream : public WriteStreamInterface
@@ -5,6 +5,7 @@ flat in float f_zValue;
 flat in vec2 f_spriteSizeInPixels;
 flat in vec4 f_hoverColor;
 flat in vec2 f_atlasOffsetInPixels;
+flat in float f_paletteRow;
 
 layout(std140) uniform fragmentUniforms
 {
@@ -14,10 +15,26 @@ layout(std140) uniform fragmentUniforms
 };
 
 uniform sampler2D tex;
+uniform sampler2D palette;
+
+// Indexed atlas layers hold a palette index per texel, which is looked up in the sprite's row of the palette texture.
+// Index 0 is transparent in every palette.
+vec4 fetchColor(vec2 atlasPositionInPixels)
+{
+    if (f_paletteRow < 0)
+        return texture(tex, atlasPositionInPixels / atlasSizeInPixels);
+
+    ivec2 texel = ivec2(floor(atlasPositionInPixels));
+    if (texel.x < 0 || texel.y < 0 || texel.x >= int(atlasSizeInPixels.x) || texel.y >= int(atlasSizeInPixels.y))
+        return vec4(0);
+
+    int index = int(texelFetch(tex, texel, 0).r * 255.0 + 0.5);
+    return texelFetch(palette, ivec2(index, int(f_paletteRow)), 0);
+}
 
 void main()
 {
-    vec4 color = texture(tex, (f_atlasOffsetInPixels.xy + f_uvNorm * f_spriteSizeInPixels) / atlasSizeInPixels);
+    vec4 color = fetchColor(f_atlasOffsetInPixels.xy + f_uvNorm * f_spriteSizeInPixels);
 
     if (color.w == 0 && f_hoverColor.a > 0)
     {
@@ -26,7 +43,7 @@ void main()
             for (float x = -1; x <= 1; x++)
             {
                 vec2 offset = vec2(x, y);
-                vec4 n = texture(tex, (f_atlasOffsetInPixels.xy + offset + f_uvNorm * f_spriteSizeInPixels) / atlasSizeInPixels);
+                vec4 n = fetchColor(f_atlasOffsetInPixels.xy + offset + f_uvNorm * f_spriteSizeInPixels);
 
                 if (n.a > 0 && (n.r > 0 || n.g > 0 || n.b > 0))
                     color = f_hoverColor;
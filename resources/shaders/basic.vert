@@ -10,12 +10,12 @@ layout(location = 3) in vec2 v_spriteSizeInPixels;
 layout(location = 4) in vec2 v_destinationInPixels;
 layout(location = 5) in vec4 v_hoverColor;
 layout(location = 6) in vec2 v_atlasOffsetInPixels;
+layout(location = 7) in float v_paletteRow;
 
 layout(std140) uniform vertexUniforms
 {
     vec2 screenSizeInPixels;
-
-    vec2 pad2;
+    vec2 offsetInPixels;
 };
 
 out vec2 f_uvNorm;
@@ -23,6 +23,7 @@ flat out float f_zValue;
 flat out vec2 f_spriteSizeInPixels;
 flat out vec4 f_hoverColor;
 flat out vec2 f_atlasOffsetInPixels;
+flat out float f_paletteRow;
 
 void main()
 {
@@ -31,8 +32,9 @@ void main()
     f_spriteSizeInPixels = v_spriteSizeInPixels;
     f_hoverColor = v_hoverColor;
     f_atlasOffsetInPixels = v_atlasOffsetInPixels;
+    f_paletteRow = v_paletteRow;
 
-    vec2 destNorm = v_destinationInPixels / screenSizeInPixels;
+    vec2 destNorm = (v_destinationInPixels + offsetInPixels) / screenSizeInPixels;
     vec2 imageSizeNorm = v_spriteSizeInPixels / screenSizeInPixels;
     vec2 posNorm = destNorm + vertex_position * imageSizeNorm;
 
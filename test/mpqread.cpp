@@ -0,0 +1,92 @@
+// Measures how MPQ read throughput scales with the number of threads reading, so this needs DIABDAT.MPQ (or spawn.mpq) in the working directory.
+// Every file named in the listfile is read whole once per thread count, and the total number of bytes read must match between runs.
+
+#include <atomic>
+#include <chrono>
+#include <faio/fafileobject.h>
+#include <faio/faio.h>
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <iostream>
+#include <misc/misc.h>
+#include <misc/stringops.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::vector<std::string> getMpqFiles()
+    {
+        std::vector<std::string> files;
+        for (const std::string& path : FAIO::listMpqFiles("*"))
+        {
+            // FAfopen refuses to open these, see the comment there
+            if (Misc::StringUtils::endsWith(path, "banner2.dun") || Misc::StringUtils::endsWith(path, "dmagew.cl2") ||
+                Misc::StringUtils::endsWith(path, "unravw.cel"))
+                continue;
+
+            if (FAIO::exists(path))
+                files.push_back(path);
+        }
+
+        return files;
+    }
+
+    size_t readAllFiles(const std::vector<std::string>& files, size_t threadCount)
+    {
+        std::atomic<size_t> nextFile = 0;
+        std::atomic<size_t> totalBytes = 0;
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([&] {
+                for (size_t index = nextFile++; index < files.size(); index = nextFile++)
+                    totalBytes += FAIO::FAFileObject(files[index]).readAll().size();
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        return totalBytes;
+    }
+}
+
+TEST(MpqRead, ThroughputScalesWithThreads)
+{
+    if (!FAIO::init("DIABDAT.MPQ", TEST_DIR "/Diablo I.txt") && !FAIO::init("spawn.mpq", TEST_DIR "/Diablo I.txt"))
+        GTEST_SKIP() << "DIABDAT.MPQ not found";
+
+    std::vector<std::string> files = getMpqFiles();
+    ASSERT_FALSE(files.empty());
+
+    // One untimed pass, so the first timed run isn't paying to get the MPQ into the OS file cache
+    size_t expectedBytes = readAllFiles(files, 1);
+
+    size_t maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t threadCount = 1;; threadCount = std::min(threadCount * 2, maxThreads))
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t bytes = readAllFiles(files, threadCount);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        EXPECT_EQ(bytes, expectedBytes);
+        std::cout << std::setw(3) << threadCount << " threads: " << files.size() << " files, " << std::fixed << std::setprecision(1)
+                  << double(bytes) / (1024.0 * 1024.0) / seconds << " MB/s" << std::endl;
+
+        if (threadCount == maxThreads)
+            break;
+    }
+
+    FAIO::quit();
+}
+
+int main(int argc, char** argv)
+{
+    Misc::saveArgv0(argv[0]);
+    ::testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <render/Software/renderinstancesoftware.h>
+#include <render/atlastexture.h>
+#include <render/commandqueue.h>
+#include <render/texture.h>
+
+using namespace Render;
+
+namespace
+{
+    Image makeSolidImage(int32_t width, int32_t height, uint8_t value)
+    {
+        Image image(width, height);
+        for (ByteColour& pixel : image)
+            pixel = ByteColour(value, 0, 0, true);
+        return image;
+    }
+
+    Image readTexture(Texture& texture)
+    {
+        Image image(texture.width(), texture.height());
+        texture.readImageData(reinterpret_cast<uint8_t*>(image.mData.data()));
+        return image;
+    }
+}
+
+TEST(AtlasTexture, PackedSpritesAreUploadedOncePerLayer)
+{
+    RenderInstanceSoftware instance(16, 16, 0);
+    std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+    AtlasTexture atlas(instance, *commandQueue);
+
+    Image big = makeSolidImage(20, 30, 10);
+    Image small = makeSolidImage(5, 5, 20);
+
+    // Only the opaque 4x2 block in the middle should end up in the atlas
+    Image trimmed(10, 10);
+    for (int32_t y = 3; y < 5; y++)
+    {
+        for (int32_t x = 2; x < 6; x++)
+            trimmed.get(x, y) = ByteColour(30, 0, 0, true);
+    }
+
+    const TextureReference& bigRef = atlas.addSprite(big, std::nullopt, "a");
+    const TextureReference& smallRef = atlas.addSprite(small, std::nullopt, "a");
+    const TextureReference& trimmedRef = atlas.addSprite(trimmed, trimmed.calculateTrimTransparentEdges(), "b");
+
+    // Nothing is written until the upload
+    EXPECT_EQ(bigRef.mTexture, nullptr);
+
+    EXPECT_EQ(atlas.uploadPendingSprites(), 2);
+    EXPECT_EQ(atlas.uploadPendingSprites(), 0);
+
+    ASSERT_NE(bigRef.mTexture, nullptr);
+    EXPECT_EQ(bigRef.mTexture, smallRef.mTexture);
+    EXPECT_NE(bigRef.mTexture, trimmedRef.mTexture);
+
+    // Layers are cut down to what was packed, rather than the maximum texture size
+    EXPECT_LT(bigRef.mTexture->width(), 64);
+    EXPECT_LT(bigRef.mTexture->height(), 64);
+
+    EXPECT_EQ(trimmedRef.mWidth, 10);
+    EXPECT_EQ(trimmedRef.mTrimmedOffsetX, 2);
+    EXPECT_EQ(trimmedRef.mTrimmedOffsetY, 3);
+    EXPECT_EQ(trimmedRef.mTrimmedWidth, 4);
+    EXPECT_EQ(trimmedRef.mTrimmedHeight, 2);
+
+    auto checkSprite = [](const TextureReference& reference, uint8_t value) {
+        Image data = readTexture(*reference.mTexture);
+        for (int32_t y = 0; y < reference.mTrimmedHeight; y++)
+        {
+            for (int32_t x = 0; x < reference.mTrimmedWidth; x++)
+            {
+                const ByteColour& pixel = data.get(reference.mX + x, reference.mY + y);
+                ASSERT_EQ(pixel.r, value);
+                ASSERT_EQ(pixel.a, 255);
+            }
+        }
+
+        // The padding around each sprite stays transparent
+        EXPECT_EQ(data.get(reference.mX - 1, reference.mY).a, 0);
+        EXPECT_EQ(data.get(reference.mX, reference.mY - 1).a, 0);
+    };
+
+    checkSprite(bigRef, 10);
+    checkSprite(smallRef, 20);
+    checkSprite(trimmedRef, 30);
+
+    // Uploaded layers are closed, so later sprites get a new one
+    Image late = makeSolidImage(3, 3, 40);
+    const TextureReference& lateRef = atlas.addSprite(late, std::nullopt, "a");
+    EXPECT_EQ(atlas.uploadPendingSprites(), 1);
+    EXPECT_NE(lateRef.mTexture, bigRef.mTexture);
+    checkSprite(lateRef, 40);
+}
+
+TEST(AtlasTexture, IndexedSpritesGetTheirOwnLayersAndShareIdenticalPalettes)
+{
+    RenderInstanceSoftware instance(16, 16, 0);
+    std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+    AtlasTexture atlas(instance, *commandQueue);
+
+    IndexedPalette::Colours colours = {};
+    colours[1] = ByteColour(255, 0, 0, true);
+    colours[2] = ByteColour(0, 255, 0, true);
+
+    IndexedPalette::Colours otherColours = colours;
+    otherColours[2] = ByteColour(0, 0, 255, true);
+
+    int32_t row = atlas.addPalette(colours);
+    EXPECT_EQ(atlas.addPalette(otherColours), row + 1);
+    EXPECT_EQ(atlas.addPalette(colours), row);
+
+    IndexedImage indexed(6, 4);
+    for (int32_t x = 0; x < 6; x++)
+        indexed.get(x, 1) = uint8_t(x % 2 + 1);
+
+    const TextureReference& rgbaRef = atlas.addSprite(makeSolidImage(5, 5, 20), std::nullopt, "a");
+    const TextureReference& indexedRef = atlas.addSprite(indexed, std::nullopt, "a", row + 1);
+
+    EXPECT_EQ(atlas.uploadPendingSprites(), 2);
+    EXPECT_EQ(rgbaRef.mPaletteRow, -1);
+    EXPECT_EQ(indexedRef.mPaletteRow, row + 1);
+
+    ASSERT_NE(indexedRef.mTexture, nullptr);
+    EXPECT_NE(indexedRef.mTexture, rgbaRef.mTexture);
+    EXPECT_EQ(indexedRef.mTexture->getInfo().format, Format::R8UNorm);
+
+    std::vector<uint8_t> indices(size_t(indexedRef.mTexture->width()) * size_t(indexedRef.mTexture->height()));
+    indexedRef.mTexture->readImageData(indices.data());
+    auto getIndex = [&](int32_t x, int32_t y) { return indices[size_t(y) * size_t(indexedRef.mTexture->width()) + size_t(x)]; };
+
+    EXPECT_EQ(getIndex(indexedRef.mX, indexedRef.mY), 0);
+    EXPECT_EQ(getIndex(indexedRef.mX, indexedRef.mY + 1), 1);
+    EXPECT_EQ(getIndex(indexedRef.mX + 5, indexedRef.mY + 1), 2);
+
+    // Each palette is one row of the palette texture
+    Texture& paletteTexture = atlas.getPaletteTexture();
+    EXPECT_EQ(paletteTexture.width(), IndexedPalette::SIZE);
+    EXPECT_EQ(paletteTexture.height(), 2);
+
+    Image palettes = readTexture(paletteTexture);
+    EXPECT_EQ(palettes.get(2, row).g, 255);
+    EXPECT_EQ(palettes.get(2, row + 1).b, 255);
+    EXPECT_EQ(palettes.get(0, row + 1).a, 0);
+}
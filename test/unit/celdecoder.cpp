@@ -0,0 +1,142 @@
+#include <cel/celdecoder.h>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace Cel;
+
+namespace
+{
+    Pal makePalette()
+    {
+        std::vector<Colour> colours;
+        for (int32_t i = 0; i < 256; i++)
+            colours.emplace_back(uint8_t(i), uint8_t(255 - i), uint8_t(i * 7), true);
+
+        return Pal(std::move(colours));
+    }
+
+    // A type 1 frame of random transparent and regular chunks that exactly covers pixelCount pixels
+    CelDecoder::FrameBytes makeType1Frame(std::mt19937& rng, int32_t pixelCount)
+    {
+        CelDecoder::FrameBytes frame;
+        while (pixelCount > 0)
+        {
+            int32_t chunkSize = std::min(int32_t(rng() % 127) + 1, pixelCount);
+            pixelCount -= chunkSize;
+
+            if (rng() % 2)
+            {
+                frame.push_back(uint8_t(int8_t(-chunkSize)));
+            }
+            else
+            {
+                frame.push_back(uint8_t(chunkSize));
+                for (int32_t i = 0; i < chunkSize; i++)
+                    frame.push_back(uint8_t(rng()));
+            }
+        }
+
+        return frame;
+    }
+
+    // A type 6 (cl2) frame of random transparent, regular and run length chunks, with some rubbish on the end
+    CelDecoder::FrameBytes makeType6Frame(std::mt19937& rng, int32_t pixelCount)
+    {
+        CelDecoder::FrameBytes frame;
+        while (pixelCount > 0)
+        {
+            switch (rng() % 3)
+            {
+                case 0:
+                {
+                    int32_t chunkSize = std::min(int32_t(rng() % 127) + 1, pixelCount);
+                    frame.push_back(uint8_t(chunkSize));
+                    pixelCount -= chunkSize;
+                    break;
+                }
+                case 1:
+                {
+                    int32_t chunkSize = std::min(int32_t(rng() % 65) + 1, pixelCount);
+                    frame.push_back(uint8_t(int8_t(-chunkSize)));
+                    for (int32_t i = 0; i < chunkSize; i++)
+                        frame.push_back(uint8_t(rng()));
+                    pixelCount -= chunkSize;
+                    break;
+                }
+                default:
+                {
+                    int32_t chunkSize = std::min(int32_t(rng() % 63) + 1, pixelCount);
+                    frame.push_back(uint8_t(int8_t(-(chunkSize + 65))));
+                    frame.push_back(uint8_t(rng()));
+                    pixelCount -= chunkSize;
+                    break;
+                }
+            }
+        }
+
+        for (int32_t i = 0; i < 5; i++)
+            frame.push_back(uint8_t(rng()));
+
+        return frame;
+    }
+
+    CelDecoder::FrameBytes makeRandomBytes(std::mt19937& rng, size_t size)
+    {
+        CelDecoder::FrameBytes frame(size);
+        for (uint8_t& byte : frame)
+            byte = uint8_t(rng());
+        return frame;
+    }
+
+    void expectFastMatchesReference(CelDecoder::FrameType type, CelDecoder::FrameBytesRef frame, int32_t width, int32_t height)
+    {
+        Pal pal = makePalette();
+
+        CelFrame fast(width, height);
+        CelDecoder::decodeFrameFast(type, frame, pal, fast);
+
+        CelFrame reference(width, height);
+        CelDecoder::decodeFrameReference(type, frame, pal, reference);
+
+        EXPECT_EQ(0, memcmp(&fast.get(0, 0), &reference.get(0, 0), size_t(width) * size_t(height) * sizeof(Colour))) << "frame type " << int32_t(type);
+    }
+}
+
+TEST(CelDecoder, FastDecodersMatchReference)
+{
+    std::mt19937 rng(1234);
+
+    for (int32_t i = 0; i < 20; i++)
+    {
+        int32_t width = int32_t(rng() % 100) + 1;
+        int32_t height = int32_t(rng() % 100) + 1;
+
+        expectFastMatchesReference(CelDecoder::FrameType::Type1, makeType1Frame(rng, width * height), width, height);
+        expectFastMatchesReference(CelDecoder::FrameType::Type6, makeType6Frame(rng, width * height), width, height);
+    }
+
+    expectFastMatchesReference(CelDecoder::FrameType::Type0, makeRandomBytes(rng, 0x400), 32, 32);
+    expectFastMatchesReference(CelDecoder::FrameType::Type2, makeRandomBytes(rng, 0x220), 32, 32);
+    expectFastMatchesReference(CelDecoder::FrameType::Type3, makeRandomBytes(rng, 0x220), 32, 32);
+    expectFastMatchesReference(CelDecoder::FrameType::Type4, makeRandomBytes(rng, 0x320), 32, 32);
+    expectFastMatchesReference(CelDecoder::FrameType::Type5, makeRandomBytes(rng, 0x320), 32, 32);
+}
+
+TEST(CelDecoder, Type1RunsWrapOntoTheRowAbove)
+{
+    Pal pal = makePalette();
+
+    // Three transparent pixels, then four of colour 9, in a 4x2 image that is stored bottom row first
+    CelDecoder::FrameBytes frame = {uint8_t(int8_t(-3)), 4, 9, 9, 9, 9, 1, 9};
+
+    CelFrame decoded(4, 2);
+    CelDecoder::decodeFrameFast(CelDecoder::FrameType::Type1, frame, pal, decoded);
+
+    EXPECT_EQ(decoded.get(0, 1).a, 0);
+    EXPECT_EQ(decoded.get(2, 1).a, 0);
+    EXPECT_EQ(decoded.get(3, 1).r, 9);
+    EXPECT_EQ(decoded.get(0, 0).r, 9);
+    EXPECT_EQ(decoded.get(3, 0).r, 9);
+    EXPECT_EQ(decoded.get(3, 0).a, 255);
+}
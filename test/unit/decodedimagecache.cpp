@@ -0,0 +1,157 @@
+#include <atomic>
+#include <cel/decodedimagecache.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+
+using namespace Cel;
+
+namespace
+{
+    DecodedImageCache::DecodedImages makeImages(uint8_t value)
+    {
+        DecodedImageCache::DecodedImages images;
+        images.animationLength = 2;
+
+        for (int32_t i = 0; i < 2; i++)
+        {
+            Image& frame = images.frames.emplace_back(4, 4);
+            frame.get(0, 0) = ByteColour(value, 0, 0, true);
+        }
+
+        return images;
+    }
+}
+
+TEST(DecodedImageCache, ExpectedUsesShareOneDecode)
+{
+    std::atomic_int32_t decodes = 0;
+    DecodedImageCache cache([&](const std::string&) {
+        decodes++;
+        return makeImages(7);
+    });
+
+    // Paths are compared case insensitively and with either slash
+    cache.expectUse("Data\\Thing.pcx");
+    cache.expectUse("data/thing.pcx");
+    cache.expectUse("data/thing.pcx");
+
+    std::shared_ptr<const DecodedImageCache::DecodedImages> shared = cache.share("data/thing.pcx");
+    DecodedImageCache::DecodedImages copied = cache.take("DATA/THING.PCX");
+
+    // The shared frames are still in use, so the taken ones must be a copy
+    EXPECT_EQ(copied.frames.size(), 2u);
+    EXPECT_EQ(copied.animationLength, 2);
+    EXPECT_EQ(copied.frames[1].get(0, 0).r, 7);
+    EXPECT_NE(&copied.frames[0].get(0, 0), &shared->frames[0].get(0, 0));
+
+    const ByteColour* sharedPixels = &shared->frames[0].get(0, 0);
+    shared.reset();
+
+    // Nobody else holds the last use, so its frames are moved out
+    DecodedImageCache::DecodedImages taken = cache.take("data/thing.pcx");
+    EXPECT_EQ(&taken.frames[0].get(0, 0), sharedPixels);
+    EXPECT_EQ(decodes, 1);
+
+    // Every expected use has been had, so the entry was dropped and another use decodes again
+    cache.take("data/thing.pcx");
+    EXPECT_EQ(decodes, 2);
+}
+
+TEST(DecodedImageCache, ConcurrentUsersWaitForTheFirstDecode)
+{
+    std::atomic_int32_t decodes = 0;
+    DecodedImageCache cache([&](const std::string&) {
+        decodes++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return makeImages(3);
+    });
+
+    constexpr int32_t threadCount = 8;
+    for (int32_t i = 0; i < threadCount; i++)
+        cache.expectUse("levels/l1data/l1.cel");
+
+    std::atomic_int32_t correct = 0;
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([&] {
+            if (cache.share("levels/l1data/l1.cel")->frames[0].get(0, 0).r == 3)
+                correct++;
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(decodes, 1);
+    EXPECT_EQ(correct, threadCount);
+}
+
+TEST(DecodedImageCache, UnannouncedUsersOnManyThreads)
+{
+    std::atomic_int32_t decodes = 0;
+    DecodedImageCache cache([&](const std::string&) {
+        decodes++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return makeImages(5);
+    });
+
+    // Nobody called expectUse, so the first user to finish drops the entry while the others may still be waiting on it
+    constexpr int32_t threadCount = 8;
+    std::atomic_int32_t correct = 0;
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([&] {
+            if (cache.share("levels/towndata/town.cel")->frames[1].get(0, 0).r == 5)
+                correct++;
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(correct, threadCount);
+    EXPECT_GE(decodes, 1);
+}
+
+TEST(DecodedImageCache, WaitersRetryWhenTheDecoderThrows)
+{
+    std::atomic_int32_t decodes = 0;
+    DecodedImageCache cache([&](const std::string&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (decodes++ == 0)
+            throw std::runtime_error("broken file");
+        return makeImages(9);
+    });
+
+    constexpr int32_t threadCount = 8;
+    for (int32_t i = 0; i < threadCount; i++)
+        cache.expectUse("monsters/zombie/zombiew.cl2");
+
+    std::atomic_int32_t failed = 0;
+    std::atomic_int32_t correct = 0;
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([&] {
+            try
+            {
+                if (cache.share("monsters/zombie/zombiew.cl2")->frames[0].get(0, 0).r == 9)
+                    correct++;
+            }
+            catch (const std::runtime_error&)
+            {
+                failed++;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(failed, 1);
+    EXPECT_EQ(correct, threadCount - 1);
+    EXPECT_EQ(decodes, 2);
+}
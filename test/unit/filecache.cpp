@@ -0,0 +1,68 @@
+#include <faio/filecache.h>
+#include <gtest/gtest.h>
+
+using namespace FAIO;
+
+namespace
+{
+    FileBuffer makeBuffer(size_t size, uint8_t value) { return std::make_shared<const std::vector<uint8_t>>(size, value); }
+}
+
+TEST(FileCache, LeastRecentlyUsedFilesAreDroppedFirst)
+{
+    FileCache cache(400);
+    int32_t loads = 0;
+
+    auto get = [&](const std::string& key, uint8_t value) {
+        return cache.get(key, [&] {
+            loads++;
+            return makeBuffer(100, value);
+        });
+    };
+
+    get("a", 1);
+    get("b", 2);
+    get("c", 3);
+    get("d", 4);
+    EXPECT_EQ(loads, 4);
+    EXPECT_EQ(cache.sizeInBytes(), 400u);
+
+    // Using a again makes b the least recently used, so adding e drops b
+    EXPECT_EQ((*get("a", 0))[0], 1);
+    get("e", 5);
+    EXPECT_EQ(loads, 5);
+    EXPECT_EQ(cache.sizeInBytes(), 400u);
+
+    EXPECT_EQ((*get("a", 0))[0], 1);
+    EXPECT_EQ(loads, 5);
+
+    EXPECT_EQ((*get("b", 6))[0], 6);
+    EXPECT_EQ(loads, 6);
+
+    cache.clear();
+    EXPECT_EQ(cache.sizeInBytes(), 0u);
+}
+
+TEST(FileCache, LargeAndMissingFilesAreNotCached)
+{
+    FileCache cache(400);
+    int32_t loads = 0;
+
+    for (int32_t i = 0; i < 2; i++)
+    {
+        FileBuffer large = cache.get("large", [&] {
+            loads++;
+            return makeBuffer(101, 7);
+        });
+        EXPECT_EQ(large->size(), 101u);
+
+        FileBuffer missing = cache.get("missing", [&] {
+            loads++;
+            return FileBuffer();
+        });
+        EXPECT_EQ(missing, nullptr);
+    }
+
+    EXPECT_EQ(loads, 4);
+    EXPECT_EQ(cache.sizeInBytes(), 0u);
+}
@@ -3,6 +3,10 @@
 #include <algorithm>
 #include <faworld/findpath.h>
 #include <gtest/gtest.h>
+#include <misc/stdhashes.h>
+#include <queue>
+#include <random>
+#include <unordered_map>
 
 using Point = Misc::Point;
 using Points = Misc::Points;
@@ -186,3 +190,102 @@ TEST(FindPathTests, pathfinderIsLimited)
     EXPECT_EQ(path.size(), 0);
     ASSERT_FALSE(isReachable);
 }
+
+namespace
+{
+    // Straight copy of the original allocating A* implementation, which the PathFinder must match exactly, as any difference would
+    // desync lockstep multiplayer games between versions.
+    Points referencePathFind(FAWorld::GameLevelImpl* level, Point start, Point goal, bool& arrivable, bool findAdjacent)
+    {
+        auto heuristic = [](Point a, Point b) -> size_t {
+            auto dx = abs(b.x - a.x);
+            auto dy = abs(b.y - a.y);
+            auto straight = std::abs(dx - dy);
+            auto diagonal = std::max(dx, dy) - straight;
+            return straight * 10 + diagonal * 14;
+        };
+
+        using Element = std::pair<size_t, Point>;
+        std::priority_queue<Element, std::vector<Element>, std::greater<Element>> frontier;
+        std::unordered_map<Point, Point> cameFrom;
+        std::vector<int32_t> costSoFar(level->width() * level->height(), -1);
+        auto cost = [&](Point p) -> int32_t& { return costSoFar[p.x + p.y * level->width()]; };
+
+        bool goalPassable = level->isPassable(goal, nullptr);
+        frontier.emplace(0, start);
+        cameFrom[start] = start;
+        cost(start) = 0;
+
+        arrivable = false;
+        for (int32_t iterations = 0; !frontier.empty() && iterations < 1000; iterations++)
+        {
+            Point current = frontier.top().second;
+            frontier.pop();
+
+            if (current == goal || ((findAdjacent || !goalPassable) && abs(goal.x - current.x) <= 1 && abs(goal.y - current.y) <= 1))
+            {
+                goal = current;
+                arrivable = true;
+                break;
+            }
+
+            for (const auto& next : FAWorld::neighbors(level, nullptr, current))
+            {
+                int32_t newCost = cost(current) + ((current.x != next.x && current.y != next.y) ? 14 : 10);
+                if (cost(next) == -1 || newCost < cost(next))
+                {
+                    cost(next) = newCost;
+                    frontier.emplace(newCost + heuristic(next, goal), next);
+                    cameFrom[next] = current;
+                }
+            }
+        }
+
+        if (!arrivable)
+            return {};
+
+        Points path{goal};
+        for (Point current = goal; current != start;)
+        {
+            current = cameFrom[current];
+            if (current != start)
+                path.push_back(current);
+        }
+        path.push_back(start);
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+}
+
+TEST(FindPathTests, matchesReferenceImplementation)
+{
+    std::mt19937 rng(1234);
+    FAWorld::PathFinder pathFinder;
+
+    for (int32_t mapIndex = 0; mapIndex < 20; mapIndex++)
+    {
+        const int32_t size = 30 + mapIndex * 5;
+        Map map{size_t(size), std::vector<int>(size, 0)};
+        for (auto& row : map)
+            for (auto& tile : row)
+                tile = (rng() % 100) < 30 ? 1 : 0;
+
+        FAWorld::LevelImplStub level(map);
+
+        for (int32_t searchIndex = 0; searchIndex < 50; searchIndex++)
+        {
+            Point start(rng() % size, rng() % size);
+            Point goal(rng() % size, rng() % size);
+            bool findAdjacent = rng() % 2;
+
+            bool expectedArrivable = false;
+            Points expected = referencePathFind(&level, start, goal, expectedArrivable, findAdjacent);
+
+            Points actual;
+            bool actualArrivable = pathFinder.findPath(&level, nullptr, start, goal, findAdjacent, actual);
+
+            ASSERT_EQ(actualArrivable, expectedArrivable);
+            ASSERT_EQ(actual, expected);
+        }
+    }
+}
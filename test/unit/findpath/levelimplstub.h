@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <faworld/gamelevel.h>
 
 namespace FAWorld
@@ -11,7 +12,17 @@ namespace FAWorld
 
         int32_t width() const override { return map.empty() ? 0 : map[0].size(); }
         int32_t height() const override { return map.size(); }
-        bool isPassable(const Misc::Point& point, const FAWorld::Actor*) const override { return map[point.y][point.x] == 0; }
+        bool isPassable(const Misc::Point& point, const FAWorld::Actor*) const override
+        {
+            return map[point.y][point.x] == 0 && std::find(occupied.begin(), occupied.end(), point) == occupied.end();
+        }
+        bool isPassableStatic(const Misc::Point& point) const override
+        {
+            return point.x >= 0 && point.x < width() && point.y >= 0 && point.y < height() && map[point.y][point.x] == 0;
+        }
+
+        // Tiles with an actor standing on them, passable statically but not to other actors
+        std::vector<Misc::Point> occupied;
 
     private:
         const std::vector<std::vector<int>> map;
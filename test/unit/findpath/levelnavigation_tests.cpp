@@ -0,0 +1,179 @@
+#include "levelimplstub.h"
+#include <faworld/findpath.h>
+#include <faworld/levelnavigation.h>
+#include <gtest/gtest.h>
+#include <random>
+
+using Point = Misc::Point;
+using Points = Misc::Points;
+
+namespace
+{
+    using Map = std::vector<std::vector<int>>;
+
+    // Two rooms separated by a solid wall down the middle
+    Map twoRoomsMap()
+    {
+        return {{0, 0, 0, 1, 0, 0, 0}, //
+                {0, 0, 0, 1, 0, 0, 0}, //
+                {0, 0, 0, 1, 0, 0, 0}, //
+                {0, 0, 0, 1, 0, 0, 0}, //
+                {0, 0, 0, 1, 0, 0, 0}};
+    }
+
+    bool isAdjacent(const Point& a, const Point& b) { return std::abs(a.x - b.x) <= 1 && std::abs(a.y - b.y) <= 1; }
+}
+
+TEST(LevelNavigationTests, regions)
+{
+    FAWorld::LevelImplStub level(twoRoomsMap());
+    FAWorld::LevelNavigation navigation(level);
+
+    EXPECT_EQ(navigation.getRegion({0, 0}), navigation.getRegion({2, 4}));
+    EXPECT_EQ(navigation.getRegion({4, 0}), navigation.getRegion({6, 4}));
+    EXPECT_NE(navigation.getRegion({0, 0}), navigation.getRegion({4, 0}));
+    EXPECT_EQ(navigation.getRegion({3, 2}), FAWorld::LevelNavigation::NoRegion);
+    EXPECT_EQ(navigation.getRegion({-1, 0}), FAWorld::LevelNavigation::NoRegion);
+
+    EXPECT_TRUE(navigation.canPossiblyReach({0, 0}, {2, 4}));
+    EXPECT_FALSE(navigation.canPossiblyReach({0, 0}, {5, 2}));
+
+    // The wall itself is adjacent to both rooms
+    EXPECT_TRUE(navigation.canPossiblyReach({0, 0}, {3, 2}));
+    EXPECT_TRUE(navigation.canPossiblyReach({6, 0}, {3, 2}));
+}
+
+TEST(LevelNavigationTests, neverRejectsReachableGoals)
+{
+    std::mt19937 random(5678);
+
+    for (int32_t iteration = 0; iteration < 20; iteration++)
+    {
+        Map map(24, std::vector<int>(24, 0));
+        for (auto& row : map)
+        {
+            for (auto& tile : row)
+                tile = (random() % 100) < 40 ? 1 : 0;
+        }
+
+        FAWorld::LevelImplStub level(map);
+        FAWorld::LevelNavigation navigation(level);
+        FAWorld::PathFinder pathFinder;
+        Points path;
+
+        for (int32_t i = 0; i < 50; i++)
+        {
+            Point start(random() % 24, random() % 24);
+            Point goal(random() % 24, random() % 24);
+            bool findAdjacent = random() % 2;
+
+            if (pathFinder.findPath(&level, nullptr, start, goal, findAdjacent, path))
+            {
+                EXPECT_TRUE(navigation.canPossiblyReach(start, goal));
+            }
+        }
+    }
+}
+
+TEST(LevelNavigationTests, flowFieldPath)
+{
+    Map map = {{0, 0, 0, 0, 0, 0, 0}, //
+               {0, 0, 0, 1, 0, 0, 0}, //
+               {0, 0, 0, 1, 0, 0, 0}, //
+               {0, 0, 0, 1, 0, 0, 0}, //
+               {0, 0, 0, 1, 0, 0, 0}};
+
+    FAWorld::LevelImplStub level(map);
+    FAWorld::LevelNavigation navigation(level);
+
+    Point start(0, 4);
+    Point target(6, 4);
+
+    Points path;
+    ASSERT_TRUE(navigation.findFlowFieldPath(nullptr, start, target, path));
+    ASSERT_GE(path.size(), 2u);
+    EXPECT_EQ(path.front(), start);
+    EXPECT_TRUE(isAdjacent(path.back(), target));
+
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        EXPECT_TRUE(isAdjacent(path[i - 1], path[i]));
+        EXPECT_TRUE(level.isPassableStatic(path[i]));
+    }
+
+    // Path goes over the top of the wall
+    EXPECT_NE(std::find(path.begin(), path.end(), Point(3, 0)), path.end());
+
+    const std::vector<int32_t>& distances = navigation.getFlowField(target);
+    EXPECT_EQ(distances[target.x + target.y * 7], 0);
+    EXPECT_EQ(distances[3 + 2 * 7], FAWorld::LevelNavigation::Unreachable);
+
+    // Unreachable targets produce no path
+    FAWorld::LevelImplStub walledLevel(twoRoomsMap());
+    FAWorld::LevelNavigation walledNavigation(walledLevel);
+    EXPECT_FALSE(walledNavigation.findFlowFieldPath(nullptr, {0, 0}, {6, 0}, path));
+    EXPECT_TRUE(path.empty());
+}
+
+TEST(LevelNavigationTests, flowFieldPathAvoidsActors)
+{
+    Map map(5, std::vector<int>(9, 0));
+
+    FAWorld::LevelImplStub level(map);
+    FAWorld::LevelNavigation navigation(level);
+
+    Point start(0, 2);
+    Point target(8, 2);
+
+    Points freePath;
+    ASSERT_TRUE(navigation.findFlowFieldPath(nullptr, start, target, freePath));
+
+    // Block the middle of the unobstructed path, well past the first step
+    Point blocked = freePath[freePath.size() / 2];
+    level.occupied.push_back(blocked);
+
+    Points path;
+    ASSERT_TRUE(navigation.findFlowFieldPath(nullptr, start, target, path));
+    EXPECT_EQ(std::find(path.begin(), path.end(), blocked), path.end());
+    EXPECT_TRUE(isAdjacent(path.back(), target));
+
+    // With a whole column occupied there is no free downhill step past it, so the caller has to fall back to a full search
+    for (int32_t y = 0; y < 5; y++)
+        level.occupied.push_back(Point(4, y));
+
+    EXPECT_FALSE(navigation.findFlowFieldPath(nullptr, start, target, path));
+    EXPECT_TRUE(path.empty());
+}
+
+TEST(LevelNavigationTests, flowFieldPathDoesNotDependOnExpansion)
+{
+    std::mt19937 random(1234);
+
+    Map map(24, std::vector<int>(24, 0));
+    for (auto& row : map)
+    {
+        for (auto& tile : row)
+            tile = (random() % 100) < 25 ? 1 : 0;
+    }
+
+    FAWorld::LevelImplStub level(map);
+    Point target(12, 12);
+
+    // One navigation only expands its field as far as each query needs, the other has it fully built up front
+    FAWorld::LevelNavigation lazyNavigation(level);
+    FAWorld::LevelNavigation fullNavigation(level);
+    fullNavigation.getFlowField(target);
+
+    for (int32_t i = 0; i < 100; i++)
+    {
+        Point start(random() % 24, random() % 24);
+
+        Points lazyPath;
+        Points fullPath;
+        bool lazyFound = lazyNavigation.findFlowFieldPath(nullptr, start, target, lazyPath);
+        bool fullFound = fullNavigation.findFlowFieldPath(nullptr, start, target, fullPath);
+
+        EXPECT_EQ(lazyFound, fullFound);
+        EXPECT_EQ(lazyPath, fullPath);
+    }
+}
@@ -0,0 +1,63 @@
+#include <Image/indexedimage.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+    std::vector<ByteColour> makeColours(int32_t count)
+    {
+        std::vector<ByteColour> colours;
+        for (int32_t i = 0; i < count; i++)
+            colours.emplace_back(uint8_t(i), uint8_t(i / 2), 7, true);
+        return colours;
+    }
+}
+
+TEST(IndexedPalette, DuplicateColoursShareAnIndex)
+{
+    std::vector<ByteColour> colours = makeColours(256);
+    colours[200] = colours[100];
+
+    // Index 0 is kept for transparency, so 255 unique colours is as many as fit
+    std::optional<IndexedPalette> palette = IndexedPalette::create(colours.data(), colours.size());
+    ASSERT_TRUE(palette.has_value());
+    EXPECT_EQ(palette->colours()[0].a, 0);
+    EXPECT_EQ(palette->colours()[1].r, 0);
+    EXPECT_EQ(palette->colours()[1].a, 255);
+    EXPECT_EQ(palette->colours()[255].r, 255);
+
+    colours[200] = ByteColour(1, 2, 3, true);
+    EXPECT_FALSE(IndexedPalette::create(colours.data(), colours.size()).has_value());
+}
+
+TEST(IndexedPalette, ImagesRoundTripThroughIndices)
+{
+    std::vector<ByteColour> colours = makeColours(16);
+    std::optional<IndexedPalette> palette = IndexedPalette::create(colours.data(), colours.size());
+    ASSERT_TRUE(palette.has_value());
+
+    Image image(3, 2);
+    image.get(0, 0) = colours[5];
+    image.get(1, 0) = colours[5];
+    image.get(2, 1) = colours[15];
+    image.get(1, 1) = ByteColour(0, 255, 0, false); // transparent pixels all become index 0, whatever their colour
+
+    std::optional<IndexedImage> indexed = palette->index(image);
+    ASSERT_TRUE(indexed.has_value());
+    EXPECT_EQ(indexed->get(0, 0), 6);
+    EXPECT_EQ(indexed->get(1, 0), 6);
+    EXPECT_EQ(indexed->get(2, 1), 16);
+    EXPECT_EQ(indexed->get(1, 1), 0);
+
+    Image expanded = indexed->toImage(*palette);
+    EXPECT_EQ(expanded.get(2, 1).r, 15);
+    EXPECT_EQ(expanded.get(2, 1).a, 255);
+    EXPECT_EQ(expanded.get(1, 1).a, 0);
+
+    // Colours outside the palette, and partial transparency, can't be indexed
+    image.get(0, 1) = ByteColour(200, 200, 200, true);
+    EXPECT_FALSE(palette->index(image).has_value());
+
+    image.get(0, 1) = colours[3];
+    image.get(0, 1).a = 128;
+    EXPECT_FALSE(palette->index(image).has_value());
+}
@@ -0,0 +1,55 @@
+#include <farender/levelrenderer.h>
+#include <gtest/gtest.h>
+
+using namespace FARender;
+
+static LevelObject makeObject(int32_t spriteFrame)
+{
+    LevelObject object;
+    object.valid = true;
+    object.spriteFrame = spriteFrame;
+    return object;
+}
+
+static std::vector<int32_t> getFrames(const LevelObjects& objects, Misc::Point tile)
+{
+    std::vector<int32_t> frames;
+    for (const auto& object : objects.get(tile))
+        frames.push_back(object.spriteFrame);
+    return frames;
+}
+
+TEST(LevelObjects, ObjectsAreBucketedByTileInOrder)
+{
+    LevelObjects objects;
+    objects.add({5, 7}, makeObject(1));
+    objects.add({6, 7}, makeObject(2));
+    objects.add({5, 7}, makeObject(3));
+    objects.add({4, 8}, makeObject(4));
+    objects.buildIndex({4, 6}, {6, 8});
+
+    EXPECT_EQ(getFrames(objects, {5, 7}), std::vector<int32_t>({1, 3}));
+    EXPECT_EQ(getFrames(objects, {6, 7}), std::vector<int32_t>({2}));
+    EXPECT_EQ(getFrames(objects, {4, 8}), std::vector<int32_t>({4}));
+    EXPECT_TRUE(objects.get({4, 6}).empty());
+}
+
+TEST(LevelObjects, OnlyTilesInTheIndexedAreaAreFound)
+{
+    LevelObjects objects;
+    objects.add({0, 0}, makeObject(1));
+    objects.add({100, 100}, makeObject(2));
+    objects.add({10, 10}, makeObject(3));
+    objects.buildIndex({5, 5}, {20, 20});
+
+    EXPECT_TRUE(objects.get({0, 0}).empty());
+    EXPECT_TRUE(objects.get({100, 100}).empty());
+    EXPECT_EQ(getFrames(objects, {10, 10}), std::vector<int32_t>({3}));
+
+    objects.clear();
+    objects.add({0, 0}, makeObject(4));
+    objects.buildIndex({0, 0}, {1, 1});
+
+    EXPECT_EQ(getFrames(objects, {0, 0}), std::vector<int32_t>({4}));
+    EXPECT_TRUE(objects.get({10, 10}).empty());
+}
@@ -0,0 +1,204 @@
+#include <engine/debugsettings.h>
+#include <engine/net/netcommon.h>
+#include <functional>
+#include <gtest/gtest.h>
+#include <limits>
+#include <serial/binarystream.h>
+#include <serial/loader.h>
+#include <serial/streamformat.h>
+
+using namespace Engine;
+
+TEST(InputsPacket, RoundTrip)
+{
+    std::map<FAWorld::Tick, std::string> encodedTicks;
+    for (FAWorld::Tick tick = 10; tick < 30; tick++)
+        encodedTicks[tick] = InputsPacket::encodeTick({});
+
+    encodedTicks[15] = InputsPacket::encodeTick({FAWorld::PlayerInput(FAWorld::PlayerInput::TargetTileData{3, 4}, 7)});
+    encodedTicks[16] = InputsPacket::encodeTick({FAWorld::PlayerInput(FAWorld::PlayerInput::TargetActorData{9}, 7),
+                                                 FAWorld::PlayerInput(FAWorld::PlayerInput::TargetTileData{5, 6}, 8)});
+
+    // Includes a gap, which must not be merged into the surrounding empty ranges
+    std::vector<FAWorld::Tick> ticks = {10, 11, 12, 13, 14, 15, 16, 17, 18, 20, 21, 29};
+
+    Serial::BinaryWriteStream writeStream;
+    {
+        Serial::Saver saver(writeStream);
+        InputsPacket::write(saver, ticks, encodedTicks);
+    }
+
+    auto data = writeStream.getData();
+    Serial::BinaryReadStream readStream(data.first, data.second);
+    Serial::Loader loader(readStream);
+
+    std::vector<FAWorld::Tick> readTicks;
+    InputsPacket::read(loader, [&](FAWorld::Tick tick, const std::string& encoded) {
+        readTicks.push_back(tick);
+
+        std::vector<FAWorld::PlayerInput> inputs;
+        InputsPacket::decodeTick(encoded, inputs);
+
+        if (tick == 15)
+        {
+            ASSERT_EQ(inputs.size(), 1u);
+            EXPECT_EQ(inputs[0].mType, FAWorld::PlayerInput::Type::TargetTile);
+            EXPECT_EQ(inputs[0].mData.dataTargetTile.x, 3);
+            EXPECT_EQ(inputs[0].mData.dataTargetTile.y, 4);
+            EXPECT_EQ(inputs[0].mActorId, 7);
+        }
+        else if (tick == 16)
+        {
+            ASSERT_EQ(inputs.size(), 2u);
+            EXPECT_EQ(inputs[0].mType, FAWorld::PlayerInput::Type::TargetActor);
+            EXPECT_EQ(inputs[0].mData.dataTargetActor.actorId, 9);
+            EXPECT_EQ(inputs[1].mActorId, 8);
+        }
+        else
+        {
+            EXPECT_TRUE(inputs.empty());
+        }
+    });
+
+    EXPECT_EQ(readTicks, ticks);
+}
+
+TEST(InputsPacket, EmptyTicksAreCheap)
+{
+    std::map<FAWorld::Tick, std::string> encodedTicks;
+    std::vector<FAWorld::Tick> ticks;
+    for (FAWorld::Tick tick = 1000; tick < 1100; tick++)
+    {
+        encodedTicks[tick] = InputsPacket::encodeTick({});
+        ticks.push_back(tick);
+    }
+
+    Serial::BinaryWriteStream writeStream;
+    {
+        Serial::Saver saver(writeStream);
+        InputsPacket::write(saver, ticks, encodedTicks);
+    }
+
+    // 100 empty ticks should collapse into a single range entry, leaving room for the stream header and end entry
+    EXPECT_LT(writeStream.getCurrentSize(), 2 * InputsPacket::maxEntrySize({}, Serial::StreamFormat::Binary));
+}
+
+TEST(InputsPacket, MaxEntrySizeIsAnUpperBound)
+{
+    for (Serial::StreamFormat format : {Serial::StreamFormat::Binary, Serial::StreamFormat::Text})
+    {
+        auto measure = [&](const std::function<void(Serial::Saver&)>& writeEntry) {
+            std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(format);
+            Serial::Saver saver(*stream);
+
+            size_t start = stream->getCurrentSize();
+            writeEntry(saver);
+            return stream->getCurrentSize() - start;
+        };
+
+        for (FAWorld::Tick tick : {FAWorld::Tick(0), FAWorld::Tick(1234567890), std::numeric_limits<FAWorld::Tick>::min()})
+        {
+            for (const std::string& encoded : {std::string(), std::string(5, 'a'), std::string(300, 'b')})
+            {
+                size_t bound = InputsPacket::maxEntrySize(encoded, format);
+
+                EXPECT_LE(measure([&](Serial::Saver& saver) {
+                              saver.save(uint8_t(255));
+                              saver.save(tick);
+                              saver.save(encoded);
+                          }),
+                          bound);
+
+                if (encoded.empty())
+                {
+                    EXPECT_LE(measure([&](Serial::Saver& saver) {
+                                  saver.save(uint8_t(255));
+                                  saver.save(tick);
+                                  saver.save(std::numeric_limits<uint32_t>::max());
+                              }),
+                              bound);
+                }
+            }
+        }
+    }
+}
+
+TEST(InputsPacket, FilledPacketsFitInEveryStreamFormat)
+{
+    for (Serial::StreamFormat format : {Serial::StreamFormat::Binary, Serial::StreamFormat::Text})
+    {
+        // Ticks are encoded in the network stream format, the same as the server does it
+        Serial::StreamFormat oldFormat = DebugSettings::NetworkStreamFormat;
+        DebugSettings::NetworkStreamFormat = format;
+
+        // Big tick numbers, as the text format writes them out as digits
+        std::map<FAWorld::Tick, std::string> encodedTicks;
+        for (FAWorld::Tick tick = 1234567890; tick < 1234567890 + 200; tick++)
+        {
+            if (tick % 3 == 0)
+                encodedTicks[tick] = InputsPacket::encodeTick({});
+            else
+                encodedTicks[tick] = InputsPacket::encodeTick({FAWorld::PlayerInput(FAWorld::PlayerInput::TargetTileData{100, 200}, int32_t(tick % 8))});
+        }
+
+        DebugSettings::NetworkStreamFormat = oldFormat;
+
+        // Add ticks until the next one doesn't fit, like Server::sendInputsToClients
+        std::vector<FAWorld::Tick> ticks;
+        size_t packetSize = InputsPacket::PACKET_START_PADDING;
+        for (const auto& [tick, encoded] : encodedTicks)
+        {
+            size_t entrySize = InputsPacket::maxEntrySize(encoded, format);
+            if (packetSize + entrySize > InputsPacket::MAX_PACKET_SIZE)
+                break;
+
+            packetSize += entrySize;
+            ticks.push_back(tick);
+        }
+
+        std::unique_ptr<Serial::WriteStreamInterface> stream = Serial::createWriteStream(format);
+        {
+            Serial::Saver saver(*stream);
+            saver.save(uint8_t(255));
+            saver.save(std::numeric_limits<uint32_t>::max());
+            InputsPacket::write(saver, ticks, encodedTicks);
+        }
+
+        EXPECT_GT(ticks.size(), 1u);
+        EXPECT_LT(ticks.size(), encodedTicks.size());
+        EXPECT_LE(stream->getData().second, InputsPacket::MAX_PACKET_SIZE) << "format " << int32_t(format);
+    }
+}
+
+TEST(InputsPacket, CopiesForPacketLoss)
+{
+    EXPECT_EQ(InputsPacket::copiesForPacketLoss(0.0), 1);
+    EXPECT_EQ(InputsPacket::copiesForPacketLoss(0.005), 1);
+    EXPECT_EQ(InputsPacket::copiesForPacketLoss(0.05), 2);
+    EXPECT_EQ(InputsPacket::copiesForPacketLoss(0.2), 3);
+    EXPECT_EQ(InputsPacket::copiesForPacketLoss(0.9), InputsPacket::MAX_COPIES);
+    EXPECT_EQ(InputsPacket::copiesForPacketLoss(1.0), InputsPacket::MAX_COPIES);
+}
+
+TEST(MapStream, FragmentedRoundTrip)
+{
+    std::string original;
+    for (int32_t i = 0; i < 100000; i++)
+        original += std::to_string(i % 1000) + ",";
+
+    std::string compressed = MapStream::compress(reinterpret_cast<const uint8_t*>(original.data()), original.size());
+    EXPECT_LT(compressed.size(), original.size() / 4);
+
+    // Smaller than the real fragments, so we get plenty of them
+    constexpr size_t fragmentSize = 1000;
+
+    MapStream::Decompressor decompressor(original.size());
+    for (size_t offset = 0; offset < compressed.size(); offset += fragmentSize)
+    {
+        EXPECT_FALSE(decompressor.isDone());
+        decompressor.addFragment(compressed.substr(offset, fragmentSize));
+    }
+
+    EXPECT_TRUE(decompressor.isDone());
+    EXPECT_EQ(decompressor.getData(), original);
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <misc/statehash.h>
 #include <random/random.h>
 #include <serial/textstream.h>
 
@@ -98,3 +99,27 @@ TEST(Random, TestSaveLoadRng)
     int32_t val = random.randomInRange(0, std::numeric_limits<int32_t>::max());
     ASSERT_EQ(val, 481516916);
 }
+
+TEST(Random, TestHashState)
+{
+    auto hash = [](const Random::Rng& rng) {
+        Misc::StateHasher hasher;
+        rng.hashState(hasher);
+        return hasher.getHash();
+    };
+
+    Random::RngMersenneTwister a(1234);
+    Random::RngMersenneTwister b(1234);
+    Random::RngMersenneTwister c(4321);
+
+    ASSERT_EQ(hash(a), hash(b));
+    ASSERT_NE(hash(a), hash(c));
+
+    // Hashing must not advance the generator
+    int32_t fromA = a.randomInRange(0, 1000);
+    ASSERT_EQ(fromA, b.randomInRange(0, 1000));
+    ASSERT_EQ(hash(a), hash(b));
+
+    a.randomInRange(0, 1000);
+    ASSERT_NE(hash(a), hash(b));
+}
@@ -0,0 +1,61 @@
+#include <farender/renderer.h>
+#include <gtest/gtest.h>
+
+using namespace FARender;
+using Clock = std::chrono::steady_clock;
+
+static ObjectToRender makeObject(const void* key, Vec2Fix position)
+{
+    ObjectToRender object;
+    object.position = FAWorld::Position(position);
+    object.interpolationKey = key;
+    return object;
+}
+
+TEST(RenderInterpolator, ObjectsMoveSmoothlyBetweenStates)
+{
+    int32_t a = 0;
+    int32_t b = 0;
+
+    RenderInterpolator interpolator;
+    Clock::time_point start = Clock::now();
+    Clock::duration tick = std::chrono::milliseconds(16);
+
+    interpolator.update(start, Vec2Fix(10, 10), {makeObject(&a, Vec2Fix(5, 5))}, start);
+
+    // Only one state so far, nothing to interpolate from
+    EXPECT_TRUE(interpolator.getPosition(makeObject(&a, Vec2Fix(5, 5))) == Vec2Fix(5, 5));
+    EXPECT_TRUE(interpolator.getCameraPosition() == Vec2Fix(10, 10));
+
+    std::vector<ObjectToRender> objects = {makeObject(&a, Vec2Fix(6, 5)), makeObject(&b, Vec2Fix(1, 1)), makeObject(nullptr, Vec2Fix(3, 3))};
+    interpolator.update(start + tick, Vec2Fix(11, 10), objects, start + tick + tick / 4);
+
+    EXPECT_TRUE(interpolator.getAlpha() == FixedPoint("0.25"));
+    EXPECT_TRUE(interpolator.getPosition(objects[0]) == Vec2Fix(FixedPoint("5.25"), FixedPoint(5)));
+    EXPECT_TRUE(interpolator.getCameraPosition() == Vec2Fix(FixedPoint("10.25"), FixedPoint(10)));
+
+    // New objects and objects without a key are drawn where they are
+    EXPECT_TRUE(interpolator.getPosition(objects[1]) == Vec2Fix(1, 1));
+    EXPECT_TRUE(interpolator.getPosition(objects[2]) == Vec2Fix(3, 3));
+
+    // Never extrapolate past the current state
+    interpolator.update(start + tick, Vec2Fix(11, 10), objects, start + tick * 3);
+    EXPECT_TRUE(interpolator.getPosition(objects[0]) == Vec2Fix(6, 5));
+}
+
+TEST(RenderInterpolator, TeleportsAreNotInterpolated)
+{
+    int32_t a = 0;
+
+    RenderInterpolator interpolator;
+    Clock::time_point start = Clock::now();
+    Clock::duration tick = std::chrono::milliseconds(16);
+
+    interpolator.update(start, Vec2Fix(10, 10), {makeObject(&a, Vec2Fix(5, 5))}, start);
+
+    std::vector<ObjectToRender> objects = {makeObject(&a, Vec2Fix(50, 5))};
+    interpolator.update(start + tick, Vec2Fix(70, 10), objects, start + tick + tick / 2);
+
+    EXPECT_TRUE(interpolator.getPosition(objects[0]) == Vec2Fix(50, 5));
+    EXPECT_TRUE(interpolator.getCameraPosition() == Vec2Fix(70, 10));
+}
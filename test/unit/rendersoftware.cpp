@@ -0,0 +1,325 @@
+#include <gtest/gtest.h>
+#include <render/Software/renderinstancesoftware.h>
+#include <render/buffer.h>
+#include <render/commandqueue.h>
+#include <render/descriptorset.h>
+#include <render/pipeline.h>
+#include <render/texture.h>
+#include <render/vertexarrayobject.h>
+#include <render/vertextypes.h>
+
+using namespace Render;
+
+namespace
+{
+    struct SpriteUniforms
+    {
+        float screenSizeInPixels[2];
+        float offsetInPixels[2];
+        float atlasSizeInPixels[2];
+        float pad2[2];
+    };
+
+    // Draws level sprites the same way LevelRenderer does, through the basic.frag pipeline
+    class SpriteDrawer
+    {
+    public:
+        SpriteDrawer(
+            RenderInstance& instance, Texture& atlas, int32_t width, int32_t height, int32_t offsetX = 0, int32_t offsetY = 0, Texture* palette = nullptr)
+        {
+            PipelineSpec spec;
+            spec.depthTest = true;
+            spec.vertexLayouts = {SpriteVertexMain::layout(), SpriteVertexPerInstance::layout()};
+            spec.vertexShaderPath = "shaders/basic.vert";
+            spec.fragmentShaderPath = "shaders/basic.frag";
+            spec.descriptorSetSpec = {{
+                {DescriptorType::UniformBuffer, "vertexUniforms"},
+                {DescriptorType::UniformBuffer, "fragmentUniforms"},
+                {DescriptorType::Texture, "tex"},
+            }};
+            if (palette)
+                spec.descriptorSetSpec.items.push_back({DescriptorType::Texture, "palette"});
+
+            mPipeline = instance.createPipeline(spec);
+            mVao = instance.createVertexArrayObject({0, 0}, spec.vertexLayouts, 0);
+            mUniformBuffer = instance.createBuffer(sizeof(SpriteUniforms));
+            mDescriptorSet = instance.createDescriptorSet(spec.descriptorSetSpec);
+
+            SpriteUniforms uniforms = {{float(width), float(height)}, {float(offsetX), float(offsetY)}, {float(atlas.width()), float(atlas.height())}, {}};
+            mUniformBuffer->setData(&uniforms, sizeof(uniforms));
+
+            mDescriptorSet->updateItems({
+                {0, BufferSlice{mUniformBuffer.get(), 0, sizeof(float) * 4}},
+                {1, BufferSlice{mUniformBuffer.get(), sizeof(float) * 4, sizeof(float) * 4}},
+                {2, &atlas},
+            });
+            if (palette)
+                mDescriptorSet->updateItems({{3, palette}});
+
+            SpriteVertexMain baseVertices[] = {{{0, 0}, {0, 0}}, {{1, 0}, {1, 0}}, {{1, 1}, {1, 1}}, {{0, 0}, {0, 0}}, {{1, 1}, {1, 1}}, {{0, 1}, {0, 1}}};
+            mVao->getVertexBuffer(0)->setData(baseVertices, sizeof(baseVertices));
+        }
+
+        void draw(CommandQueue& commandQueue, std::vector<SpriteVertexPerInstance> instances)
+        {
+            mVao->getVertexBuffer(1)->setData(instances.data(), instances.size() * sizeof(SpriteVertexPerInstance));
+
+            Bindings bindings;
+            bindings.pipeline = mPipeline.get();
+            bindings.vao = mVao.get();
+            bindings.descriptorSet = mDescriptorSet.get();
+
+            commandQueue.cmdDrawInstances(0, 6, instances.size(), bindings);
+        }
+
+    private:
+        std::unique_ptr<Pipeline> mPipeline;
+        std::unique_ptr<VertexArrayObject> mVao;
+        std::unique_ptr<Buffer> mUniformBuffer;
+        std::unique_ptr<DescriptorSet> mDescriptorSet;
+    };
+
+    SpriteVertexPerInstance makeSprite(int16_t x, int16_t y, uint16_t size, uint16_t atlasX, float z)
+    {
+        SpriteVertexPerInstance sprite = {};
+        sprite.v_zValue = z;
+        sprite.v_spriteSizeInPixels[0] = size;
+        sprite.v_spriteSizeInPixels[1] = size;
+        sprite.v_destinationInPixels[0] = x;
+        sprite.v_destinationInPixels[1] = y;
+        sprite.v_atlasOffsetInPixels[0] = atlasX;
+        sprite.v_atlasOffsetInPixels[1] = 0;
+        sprite.v_paletteRow = -1;
+        return sprite;
+    }
+
+    // An atlas holding two 8x8 sprites side by side: opaque red with a transparent top left texel, and opaque green
+    std::unique_ptr<Texture> createAtlas(RenderInstance& instance)
+    {
+        BaseTextureInfo info;
+        info.width = 16;
+        info.height = 8;
+        info.minFilter = Filter::Nearest;
+        info.magFilter = Filter::Nearest;
+        std::unique_ptr<Texture> atlas = instance.createTexture(info);
+
+        std::vector<uint8_t> data(16 * 8 * 4);
+        for (int32_t y = 0; y < 8; y++)
+        {
+            for (int32_t x = 0; x < 16; x++)
+            {
+                uint8_t* texel = &data[(y * 16 + x) * 4];
+                texel[0] = x < 8 ? 255 : 0;
+                texel[1] = x < 8 ? 0 : 255;
+                texel[3] = (x == 0 && y == 0) ? 0 : 255;
+            }
+        }
+
+        atlas->updateImageData(0, 0, 0, 16, 8, data.data(), 16);
+        return atlas;
+    }
+}
+
+TEST(RenderSoftware, SpritesUseExplicitDepthAndSkipTransparentTexels)
+{
+    RenderInstanceSoftware instance(32, 32, 0);
+    std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+    std::unique_ptr<Texture> atlas = createAtlas(instance);
+    SpriteDrawer drawer(instance, *atlas, 32, 32);
+
+    commandQueue->begin();
+    commandQueue->cmdClearFramebuffer(Colors::blue, true);
+
+    // The red sprite is submitted last, but is behind the green one
+    drawer.draw(*commandQueue, {makeSprite(4, 4, 8, 8, 0.25f), makeSprite(8, 8, 8, 0, 0.5f)});
+
+    Image frame = instance.captureFrame();
+
+    auto isColor = [&](int32_t x, int32_t y, uint8_t r, uint8_t g, uint8_t b) {
+        const ByteColour& pixel = frame.get(x, y);
+        return pixel.r == r && pixel.g == g && pixel.b == b && pixel.a == 255;
+    };
+
+    EXPECT_TRUE(isColor(0, 0, 0, 0, 255));
+    EXPECT_TRUE(isColor(4, 4, 0, 255, 0));
+    EXPECT_TRUE(isColor(11, 11, 0, 255, 0));
+    EXPECT_TRUE(isColor(12, 12, 255, 0, 0));
+    EXPECT_TRUE(isColor(15, 15, 255, 0, 0));
+    EXPECT_TRUE(isColor(16, 16, 0, 0, 255));
+
+    // The transparent texel of the red sprite leaves the background alone
+    drawer.draw(*commandQueue, {makeSprite(20, 20, 8, 0, 0.1f)});
+    commandQueue->end();
+
+    frame = instance.captureFrame();
+    EXPECT_TRUE(isColor(20, 20, 0, 0, 255));
+    EXPECT_TRUE(isColor(21, 20, 255, 0, 0));
+}
+
+TEST(RenderSoftware, SpritesAreMovedByTheOffsetUniform)
+{
+    RenderInstanceSoftware instance(32, 32, 0);
+    std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+    std::unique_ptr<Texture> atlas = createAtlas(instance);
+    SpriteDrawer drawer(instance, *atlas, 32, 32, 10, -90);
+
+    commandQueue->begin();
+    commandQueue->cmdClearFramebuffer(Colors::black, true);
+    drawer.draw(*commandQueue, {makeSprite(0, 100, 8, 8, 0.5f)});
+    commandQueue->end();
+
+    Image frame = instance.captureFrame();
+    EXPECT_EQ(frame.get(9, 10).g, 0);
+    EXPECT_EQ(frame.get(10, 10).g, 255);
+    EXPECT_EQ(frame.get(17, 17).g, 255);
+    EXPECT_EQ(frame.get(18, 17).g, 0);
+}
+
+TEST(RenderSoftware, IndexedSpritesAreDrawnThroughTheirPaletteRow)
+{
+    RenderInstanceSoftware instance(32, 32, 0);
+    std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+
+    // An 8x8 sprite of index 1, with a transparent (index 0) top left texel
+    BaseTextureInfo info;
+    info.width = 8;
+    info.height = 8;
+    info.format = Format::R8UNorm;
+    std::unique_ptr<Texture> atlas = instance.createTexture(info);
+
+    std::vector<uint8_t> indices(8 * 8, 1);
+    indices[0] = 0;
+    atlas->updateImageData(0, 0, 0, 8, 8, indices.data(), 8);
+
+    // Index 1 is red in the first palette and green in the second
+    info.width = 256;
+    info.height = 2;
+    info.format = Format::RGBA8UNorm;
+    std::unique_ptr<Texture> palette = instance.createTexture(info);
+
+    std::vector<ByteColour> colours(256 * 2);
+    colours[1] = ByteColour(255, 0, 0, true);
+    colours[256 + 1] = ByteColour(0, 255, 0, true);
+    palette->updateImageData(0, 0, 0, 256, 2, reinterpret_cast<const uint8_t*>(colours.data()), 256);
+
+    SpriteDrawer drawer(instance, *atlas, 32, 32, 0, 0, palette.get());
+
+    SpriteVertexPerInstance red = makeSprite(0, 0, 8, 0, 0.5f);
+    red.v_paletteRow = 0;
+    SpriteVertexPerInstance green = makeSprite(16, 16, 8, 0, 0.5f);
+    green.v_paletteRow = 1;
+
+    commandQueue->begin();
+    commandQueue->cmdClearFramebuffer(Colors::blue, true);
+    drawer.draw(*commandQueue, {red, green});
+    commandQueue->end();
+
+    Image frame = instance.captureFrame();
+    EXPECT_EQ(frame.get(0, 0).b, 255);
+    EXPECT_EQ(frame.get(1, 0).r, 255);
+    EXPECT_EQ(frame.get(7, 7).r, 255);
+    EXPECT_EQ(frame.get(16, 16).b, 255);
+    EXPECT_EQ(frame.get(17, 16).g, 255);
+    EXPECT_EQ(frame.get(23, 23).g, 255);
+    EXPECT_EQ(frame.get(23, 23).r, 0);
+}
+
+TEST(RenderSoftware, PendingTextureDataIsProvidedWhenFirstDrawn)
+{
+    RenderInstanceSoftware instance(32, 32, 0);
+    std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+
+    BaseTextureInfo info;
+    info.width = 16;
+    info.height = 8;
+    std::unique_ptr<Texture> atlas = instance.createTexture(info);
+
+    int32_t provided = 0;
+    atlas->setPendingData([&](Texture& texture) {
+        provided++;
+        std::unique_ptr<Texture> data = createAtlas(instance);
+
+        std::vector<uint8_t> pixels(16 * 8 * 4);
+        data->readImageData(pixels.data());
+        texture.updateImageData(0, 0, 0, 16, 8, pixels.data(), 16);
+    });
+
+    SpriteDrawer drawer(instance, *atlas, 32, 32);
+    EXPECT_EQ(provided, 0);
+
+    commandQueue->begin();
+    commandQueue->cmdClearFramebuffer(Colors::black, true);
+    drawer.draw(*commandQueue, {makeSprite(0, 0, 8, 8, 0.5f)});
+    drawer.draw(*commandQueue, {makeSprite(8, 8, 8, 8, 0.5f)});
+    commandQueue->end();
+
+    EXPECT_EQ(provided, 1);
+    EXPECT_FALSE(atlas->hasPendingData());
+
+    Image frame = instance.captureFrame();
+    EXPECT_EQ(frame.get(4, 4).g, 255);
+    EXPECT_EQ(frame.get(12, 12).g, 255);
+}
+
+TEST(RenderSoftware, TiledRenderingMatchesSingleThreaded)
+{
+    auto render = [](size_t workerThreads) {
+        RenderInstanceSoftware instance(300, 200, workerThreads);
+        std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+        std::unique_ptr<Texture> atlas = createAtlas(instance);
+        SpriteDrawer drawer(instance, *atlas, 300, 200);
+
+        std::vector<SpriteVertexPerInstance> sprites;
+        for (int32_t i = 0; i < 2000; i++)
+            sprites.push_back(makeSprite(int16_t((i * 37) % 310 - 5), int16_t((i * 53) % 210 - 5), 8, uint16_t((i % 2) * 8), 1.0f - (i + 1) / 2002.0f));
+
+        commandQueue->begin();
+        commandQueue->cmdClearFramebuffer(Colors::black, true);
+        drawer.draw(*commandQueue, sprites);
+        commandQueue->end();
+
+        return instance.captureFrame();
+    };
+
+    Image serial = render(0);
+    Image parallel = render(3);
+
+    ASSERT_EQ(serial.width(), parallel.width());
+    ASSERT_EQ(serial.height(), parallel.height());
+    EXPECT_EQ(0, memcmp(&serial.get(0, 0), &parallel.get(0, 0), size_t(serial.width()) * size_t(serial.height()) * sizeof(ByteColour)));
+}
+
+TEST(RenderSoftware, SharedTriangleEdgesAreDrawnOnce)
+{
+    RenderInstanceSoftware instance(40, 30, 2);
+    std::unique_ptr<CommandQueue> commandQueue = instance.createCommandQueue();
+
+    PipelineSpec spec;
+    spec.vertexLayouts = {DebugVertex::layout()};
+    spec.vertexShaderPath = "shaders/debug.vert";
+    spec.fragmentShaderPath = "shaders/debug.frag";
+    std::unique_ptr<Pipeline> pipeline = instance.createPipeline(spec);
+    std::unique_ptr<VertexArrayObject> vao = instance.createVertexArrayObject({0}, spec.vertexLayouts, 0);
+
+    // A half transparent quad made of two triangles, with the diagonal shared
+    DebugVertex topLeft{{0, 0}, {1, 1, 1, 0.5f}};
+    DebugVertex topRight{{1, 0}, {1, 1, 1, 0.5f}};
+    DebugVertex bottomLeft{{0, 1}, {1, 1, 1, 0.5f}};
+    DebugVertex bottomRight{{1, 1}, {1, 1, 1, 0.5f}};
+    DebugVertex vertices[] = {topLeft, topRight, bottomLeft, topRight, bottomRight, bottomLeft};
+    vao->getVertexBuffer(0)->setData(vertices, sizeof(vertices));
+
+    Bindings bindings;
+    bindings.pipeline = pipeline.get();
+    bindings.vao = vao.get();
+
+    commandQueue->begin();
+    commandQueue->cmdClearFramebuffer(Colors::black, true);
+    commandQueue->cmdDraw(0, 6, bindings);
+    commandQueue->end();
+
+    // Drawn once is 50% grey, twice would be 75%
+    Image frame = instance.captureFrame();
+    for (const ByteColour& pixel : frame)
+        ASSERT_NEAR(pixel.r, 128, 1);
+}
@@ -0,0 +1,97 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <limits>
+#include <serial/binarystream.h>
+#include <serial/loader.h>
+#include <serial/streamformat.h>
+#include <serial/textstream.h>
+
+static std::string roundTripData(Serial::WriteStreamInterface& stream)
+{
+    {
+        Serial::Saver saver(stream);
+        Serial::ScopedCategorySaver category("Test", saver);
+
+        saver.save(true);
+        saver.save(false);
+        saver.save(std::numeric_limits<int64_t>::min());
+        saver.save(std::numeric_limits<uint64_t>::max());
+        saver.save(int32_t(-123456));
+        saver.save(uint32_t(123456));
+        saver.save(int16_t(-300));
+        saver.save(uint16_t(65535));
+        saver.save(int8_t(-128));
+        saver.save(uint8_t(255));
+        saver.save(std::string("hello\nworld"));
+        saver.save(std::string());
+    }
+
+    auto data = stream.getData();
+    return std::string(reinterpret_cast<const char*>(data.first), data.second);
+}
+
+static void checkRoundTripData(Serial::ReadStreamInterface& stream)
+{
+    // Like the game's loading code, we don't read the categories back explicitly, the streams should skip them
+    Serial::Loader loader(stream);
+
+    ASSERT_EQ(loader.load<bool>(), true);
+    ASSERT_EQ(loader.load<bool>(), false);
+    ASSERT_EQ(loader.load<int64_t>(), std::numeric_limits<int64_t>::min());
+    ASSERT_EQ(loader.load<uint64_t>(), std::numeric_limits<uint64_t>::max());
+    ASSERT_EQ(loader.load<int32_t>(), -123456);
+    ASSERT_EQ(loader.load<uint32_t>(), 123456u);
+    ASSERT_EQ(loader.load<int16_t>(), -300);
+    ASSERT_EQ(loader.load<uint16_t>(), 65535);
+    ASSERT_EQ(loader.load<int8_t>(), -128);
+    ASSERT_EQ(loader.load<uint8_t>(), 255);
+    ASSERT_EQ(loader.load<std::string>(), "hello\nworld");
+    ASSERT_EQ(loader.load<std::string>(), "");
+}
+
+TEST(Serial, BinaryRoundTrip)
+{
+    Serial::BinaryWriteStream writeStream;
+    std::string data = roundTripData(writeStream);
+
+    Serial::BinaryReadStream readStream(data);
+    checkRoundTripData(readStream);
+}
+
+TEST(Serial, BinarySmallerThanText)
+{
+    Serial::BinaryWriteStream binaryStream;
+    Serial::TextWriteStream textStream;
+
+    ASSERT_LT(roundTripData(binaryStream).size(), roundTripData(textStream).size());
+}
+
+TEST(Serial, DetectFormat)
+{
+    for (Serial::StreamFormat format : {Serial::StreamFormat::Text, Serial::StreamFormat::Binary})
+    {
+        std::unique_ptr<Serial::WriteStreamInterface> writeStream = Serial::createWriteStream(format);
+        std::string data = roundTripData(*writeStream);
+
+        ASSERT_EQ(Serial::detectStreamFormat(data), format);
+
+        std::unique_ptr<Serial::ReadStreamInterface> readStream = Serial::createReadStream(data);
+        checkRoundTripData(*readStream);
+    }
+}
+
+TEST(Serial, ReadFromBorrowedSpan)
+{
+    for (Serial::StreamFormat format : {Serial::StreamFormat::Text, Serial::StreamFormat::Binary})
+    {
+        std::unique_ptr<Serial::WriteStreamInterface> writeStream = Serial::createWriteStream(format);
+        std::string data = roundTripData(*writeStream);
+
+        // Exactly sized heap buffer, so reading past the end of the span would be caught by sanitizers
+        std::unique_ptr<uint8_t[]> buffer(new uint8_t[data.size()]);
+        memcpy(buffer.get(), data.data(), data.size());
+
+        std::unique_ptr<Serial::ReadStreamInterface> readStream = Serial::createReadStream(buffer.get(), data.size());
+        checkRoundTripData(*readStream);
+    }
+}
@@ -0,0 +1,21 @@
+#include <faaudio/soundid.h>
+#include <gtest/gtest.h>
+
+using namespace FAAudio;
+
+TEST(SoundId, InterningTheSamePathGivesTheSameId)
+{
+    SoundId hit = SoundId::intern("monsters/zombie/zombieh1.wav");
+    SoundId die = SoundId::intern("monsters/zombie/zombied1.wav");
+
+    EXPECT_TRUE(hit.isValid());
+    EXPECT_NE(hit, die);
+    EXPECT_EQ(hit, SoundId::intern("monsters/zombie/zombieh1.wav"));
+
+    EXPECT_EQ(hit.path(), "monsters/zombie/zombieh1.wav");
+    EXPECT_EQ(die.path(), "monsters/zombie/zombied1.wav");
+    EXPECT_LT(die.index(), SoundId::count());
+
+    EXPECT_FALSE(SoundId::intern("").isValid());
+    EXPECT_FALSE(SoundId().isValid());
+}
@@ -0,0 +1,22 @@
+#include <gtest/gtest.h>
+#include <level/tilesetdata.h>
+
+using namespace Level;
+
+TEST(TilesetData, LevelsOfTheSameTypeShareOneCopy)
+{
+    std::shared_ptr<const TilesetData> first = TilesetData::get("missing/l1.til", "missing/l1.min", "missing/l1.sol");
+    std::shared_ptr<const TilesetData> second = TilesetData::get("missing/l1.til", "missing/l1.min", "missing/l1.sol");
+    std::shared_ptr<const TilesetData> other = TilesetData::get("missing/l2.til", "missing/l2.min", "missing/l2.sol");
+
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, other);
+
+    // The cache doesn't keep data alive by itself, so it's freed once no level uses it
+    std::weak_ptr<const TilesetData> weak = first;
+    first.reset();
+    second.reset();
+    EXPECT_TRUE(weak.expired());
+
+    EXPECT_EQ(other, TilesetData::get("missing/l2.til", "missing/l2.min", "missing/l2.sol"));
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <misc/triplebuffer.h>
+#include <thread>
+
+TEST(TripleBuffer, ConsumerGetsTheNewestPublishedValue)
+{
+    Misc::TripleBuffer<int32_t> buffer(0);
+    EXPECT_EQ(buffer.acquireLatest(), nullptr);
+
+    buffer.getWriteSlot() = 1;
+    buffer.publish();
+    buffer.getWriteSlot() = 2;
+    buffer.publish();
+
+    ASSERT_NE(buffer.acquireLatest(), nullptr);
+    EXPECT_EQ(*buffer.acquireLatest(), 2);
+
+    // Nothing new published, so the consumer keeps the value it has
+    buffer.getWriteSlot() = 3;
+    EXPECT_EQ(*buffer.acquireLatest(), 2);
+
+    buffer.publish();
+    EXPECT_EQ(*buffer.acquireLatest(), 3);
+}
+
+TEST(TripleBuffer, SlotsAreNeverSharedBetweenThreads)
+{
+    struct Value
+    {
+        int32_t a = 0;
+        int32_t b = 0;
+    };
+
+    Misc::TripleBuffer<Value> buffer;
+    constexpr int32_t count = 200000;
+
+    std::thread producer([&]() {
+        for (int32_t i = 1; i <= count; i++)
+        {
+            Value& value = buffer.getWriteSlot();
+            value.a = i;
+            value.b = -i;
+            buffer.publish();
+        }
+    });
+
+    int32_t last = 0;
+    while (last != count)
+    {
+        if (const Value* value = buffer.acquireLatest())
+        {
+            ASSERT_EQ(value->a, -value->b);
+            ASSERT_GE(value->a, last);
+            last = value->a;
+        }
+    }
+
+    producer.join();
+}